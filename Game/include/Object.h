@@ -9,11 +9,12 @@ extern "C" {
 // object "virtual" functions
 typedef struct object_t Object;
 typedef void (*ObjDrawFunc)(Object*);
-typedef void (*ObjUpdateFunc)(Object*, uint32_t);
+typedef void (*ObjUpdateFunc)(Object*, Milliseconds);
 
 typedef struct object_vtable_t {
     ObjDrawFunc     draw;
     ObjUpdateFunc   update;
+    const char*     name;       // what the profiler calls this class
 } ObjVtable;
 
 typedef struct object_t {
@@ -32,10 +33,10 @@ void objDisableRegistration();
 void objInit(Object* obj, ObjVtable* vtable, Coord2D pos, Coord2D vel);
 void objDeinit(Object* obj);
 void objDraw(Object* obj);
-void objUpdate(Object* obj, uint32_t milliseconds);
+void objUpdate(Object* obj, Milliseconds milliseconds);
 
 // default update implementation that just moves at the current velocity
-void objDefaultUpdate(Object* obj, uint32_t milliseconds);
+void objDefaultUpdate(Object* obj, Milliseconds milliseconds);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,48 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_NO_EVENT 0xFF
+
+typedef enum anim_loop_t {
+    ANIM_LOOP,      // after the last frame, go back to the clip's loopStart frame
+    ANIM_ONCE       // hold the last frame and report finished
+} AnimLoop;
+
+/// @brief One frame of a clip
+typedef struct anim_frame_t {
+    uint8_t cell;       // sprite sheet cell, the drawing object knows the sheet layout
+    uint8_t event;      // fired when the frame is entered, ANIM_NO_EVENT for none
+    uint16_t duration;  // milliseconds
+} AnimFrame;
+
+/// @brief A sequence of frames, normally a static const table next to the object using it
+typedef struct anim_clip_t {
+    const AnimFrame* frames;
+    uint8_t frameCount;
+    uint8_t loopStart;
+    AnimLoop loop;
+} AnimClip;
+
+typedef struct animator_t Animator;
+
+typedef void (*AnimEventCB)(void* owner, uint8_t event, uint8_t frame);
+
+void animMgrInit(uint32_t maxAnimators);
+void animMgrShutdown();
+void animMgrUpdate(Milliseconds milliseconds);
+
+Animator* animNew(void* owner, AnimEventCB eventCB);
+void animDelete(Animator* anim);
+void animPlay(Animator* anim, const AnimClip* clip, uint8_t frame);
+void animSwitch(Animator* anim, const AnimClip* clip);
+void animStop(Animator* anim);
+uint8_t animGetCell(const Animator* anim);
+bool animFinished(const Animator* anim);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,4 @@
+#pragma once
+#include "baseTypes.h"
+
+int32_t benchRun(const char* name);
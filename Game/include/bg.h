@@ -7,6 +7,7 @@ typedef struct bg_t Bg;
 
 
 void bgInitTexture();
+void bgReleaseTexture();
 Bg* bgInit(Bounds2D bounds);
 void bgFlyAway(Bg* bg);
 void bgGameBg(Bg* bg);
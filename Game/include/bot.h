@@ -0,0 +1,31 @@
+#pragma once
+#include "baseTypes.h"
+#include "input.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief How well the bot plays
+typedef struct bot_skill_t {
+	const char*		name;
+	Milliseconds	reaction;		// from a duck taking off to the first shot at it
+	Milliseconds	reactionJitter;	// standard deviation of the reaction
+	float			aimError;		// standard deviation of where the shot lands, pixels
+	float			holdFire;		// don't pull the trigger while the aim is off by more than this, pixels
+	Milliseconds	shotInterval;	// least time between shots
+	bool			predict;		// lead the duck by its velocity instead of shooting where it was
+} BotSkill;
+
+/// @brief What to play like, and how often to log the soak stats
+typedef struct bot_config_t {
+	const BotSkill*	skill;
+	uint32_t		logMinutes;
+} BotConfig;
+
+const BotSkill* botFindSkill(const char* name);
+const InputPointerBackend* botGetBackend();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief What a capture recorded and what it cost the thread owning the GL context
+typedef struct capture_stats_t {
+	uint32_t presented;
+	uint32_t frames;		// written to the video
+	uint32_t dropped;		// replaced by a newer frame before a video frame came due
+	uint32_t repeated;
+	double averageMs;
+	double worstMs;
+} CaptureStats;
+
+bool captureStart(const char* filename, uint32_t fps);
+void captureStop();
+bool captureActive();
+const CaptureStats* captureGetStats();
+void captureFrame();
+
+#ifdef __cplusplus
+}
+#endif
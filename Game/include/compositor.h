@@ -0,0 +1,7 @@
+#pragma once
+#include "baseTypes.h"
+#include "draw.h"
+
+void compositorInit();
+void compositorShutdown();
+void compositorPresent(const SpriteCmd* cmds, uint32_t count);
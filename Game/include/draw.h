@@ -1,7 +1,40 @@
 #pragma once
 #include <Windows.h>
 #include <gl/GLU.h>
+#include "baseTypes.h"
+#include "spritecmd.h"
+
+typedef enum draw_backend_t {
+	DRAW_BACKEND_GL,
+	DRAW_BACKEND_GL_INSTANCED,
+	DRAW_BACKEND_SOFTWARE
+} DrawBackend;
+
+/// @brief What the last submitted frame cost GL
+typedef struct draw_stats_t {
+	uint32_t sprites;
+	uint32_t drawCalls;
+	uint32_t textureBinds;
+} DrawStats;
+
+void drawInit();
+void drawShutdown();
+void drawSetBackend(DrawBackend backend);
+DrawBackend drawGetBackend();
+void drawSetPartialRedraw(bool enabled);
+void drawSetRenderBuffers(uint32_t count);
+void drawSetRenderDelay(uint32_t milliseconds);
+GLuint drawLoadTexture(const char* filename, uint32_t* bytes);
+GLuint drawCreateTexture(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels);
+void drawUnloadTexture(GLuint texture);
+
+void drawFrameBegin();
+void drawFrameEnd();
+uint64_t drawRender();
+DrawStats drawGetStats();
 
 void drawSprite(GLuint texture, GLfloat xPositionLeft, GLfloat xPositionRight, GLfloat yPositionTop,
 				GLfloat yPositionBottom, GLfloat u, GLfloat v, GLfloat xTextureCoord, GLfloat yTextureCoord,
-				float depth);
\ No newline at end of file
+				float depth);
+void drawSprites(const SpriteCmd* cmds, uint32_t count);
+void drawSubmitCmd(const SpriteCmd* cmd);
@@ -14,9 +14,12 @@ void duckClearCB();
 
 
 void duckInitTexture();
+void duckReleaseTexture();
 Duck* duckNew(Bounds2D bounds);
 void duckDelete(Duck* duck);
 void ducksFlyAway(Duck** ducks);
-int32_t duckCheckForHit(Coord2D mousePos, Duck** ducks);
+int32_t duckCheckForHit(Coord2D mousePos, uint64_t time, Duck** ducks);
+Coord2D duckPositionAt(const Duck* duck, uint64_t time);
+bool duckFindTarget(Duck** ducks, Coord2D* pos, Coord2D* velocity);
 void ducksSetActive(uint8_t roundNum, Duck** ducks);
 bool duckActiveStatus(Duck** ducks);
\ No newline at end of file
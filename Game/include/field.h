@@ -1,5 +1,5 @@
 #pragma once
-#include "object.h"
+#include "Object.h"
 
 #ifdef __cplusplus
 extern "C" {
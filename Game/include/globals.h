@@ -1,5 +1,6 @@
 #pragma once
-#include "basetypes.h"
+#include "baseTypes.h"
+#include "sound.h"
 
 typedef enum sounds_t
 {
@@ -20,4 +21,6 @@ typedef enum sounds_t
     numSounds
 } soundIds;
 
-const Coord2D uiSize;
\ No newline at end of file
+const Coord2D uiSize;
+const int32_t soundPriorities[numSounds];
+const SoundPolicy soundPolicies[numSounds];
\ No newline at end of file
@@ -0,0 +1,5 @@
+#pragma once
+#include "baseTypes.h"
+#include "levelmgr.h"
+
+int32_t goldenRun(const LevelDef* levelDef, const char* directory, bool update, bool gl);
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "spritecmd.h"
+
+bool instInit();
+void instShutdown();
+bool instDraw(const SpriteCmd* cmds, uint32_t count);
+uint32_t instGetDrawCalls();
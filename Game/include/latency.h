@@ -0,0 +1,22 @@
+#pragma once
+#include "baseTypes.h"
+#include "levelmgr.h"
+#include "application.h"
+
+/// @brief What an input led to, each measured from the input to the frame showing it
+typedef enum latency_outcome_t {
+	LATENCY_SHOT,		// the gun fired
+	LATENCY_HIT,		// a duck switched to its shot sprite
+	LATENCY_CURSOR,		// a pointer sample moved the crosshair, from its arrival
+	LATENCY_OUTCOME_COUNT
+} LatencyOutcome;
+
+void latencyStart();
+void latencyStop();
+void latencyReport();
+void latencyTag(LatencyOutcome outcome, uint64_t inputTime);
+uint64_t latencyFrameRecorded();
+uint64_t latencyNewestFrame();
+void latencyFramePresented(uint64_t frame, uint64_t presentTime);
+
+int32_t latencyRun(const LevelDef* levelDef, AppUpdateFunc update, AppDrawFunc draw, uint32_t clicks);
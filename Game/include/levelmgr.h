@@ -17,15 +17,30 @@ typedef struct leveldef_t {
     uint32_t numDucks;
 } LevelDef;
 
+// known scenes that can be staged without input, for frame comparisons
+typedef enum scene_t
+{
+        sceneMenu,
+        sceneRoundPopup,
+        sceneFlyAway,
+        sceneDogOneDuck,
+        sceneDogTwoDucks,
+        sceneDogLaugh,
+        sceneGameOver,
+        sceneCount
+} Scene;
+
 typedef struct level_t Level;
 
 void levelMgrInit();
 void levelMgrShutdown();
 Level *levelMgrLoad(const LevelDef* levelDef);
-void processClick(Coord2D pos);
+int32_t processClick(Coord2D pos, uint64_t pressTime);
+bool levelMgrFindTarget(Coord2D* pos, Coord2D* velocity);
 levelState levelMgrGetState();
 void levelMgrStartGame();
 void levelMgrUnload(Level* level);
+void levelMgrStageScene(Scene scene);
 
 #ifdef __cplusplus
 }
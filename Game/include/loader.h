@@ -0,0 +1,19 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*LoaderFunc)(void* job);
+
+void loaderInit(uint32_t maxWorkers);
+void loaderShutdown();
+bool loaderIsAsync();
+void loaderSubmit(LoaderFunc work, LoaderFunc done, void* job);
+void loaderPoll();
+bool loaderBusy();
+
+#ifdef __cplusplus
+}
+#endif
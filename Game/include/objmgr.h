@@ -12,7 +12,8 @@ void objMgrAdd(Object* obj);
 void objMgrRemove(Object* obj);
 
 void objMgrDraw();
-void objMgrUpdate(uint32_t milliseconds);
+void objMgrUpdate(Milliseconds milliseconds);
+uint32_t objMgrGetCount();
 
 #ifdef __cplusplus
 }
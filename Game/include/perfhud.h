@@ -0,0 +1,18 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void perfHudInit();
+void perfHudShutdown();
+void perfHudSetVisible(bool visible);
+bool perfHudIsVisible();
+void perfHudRecordUpdate(Milliseconds frame, uint64_t updateMicroseconds);
+void perfHudRecordDraw(uint64_t drawMicroseconds);
+void perfHudDraw();
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,7 @@ typedef struct player_t Player;
 
 
 void playerInitTextures();
+void playerReleaseTextures();
 Player* playerInit(Bounds2D bounds);
 bool playerShoot(Player* player);
 void playerUpScore(Player* player, uint32_t duckScore);
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 
+void randSeed(uint32_t seed);
 float randGetFloat(float min, float max);
 int32_t randGetInt(int32_t min, int32_t max);
 
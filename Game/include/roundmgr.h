@@ -16,7 +16,12 @@ void roundClearCBs();
 void roundSetActive(Round* round);
 void roundSetInctive(Round* round);
 void roundInitTextures();
+void roundReleaseTextures();
 Round* roundInit(Bounds2D bounds);
 void roundDuckHit(Round* round);
 State roundGetState(Round* round);
+bool roundAcceptsShots(Round* round);
+bool roundFlyingAway(Round* round);
+bool roundDogVisible(Round* round);
+bool roundGameOver(Round* round);
 void roundDeInit(Round* round);
\ No newline at end of file
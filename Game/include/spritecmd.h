@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+
+/// @brief A single recorded textured quad, exactly as passed to drawSprite.
+/// Kept free of platform headers so the software renderer can use it anywhere
+typedef struct sprite_cmd_t {
+	uint32_t texture;
+	float xPositionLeft;
+	float xPositionRight;
+	float yPositionTop;
+	float yPositionBottom;
+	float u;
+	float v;
+	float xTextureCoord;
+	float yTextureCoord;
+	float depth;
+} SpriteCmd;
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "spritecmd.h"
+
+/// @brief 8-bit per channel image, rows stored top to bottom
+typedef struct sw_image_t {
+	int32_t width;
+	int32_t height;
+	int32_t channels;
+	uint8_t* pixels;
+} SwImage;
+
+bool swrInit(int32_t width, int32_t height);
+void swrShutdown();
+uint32_t swrLoadTexture(const char* filename);
+uint32_t swrCreateTexture(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels);
+void swrUnloadTexture(uint32_t id);
+const SwImage* swrGetTexture(uint32_t id);
+void swrClear(uint8_t red, uint8_t green, uint8_t blue);
+void swrDraw(const SpriteCmd* cmds, uint32_t count);
+const SwImage* swrGetFrame();
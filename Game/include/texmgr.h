@@ -0,0 +1,22 @@
+#pragma once
+#include <Windows.h>
+#include <gl/GLU.h>
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void texMgrInit();
+void texMgrShutdown();
+GLuint texMgrAcquire(const char* filename);
+GLuint texMgrCreate(const char* name, const uint8_t* pixels, int32_t width, int32_t height, int32_t channels);
+void texMgrRelease(GLuint handle);
+GLuint texMgrGetTexture(GLuint handle);
+uint32_t texMgrUpload();
+uint32_t texMgrLoading();
+void texMgrReport();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include <Windows.h>
+#include <gl/GLU.h>
+#include "baseTypes.h"
+#include "spritecmd.h"
+
+// most digits a single number can be laid out with
+#define TEXT_MAX_DIGITS 10
+
+typedef enum text_style_t {
+	TEXT_STYLE_COUNTER,		// round counter digits
+	TEXT_STYLE_SCORE,		// score and popup digits
+	TEXT_STYLE_COUNT
+} TextStyle;
+
+typedef enum text_pad_t {
+	TEXT_PAD_ZERO,			// right aligned with leading zeros
+	TEXT_PAD_LEFT,			// right aligned with leading blanks
+	TEXT_PAD_RIGHT			// left aligned with trailing blanks
+} TextPad;
+
+/// @brief Where and how a number is drawn. A digits count of 0 uses as many as the value needs,
+/// otherwise higher digits that don't fit are dropped
+typedef struct text_layout_t {
+	TextStyle style;
+	TextPad pad;
+	uint32_t digits;
+	Coord2D position;
+	Coord2D glyphSize;
+	float depth;
+} TextLayout;
+
+void textInitTexture();
+void textReleaseTexture();
+GLuint textGetTexture();
+
+uint32_t textBuildNumber(const TextLayout* layout, uint32_t value, SpriteCmd* quads);
+const SpriteCmd* textLayoutNumber(const TextLayout* layout, uint32_t value, uint32_t* count);
+void textDrawNumber(const TextLayout* layout, uint32_t value);
@@ -0,0 +1,214 @@
+#include <Windows.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "anim.h"
+
+// Animators live in one array owned by this module and are all advanced by animMgrUpdate,
+// which the object manager calls once per update after the objects have picked their clips
+
+struct animator_t {
+    // hot, read by every pass
+    const AnimClip* clip;       // NULL when stopped or unused
+    Milliseconds elapsed;       // time spent in the current frame
+    uint16_t duration;          // of the current frame
+    uint8_t frame;
+    bool entered;               // the current frame's event hasn't fired yet
+    bool finished;
+
+    // cold
+    bool used;
+    void* owner;
+    AnimEventCB eventCB;
+};
+
+static struct animmgr_t {
+    Animator* list;
+    uint32_t max;
+    uint32_t count;
+    uint32_t highWater;     // one past the highest slot in use, bounds the update pass
+} _animMgr = { NULL, 0, 0, 0 };
+
+static void _animEnter(Animator* anim, uint8_t frame);
+
+/// @brief Initialize the animator pool
+/// @param maxAnimators 
+void animMgrInit(uint32_t maxAnimators)
+{
+    _animMgr.list = malloc(maxAnimators * sizeof(Animator));
+    if (_animMgr.list != NULL) {
+        ZeroMemory(_animMgr.list, maxAnimators * sizeof(Animator));
+        _animMgr.max = maxAnimators;
+        _animMgr.count = 0;
+        _animMgr.highWater = 0;
+    }
+}
+
+/// @brief Shutdown the animator pool
+void animMgrShutdown()
+{
+    // every animNew should have been matched by an animDelete
+    assert(_animMgr.count == 0);
+
+    free(_animMgr.list);
+    _animMgr.list = NULL;
+    _animMgr.max = _animMgr.count = _animMgr.highWater = 0;
+}
+
+/// @brief Advance every playing animator, firing the events of the frames entered
+/// @param milliseconds 
+void animMgrUpdate(Milliseconds milliseconds)
+{
+    for (uint32_t i = 0; i < _animMgr.highWater; ++i)
+    {
+        Animator* anim = &_animMgr.list[i];
+        if (anim->clip == NULL || anim->finished)
+            continue;
+
+        if (anim->entered)
+        {
+            anim->entered = false;
+            uint8_t event = anim->clip->frames[anim->frame].event;
+            if (event != ANIM_NO_EVENT && anim->eventCB != NULL)
+                anim->eventCB(anim->owner, event, anim->frame);
+        }
+
+        anim->elapsed += milliseconds;
+        while (anim->elapsed >= anim->duration && !anim->finished)
+        {
+            anim->elapsed -= anim->duration;
+            const AnimClip* clip = anim->clip;
+            uint8_t next = anim->frame + 1;
+            if (next >= clip->frameCount)
+            {
+                if (clip->loop == ANIM_ONCE)
+                {
+                    anim->finished = true;
+                    break;
+                }
+                next = clip->loopStart;
+            }
+            _animEnter(anim, next);
+
+            anim->entered = false;
+            uint8_t event = clip->frames[next].event;
+            if (event != ANIM_NO_EVENT && anim->eventCB != NULL)
+                anim->eventCB(anim->owner, event, next);
+
+            // the callback may have changed or stopped the clip
+            if (anim->clip != clip)
+                break;
+        }
+    }
+}
+
+/// @brief Take an animator from the pool, stopped until a clip is played
+/// @param owner passed back to eventCB
+/// @param eventCB may be NULL
+/// @return animator, NULL when the pool is full
+Animator* animNew(void* owner, AnimEventCB eventCB)
+{
+    for (uint32_t i = 0; i < _animMgr.max; ++i)
+    {
+        Animator* anim = &_animMgr.list[i];
+        if (!anim->used)
+        {
+            ZeroMemory(anim, sizeof(Animator));
+            anim->used = true;
+            anim->owner = owner;
+            anim->eventCB = eventCB;
+            ++_animMgr.count;
+            if (i >= _animMgr.highWater)
+                _animMgr.highWater = i + 1;
+            return anim;
+        }
+    }
+
+    // out of space to add an animator!
+    assert(false);
+    return NULL;
+}
+
+/// @brief Give an animator back to the pool
+/// @param anim 
+void animDelete(Animator* anim)
+{
+    if (anim == NULL)
+        return;
+
+    assert(anim->used);
+    ZeroMemory(anim, sizeof(Animator));
+    --_animMgr.count;
+    while (_animMgr.highWater > 0 && !_animMgr.list[_animMgr.highWater - 1].used)
+    {
+        --_animMgr.highWater;
+    }
+}
+
+/// @brief Start a clip from the given frame, its event fires on the next update
+/// @param anim 
+/// @param clip 
+/// @param frame 
+void animPlay(Animator* anim, const AnimClip* clip, uint8_t frame)
+{
+    assert(frame < clip->frameCount);
+    anim->clip = clip;
+    anim->elapsed = 0;
+    anim->finished = false;
+    _animEnter(anim, frame);
+}
+
+/// @brief Change to a clip with the same timing without restarting it, e.g. a direction variant
+/// @param anim 
+/// @param clip 
+void animSwitch(Animator* anim, const AnimClip* clip)
+{
+    if (anim->clip == clip)
+        return;
+
+    if (anim->clip == NULL || anim->frame >= clip->frameCount)
+    {
+        animPlay(anim, clip, 0);
+        return;
+    }
+    anim->clip = clip;
+    anim->duration = clip->frames[anim->frame].duration;
+}
+
+/// @brief Stop advancing and firing events
+/// @param anim 
+void animStop(Animator* anim)
+{
+    anim->clip = NULL;
+}
+
+/// @brief The sprite sheet cell to draw
+/// @param anim 
+/// @return cell, 0 when stopped
+uint8_t animGetCell(const Animator* anim)
+{
+    if (anim->clip == NULL)
+        return 0;
+
+    return anim->clip->frames[anim->frame].cell;
+}
+
+/// @brief Whether an ANIM_ONCE clip has played its last frame out
+/// @param anim 
+/// @return 
+bool animFinished(const Animator* anim)
+{
+    return anim->finished;
+}
+
+/// @brief Move to a frame, its event is still to be fired
+/// @param anim 
+/// @param frame 
+static void _animEnter(Animator* anim, uint8_t frame)
+{
+    anim->frame = frame;
+    anim->duration = anim->clip->frames[frame].duration;
+    anim->entered = true;
+
+    // a zero length frame would never let the update pass finish
+    assert(anim->duration > 0);
+}
@@ -0,0 +1,1099 @@
+#include <Windows.h>
+#include <Psapi.h>
+#include <gl/GLU.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "draw.h"
+#include "text.h"
+#include "texmgr.h"
+#include "timer.h"
+#include "anim.h"
+#include "instrender.h"
+#include "random.h"
+#include "application.h"
+#include "framework.h"
+#include "input.h"
+#include "globals.h"
+#include "objmgr.h"
+#include "duck.h"
+#include "Object.h"
+#include "mixer.h"
+#include "wavFile.h"
+#include "capture.h"
+#include "levelmgr.h"
+#include "loader.h"
+
+// Micro-benchmarks run from the command line with -bench <name>, or -bench all.
+// Everything records through the software backend so no window or GL context is needed,
+// except the quads and capture benches which time the GL paths in an offscreen context
+
+#define BENCH_SCORE_ITERATIONS 1000000
+#define BENCH_ANIM_MAX 100000
+#define BENCH_ANIM_UPDATES 1000
+#define BENCH_QUADS_MAX 100000
+#define BENCH_QUADS_SPRITES 10000000	// sprites drawn per measurement, spread over the frames
+#define BENCH_INPUT_FRAMES 600
+#define BENCH_INPUT_FPS 60
+#define BENCH_INPUT_CLICK_HZ 1000
+#define BENCH_REWIND_FRAMES 3600
+#define BENCH_REWIND_ROUND 20
+#define BENCH_REWIND_CLICKS 8			// per duck per frame, spread through the frame
+#define BENCH_REWIND_TOLERANCE 0.5f		// pixels
+#define BENCH_SHOTS_CLICKS 8
+#define BENCH_SHOTS_QUEUED_MS 100		// how long each click waits to be read, like a slow frame
+#define BENCH_SHOTS_TICK_MS 20.0		// message times are only as fine as the system tick
+#define BENCH_SHOTS_TIMEOUT_S 60
+#define BENCH_SHOTS_MAX_OBJECTS 500
+#define BENCH_SHOTS_CLASS_NAME "Duck Hunt bench input"
+#define BENCH_MIXER_CLIP_RATE 44100			// resampled to the mixer's rate on load
+#define BENCH_MIXER_SECONDS 2
+#define BENCH_MIXER_TOLERANCE 1.0e-5f
+#define BENCH_SFX_DIRECTORY "asset/sfx/"
+#define BENCH_SFX_MAX_FILES 32
+#define BENCH_SFX_FORMAT_BYTES 16		// the WAVEFORMAT and bits per sample every fmt chunk has
+#define BENCH_FLOCK_MAX 1000
+#define BENCH_FLOCK_FRAMES 600
+#define BENCH_FLOCK_MIX_FRAMES (MIXER_SAMPLE_RATE / BENCH_INPUT_FPS)
+#define BENCH_FLOCK_SLACK 2.0			// times the mixing of the smallest flock the largest may cost
+#define BENCH_FLOCK_NOISE_US 20.0
+#define BENCH_CAPTURE_FPS 60
+#define BENCH_CAPTURE_SECONDS 2
+#define BENCH_CAPTURE_SLACK_FRAMES 2
+#define BENCH_CAPTURE_BUDGET_MS 1.0		// on the GL thread, per presented frame at 960x1024
+#define BENCH_CAPTURE_FILE "duckHuntBench.y4m"
+
+typedef bool (*BenchFunc)();
+
+typedef struct bench_t {
+	const char* name;
+	const char* description;
+	BenchFunc func;
+} Bench;
+
+/// @brief A clip read into the heap, the way sounds loaded before they were mapped
+typedef struct bench_sfx_clip_t {
+	uint8_t format[40];
+	uint8_t* samples;
+	uint32_t sampleBytes;
+} BenchSfxClip;
+
+static bool _benchScore();
+static bool _benchAnim();
+static bool _benchQuads();
+static bool _benchInput();
+static bool _benchRewind();
+static bool _benchShots();
+static bool _benchMixer();
+static bool _benchSfx();
+static bool _benchFlock();
+static bool _benchCapture();
+
+static const Bench _benches[] = {
+	{ "score", "cost of recording the six digit score", _benchScore },
+	{ "anim", "cost of the batched animation pass per animator", _benchAnim },
+	{ "quads", "GL immediate mode against GL 3.3 instancing, offscreen", _benchQuads },
+	{ "input", "clicks much faster than the frame rate all reach the update", _benchInput },
+	{ "rewind", "shots tested where the ducks were at the click, not at the update", _benchRewind },
+	{ "shots", "clicks posted to a window keep their time through the queue and hit", _benchShots },
+	{ "mixer", "software mixing cost per voice per second of audio, SIMD against scalar", _benchMixer },
+	{ "sfx", "load time and working set of the sound effects, read into the heap against mapped", _benchSfx },
+	{ "flock", "voices and mixing stay bounded as the flock grows to 1000 ducks", _benchFlock },
+	{ "capture", "video frame cadence and GL thread cost of recording, offscreen", _benchCapture },
+};
+static const uint32_t _benchCount = sizeof(_benches) / sizeof(_benches[0]);
+
+// the sounds a flock makes, and where to load them from
+static const soundIds _benchFlockSounds[] = { flap, quack, fall, thud };
+static const char* _benchFlockFiles[] = {
+	BENCH_SFX_DIRECTORY "wingFlap.wav",
+	BENCH_SFX_DIRECTORY "quack.wav",
+	BENCH_SFX_DIRECTORY "duckFall.wav",
+	BENCH_SFX_DIRECTORY "duckThud.wav"
+};
+static int32_t _benchSoundIds[numSounds];
+static uint32_t _benchTriggers = 0;
+
+static void _benchLegacyScore(GLuint texture, uint32_t score);
+static void _benchNoSound(soundIds id);
+static void _benchSound(soundIds id);
+static size_t _benchWorkingSet();
+static void _benchLegacyLoadWav(const char* filename, BenchSfxClip* clip);
+static HRESULT _benchLegacyFindChunk(HANDLE file, DWORD fourcc, DWORD* chunkSize, DWORD* chunkDataPosition);
+static HRESULT _benchLegacyReadChunk(HANDLE file, void* buffer, DWORD bufferSize, DWORD bufferOffset);
+
+/// @brief Run one benchmark by name, or all of them
+/// @param name
+/// @return number of benchmarks that failed or weren't found
+int32_t benchRun(const char* name)
+{
+	int32_t failures = 0;
+	bool found = false;
+
+	timerInit();
+	drawSetBackend(DRAW_BACKEND_SOFTWARE);
+	for (uint32_t i = 0; i < _benchCount; ++i)
+	{
+		if (strcmp(name, "all") != 0 && strcmp(name, _benches[i].name) != 0)
+			continue;
+
+		found = true;
+		printf("bench %s: %s\n", _benches[i].name, _benches[i].description);
+		if (!_benches[i].func())
+		{
+			++failures;
+		}
+	}
+	drawSetBackend(DRAW_BACKEND_GL);
+	timerShutdown();
+
+	if (!found)
+	{
+		printf("bench: no benchmark named %s, available:\n", name);
+		for (uint32_t i = 0; i < _benchCount; ++i)
+		{
+			printf("  %-10s %s\n", _benches[i].name, _benches[i].description);
+		}
+		return 1;
+	}
+	return failures;
+}
+
+/// @brief Compare the old per-digit score drawing with the cached text layout,
+/// both when the score holds still and when it changes every frame
+/// @return true
+static bool _benchScore()
+{
+	const TextLayout layout = {
+		TEXT_STYLE_SCORE, TEXT_PAD_ZERO, 6, { 720.0f, 887.0f }, { 30.0f, 35.0f }, 0.76f
+	};
+
+	drawInit();
+	texMgrInit();
+	textInitTexture();
+	GLuint texture = textGetTexture();
+
+	uint64_t start = timerNowMicroseconds();
+	for (uint32_t i = 0; i < BENCH_SCORE_ITERATIONS; ++i)
+	{
+		drawFrameBegin();
+		_benchLegacyScore(texture, 12500);
+	}
+	uint64_t legacy = timerNowMicroseconds() - start;
+
+	start = timerNowMicroseconds();
+	for (uint32_t i = 0; i < BENCH_SCORE_ITERATIONS; ++i)
+	{
+		drawFrameBegin();
+		textDrawNumber(&layout, 12500);
+	}
+	uint64_t cached = timerNowMicroseconds() - start;
+
+	start = timerNowMicroseconds();
+	for (uint32_t i = 0; i < BENCH_SCORE_ITERATIONS; ++i)
+	{
+		drawFrameBegin();
+		textDrawNumber(&layout, i);
+	}
+	uint64_t changing = timerNowMicroseconds() - start;
+
+	textReleaseTexture();
+	texMgrShutdown();
+	drawShutdown();
+
+	const double toNs = 1000.0 / BENCH_SCORE_ITERATIONS;
+	printf("  per-digit math   %8.1f ns/frame\n", legacy * toNs);
+	printf("  cached, same     %8.1f ns/frame\n", cached * toNs);
+	printf("  cached, changing %8.1f ns/frame\n", changing * toNs);
+	return true;
+}
+
+/// @brief Advance growing numbers of looping animators, the cost per animator should stay flat
+/// @return false if the animators couldn't be allocated
+static bool _benchAnim()
+{
+	static const AnimFrame frames[] = {
+		{ 0, ANIM_NO_EVENT, 56 }, { 1, ANIM_NO_EVENT, 56 }, { 2, ANIM_NO_EVENT, 56 }
+	};
+	static const AnimClip clip = { frames, 3, 0, ANIM_LOOP };
+	const uint32_t counts[] = { 10, 1000, BENCH_ANIM_MAX };
+
+	Animator** anims = malloc(BENCH_ANIM_MAX * sizeof(Animator*));
+	if (anims == NULL)
+		return false;
+
+	for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+	{
+		animMgrInit(counts[c]);
+		for (uint32_t i = 0; i < counts[c]; ++i)
+		{
+			anims[i] = animNew(NULL, NULL);
+			animPlay(anims[i], &clip, (uint8_t)(i % 3));
+		}
+
+		uint64_t start = timerNowMicroseconds();
+		for (uint32_t i = 0; i < BENCH_ANIM_UPDATES; ++i)
+		{
+			// 16ms steps, so most passes only count time and some change frame
+			animMgrUpdate(16);
+		}
+		uint64_t elapsed = timerNowMicroseconds() - start;
+
+		for (uint32_t i = 0; i < counts[c]; ++i)
+		{
+			animDelete(anims[i]);
+		}
+		animMgrShutdown();
+
+		printf("  %6u animators %8.2f us/update %6.2f ns/animator\n", counts[c],
+			   (double)elapsed / BENCH_ANIM_UPDATES, elapsed * 1000.0 / ((double)BENCH_ANIM_UPDATES * counts[c]));
+	}
+
+	free(anims);
+	return true;
+}
+
+/// @brief Draw 10 and 100k duck sprites through both GL paths, waiting for the GPU each frame
+/// @return false if no offscreen 3.3 context could be made
+static bool _benchQuads()
+{
+	static const char DUCK_SHEET[] = "asset/NES - Duck Hunt - Ducks.png";
+	const uint32_t counts[] = { 10, BENCH_QUADS_MAX };
+	const DrawBackend backends[] = { DRAW_BACKEND_GL, DRAW_BACKEND_GL_INSTANCED };
+	const char* backendNames[] = { "immediate", "instanced" };
+	bool ok = true;
+
+	Application* app = appNew(GetModuleHandle(NULL), "Duck Hunt bench", NULL, NULL);
+	if (app == NULL)
+		return false;
+	appSetWidth(app, 960);
+	appSetHeight(app, 1024);
+	appSetGLVersion(app, 3, 3);
+	GLOffscreen* offscreen = fwInitOffscreen(app);
+	SpriteCmd* cmds = malloc(BENCH_QUADS_MAX * sizeof(SpriteCmd));
+	if (offscreen == NULL || cmds == NULL)
+	{
+		free(cmds);
+		fwShutdownOffscreen(offscreen);
+		appDelete(app);
+		return false;
+	}
+
+	drawSetBackend(DRAW_BACKEND_GL);
+	drawSetRenderBuffers(0);
+	drawInit();
+	texMgrInit();
+	GLuint sheet = texMgrAcquire(DUCK_SHEET);
+
+	// the same scattered, partly mirrored flying ducks for every run
+	randSeed(1985);
+	for (uint32_t i = 0; i < BENCH_QUADS_MAX; ++i)
+	{
+		float x = randGetFloat(0.0f, 960.0f - 136.0f);
+		float y = randGetFloat(0.0f, 1024.0f - 132.0f);
+		float u = 1.0f / 12.0f;
+		bool mirror = (i % 2) != 0;
+		cmds[i].texture = sheet;
+		cmds[i].xPositionLeft = x;
+		cmds[i].xPositionRight = x + 136.0f;
+		cmds[i].yPositionTop = y;
+		cmds[i].yPositionBottom = y + 132.0f;
+		cmds[i].u = mirror ? -u : u;
+		cmds[i].v = 1.0f / 3.0f;
+		cmds[i].xTextureCoord = (i % 3) * u + (mirror ? u : 0.0f);
+		cmds[i].yTextureCoord = 1.0f;
+		cmds[i].depth = randGetFloat(-0.9f, 0.9f);
+	}
+
+	for (uint32_t b = 0; b < 2 && ok; ++b)
+	{
+		drawSetBackend(backends[b]);
+		for (uint32_t c = 0; c < 2; ++c)
+		{
+			uint32_t frames = BENCH_QUADS_SPRITES / counts[c];
+			frames = min(frames, 1000);
+
+			uint64_t start = timerNowMicroseconds();
+			for (uint32_t f = 0; f < frames; ++f)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				drawFrameBegin();
+				drawSprites(cmds, counts[c]);
+				drawFrameEnd();
+				glFinish();
+			}
+			uint64_t elapsed = timerNowMicroseconds() - start;
+
+			printf("  %-9s %6u sprites %8.3f ms/frame", backendNames[b], counts[c], elapsed / 1000.0 / frames);
+			if (backends[b] == DRAW_BACKEND_GL_INSTANCED)
+				printf(" %u draw call(s)", instGetDrawCalls());
+			printf("\n");
+		}
+		// drawSubmit fell back to immediate mode
+		if (backends[b] == DRAW_BACKEND_GL_INSTANCED && instGetDrawCalls() == 0)
+		{
+			printf("  instanced path unavailable, no GL 3.3 context\n");
+			ok = false;
+		}
+	}
+
+	texMgrRelease(sheet);
+	texMgrShutdown();
+	drawShutdown();
+	drawSetBackend(DRAW_BACKEND_SOFTWARE);
+	free(cmds);
+	fwShutdownOffscreen(offscreen);
+	appDelete(app);
+	return ok;
+}
+
+/// @brief Click at 1000Hz against 60Hz updates, every click is a press and a release inside one
+/// frame, and check that each one reaches the update in order with its edges set
+/// @return false if any click went missing
+static bool _benchInput()
+{
+	const uint64_t framePeriod = 1000000000ull / BENCH_INPUT_FPS;
+	const uint64_t clickPeriod = 1000000000ull / BENCH_INPUT_CLICK_HZ;
+	uint64_t fired = 0, seen = 0, injectNs = 0;
+	uint32_t framesClicked = 0, framesWithEdges = 0;
+	uint64_t nextClick = 0, lastTimestamp = 0;
+	bool ordered = true;
+
+	inputInit();
+	for (uint32_t frame = 0; frame < BENCH_INPUT_FRAMES; ++frame)
+	{
+		uint64_t frameEnd = (frame + 1) * framePeriod;
+		uint64_t start = timerNowNanoseconds();
+		uint32_t clicks = 0;
+		for (; nextClick < frameEnd; nextClick += clickPeriod)
+		{
+			inputMouseInjectButton(INPUT_BUTTON_LEFT, true, nextClick);
+			inputMouseInjectButton(INPUT_BUTTON_LEFT, false, nextClick + clickPeriod / 2);
+			++clicks;
+		}
+		injectNs += timerNowNanoseconds() - start;
+		fired += clicks;
+
+		// what the update sees
+		uint32_t count;
+		const InputEvent* events = inputEvents(&count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (events[i].timestamp < lastTimestamp)
+				ordered = false;
+			lastTimestamp = events[i].timestamp;
+			if (events[i].type == INPUT_EVENT_BUTTON_DOWN && events[i].code == INPUT_BUTTON_LEFT)
+				++seen;
+		}
+		if (clicks > 0)
+		{
+			++framesClicked;
+			if (inputMousePressedThisFrame(INPUT_BUTTON_LEFT) && inputMouseReleasedThisFrame(INPUT_BUTTON_LEFT))
+				++framesWithEdges;
+		}
+		inputFrameEnd();
+	}
+	uint32_t dropped = inputDroppedEvents();
+	inputShutdown();
+
+	bool ok = (seen == fired && framesWithEdges == framesClicked && dropped == 0 && ordered);
+	printf("  %llu clicks at %u Hz over %u frames at %u Hz, %llu reached the update, %u events dropped%s\n",
+		   (unsigned long long)fired, BENCH_INPUT_CLICK_HZ, BENCH_INPUT_FRAMES, BENCH_INPUT_FPS,
+		   (unsigned long long)seen, dropped, ordered ? "" : ", out of order");
+	printf("  edges set in %u of %u frames, %.1f ns per event queued\n",
+		   framesWithEdges, framesClicked, (double)injectNs / (fired * 2));
+	printf("  %s\n", ok ? "PASS" : "FAIL");
+	return ok;
+}
+
+/// @brief Fly two round 20 ducks at 60Hz and ask where they were at clicks spread through each
+/// frame. Between bounces a duck moves in a straight line, so where it really was is known
+/// from the start of the frame and its velocity. Compare that with the rewound position and
+/// with the position the update left it at, which is what the hit test used to see
+/// @return false if a rewound position is off by more than the tolerance
+static bool _benchRewind()
+{
+	const uint64_t period = 1000000000ull / BENCH_INPUT_FPS;
+	const Bounds2D bounds = { { 0.0f, 0.0f }, { 960.0f, 1024.0f } };
+	double rewoundSum = 0.0, currentSum = 0.0;
+	float rewoundMax = 0.0f, currentMax = 0.0f;
+	uint32_t samples = 0;
+
+	drawInit();
+	texMgrInit();
+	objMgrInit(16);
+	inputInit();
+	duckInitTexture();
+	duckSetCB(_benchNoSound);
+	Duck* ducks[2] = { duckNew(bounds), duckNew(bounds) };
+	randSeed(1985);
+
+	bool respawned = true;
+	uint64_t now = period;
+	for (uint32_t frame = 0; frame < BENCH_REWIND_FRAMES; ++frame)
+	{
+		if (!duckActiveStatus(ducks))
+		{
+			ducksSetActive(BENCH_REWIND_ROUND, ducks);
+			respawned = true;
+		}
+
+		Coord2D startPosition[2], startVelocity[2];
+		for (uint32_t d = 0; d < 2; ++d)
+		{
+			startPosition[d] = ((Object*)ducks[d])->position;
+			startVelocity[d] = ((Object*)ducks[d])->velocity;
+		}
+		uint64_t start = now;
+		now += period;
+		inputFrameBegin(now);
+		objMgrUpdate((Milliseconds)(period / 1000000.0));
+
+		// a fresh duck has no position from before this frame to rewind to
+		if (respawned)
+		{
+			respawned = false;
+			continue;
+		}
+		for (uint32_t d = 0; d < 2; ++d)
+		{
+			const Object* obj = (const Object*)ducks[d];
+			if (obj->velocity.x != startVelocity[d].x || obj->velocity.y != startVelocity[d].y)
+				continue;
+
+			for (uint32_t c = 0; c < BENCH_REWIND_CLICKS; ++c)
+			{
+				uint64_t click = start + (period * (2 * c + 1)) / (2 * BENCH_REWIND_CLICKS);
+				double seconds = (click - start) / 1000000000.0;
+				double trueX = startPosition[d].x + startVelocity[d].x * seconds;
+				double trueY = startPosition[d].y + startVelocity[d].y * seconds;
+
+				Coord2D rewound = duckPositionAt(ducks[d], click);
+				float rewoundError = (float)hypot(rewound.x - trueX, rewound.y - trueY);
+				float currentError = (float)hypot(obj->position.x - trueX, obj->position.y - trueY);
+				rewoundSum += rewoundError;
+				currentSum += currentError;
+				rewoundMax = max(rewoundMax, rewoundError);
+				currentMax = max(currentMax, currentError);
+				++samples;
+			}
+		}
+	}
+
+	duckDelete(ducks[0]);
+	duckDelete(ducks[1]);
+	duckClearCB();
+	duckReleaseTexture();
+	inputShutdown();
+	objMgrShutdown();
+	texMgrShutdown();
+	drawShutdown();
+
+	bool ok = (samples > 0 && rewoundMax <= BENCH_REWIND_TOLERANCE);
+	printf("  %u clicks at known times inside %u frames of round %u ducks\n", samples, BENCH_REWIND_FRAMES, BENCH_REWIND_ROUND);
+	printf("  at the update  %6.2f px avg %6.2f px max\n", samples ? currentSum / samples : 0.0, currentMax);
+	printf("  rewound        %6.2f px avg %6.2f px max\n", samples ? rewoundSum / samples : 0.0, rewoundMax);
+	printf("  %s\n", ok ? "PASS" : "FAIL");
+	return ok;
+}
+
+/// @brief Post clicks on the flying ducks to a window and leave them queued for a while, the way
+/// a long frame would, then pump them through the framework's input handling and processClick
+/// like the game does. Each press should keep the time it was posted, not the time it was read,
+/// so it's tested where the duck was and still hits
+/// @return false if a press is stamped more than a tick from its post or too few hit
+static bool _benchShots()
+{
+	const LevelDef levelDef = { { { 0, 0 }, { 960, 1024 } }, 0x00ff0000, 2 };
+	const uint64_t period = 1000000000ull / BENCH_INPUT_FPS;
+	uint32_t fired = 0, stamped = 0, hits = 0;
+	double errorSum = 0.0, errorMax = 0.0, movedSum = 0.0;
+
+	WNDCLASSEX windowClass;
+	ZeroMemory(&windowClass, sizeof(WNDCLASSEX));
+	windowClass.cbSize = sizeof(WNDCLASSEX);
+	windowClass.lpfnWndProc = fwInputWindowProc;
+	windowClass.hInstance = GetModuleHandle(NULL);
+	windowClass.lpszClassName = BENCH_SHOTS_CLASS_NAME;
+	RegisterClassEx(&windowClass);
+	HWND window = CreateWindowEx(0, BENCH_SHOTS_CLASS_NAME, "", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL,
+								 GetModuleHandle(NULL), NULL);
+	if (window == NULL)
+	{
+		UnregisterClass(BENCH_SHOTS_CLASS_NAME, GetModuleHandle(NULL));
+		return false;
+	}
+
+	soundSetSink(mixerNullSink(), NULL);
+	soundInit(numSounds);
+	drawInit();
+	texMgrInit();
+	loaderInit(0);
+	objMgrInit(BENCH_SHOTS_MAX_OBJECTS);
+	inputInit();
+	levelMgrInit();
+	Level* level = levelMgrLoad(&levelDef);
+	levelMgrStartGame();
+
+	uint64_t start = timerNowNanoseconds();
+	uint64_t last = start;
+	while (fired < BENCH_SHOTS_CLICKS && last - start < BENCH_SHOTS_TIMEOUT_S * 1000000000ull)
+	{
+		Coord2D target, velocity = { 0.0f, 0.0f };
+		uint64_t posted = 0;
+		if (levelMgrFindTarget(&target, &velocity))
+		{
+			LPARAM position = MAKELPARAM((WORD)target.x, (WORD)target.y);
+			posted = timerNowNanoseconds();
+			PostMessage(window, WM_MOUSEMOVE, 0, position);
+			PostMessage(window, WM_LBUTTONDOWN, MK_LBUTTON, position);
+			PostMessage(window, WM_LBUTTONUP, 0, position);
+			++fired;
+			Sleep(BENCH_SHOTS_QUEUED_MS);
+		}
+		else
+		{
+			Sleep((DWORD)(period / 1000000));
+		}
+
+		MSG msg;
+		while (PeekMessage(&msg, window, 0, 0, PM_REMOVE) != 0)
+		{
+			DispatchMessage(&msg);
+		}
+
+		// the update as the game runs it, the ducks move up to now and each click rewinds them
+		uint64_t now = timerNowNanoseconds();
+		inputFrameBegin(now);
+		soundFrameBegin(now);
+		objMgrUpdate((Milliseconds)((now - last) / 1000000.0));
+		last = now;
+
+		uint32_t count;
+		const InputEvent* events = inputEvents(&count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (events[i].type != INPUT_EVENT_BUTTON_DOWN || events[i].code != INPUT_BUTTON_LEFT)
+				continue;
+
+			double error = fabs((double)events[i].timestamp - (double)posted) / 1000000.0;
+			errorSum += error;
+			errorMax = max(errorMax, error);
+			movedSum += hypot(velocity.x, velocity.y) * (now - posted) / 1000000000.0;
+			++stamped;
+			if (processClick(events[i].position, events[i].timestamp) != 0)
+				++hits;
+		}
+		inputFrameEnd();
+	}
+
+	levelMgrUnload(level);
+	levelMgrShutdown();
+	inputShutdown();
+	objMgrShutdown();
+	loaderShutdown();
+	texMgrShutdown();
+	drawShutdown();
+	soundShutdown();
+	soundSetSink(NULL, NULL);
+	DestroyWindow(window);
+	UnregisterClass(BENCH_SHOTS_CLASS_NAME, GetModuleHandle(NULL));
+
+	bool ok = (fired > 0 && stamped == fired && errorMax <= BENCH_SHOTS_TICK_MS && hits * 4 >= fired * 3);
+	printf("  %u clicks queued for %u ms each, %u reached the update, %u hit\n", fired, BENCH_SHOTS_QUEUED_MS,
+		   stamped, hits);
+	printf("  stamped %.1f ms avg %.1f ms max from the post, the duck had moved %.0f px avg by the update\n",
+		   stamped ? errorSum / stamped : 0.0, errorMax, stamped ? movedSum / stamped : 0.0);
+	printf("  %s\n", ok ? "PASS" : "FAIL");
+	return ok;
+}
+
+/// @brief Mix a second of 1, 8 and 32 voices of a 16-bit mono clip, one sample at a time and
+/// with SIMD. Both should give the same mix
+/// @return false if the clip couldn't be added or the mixes differ
+static bool _benchMixer()
+{
+	const uint32_t counts[] = { 1, 8, 32 };
+	const uint32_t clipFrames = BENCH_MIXER_CLIP_RATE * BENCH_MIXER_SECONDS;
+	const uint32_t mixSamples = MIXER_SAMPLE_RATE * MIXER_CHANNELS;
+
+	int16_t* clipSamples = malloc(clipFrames * sizeof(int16_t));
+	float* mixes[2] = { malloc(mixSamples * sizeof(float)), malloc(mixSamples * sizeof(float)) };
+	if (clipSamples == NULL || mixes[0] == NULL || mixes[1] == NULL)
+	{
+		free(clipSamples);
+		free(mixes[0]);
+		free(mixes[1]);
+		return false;
+	}
+	for (uint32_t i = 0; i < clipFrames; ++i)
+	{
+		clipSamples[i] = (int16_t)(sin(i * 440.0 * 6.28318531 / BENCH_MIXER_CLIP_RATE) * 16000.0);
+	}
+
+	mixerInit();
+	int32_t clip = mixerAddClip(clipSamples, (uint32_t)(clipFrames * sizeof(int16_t)), MIXER_FORMAT_PCM, 1, BENCH_MIXER_CLIP_RATE, 16);
+	free(clipSamples);
+	bool ok = (clip != MIXER_NOCLIP);
+
+	float worst = 0.0f;
+	for (uint32_t c = 0; ok && c < sizeof(counts) / sizeof(counts[0]); ++c)
+	{
+		double usPerVoiceSecond[2];
+		for (uint32_t simd = 0; simd < 2; ++simd)
+		{
+			mixerSetSimd(simd == 1);
+			for (uint32_t i = 0; i < counts[c]; ++i)
+			{
+				mixerPlay(clip, 1.0f / counts[c], 0);
+			}
+
+			uint64_t start = timerNowNanoseconds();
+			for (uint32_t frame = 0; frame < MIXER_SAMPLE_RATE; frame += MIXER_BLOCK_FRAMES)
+			{
+				uint32_t frames = MIXER_SAMPLE_RATE - frame;
+				if (frames > MIXER_BLOCK_FRAMES)
+					frames = MIXER_BLOCK_FRAMES;
+				mixerRender(mixes[simd] + frame * MIXER_CHANNELS, frames);
+			}
+			usPerVoiceSecond[simd] = (timerNowNanoseconds() - start) / 1000.0 / counts[c];
+			mixerStopClip(clip);
+		}
+
+		for (uint32_t i = 0; i < mixSamples; ++i)
+		{
+			float difference = fabsf(mixes[0][i] - mixes[1][i]);
+			if (difference > worst)
+				worst = difference;
+		}
+		printf("  %2u voices %8.2f us scalar %8.2f us SIMD per voice per second of audio\n",
+			   counts[c], usPerVoiceSecond[0], usPerVoiceSecond[1]);
+	}
+	mixerReport();
+	mixerShutdown();
+	free(mixes[0]);
+	free(mixes[1]);
+
+	ok = ok && worst <= BENCH_MIXER_TOLERANCE;
+	printf("  SIMD and scalar mixes differ by at most %g\n", worst);
+	printf("  %s\n", ok ? "PASS" : "FAIL");
+	return ok;
+}
+
+/// @brief Load every WAV in asset/sfx by reading chunk by chunk into the heap as the sound
+/// module used to, and by mapping, then touch every sample as playing them would. Warm, so
+/// neither pays for the disk
+/// @return false if there are no files or the two loaders disagree on any of them
+static bool _benchSfx()
+{
+	static char names[BENCH_SFX_MAX_FILES][MAX_PATH];
+	static BenchSfxClip legacy[BENCH_SFX_MAX_FILES];
+	static WavFile mapped[BENCH_SFX_MAX_FILES];
+	const char* loaderNames[] = { "read", "mapped" };
+	uint32_t count = 0;
+
+	WIN32_FIND_DATA found;
+	HANDLE find = FindFirstFile(BENCH_SFX_DIRECTORY "*.wav", &found);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			snprintf(names[count++], MAX_PATH, "%s%s", BENCH_SFX_DIRECTORY, found.cFileName);
+		} while (count < BENCH_SFX_MAX_FILES && FindNextFile(find, &found));
+		FindClose(find);
+	}
+	if (count == 0)
+	{
+		printf("  no WAV files in %s\n", BENCH_SFX_DIRECTORY);
+		return false;
+	}
+
+	// bring the files into the cache
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_benchLegacyLoadWav(names[i], &legacy[i]);
+		free(legacy[i].samples);
+	}
+
+	uint32_t checksum = 0;
+	for (uint32_t loader = 0; loader < 2; ++loader)
+	{
+		size_t before = _benchWorkingSet();
+		uint64_t start = timerNowNanoseconds();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (loader == 0)
+				_benchLegacyLoadWav(names[i], &legacy[i]);
+			else
+				wavOpen(names[i], &mapped[i]);
+		}
+		uint64_t loadNs = timerNowNanoseconds() - start;
+		size_t loaded = _benchWorkingSet();
+
+		uint64_t bytes = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint8_t* samples = (loader == 0) ? legacy[i].samples : mapped[i].samples;
+			uint32_t sampleBytes = (loader == 0) ? legacy[i].sampleBytes : mapped[i].sampleBytes;
+			for (uint32_t j = 0; j < sampleBytes; ++j)
+			{
+				checksum += samples[j];
+			}
+			bytes += sampleBytes;
+		}
+		size_t played = _benchWorkingSet();
+
+		printf("  %-6s %2u files, %.1f KB of samples, loaded in %8.3f ms, working set +%.1f KB loaded, +%.1f KB played\n",
+			   loaderNames[loader], count, bytes / 1024.0, loadNs / 1000000.0,
+			   ((double)loaded - (double)before) / 1024.0, ((double)played - (double)before) / 1024.0);
+	}
+
+	uint32_t mismatched = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		bool same = mapped[i].samples != NULL && legacy[i].samples != NULL &&
+			mapped[i].sampleBytes == legacy[i].sampleBytes &&
+			memcmp(mapped[i].samples, legacy[i].samples, legacy[i].sampleBytes) == 0 &&
+			memcmp(mapped[i].format, legacy[i].format, BENCH_SFX_FORMAT_BYTES) == 0;
+		if (!same)
+		{
+			printf("  %s loads differently\n", names[i]);
+			++mismatched;
+		}
+		free(legacy[i].samples);
+		wavClose(&mapped[i]);
+	}
+
+	printf("  checksum %u\n", checksum);
+	printf("  %s\n", (mismatched == 0) ? "PASS" : "FAIL");
+	return mismatched == 0;
+}
+
+/// @brief The process's working set, to see what loading and playing brings in
+/// @return bytes
+static size_t _benchWorkingSet()
+{
+	PROCESS_MEMORY_COUNTERS memory;
+	ZeroMemory(&memory, sizeof(memory));
+	memory.cb = sizeof(memory);
+	GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory));
+	return memory.WorkingSetSize;
+}
+
+/// @brief The sound module's WAV loading as it was before mapping, kept as the baseline. Each
+/// chunk lookup rescans the file from the start with a seek and a read per chunk header.
+/// FROM: https://learn.microsoft.com/en-us/windows/win32/xaudio2/how-to--load-audio-data-files-in-xaudio2
+/// @param filename
+/// @param clip samples are malloc'd, NULL on failure
+static void _benchLegacyLoadWav(const char* filename, BenchSfxClip* clip)
+{
+	ZeroMemory(clip, sizeof(BenchSfxClip));
+	HANDLE file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	DWORD chunkSize, chunkPosition, fileType;
+	_benchLegacyFindChunk(file, 'FFIR', &chunkSize, &chunkPosition);
+	_benchLegacyReadChunk(file, &fileType, sizeof(DWORD), chunkPosition);
+	if (fileType != 'EVAW')
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	_benchLegacyFindChunk(file, ' tmf', &chunkSize, &chunkPosition);
+	_benchLegacyReadChunk(file, clip->format, (DWORD)min(chunkSize, sizeof(clip->format)), chunkPosition);
+
+	_benchLegacyFindChunk(file, 'atad', &chunkSize, &chunkPosition);
+	clip->samples = malloc(chunkSize);
+	if (clip->samples != NULL)
+	{
+		_benchLegacyReadChunk(file, clip->samples, chunkSize, chunkPosition);
+		clip->sampleBytes = chunkSize;
+	}
+	CloseHandle(file);
+}
+
+static HRESULT _benchLegacyFindChunk(HANDLE file, DWORD fourcc, DWORD* chunkSize, DWORD* chunkDataPosition)
+{
+	HRESULT hr = S_OK;
+	if (INVALID_SET_FILE_POINTER == SetFilePointer(file, 0, NULL, FILE_BEGIN))
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	DWORD chunkType;
+	DWORD chunkDataSize;
+	DWORD riffDataSize = 0;
+	DWORD fileType;
+	DWORD bytesRead = 0;
+	DWORD offset = 0;
+
+	while (hr == S_OK)
+	{
+		DWORD read;
+		if (0 == ReadFile(file, &chunkType, sizeof(DWORD), &read, NULL))
+			hr = HRESULT_FROM_WIN32(GetLastError());
+
+		if (0 == ReadFile(file, &chunkDataSize, sizeof(DWORD), &read, NULL))
+			hr = HRESULT_FROM_WIN32(GetLastError());
+
+		switch (chunkType)
+		{
+		case 'FFIR':
+			riffDataSize = chunkDataSize;
+			chunkDataSize = 4;
+			if (0 == ReadFile(file, &fileType, sizeof(DWORD), &read, NULL))
+				hr = HRESULT_FROM_WIN32(GetLastError());
+			break;
+
+		default:
+			if (INVALID_SET_FILE_POINTER == SetFilePointer(file, chunkDataSize, NULL, FILE_CURRENT))
+				return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		offset += sizeof(DWORD) * 2;
+
+		if (chunkType == fourcc)
+		{
+			*chunkSize = chunkDataSize;
+			*chunkDataPosition = offset;
+			return S_OK;
+		}
+
+		offset += chunkDataSize;
+
+		if (bytesRead >= riffDataSize) return S_FALSE;
+	}
+
+	return S_OK;
+}
+
+static HRESULT _benchLegacyReadChunk(HANDLE file, void* buffer, DWORD bufferSize, DWORD bufferOffset)
+{
+	HRESULT hr = S_OK;
+	if (INVALID_SET_FILE_POINTER == SetFilePointer(file, bufferOffset, NULL, FILE_BEGIN))
+		return HRESULT_FROM_WIN32(GetLastError());
+	DWORD read;
+	if (0 == ReadFile(file, buffer, bufferSize, &read, NULL))
+		hr = HRESULT_FROM_WIN32(GetLastError());
+	return hr;
+}
+
+/// @brief Fly flocks of 10, 100 and 1000 ducks through the sound policies into the software
+/// mixer, and 1000 without them for comparison. The triggers grow with the flock but the
+/// voices should stay within the policies' limits and the mixing with them. The mixer has a voice
+/// cap of its own, so the unlimited run has to show the policies are what hold the flock down
+/// @return false if the voices grow past the limits, the mixing grows with the flock, or the
+/// flock mixes as cheaply without the policies
+static bool _benchFlock()
+{
+	static Duck* ducks[BENCH_FLOCK_MAX];
+	static float mix[BENCH_FLOCK_MIX_FRAMES * MIXER_CHANNELS];
+	const uint32_t counts[] = { 10, 100, BENCH_FLOCK_MAX, BENCH_FLOCK_MAX };
+	const uint32_t runs = sizeof(counts) / sizeof(counts[0]);
+	const uint64_t period = 1000000000ull / BENCH_INPUT_FPS;
+	const Bounds2D bounds = { { 0.0f, 0.0f }, { 960.0f, 1024.0f } };
+	double mixUs[4];
+	uint32_t voicesRun[4];
+	uint32_t limit = 0;
+	bool bounded = true;
+
+	for (uint32_t i = 0; i < sizeof(_benchFlockSounds) / sizeof(_benchFlockSounds[0]); ++i)
+	{
+		limit += soundPolicies[_benchFlockSounds[i]].maxInstances;
+	}
+
+	for (uint32_t run = 0; run < runs; ++run)
+	{
+		// the last run goes without the policies
+		bool policies = (run < runs - 1);
+
+		// mixed here a frame at a time rather than on the mixer's thread
+		soundSetSink(mixerNullSink(), NULL);
+		soundInit(numSounds);
+		mixerStop();
+		for (uint32_t i = 0; i < numSounds; ++i)
+		{
+			_benchSoundIds[i] = SOUND_NOSOUND;
+		}
+		for (uint32_t i = 0; i < sizeof(_benchFlockSounds) / sizeof(_benchFlockSounds[0]); ++i)
+		{
+			soundIds id = _benchFlockSounds[i];
+			_benchSoundIds[id] = soundLoad(_benchFlockFiles[i]);
+			soundSetPriority(_benchSoundIds[id], soundPriorities[id]);
+			if (policies)
+				soundSetPolicy(_benchSoundIds[id], &soundPolicies[id]);
+		}
+
+		drawInit();
+		texMgrInit();
+		objMgrInit(counts[run] + 16);
+		inputInit();
+		duckInitTexture();
+		duckSetCB(_benchSound);
+		for (uint32_t i = 0; i < counts[run]; ++i)
+		{
+			ducks[i] = duckNew(bounds);
+		}
+		randSeed(1985);
+
+		uint32_t voices = 0;
+		uint64_t mixNs = 0;
+		uint64_t now = 0;
+		_benchTriggers = 0;
+		for (uint32_t frame = 0; frame < BENCH_FLOCK_FRAMES; ++frame)
+		{
+			for (uint32_t i = 0; i < counts[run]; i += 2)
+			{
+				if (!duckActiveStatus(&ducks[i]))
+					ducksSetActive(1, &ducks[i]);
+			}
+			now += period;
+			inputFrameBegin(now);
+			soundFrameBegin(now);
+			objMgrUpdate((Milliseconds)(period / 1000000.0));
+			voices = max(voices, soundGetActiveVoices());
+
+			uint64_t start = timerNowNanoseconds();
+			mixerRender(mix, BENCH_FLOCK_MIX_FRAMES);
+			mixNs += timerNowNanoseconds() - start;
+		}
+		mixUs[run] = mixNs / 1000.0 / BENCH_FLOCK_FRAMES;
+		voicesRun[run] = voices;
+
+		printf("  %4u ducks %-8s %7.0f triggers/s, %2u voices at most, %6.2f us mixing per frame\n",
+			   counts[run], policies ? "" : "no limit", _benchTriggers * (double)BENCH_INPUT_FPS / BENCH_FLOCK_FRAMES,
+			   voices, mixUs[run]);
+		if (policies && voices > limit)
+			bounded = false;
+
+		for (uint32_t i = 0; i < counts[run]; ++i)
+		{
+			duckDelete(ducks[i]);
+		}
+		duckClearCB();
+		duckReleaseTexture();
+		inputShutdown();
+		objMgrShutdown();
+		texMgrShutdown();
+		drawShutdown();
+		soundShutdown();
+		soundSetSink(NULL, NULL);
+	}
+
+	bool flat = (mixUs[2] <= mixUs[0] * BENCH_FLOCK_SLACK + BENCH_FLOCK_NOISE_US);
+	bool policed = (voicesRun[3] > limit && mixUs[2] < mixUs[3]);
+	printf("  the policies allow %u voices, mixing 1000 ducks costs %.1fx 10 ducks and %.1fx no limit\n", limit,
+		   (mixUs[0] > 0.0) ? mixUs[2] / mixUs[0] : 0.0, (mixUs[3] > 0.0) ? mixUs[2] / mixUs[3] : 0.0);
+	printf("  %s\n", (bounded && flat && policed) ? "PASS" : "FAIL");
+	return bounded && flat && policed;
+}
+
+/// @brief Count the flock's sounds and play them
+/// @param id
+static void _benchSound(soundIds id)
+{
+	_benchTriggers++;
+	soundPlay(_benchSoundIds[id]);
+}
+
+/// @brief Capture offscreen frames presented at half and at many times the video rate, and
+/// check the video keeps time and the capture stays within its budget on the GL thread
+/// @return false if the frame counts are off or the capture costs more than the budget
+static bool _benchCapture()
+{
+	const uint32_t rates[] = { BENCH_CAPTURE_FPS / 2, 0 };		// 0 presents as fast as it can
+	const char* rateNames[] = { "half rate", "uncapped" };
+	char filename[MAX_PATH];
+	bool ok = true;
+
+	Application* app = appNew(GetModuleHandle(NULL), "Duck Hunt bench", NULL, NULL);
+	if (app == NULL)
+		return false;
+	appSetWidth(app, 960);
+	appSetHeight(app, 1024);
+	GLOffscreen* offscreen = fwInitOffscreen(app);
+	DWORD length = GetTempPathA(MAX_PATH, filename);
+	if (offscreen == NULL || length == 0 || length + sizeof(BENCH_CAPTURE_FILE) > MAX_PATH)
+	{
+		fwShutdownOffscreen(offscreen);
+		appDelete(app);
+		return false;
+	}
+	strcat_s(filename, MAX_PATH, BENCH_CAPTURE_FILE);
+
+	for (uint32_t r = 0; r < 2; ++r)
+	{
+		if (!captureStart(filename, BENCH_CAPTURE_FPS))
+		{
+			ok = false;
+			break;
+		}
+		uint64_t start = timerNowMicroseconds();
+		uint64_t end = start + BENCH_CAPTURE_SECONDS * 1000000ull;
+		uint64_t next = start;
+		for (uint32_t f = 0; timerNowMicroseconds() < end; ++f)
+		{
+			// a different colour every frame, so nothing can be skipped as unchanged
+			glClearColor((f % 7) / 7.0f, (f % 11) / 11.0f, (f % 13) / 13.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			captureFrame();
+			glFinish();
+			if (rates[r] > 0)
+			{
+				next += 1000000ull / rates[r];
+				timerSleepUntil(next);
+			}
+		}
+		captureStop();
+
+		// the video runs from the first frame to one video frame past the last
+		const CaptureStats* stats = captureGetStats();
+		double seconds = (timerNowMicroseconds() - start) / 1000000.0;
+		double expected = BENCH_CAPTURE_SECONDS * (double)BENCH_CAPTURE_FPS;
+		bool timed = fabs(stats->frames - expected) <= BENCH_CAPTURE_SLACK_FRAMES;
+		bool cheap = stats->averageMs <= BENCH_CAPTURE_BUDGET_MS;
+		printf("  %-9s %5u presented in %.2f s, %4u video frames (%.0f due), %u dropped, %u repeated, "
+			   "%.3f ms average %.3f ms worst\n", rateNames[r], stats->presented, seconds, stats->frames,
+			   expected, stats->dropped, stats->repeated, stats->averageMs, stats->worstMs);
+		ok = ok && timed && cheap;
+	}
+	DeleteFileA(filename);
+
+	printf("  %s\n", ok ? "PASS" : "FAIL");
+	fwShutdownOffscreen(offscreen);
+	appDelete(app);
+	return ok;
+}
+
+/// @brief The score drawing as it was before the text module, kept as the baseline
+/// @param texture
+/// @param score
+static void _benchLegacyScore(GLuint texture, uint32_t score)
+{
+	const float NUM_WIDTH = 30.0f;
+	const float NUM_HEIGHT = 35.0f;
+	float leftx = 720.0f, topy = 887.0f;
+
+	for (int32_t i = 100000; i > 0; i /= 10)
+	{
+		float uPerNum = 1.0f / 11.0f;
+		float vPerNum = 1.0f / 2.0f;
+
+		uint32_t digit = (score / i) % 10;
+		float xTextureCoord = uPerNum * ((digit % 5) + 6);
+		float yTextureCoord = (digit >= 5) ? vPerNum : 1;
+
+		drawSprite(texture, leftx, leftx + NUM_WIDTH, topy, topy + NUM_HEIGHT,
+				   uPerNum, vPerNum, xTextureCoord, yTextureCoord, 0.76f);
+		leftx += NUM_WIDTH;
+	}
+}
+
+/// @brief The ducks call back for their sounds, nothing is playing here
+/// @param id
+static void _benchNoSound(soundIds id)
+{
+}
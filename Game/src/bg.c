@@ -5,10 +5,10 @@
 
 #include "bg.h"
 #include "Object.h"
-#include "SOIL.h"
 #include "globals.h"
 #include "baseTypes.h"
 #include "draw.h"
+#include "texmgr.h"
 
 typedef enum bgState_t
 {
@@ -26,11 +26,12 @@ typedef struct bg_t
 } Bg;
 
 // the object vtable for the UI object
-static void _bgUpdate(Object* obj, uint32_t milliseconds);
+static void _bgUpdate(Object* obj, Milliseconds milliseconds);
 static void _bgDraw(Object* obj);
 static ObjVtable _bgVtable = {
     _bgDraw,
-    _bgUpdate
+    _bgUpdate,
+    "bg"
 };
 
 
@@ -45,12 +46,18 @@ void bgInitTexture()
 {
     if (_bgTexture == 0)
     {
-        _bgTexture = SOIL_load_OGL_texture(BG, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-             SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+        _bgTexture = texMgrAcquire(BG);
         assert(_bgTexture != 0);
     }
 }
 
+// release the bg image
+void bgReleaseTexture()
+{
+    texMgrRelease(_bgTexture);
+    _bgTexture = 0;
+}
+
 /// @brief Instantiate and initialize the BG
 /// @param bounds 
 /// @return 
@@ -100,7 +107,7 @@ void bgDeInit(Bg* bg)
     free(bg);
 }
 
-static void _bgUpdate(Object* obj, uint32_t milliseconds)
+static void _bgUpdate(Object* obj, Milliseconds milliseconds)
 {
 
 }
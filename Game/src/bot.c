@@ -0,0 +1,268 @@
+#include <Windows.h>
+#include <Psapi.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "bot.h"
+#include "levelmgr.h"
+#include "random.h"
+#include "sound.h"
+#include "globals.h"
+
+// A player for load and soak tests. It's a pointer backend polled at the start of every update,
+// so the game sees its shots exactly as it would a light gun's and runs unmodified. Every so
+// often it logs the frame times, memory and voices, to catch anything that creeps over hours
+
+#define BOT_DEFAULT_SKILL "average"
+#define BOT_MENU_CLICK_INTERVAL 1000.0f		// milliseconds between clicks to start a game
+#define BOT_MAX_AIM_TRIES 8					// rerolls of a shaky aim before waiting for the next frame
+
+static const BotSkill _skills[] = {
+	// name			reaction	jitter		aimError	holdFire	interval	predict
+	{ "novice",		600.0f,		150.0f,		25.0f,		60.0f,		400.0f,		false },
+	{ "average",	350.0f,		100.0f,		12.0f,		40.0f,		250.0f,		false },
+	{ "expert",		200.0f,		50.0f,		5.0f,		20.0f,		150.0f,		true },
+	{ "perfect",	0.0f,		0.0f,		0.0f,		0.0f,		100.0f,		true }
+};
+
+static struct bot_t {
+	const BotSkill*	skill;
+	uint64_t		logInterval;			// nanoseconds
+	bool			triggerHeld;
+	Coord2D			aim;
+	uint64_t		targetSince;			// 0 while no duck is flying
+	uint64_t		fireAt;
+	uint64_t		nextShot;
+	uint64_t		lastPoll;
+	levelState		lastState;
+
+	// soak stats, since the last log
+	uint64_t		logStart;
+	uint64_t		frames;
+	uint64_t		frameTotal;
+	uint64_t		frameMax;
+	uint32_t		shots;
+	uint32_t		held;
+	uint32_t		games;
+	uint32_t		logs;
+} _bot;
+
+static bool _botStart(const void* config);
+static void _botStop();
+static void _botPoll(uint64_t frameTime);
+static void _botFire(Coord2D aim, uint64_t frameTime);
+static void _botLog(uint64_t frameTime);
+static float _botGaussian();
+static uint64_t _botNanoseconds(Milliseconds milliseconds);
+
+static const InputPointerBackend _botBackend = {
+	"bot",
+	_botStart,
+	_botStop,
+	_botPoll
+};
+
+/// @brief Look up a skill preset
+/// @param name novice, average, expert or perfect, NULL for the default
+/// @return NULL if there's no such preset
+const BotSkill* botFindSkill(const char* name)
+{
+	if (name == NULL || name[0] == '\0')
+	{
+		name = BOT_DEFAULT_SKILL;
+	}
+	for (uint32_t i = 0; i < sizeof(_skills) / sizeof(_skills[0]); ++i)
+	{
+		if (strcmp(_skills[i].name, name) == 0)
+			return &_skills[i];
+	}
+	return NULL;
+}
+
+/// @brief The bot, to hand to inputPointerStart with a BotConfig
+/// @return
+const InputPointerBackend* botGetBackend()
+{
+	return &_botBackend;
+}
+
+/// @brief Start playing
+/// @param config a BotConfig
+/// @return
+static bool _botStart(const void* config)
+{
+	const BotConfig* botConfig = (const BotConfig*)config;
+	if (botConfig->skill == NULL)
+		return false;
+
+	ZeroMemory(&_bot, sizeof(_bot));
+	_bot.skill = botConfig->skill;
+	_bot.logInterval = (uint64_t)botConfig->logMinutes * 60ull * 1000000000ull;
+	printf("bot: playing as %s, logging every %u minutes\n", _bot.skill->name, botConfig->logMinutes);
+	return true;
+}
+
+/// @brief Log whatever has built up since the last log
+static void _botStop()
+{
+	if (_bot.frames > 0)
+	{
+		_botLog(_bot.lastPoll);
+	}
+	_bot.skill = NULL;
+}
+
+/// @brief Decide what to do this frame. A press goes in one frame and its release the next,
+/// like a trigger pull
+/// @param frameTime when the update starts, timerNowNanoseconds
+static void _botPoll(uint64_t frameTime)
+{
+	if (_bot.lastPoll == 0)
+	{
+		_bot.logStart = frameTime;
+	}
+	else
+	{
+		uint64_t frame = frameTime - _bot.lastPoll;
+		_bot.frames++;
+		_bot.frameTotal += frame;
+		if (frame > _bot.frameMax)
+		{
+			_bot.frameMax = frame;
+		}
+	}
+	Milliseconds sinceLastPoll = (_bot.lastPoll > 0) ? (frameTime - _bot.lastPoll) / 1000000.0f : 0.0f;
+	_bot.lastPoll = frameTime;
+	if (_bot.logInterval > 0 && frameTime - _bot.logStart >= _bot.logInterval)
+	{
+		_botLog(frameTime);
+	}
+
+	// a game has started when the menu gives way, however many clicks that took
+	levelState state = levelMgrGetState();
+	if (_bot.lastState == menuScreen && state != menuScreen)
+	{
+		_bot.games++;
+	}
+	_bot.lastState = state;
+
+	if (_bot.triggerHeld)
+	{
+		_bot.triggerHeld = false;
+		inputPointerSample(_bot.aim, 0, frameTime);
+		return;
+	}
+
+	// any click starts a game, and the game goes back to the menu when it's over
+	if (state == menuScreen)
+	{
+		if (frameTime >= _bot.nextShot)
+		{
+			Coord2D centre = { uiSize.x / 2.0f, uiSize.y / 2.0f };
+			_botFire(centre, frameTime);
+			_bot.nextShot = frameTime + _botNanoseconds(BOT_MENU_CLICK_INTERVAL);
+		}
+		return;
+	}
+
+	Coord2D position, velocity;
+	if (!levelMgrFindTarget(&position, &velocity))
+	{
+		_bot.targetSince = 0;
+		return;
+	}
+	if (_bot.targetSince == 0)
+	{
+		Milliseconds reaction = _bot.skill->reaction + _botGaussian() * _bot.skill->reactionJitter;
+		_bot.targetSince = frameTime;
+		_bot.fireAt = frameTime + _botNanoseconds(reaction);
+	}
+
+	// the ducks were last moved a frame ago, and the shot is tested against where they are now
+	Coord2D target = position;
+	if (_bot.skill->predict)
+	{
+		target.x += velocity.x * sinceLastPoll / 1000.0f;
+		target.y += velocity.y * sinceLastPoll / 1000.0f;
+	}
+	if (frameTime < _bot.fireAt || frameTime < _bot.nextShot)
+	{
+		// follow the duck with the crosshair while waiting
+		inputPointerSample(target, 0, frameTime);
+		return;
+	}
+
+	// trigger discipline: steady the aim before firing, and wait for a better frame if it won't
+	for (uint32_t i = 0; i < BOT_MAX_AIM_TRIES; ++i)
+	{
+		Coord2D error = { _botGaussian() * _bot.skill->aimError, _botGaussian() * _bot.skill->aimError };
+		if (sqrtf(error.x * error.x + error.y * error.y) <= _bot.skill->holdFire)
+		{
+			Coord2D aim = { target.x + error.x, target.y + error.y };
+			_botFire(aim, frameTime);
+			_bot.nextShot = frameTime + _botNanoseconds(_bot.skill->shotInterval);
+			return;
+		}
+	}
+	_bot.held++;
+	inputPointerSample(target, 0, frameTime);
+}
+
+/// @brief Press the trigger, released on the next poll
+/// @param aim
+/// @param frameTime
+static void _botFire(Coord2D aim, uint64_t frameTime)
+{
+	_bot.aim = aim;
+	_bot.triggerHeld = true;
+	_bot.shots++;
+	inputPointerSample(aim, 1u << INPUT_BUTTON_LEFT, frameTime);
+}
+
+/// @brief Print the soak stats since the last log and start over
+/// @param frameTime
+static void _botLog(uint64_t frameTime)
+{
+	PROCESS_MEMORY_COUNTERS memory;
+	ZeroMemory(&memory, sizeof(memory));
+	memory.cb = sizeof(memory);
+	GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory));
+
+	_bot.logs++;
+	printf("bot: log %u: %llu frames, %.2f ms avg, %.2f ms max, RSS %.1f MB, %u voices playing, "
+		   "%u created, %u shots, %u held, %u games\n",
+		   _bot.logs, (unsigned long long)_bot.frames,
+		   (_bot.frames > 0) ? _bot.frameTotal / (double)_bot.frames / 1000000.0 : 0.0,
+		   _bot.frameMax / 1000000.0,
+		   memory.WorkingSetSize / (1024.0 * 1024.0),
+		   soundGetActiveVoices(), soundGetVoicesCreated(),
+		   _bot.shots, _bot.held, _bot.games);
+	fflush(stdout);
+
+	_bot.logStart = frameTime;
+	_bot.frames = 0;
+	_bot.frameTotal = 0;
+	_bot.frameMax = 0;
+	_bot.shots = 0;
+	_bot.held = 0;
+	_bot.games = 0;
+}
+
+/// @brief A normally distributed value with a standard deviation of 1
+/// @return
+static float _botGaussian()
+{
+	const float TWO_PI = 6.28318531f;
+	float u = randGetFloat(1.0e-6f, 1.0f);
+	float v = randGetFloat(0.0f, 1.0f);
+	return sqrtf(-2.0f * logf(u)) * cosf(TWO_PI * v);
+}
+
+/// @brief
+/// @param milliseconds negative counts as 0
+/// @return
+static uint64_t _botNanoseconds(Milliseconds milliseconds)
+{
+	return (milliseconds > 0.0f) ? (uint64_t)(milliseconds * 1000000.0) : 0;
+}
@@ -0,0 +1,561 @@
+#include <Windows.h>
+#include <gl/GL.h>
+#include <emmintrin.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "framework.h"
+#include "timer.h"
+#include "profile.h"
+
+// Records the presented frames to a Y4M file, or to raw I420 for any other extension.
+// The video runs at a fixed rate against the timer: each video frame shows the last frame
+// presented by its time, so frames presented faster than that are dropped and slow ones are
+// repeated. How long a frame stays up is only known at the next present, so it waits until then.
+// captureFrame reads the back buffer on the thread owning the GL context. With pixel buffer
+// objects the read of one frame overlaps drawing the next and only a copy is left on that
+// thread. The copies go to a ring of preallocated slots, and a writer thread converts them
+// to YUV420 and writes them out. When the writer falls behind, the newest queued frame is
+// written again in place of the dropped one so the video keeps time
+
+#define CAPTURE_SLOTS 8
+#define CAPTURE_PBOS 2
+#define CAPTURE_DEFAULT_FPS 60
+
+#ifndef GL_PIXEL_PACK_BUFFER
+typedef ptrdiff_t GLsizeiptr;
+
+#define GL_PIXEL_PACK_BUFFER				0x88EB
+#define GL_STREAM_READ						0x88E1
+#define GL_READ_ONLY						0x88B8
+#endif
+#ifndef GL_BGRA
+#define GL_BGRA								0x80E1
+#endif
+
+typedef void (APIENTRY* GenBuffersFunc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* BindBufferFunc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* DeleteBuffersFunc)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY* BufferDataFunc)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+typedef void* (APIENTRY* MapBufferFunc)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY* UnmapBufferFunc)(GLenum target);
+
+/// @brief One captured frame, BGRA with rows bottom to top as GL reads them
+typedef struct capture_slot_t {
+	uint8_t* pixels;
+	// extra times to write this frame, for frames dropped while the ring was full
+	uint32_t repeats;
+} CaptureSlot;
+
+static struct capture_t {
+	bool active;
+	bool y4m;
+	FILE* file;
+	uint32_t fps;
+	int32_t width;
+	int32_t height;
+
+	// GL thread side, set up at the first frame
+	bool glReady;
+	bool failed;
+	bool pboReady;
+	GLuint pbos[CAPTURE_PBOS];
+	uint32_t pboFrames;
+	uint64_t pboVideoFrames[CAPTURE_PBOS];	// video frame each read in flight was presented at
+	GenBuffersFunc GenBuffers;
+	BindBufferFunc BindBuffer;
+	DeleteBuffersFunc DeleteBuffers;
+	BufferDataFunc BufferData;
+	MapBufferFunc MapBuffer;
+	UnmapBufferFunc UnmapBuffer;
+
+	// frames waiting for the writer, as a ring
+	CaptureSlot slots[CAPTURE_SLOTS];
+	uint32_t head;
+	uint32_t count;
+	bool stopping;
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE changed;
+	HANDLE writer;
+
+	// writer side
+	uint8_t* yuv;
+
+	// the newest frame, copied but not handed to the writer until the next present
+	uint64_t startMicroseconds;
+	bool pending;
+	bool pendingInRing;					// false if the ring was full, the newest queued one stands in
+	uint64_t pendingVideoFrame;
+} _capture;
+
+static CaptureStats _captureStats;
+
+static bool _captureSetup();
+static uint64_t _captureVideoFrame();
+static void _captureQueue(const uint8_t* pixels, uint64_t videoFrame);
+static void _captureSettle(uint64_t videoFrame);
+static void _captureFlushPbos();
+static DWORD WINAPI _captureWriter(LPVOID param);
+static void _captureConvert(const uint8_t* bgra, int32_t width, int32_t height, uint8_t* yuv);
+static __m128i _captureDot(__m128i pixels, __m128i coeffs);
+
+/// @brief Open the output and start the writer. The frame size is taken from the viewport
+/// at the first captured frame
+/// @param filename .y4m for Y4M, anything else for headerless I420
+/// @param fps frame rate to tag the video with, 0 for the default
+/// @return false if the file couldn't be opened
+bool captureStart(const char* filename, uint32_t fps)
+{
+	ZeroMemory(&_capture, sizeof(_capture));
+	ZeroMemory(&_captureStats, sizeof(_captureStats));
+	if (fopen_s(&_capture.file, filename, "wb") != 0 || _capture.file == NULL)
+	{
+		printf("capture: can't open %s\n", filename);
+		return false;
+	}
+	size_t length = strlen(filename);
+	_capture.y4m = (length >= 4 && _stricmp(filename + length - 4, ".y4m") == 0);
+	_capture.fps = (fps > 0) ? fps : CAPTURE_DEFAULT_FPS;
+
+	InitializeCriticalSection(&_capture.lock);
+	InitializeConditionVariable(&_capture.changed);
+	_capture.writer = CreateThread(NULL, 0, _captureWriter, NULL, 0, NULL);
+	if (_capture.writer == NULL)
+	{
+		DeleteCriticalSection(&_capture.lock);
+		fclose(_capture.file);
+		_capture.file = NULL;
+		return false;
+	}
+	_capture.active = true;
+	return true;
+}
+
+/// @brief Read back what is in flight, let the writer finish and close the file.
+/// The GL context must be current on the calling thread
+void captureStop()
+{
+	if (!_capture.active)
+		return;
+
+	_captureFlushPbos();
+	if (_capture.pboReady)
+	{
+		_capture.DeleteBuffers(CAPTURE_PBOS, _capture.pbos);
+	}
+
+	EnterCriticalSection(&_capture.lock);
+	_capture.stopping = true;
+	WakeAllConditionVariable(&_capture.changed);
+	LeaveCriticalSection(&_capture.lock);
+	WaitForSingleObject(_capture.writer, INFINITE);
+	CloseHandle(_capture.writer);
+	DeleteCriticalSection(&_capture.lock);
+
+	fclose(_capture.file);
+	for (uint32_t i = 0; i < CAPTURE_SLOTS; ++i)
+	{
+		free(_capture.slots[i].pixels);
+	}
+	free(_capture.yuv);
+
+	if (_captureStats.presented > 0)
+	{
+		_captureStats.averageMs /= _captureStats.presented;
+		printf("capture: %u frames at %dx%d %u fps from %u presented, %u dropped, %u repeated, "
+			   "%.3f ms average %.3f ms worst on the GL thread\n",
+			   _captureStats.frames, _capture.width, _capture.height, _capture.fps, _captureStats.presented,
+			   _captureStats.dropped, _captureStats.repeated, _captureStats.averageMs, _captureStats.worstMs);
+	}
+	ZeroMemory(&_capture, sizeof(_capture));
+}
+
+/// @brief Whether frames are being recorded
+/// @return
+bool captureActive()
+{
+	return _capture.active;
+}
+
+/// @brief What the last capture recorded and what it cost the GL thread, kept after captureStop
+/// @return
+const CaptureStats* captureGetStats()
+{
+	return &_captureStats;
+}
+
+/// @brief Capture the frame just drawn into the back buffer. Called by the thread that owns
+/// the context, before the swap
+void captureFrame()
+{
+	if (!_capture.active || _capture.failed)
+		return;
+
+	PROFILE_BEGIN("captureFrame");
+	uint64_t start = timerNowMicroseconds();
+	if (!_capture.glReady)
+	{
+		_capture.glReady = true;
+		if (!_captureSetup())
+		{
+			// nothing to capture into, leave the game running
+			printf("capture: out of memory\n");
+			_capture.failed = true;
+			PROFILE_END();
+			return;
+		}
+	}
+
+	uint64_t videoFrame = _captureVideoFrame();
+	_captureStats.presented++;
+	if (_capture.pboReady)
+	{
+		// collect the read started a frame ago, unless this one took its place on the video
+		if (_capture.pboFrames > 0)
+		{
+			uint32_t previous = (_capture.pboFrames - 1) % CAPTURE_PBOS;
+			if (videoFrame > _capture.pboVideoFrames[previous])
+			{
+				_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, _capture.pbos[previous]);
+				const uint8_t* pixels = _capture.MapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+				if (pixels != NULL)
+				{
+					_captureQueue(pixels, _capture.pboVideoFrames[previous]);
+					_capture.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				}
+			}
+			else
+			{
+				_captureStats.dropped++;
+			}
+		}
+		_captureSettle(videoFrame);
+
+		// then start reading this one
+		uint32_t index = _capture.pboFrames % CAPTURE_PBOS;
+		_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, _capture.pbos[index]);
+		glReadPixels(0, 0, _capture.width, _capture.height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+		_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		_capture.pboVideoFrames[index] = videoFrame;
+		++_capture.pboFrames;
+	}
+	else
+	{
+		_captureSettle(videoFrame);
+		_captureQueue(NULL, videoFrame);
+	}
+
+	double spent = (timerNowMicroseconds() - start) / 1000.0;
+	_captureStats.averageMs += spent;
+	_captureStats.worstMs = max(_captureStats.worstMs, spent);
+	PROFILE_END();
+}
+
+/// @brief Size the capture from the viewport, allocate the ring and the pixel buffers
+/// @return false if out of memory
+static bool _captureSetup()
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	// 4:2:0 needs even dimensions
+	_capture.width = viewport[2] & ~1;
+	_capture.height = viewport[3] & ~1;
+	if (_capture.width <= 0 || _capture.height <= 0)
+		return false;
+	_capture.startMicroseconds = timerNowMicroseconds();
+
+	size_t frameBytes = (size_t)_capture.width * _capture.height * 4;
+	for (uint32_t i = 0; i < CAPTURE_SLOTS; ++i)
+	{
+		_capture.slots[i].pixels = malloc(frameBytes);
+		if (_capture.slots[i].pixels == NULL)
+			return false;
+	}
+	_capture.yuv = malloc((size_t)_capture.width * _capture.height * 3 / 2);
+	if (_capture.yuv == NULL)
+		return false;
+
+	if (_capture.y4m)
+	{
+		fprintf(_capture.file, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg\n",
+				_capture.width, _capture.height, _capture.fps);
+	}
+
+	// pixel buffer objects are GL 1.5, without them the read stalls until the frame is drawn
+	_capture.GenBuffers = (GenBuffersFunc)fwGetProcAddress("glGenBuffers");
+	_capture.BindBuffer = (BindBufferFunc)fwGetProcAddress("glBindBuffer");
+	_capture.DeleteBuffers = (DeleteBuffersFunc)fwGetProcAddress("glDeleteBuffers");
+	_capture.BufferData = (BufferDataFunc)fwGetProcAddress("glBufferData");
+	_capture.MapBuffer = (MapBufferFunc)fwGetProcAddress("glMapBuffer");
+	_capture.UnmapBuffer = (UnmapBufferFunc)fwGetProcAddress("glUnmapBuffer");
+	_capture.pboReady = _capture.GenBuffers != NULL && _capture.BindBuffer != NULL &&
+						_capture.DeleteBuffers != NULL && _capture.BufferData != NULL &&
+						_capture.MapBuffer != NULL && _capture.UnmapBuffer != NULL;
+	if (_capture.pboReady)
+	{
+		_capture.GenBuffers(CAPTURE_PBOS, _capture.pbos);
+		for (uint32_t i = 0; i < CAPTURE_PBOS; ++i)
+		{
+			_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, _capture.pbos[i]);
+			_capture.BufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frameBytes, NULL, GL_STREAM_READ);
+		}
+		_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	return true;
+}
+
+/// @brief The video frame due on the timer, counted from the first captured frame
+/// @return
+static uint64_t _captureVideoFrame()
+{
+	uint64_t elapsed = timerNowMicroseconds() - _capture.startMicroseconds;
+	return elapsed * _capture.fps / 1000000ull;
+}
+
+/// @brief Copy a frame into the next free slot, to be handed to the writer by _captureSettle.
+/// If the ring is full the newest queued frame is written again in its place
+/// @param pixels mapped pixel buffer, or NULL to read the back buffer directly
+/// @param videoFrame when it was presented
+static void _captureQueue(const uint8_t* pixels, uint64_t videoFrame)
+{
+	EnterCriticalSection(&_capture.lock);
+	bool full = (_capture.count == CAPTURE_SLOTS);
+	LeaveCriticalSection(&_capture.lock);
+
+	_capture.pending = true;
+	_capture.pendingInRing = !full;
+	_capture.pendingVideoFrame = videoFrame;
+	if (full)
+		return;
+
+	// only this thread moves the head, and the writer never touches a free slot
+	CaptureSlot* slot = &_capture.slots[_capture.head];
+	size_t frameBytes = (size_t)_capture.width * _capture.height * 4;
+	if (pixels != NULL)
+	{
+		memcpy(slot->pixels, pixels, frameBytes);
+	}
+	else
+	{
+		glReadPixels(0, 0, _capture.width, _capture.height, GL_BGRA, GL_UNSIGNED_BYTE, slot->pixels);
+	}
+}
+
+/// @brief Hand the pending frame to the writer, once for every video frame until the next one
+/// was presented. A frame the next one replaced before any video frame came due is dropped and
+/// its slot reused
+/// @param videoFrame when the next frame was presented
+static void _captureSettle(uint64_t videoFrame)
+{
+	if (!_capture.pending)
+		return;
+
+	_capture.pending = false;
+	uint32_t copies = (videoFrame > _capture.pendingVideoFrame) ? (uint32_t)(videoFrame - _capture.pendingVideoFrame) : 0;
+	if (copies == 0)
+	{
+		_captureStats.dropped++;
+		return;
+	}
+
+	EnterCriticalSection(&_capture.lock);
+	if (_capture.pendingInRing)
+	{
+		_capture.slots[_capture.head].repeats = copies - 1;
+		_capture.head = (_capture.head + 1) % CAPTURE_SLOTS;
+		_capture.count++;
+		_captureStats.frames += copies;
+		_captureStats.repeated += copies - 1;
+		WakeAllConditionVariable(&_capture.changed);
+	}
+	else if (_capture.count > 0)
+	{
+		_capture.slots[(_capture.head + CAPTURE_SLOTS - 1) % CAPTURE_SLOTS].repeats += copies;
+		_captureStats.frames += copies;
+		_captureStats.repeated += copies;
+	}
+	else
+	{
+		// the writer caught up with everything before the stand in could be repeated
+		_captureStats.dropped++;
+	}
+	LeaveCriticalSection(&_capture.lock);
+}
+
+/// @brief Queue the frame still being read into a pixel buffer, and give the last frame one
+/// video frame of its own
+static void _captureFlushPbos()
+{
+	if (_capture.pboReady && _capture.pboFrames > 0)
+	{
+		uint32_t last = (_capture.pboFrames - 1) % CAPTURE_PBOS;
+		_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, _capture.pbos[last]);
+		const uint8_t* pixels = _capture.MapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (pixels != NULL)
+		{
+			_captureQueue(pixels, _capture.pboVideoFrames[last]);
+			_capture.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		_capture.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	if (_capture.pending)
+	{
+		_captureSettle(_capture.pendingVideoFrame + 1);
+	}
+}
+
+/// @brief Convert and write queued frames until stopped and drained
+/// @param param unused
+/// @return
+static DWORD WINAPI _captureWriter(LPVOID param)
+{
+	size_t yuvBytes = 0;
+	PROFILE_THREAD("capture");
+
+	EnterCriticalSection(&_capture.lock);
+	for (;;)
+	{
+		while (_capture.count == 0 && !_capture.stopping)
+		{
+			SleepConditionVariableCS(&_capture.changed, &_capture.lock, INFINITE);
+		}
+		if (_capture.count == 0)
+			break;
+
+		uint32_t tail = (_capture.head + CAPTURE_SLOTS - _capture.count) % CAPTURE_SLOTS;
+		CaptureSlot* slot = &_capture.slots[tail];
+		LeaveCriticalSection(&_capture.lock);
+
+		yuvBytes = (size_t)_capture.width * _capture.height * 3 / 2;
+		PROFILE_BEGIN("captureConvert");
+		_captureConvert(slot->pixels, _capture.width, _capture.height, _capture.yuv);
+		PROFILE_END();
+
+		EnterCriticalSection(&_capture.lock);
+		uint32_t writes = 1 + slot->repeats;
+		slot->repeats = 0;
+		_capture.count--;
+		WakeAllConditionVariable(&_capture.changed);
+		LeaveCriticalSection(&_capture.lock);
+
+		for (uint32_t i = 0; i < writes; ++i)
+		{
+			if (_capture.y4m)
+			{
+				fputs("FRAME\n", _capture.file);
+			}
+			fwrite(_capture.yuv, 1, yuvBytes, _capture.file);
+		}
+
+		EnterCriticalSection(&_capture.lock);
+	}
+	LeaveCriticalSection(&_capture.lock);
+	return 0;
+}
+
+/// @brief BGRA, bottom row first, to planar I420 top row first with BT.601 studio swing.
+/// Eight pixels of two rows at a time, chroma from the average of each 2x2 block
+/// @param bgra
+/// @param width even
+/// @param height even
+/// @param yuv width * height * 3 / 2 bytes
+static void _captureConvert(const uint8_t* bgra, int32_t width, int32_t height, uint8_t* yuv)
+{
+	const __m128i LUMA = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+	const __m128i BLUE_DIFF = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+	const __m128i RED_DIFF = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+	const __m128i ROUND = _mm_set1_epi32(128);
+	const __m128i LUMA_OFFSET = _mm_set1_epi16(16);
+	const __m128i CHROMA_OFFSET = _mm_set1_epi16(128);
+
+	uint8_t* planeY = yuv;
+	uint8_t* planeU = planeY + width * height;
+	uint8_t* planeV = planeU + (width / 2) * (height / 2);
+	int32_t stride = width * 4;
+	int32_t wide = width & ~7;
+
+	for (int32_t y = 0; y < height; y += 2)
+	{
+		const uint8_t* top = bgra + (size_t)(height - 1 - y) * stride;
+		const uint8_t* bottom = top - stride;
+		uint8_t* lumaTop = planeY + (size_t)y * width;
+		uint8_t* lumaBottom = lumaTop + width;
+		uint8_t* u = planeU + (size_t)(y / 2) * (width / 2);
+		uint8_t* v = planeV + (size_t)(y / 2) * (width / 2);
+
+		int32_t x = 0;
+		for (; x < wide; x += 8)
+		{
+			__m128i top0 = _mm_loadu_si128((const __m128i*)(top + x * 4));
+			__m128i top1 = _mm_loadu_si128((const __m128i*)(top + x * 4 + 16));
+			__m128i bottom0 = _mm_loadu_si128((const __m128i*)(bottom + x * 4));
+			__m128i bottom1 = _mm_loadu_si128((const __m128i*)(bottom + x * 4 + 16));
+
+			__m128i luma = _mm_packs_epi32(
+				_mm_srai_epi32(_mm_add_epi32(_captureDot(top0, LUMA), ROUND), 8),
+				_mm_srai_epi32(_mm_add_epi32(_captureDot(top1, LUMA), ROUND), 8));
+			luma = _mm_add_epi16(luma, LUMA_OFFSET);
+			_mm_storel_epi64((__m128i*)(lumaTop + x), _mm_packus_epi16(luma, luma));
+
+			luma = _mm_packs_epi32(
+				_mm_srai_epi32(_mm_add_epi32(_captureDot(bottom0, LUMA), ROUND), 8),
+				_mm_srai_epi32(_mm_add_epi32(_captureDot(bottom1, LUMA), ROUND), 8));
+			luma = _mm_add_epi16(luma, LUMA_OFFSET);
+			_mm_storel_epi64((__m128i*)(lumaBottom + x), _mm_packus_epi16(luma, luma));
+
+			// average down the columns, then across neighbouring pixels
+			__m128 column0 = _mm_castsi128_ps(_mm_avg_epu8(top0, bottom0));
+			__m128 column1 = _mm_castsi128_ps(_mm_avg_epu8(top1, bottom1));
+			__m128i block = _mm_avg_epu8(
+				_mm_castps_si128(_mm_shuffle_ps(column0, column1, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm_castps_si128(_mm_shuffle_ps(column0, column1, _MM_SHUFFLE(3, 1, 3, 1))));
+
+			__m128i chroma = _mm_packs_epi32(
+				_mm_srai_epi32(_mm_add_epi32(_captureDot(block, BLUE_DIFF), ROUND), 8),
+				_mm_srai_epi32(_mm_add_epi32(_captureDot(block, RED_DIFF), ROUND), 8));
+			chroma = _mm_add_epi16(chroma, CHROMA_OFFSET);
+			chroma = _mm_packus_epi16(chroma, chroma);
+			*(int32_t*)(u + x / 2) = _mm_cvtsi128_si32(chroma);
+			*(int32_t*)(v + x / 2) = _mm_cvtsi128_si32(_mm_srli_si128(chroma, 4));
+		}
+
+		// whatever doesn't fill eight pixels
+		for (; x < width; x += 2)
+		{
+			const uint8_t* p[4] = { top + x * 4, top + x * 4 + 4, bottom + x * 4, bottom + x * 4 + 4 };
+			uint8_t* luma[4] = { lumaTop + x, lumaTop + x + 1, lumaBottom + x, lumaBottom + x + 1 };
+			int32_t blue = 0, green = 0, red = 0;
+			for (int32_t i = 0; i < 4; ++i)
+			{
+				*luma[i] = (uint8_t)(((25 * p[i][0] + 129 * p[i][1] + 66 * p[i][2] + 128) >> 8) + 16);
+				blue += p[i][0];
+				green += p[i][1];
+				red += p[i][2];
+			}
+			blue = (blue + 2) / 4;
+			green = (green + 2) / 4;
+			red = (red + 2) / 4;
+			u[x / 2] = (uint8_t)(((112 * blue - 74 * green - 38 * red + 128) >> 8) + 128);
+			v[x / 2] = (uint8_t)(((-18 * blue - 94 * green + 112 * red + 128) >> 8) + 128);
+		}
+	}
+}
+
+/// @brief Weighted sum of the channels of four BGRA pixels
+/// @param pixels four BGRA pixels
+/// @param coeffs blue, green, red, alpha weights, twice
+/// @return four 32-bit sums
+static __m128i _captureDot(__m128i pixels, __m128i coeffs)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	// each madd leaves blue+green and red+alpha for two pixels
+	__m128 low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coeffs));
+	__m128 high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coeffs));
+	__m128i even = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i odd = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+	return _mm_add_epi32(even, odd);
+}
@@ -0,0 +1,409 @@
+#include <Windows.h>
+#include <gl/GLU.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "compositor.h"
+
+// the back buffer is either copied or exchanged on swap, so the regions that need
+// recompositing are the changes from the last two frames combined
+#define MAX_DIRTY_RECTS 8
+#define MAX_RAW_RECTS 64
+#define FULL_REDRAW_RATIO 0.6f
+#define STATS_INTERVAL 300
+
+/// @brief Pixel space rectangle, x1 and y1 are exclusive
+typedef struct rect_t {
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+} Rect;
+
+static struct compositor_t {
+    // copy of the last presented frame, hashed for lookup
+    SpriteCmd* prev;
+    uint32_t prevCount;
+    uint32_t prevMax;
+    uint32_t* table;
+    uint32_t tableSize;
+    bool* used;
+
+    // changes found in the last frame
+    Rect lastDirty[MAX_DIRTY_RECTS];
+    uint32_t lastDirtyCount;
+    bool lastFull;
+
+    bool valid;
+    GLint viewport[4];
+
+    // stats
+    uint32_t frames;
+    uint32_t rects;
+    double pixelsTouched;
+    double pixelsFull;
+} _compositor;
+
+static uint32_t _compositorHash(const SpriteCmd* cmd);
+static void _compositorStore(const SpriteCmd* cmds, uint32_t count);
+static bool _compositorDiff(const SpriteCmd* cmds, uint32_t count, Rect* rects, uint32_t* rectCount);
+static uint32_t _compositorMergeRects(Rect* rects, uint32_t count);
+static Rect _compositorCmdRect(const SpriteCmd* cmd);
+static Rect _compositorIntersect(Rect a, Rect b);
+static double _compositorArea(Rect r);
+static void _compositorReport();
+
+/// @brief Initialize the compositor
+void compositorInit()
+{
+    ZeroMemory(&_compositor, sizeof(_compositor));
+}
+
+/// @brief Free up the cached frame
+void compositorShutdown()
+{
+    free(_compositor.prev);
+    free(_compositor.table);
+    free(_compositor.used);
+    ZeroMemory(&_compositor, sizeof(_compositor));
+}
+
+/// @brief Draw the frame, only recompositing the regions that differ from the frames already in the back buffer
+/// @param cmds
+/// @param count
+void compositorPresent(const SpriteCmd* cmds, uint32_t count)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    Rect screen = { 0, 0, viewport[2], viewport[3] };
+    double screenArea = _compositorArea(screen);
+
+    // anything that invalidates the whole back buffer forces a full redraw
+    bool diffFull = !_compositor.valid || memcmp(viewport, _compositor.viewport, sizeof(viewport)) != 0;
+
+    Rect rects[MAX_RAW_RECTS + MAX_DIRTY_RECTS];
+    uint32_t rectCount = 0;
+    if (!diffFull)
+    {
+        diffFull = !_compositorDiff(cmds, count, rects, &rectCount);
+    }
+    if (!diffFull)
+    {
+        rectCount = _compositorMergeRects(rects, rectCount);
+    }
+
+    // combine with last frame's changes for the buffer we are about to draw over
+    bool full = diffFull || _compositor.lastFull;
+    Rect lastDirty[MAX_DIRTY_RECTS];
+    uint32_t lastDirtyCount = _compositor.lastDirtyCount;
+    memcpy(lastDirty, _compositor.lastDirty, lastDirtyCount * sizeof(Rect));
+
+    _compositor.lastFull = diffFull;
+    _compositor.lastDirtyCount = 0;
+    if (!diffFull)
+    {
+        memcpy(_compositor.lastDirty, rects, rectCount * sizeof(Rect));
+        _compositor.lastDirtyCount = rectCount;
+    }
+    if (!full)
+    {
+        memcpy(&rects[rectCount], lastDirty, lastDirtyCount * sizeof(Rect));
+        rectCount = _compositorMergeRects(rects, rectCount + lastDirtyCount);
+    }
+
+    double dirtyArea = 0;
+    for (uint32_t i = 0; i < rectCount; ++i)
+    {
+        dirtyArea += _compositorArea(rects[i]);
+    }
+    if (dirtyArea > screenArea * FULL_REDRAW_RATIO)
+    {
+        full = true;
+    }
+
+    // cost of drawing everything, for comparison
+    double pixelsFull = screenArea;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        pixelsFull += _compositorArea(_compositorIntersect(_compositorCmdRect(&cmds[i]), screen));
+    }
+    _compositor.pixelsFull += pixelsFull;
+
+    if (full)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            drawSubmitCmd(&cmds[i]);
+        }
+        _compositor.pixelsTouched += pixelsFull;
+        ++_compositor.rects;
+    }
+    else if (rectCount > 0)
+    {
+        glEnable(GL_SCISSOR_TEST);
+        for (uint32_t r = 0; r < rectCount; ++r)
+        {
+            Rect rect = rects[r];
+            // GL scissor boxes start at the bottom of the window
+            glScissor(rect.x0, viewport[3] - rect.y1, rect.x1 - rect.x0, rect.y1 - rect.y0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            _compositor.pixelsTouched += _compositorArea(rect);
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                double area = _compositorArea(_compositorIntersect(_compositorCmdRect(&cmds[i]), rect));
+                if (area > 0)
+                {
+                    drawSubmitCmd(&cmds[i]);
+                    _compositor.pixelsTouched += area;
+                }
+            }
+        }
+        glDisable(GL_SCISSOR_TEST);
+        _compositor.rects += rectCount;
+    }
+
+    memcpy(_compositor.viewport, viewport, sizeof(viewport));
+    _compositor.valid = true;
+    _compositorStore(cmds, count);
+
+    if (++_compositor.frames == STATS_INTERVAL)
+    {
+        _compositorReport();
+    }
+}
+
+/// @brief FNV-1a over the command bytes
+/// @param cmd
+/// @return hash
+static uint32_t _compositorHash(const SpriteCmd* cmd)
+{
+    const uint8_t* bytes = (const uint8_t*)cmd;
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < sizeof(SpriteCmd); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/// @brief Keep a copy of the presented frame and index it for the next diff
+/// @param cmds
+/// @param count
+static void _compositorStore(const SpriteCmd* cmds, uint32_t count)
+{
+    if (count > _compositor.prevMax)
+    {
+        free(_compositor.prev);
+        free(_compositor.used);
+        _compositor.prev = malloc(count * sizeof(SpriteCmd));
+        _compositor.used = malloc(count * sizeof(bool));
+        _compositor.prevMax = (_compositor.prev != NULL && _compositor.used != NULL) ? count : 0;
+    }
+    uint32_t tableSize = 64;
+    while (tableSize < count * 2)
+    {
+        tableSize *= 2;
+    }
+    if (tableSize > _compositor.tableSize)
+    {
+        free(_compositor.table);
+        _compositor.table = malloc(tableSize * sizeof(uint32_t));
+        _compositor.tableSize = (_compositor.table != NULL) ? tableSize : 0;
+    }
+    if (_compositor.prevMax < count || _compositor.tableSize == 0)
+    {
+        // out of memory, next frame is drawn in full
+        _compositor.prevCount = 0;
+        _compositor.valid = false;
+        return;
+    }
+
+    memcpy(_compositor.prev, cmds, count * sizeof(SpriteCmd));
+    _compositor.prevCount = count;
+
+    // open addressing, entries are prev index + 1 so zero means empty
+    ZeroMemory(_compositor.table, _compositor.tableSize * sizeof(uint32_t));
+    uint32_t mask = _compositor.tableSize - 1;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t slot = _compositorHash(&cmds[i]) & mask;
+        while (_compositor.table[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        _compositor.table[slot] = i + 1;
+    }
+}
+
+/// @brief Find the sprites that appeared, moved or disappeared since the last frame
+/// @param cmds
+/// @param count
+/// @param rects
+/// @param rectCount
+/// @return false if there are too many changes to track separately
+static bool _compositorDiff(const SpriteCmd* cmds, uint32_t count, Rect* rects, uint32_t* rectCount)
+{
+    uint32_t n = 0;
+    uint32_t mask = _compositor.tableSize - 1;
+    Rect screen = { 0, 0, _compositor.viewport[2], _compositor.viewport[3] };
+
+    if (_compositor.prevCount > 0)
+    {
+        ZeroMemory(_compositor.used, _compositor.prevCount * sizeof(bool));
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bool found = false;
+        if (_compositor.prevCount > 0)
+        {
+            uint32_t slot = _compositorHash(&cmds[i]) & mask;
+            while (_compositor.table[slot] != 0)
+            {
+                uint32_t index = _compositor.table[slot] - 1;
+                if (!_compositor.used[index] && memcmp(&_compositor.prev[index], &cmds[i], sizeof(SpriteCmd)) == 0)
+                {
+                    _compositor.used[index] = true;
+                    found = true;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+
+        if (!found)
+        {
+            Rect rect = _compositorIntersect(_compositorCmdRect(&cmds[i]), screen);
+            if (_compositorArea(rect) > 0)
+            {
+                if (n == MAX_RAW_RECTS)
+                    return false;
+                rects[n++] = rect;
+            }
+        }
+    }
+
+    // anything left over from the last frame has to be erased
+    for (uint32_t i = 0; i < _compositor.prevCount; ++i)
+    {
+        if (!_compositor.used[i])
+        {
+            Rect rect = _compositorIntersect(_compositorCmdRect(&_compositor.prev[i]), screen);
+            if (_compositorArea(rect) > 0)
+            {
+                if (n == MAX_RAW_RECTS)
+                    return false;
+                rects[n++] = rect;
+            }
+        }
+    }
+
+    *rectCount = n;
+    return true;
+}
+
+/// @brief Merge overlapping rectangles, then the cheapest pairs until the list is small enough
+/// @param rects
+/// @param count
+/// @return new count
+static uint32_t _compositorMergeRects(Rect* rects, uint32_t count)
+{
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (uint32_t i = 0; i < count && !merged; ++i)
+        {
+            for (uint32_t j = i + 1; j < count && !merged; ++j)
+            {
+                if (rects[i].x0 <= rects[j].x1 && rects[j].x0 <= rects[i].x1 &&
+                    rects[i].y0 <= rects[j].y1 && rects[j].y0 <= rects[i].y1)
+                {
+                    rects[i].x0 = min(rects[i].x0, rects[j].x0);
+                    rects[i].y0 = min(rects[i].y0, rects[j].y0);
+                    rects[i].x1 = max(rects[i].x1, rects[j].x1);
+                    rects[i].y1 = max(rects[i].y1, rects[j].y1);
+                    rects[j] = rects[--count];
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    while (count > MAX_DIRTY_RECTS)
+    {
+        uint32_t bestI = 0, bestJ = 1;
+        double bestCost = -1;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            for (uint32_t j = i + 1; j < count; ++j)
+            {
+                Rect u = {
+                    min(rects[i].x0, rects[j].x0), min(rects[i].y0, rects[j].y0),
+                    max(rects[i].x1, rects[j].x1), max(rects[i].y1, rects[j].y1)
+                };
+                double cost = _compositorArea(u) - _compositorArea(rects[i]) - _compositorArea(rects[j]);
+                if (bestCost < 0 || cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        rects[bestI].x0 = min(rects[bestI].x0, rects[bestJ].x0);
+        rects[bestI].y0 = min(rects[bestI].y0, rects[bestJ].y0);
+        rects[bestI].x1 = max(rects[bestI].x1, rects[bestJ].x1);
+        rects[bestI].y1 = max(rects[bestI].y1, rects[bestJ].y1);
+        rects[bestJ] = rects[--count];
+    }
+
+    return count;
+}
+
+/// @brief Pixel bounds covered by a sprite
+/// @param cmd
+/// @return rect
+static Rect _compositorCmdRect(const SpriteCmd* cmd)
+{
+    Rect rect = {
+        (int32_t)floorf(min(cmd->xPositionLeft, cmd->xPositionRight)),
+        (int32_t)floorf(min(cmd->yPositionTop, cmd->yPositionBottom)),
+        (int32_t)ceilf(max(cmd->xPositionLeft, cmd->xPositionRight)),
+        (int32_t)ceilf(max(cmd->yPositionTop, cmd->yPositionBottom))
+    };
+    return rect;
+}
+
+static Rect _compositorIntersect(Rect a, Rect b)
+{
+    Rect rect = { max(a.x0, b.x0), max(a.y0, b.y0), min(a.x1, b.x1), min(a.y1, b.y1) };
+    return rect;
+}
+
+static double _compositorArea(Rect r)
+{
+    if (r.x1 <= r.x0 || r.y1 <= r.y0)
+        return 0;
+    return (double)(r.x1 - r.x0) * (double)(r.y1 - r.y0);
+}
+
+/// @brief Print the average pixels touched per frame against a full redraw
+static void _compositorReport()
+{
+    double touched = _compositor.pixelsTouched / _compositor.frames;
+    double full = _compositor.pixelsFull / _compositor.frames;
+    printf("compositor: %.0f px/frame touched vs %.0f px/frame full redraw (%.1f%%), %.2f rects/frame\n",
+        touched, full, (full > 0) ? (100.0 * touched / full) : 0.0, (double)_compositor.rects / _compositor.frames);
+
+    _compositor.frames = 0;
+    _compositor.rects = 0;
+    _compositor.pixelsTouched = 0;
+    _compositor.pixelsFull = 0;
+}
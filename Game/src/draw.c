@@ -1,16 +1,338 @@
 #include <Windows.h>
 #include <gl/GLU.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 
+#include "draw.h"
+#include "compositor.h"
+#include "swrender.h"
+#include "instrender.h"
+#include "capture.h"
+#include "latency.h"
+#include "texmgr.h"
+#include "timer.h"
+#include "profile.h"
+#include "SOIL.h"
 
-/// @brief draws the given sprite based on the given parameters
-/// @params 
+#define DRAW_INITIAL_CMDS 256
+#define DRAW_MAX_BUFFERS 3
+
+/// @brief One recorded frame
+typedef struct drawbuffer_t {
+	SpriteCmd* cmds;
+	uint32_t count;
+	uint32_t max;
+	uint64_t recordedAt;
+	uint64_t latencyFrame;
+} DrawBuffer;
+
+static bool _drawReserve(uint32_t count);
+static void _drawSubmit(const DrawBuffer* frame);
+static void _drawRecordStats(const DrawBuffer* frame);
+static void _drawPublish();
+static int32_t _drawFindFree();
+
+static struct drawlist_t {
+	DrawBuffer buffers[DRAW_MAX_BUFFERS];
+	DrawBuffer* rec;
+	bool partialRedraw;
+	DrawBackend backend;
+
+	// handoff to the render thread, indices into buffers or -1
+	uint32_t bufferCount;
+	int32_t recording;
+	int32_t pending;
+	int32_t rendering;
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE changed;
+	uint32_t renderDelay;
+
+	// instanced renderer, set up on the thread owning the context at the first submit
+	bool instancedTried;
+	bool instancedReady;
+
+	// written by the thread that submits, read by anyone for display
+	uint32_t submitted;
+	bool submittedInstanced;	// the last frame went out through instDraw
+	DrawStats stats;
+} _drawList = { { { NULL, 0, 0, 0, 0 } }, NULL, false, DRAW_BACKEND_GL, 0 };
+
+/// @brief Allocate the per-frame sprite lists
+void drawInit()
+{
+	uint32_t buffers = (_drawList.bufferCount > 0) ? _drawList.bufferCount : 1;
+	for (uint32_t i = 0; i < buffers; ++i)
+	{
+		DrawBuffer* buffer = &_drawList.buffers[i];
+		buffer->cmds = malloc(DRAW_INITIAL_CMDS * sizeof(SpriteCmd));
+		buffer->max = (buffer->cmds != NULL) ? DRAW_INITIAL_CMDS : 0;
+		buffer->count = 0;
+	}
+	_drawList.recording = 0;
+	_drawList.pending = -1;
+	_drawList.rendering = -1;
+	_drawList.rec = &_drawList.buffers[0];
+	InitializeCriticalSection(&_drawList.lock);
+	InitializeConditionVariable(&_drawList.changed);
+
+	compositorInit();
+}
+
+/// @brief Free the per-frame sprite lists. The render thread must have stopped
+void drawShutdown()
+{
+	compositorShutdown();
+	if (_drawList.instancedReady)
+	{
+		instShutdown();
+	}
+	_drawList.instancedTried = _drawList.instancedReady = false;
+
+	DeleteCriticalSection(&_drawList.lock);
+	for (uint32_t i = 0; i < DRAW_MAX_BUFFERS; ++i)
+	{
+		free(_drawList.buffers[i].cmds);
+		_drawList.buffers[i].cmds = NULL;
+		_drawList.buffers[i].max = _drawList.buffers[i].count = 0;
+	}
+	_drawList.rec = NULL;
+}
+
+/// @brief Choose where recorded frames go. Must be set before any textures are loaded,
+/// except when switching between the two GL backends which share textures.
+/// DRAW_BACKEND_GL_INSTANCED redraws every frame in full and needs a GL 3.3 context
+/// (appSetGLVersion), without one it falls back to DRAW_BACKEND_GL
+/// @param backend
+void drawSetBackend(DrawBackend backend)
+{
+	_drawList.backend = backend;
+}
+
+/// @brief Where recorded frames currently go
+/// @return backend
+DrawBackend drawGetBackend()
+{
+	return _drawList.backend;
+}
+
+/// @brief Only recomposite the regions that changed since the last presented frame.
+/// Requires the framework to preserve the back buffer across swaps (appSetPreserveFrame)
+/// @param enabled
+void drawSetPartialRedraw(bool enabled)
+{
+	_drawList.partialRedraw = enabled;
+}
+
+/// @brief How frames reach GL. Must be set before drawInit.
+/// 0 submits on the recording thread at drawFrameEnd. 2 hands each frame to drawRender and waits
+/// for the previous one to be picked up; 3 never waits, an unrendered frame is replaced by a newer one
+/// @param count
+void drawSetRenderBuffers(uint32_t count)
+{
+	_drawList.bufferCount = min(count, DRAW_MAX_BUFFERS);
+	if (_drawList.bufferCount == 1)
+	{
+		_drawList.bufferCount = 2;
+	}
+}
+
+/// @brief Stall drawRender for the given time every frame, to see how the game copes with a slow GPU
+/// @param milliseconds
+void drawSetRenderDelay(uint32_t milliseconds)
+{
+	_drawList.renderDelay = milliseconds;
+}
+
+/// @brief Decode a sprite sheet and create a texture for the active backend.
+/// Modules should go through texMgrAcquire so each file is only loaded once
+/// @param filename
+/// @param bytes size of the decoded texture
+/// @return texture id, 0 on failure
+GLuint drawLoadTexture(const char* filename, uint32_t* bytes)
+{
+	*bytes = 0;
+
+	int32_t width, height, channels;
+	uint8_t* pixels = SOIL_load_image(filename, &width, &height, &channels, SOIL_LOAD_AUTO);
+	if (pixels == NULL)
+		return 0;
+
+	GLuint texture = drawCreateTexture(pixels, width, height, channels);
+	SOIL_free_image_data(pixels);
+	if (texture != 0)
+	{
+		*bytes = (uint32_t)(width * height * channels);
+	}
+	return texture;
+}
+
+/// @brief Create a texture for the active backend from decoded pixels.
+/// Must be called on the thread that owns the GL context
+/// @param pixels as returned by SOIL_load_image
+/// @param width
+/// @param height
+/// @param channels
+/// @return texture id, 0 on failure
+GLuint drawCreateTexture(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels)
+{
+	if (_drawList.backend == DRAW_BACKEND_SOFTWARE)
+	{
+		return swrCreateTexture(pixels, width, height, channels);
+	}
+
+	return SOIL_create_OGL_texture(pixels, width, height, channels, SOIL_CREATE_NEW_ID,
+		SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+}
+
+/// @brief Delete a texture made by drawLoadTexture
+/// @param texture
+void drawUnloadTexture(GLuint texture)
+{
+	if (_drawList.backend == DRAW_BACKEND_SOFTWARE)
+	{
+		swrUnloadTexture(texture);
+		return;
+	}
+
+	glDeleteTextures(1, &texture);
+}
+
+/// @brief Start recording the sprites for a new frame
+void drawFrameBegin()
+{
+	_drawList.rec->count = 0;
+}
+
+/// @brief Send the recorded frame to the software renderer, to GL, or to the render thread
+void drawFrameEnd()
+{
+	_drawList.rec->latencyFrame = latencyFrameRecorded();
+	// without a display the software frame is presented by whoever reads it
+	if (_drawList.backend == DRAW_BACKEND_SOFTWARE)
+	{
+		texMgrUpload();
+		swrClear(0, 0, 0);
+		swrDraw(_drawList.rec->cmds, _drawList.rec->count);
+		return;
+	}
+
+	if (_drawList.bufferCount == 0)
+	{
+		PROFILE_BEGIN("drawSubmit");
+		_drawSubmit(_drawList.rec);
+		PROFILE_END();
+		_drawRecordStats(_drawList.rec);
+		captureFrame();
+		latencyFramePresented(_drawList.rec->latencyFrame, timerNowNanoseconds());
+		return;
+	}
+
+	_drawPublish();
+}
+
+/// @brief Submit the newest published frame to GL. Called by the thread that owns the context
+/// @return timerNowMicroseconds when the frame was recorded, 0 if nothing new was published
+uint64_t drawRender()
+{
+	EnterCriticalSection(&_drawList.lock);
+	if (_drawList.pending < 0)
+	{
+		LeaveCriticalSection(&_drawList.lock);
+		return 0;
+	}
+	_drawList.rendering = _drawList.pending;
+	_drawList.pending = -1;
+	WakeAllConditionVariable(&_drawList.changed);
+	LeaveCriticalSection(&_drawList.lock);
+
+	const DrawBuffer* frame = &_drawList.buffers[_drawList.rendering];
+	if (_drawList.renderDelay > 0)
+	{
+		Sleep(_drawList.renderDelay);
+	}
+	PROFILE_BEGIN("drawSubmit");
+	_drawSubmit(frame);
+	PROFILE_END();
+	_drawRecordStats(frame);
+	captureFrame();
+	latencyFramePresented(frame->latencyFrame, timerNowNanoseconds());
+	uint64_t recordedAt = frame->recordedAt;
+
+	// immediate mode has copied everything, the buffer can be recorded into again
+	EnterCriticalSection(&_drawList.lock);
+	_drawList.rendering = -1;
+	WakeAllConditionVariable(&_drawList.changed);
+	LeaveCriticalSection(&_drawList.lock);
+
+	return recordedAt;
+}
+
+/// @brief What the last submitted frame cost. Updated by the thread that submits, so from
+/// another thread the fields may come from neighbouring frames
+/// @return stats
+DrawStats drawGetStats()
+{
+	return _drawList.stats;
+}
+
+/// @brief records the given sprite based on the given parameters, to be drawn at drawFrameEnd.
+/// The texture is a texmgr handle, resolved here so a texture still loading records as 0
+/// @params
 void drawSprite(GLuint texture, GLfloat xPositionLeft, GLfloat xPositionRight, GLfloat yPositionTop,
 				GLfloat yPositionBottom, GLfloat u, GLfloat v, GLfloat xTextureCoord, GLfloat yTextureCoord,
 				float depth)
 {
+	PROFILE_BEGIN("drawSprite");
+	if (!_drawReserve(1))
+	{
+		PROFILE_END();
+		return;
+	}
+
+	SpriteCmd* cmd = &_drawList.rec->cmds[_drawList.rec->count++];
+	cmd->texture = texMgrGetTexture(texture);
+	cmd->xPositionLeft = xPositionLeft;
+	cmd->xPositionRight = xPositionRight;
+	cmd->yPositionTop = yPositionTop;
+	cmd->yPositionBottom = yPositionBottom;
+	cmd->u = u;
+	cmd->v = v;
+	cmd->xTextureCoord = xTextureCoord;
+	cmd->yTextureCoord = yTextureCoord;
+	cmd->depth = depth;
+	PROFILE_END();
+}
+
+/// @brief records a prebuilt list of sprites in one copy, resolving their texmgr handles
+/// @param cmds
+/// @param count
+void drawSprites(const SpriteCmd* cmds, uint32_t count)
+{
+	if (count == 0 || !_drawReserve(count))
+		return;
+
+	SpriteCmd* dst = &_drawList.rec->cmds[_drawList.rec->count];
+	memcpy(dst, cmds, count * sizeof(SpriteCmd));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		dst[i].texture = texMgrGetTexture(cmds[i].texture);
+	}
+	_drawList.rec->count += count;
+}
+
+/// @brief draws a recorded sprite with GL
+/// @param cmd
+void drawSubmitCmd(const SpriteCmd* cmd)
+{
+	// not uploaded yet
+	if (cmd->texture == 0)
+		return;
+	++_drawList.submitted;
+
 	// draw the Ui elements
 	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindTexture(GL_TEXTURE_2D, cmd->texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glBegin(GL_TRIANGLE_STRIP);
 	{
@@ -18,20 +340,139 @@ void drawSprite(GLuint texture, GLfloat xPositionLeft, GLfloat xPositionRight, G
 		glColor4ub(0xFF, 0xFF, 0xFF, 0xFF);
 
 		// TL
-		glTexCoord2f(xTextureCoord, yTextureCoord);
-		glVertex3f(xPositionLeft, yPositionTop, depth);
+		glTexCoord2f(cmd->xTextureCoord, cmd->yTextureCoord);
+		glVertex3f(cmd->xPositionLeft, cmd->yPositionTop, cmd->depth);
 
 		// BL
-		glTexCoord2f(xTextureCoord, yTextureCoord - v);
-		glVertex3f(xPositionLeft, yPositionBottom, depth);
+		glTexCoord2f(cmd->xTextureCoord, cmd->yTextureCoord - cmd->v);
+		glVertex3f(cmd->xPositionLeft, cmd->yPositionBottom, cmd->depth);
 
 		// TR
-		glTexCoord2f(xTextureCoord + u, yTextureCoord);
-		glVertex3f(xPositionRight, yPositionTop, depth);
+		glTexCoord2f(cmd->xTextureCoord + cmd->u, cmd->yTextureCoord);
+		glVertex3f(cmd->xPositionRight, cmd->yPositionTop, cmd->depth);
 
 		// BR
-		glTexCoord2f(xTextureCoord + u, yTextureCoord - v);
-		glVertex3f(xPositionRight, yPositionBottom, depth);
+		glTexCoord2f(cmd->xTextureCoord + cmd->u, cmd->yTextureCoord - cmd->v);
+		glVertex3f(cmd->xPositionRight, cmd->yPositionBottom, cmd->depth);
 	}
 	glEnd();
-}
\ No newline at end of file
+}
+
+/// @brief draw a whole frame, either in full or through the compositor
+/// @param frame
+static void _drawSubmit(const DrawBuffer* frame)
+{
+	// anything the loader finished since the last frame shows up from the next one
+	texMgrUpload();
+	_drawList.submitted = 0;
+	_drawList.submittedInstanced = false;
+
+	if (_drawList.backend == DRAW_BACKEND_GL_INSTANCED)
+	{
+		if (!_drawList.instancedTried)
+		{
+			_drawList.instancedTried = true;
+			_drawList.instancedReady = instInit();
+		}
+		if (_drawList.instancedReady && instDraw(frame->cmds, frame->count))
+		{
+			_drawList.submittedInstanced = true;
+			return;
+		}
+		// no 3.3 context or no room for the frame's instances, fall through to immediate mode
+	}
+
+	if (_drawList.partialRedraw)
+	{
+		compositorPresent(frame->cmds, frame->count);
+		return;
+	}
+
+	for (uint32_t i = 0; i < frame->count; ++i)
+	{
+		drawSubmitCmd(&frame->cmds[i]);
+	}
+}
+
+/// @brief Keep what a submitted frame cost for drawGetStats
+/// @param frame
+static void _drawRecordStats(const DrawBuffer* frame)
+{
+	DrawStats stats;
+	stats.sprites = frame->count;
+	if (_drawList.submittedInstanced)
+	{
+		// one bind per run of sprites sharing a texture
+		stats.drawCalls = instGetDrawCalls();
+		stats.textureBinds = stats.drawCalls;
+	}
+	else
+	{
+		// immediate mode binds and draws every quad on its own
+		stats.drawCalls = _drawList.submitted;
+		stats.textureBinds = _drawList.submitted;
+	}
+	_drawList.stats = stats;
+}
+
+/// @brief hand the recorded frame to the render thread and move on to a free buffer
+static void _drawPublish()
+{
+	EnterCriticalSection(&_drawList.lock);
+	_drawList.rec->recordedAt = timerNowMicroseconds();
+
+	// with a spare buffer the newest frame wins, otherwise wait for the render thread to catch up
+	if (_drawList.bufferCount > 2)
+	{
+		_drawList.pending = -1;
+	}
+	while (_drawList.pending >= 0)
+	{
+		SleepConditionVariableCS(&_drawList.changed, &_drawList.lock, INFINITE);
+	}
+	_drawList.pending = _drawList.recording;
+
+	while ((_drawList.recording = _drawFindFree()) < 0)
+	{
+		SleepConditionVariableCS(&_drawList.changed, &_drawList.lock, INFINITE);
+	}
+	_drawList.rec = &_drawList.buffers[_drawList.recording];
+	LeaveCriticalSection(&_drawList.lock);
+}
+
+/// @brief find a buffer that is neither waiting to be rendered nor being rendered, lock must be held
+/// @return index, -1 if there is none
+static int32_t _drawFindFree()
+{
+	for (int32_t i = 0; i < (int32_t)_drawList.bufferCount; ++i)
+	{
+		if (i != _drawList.pending && i != _drawList.rendering)
+			return i;
+	}
+	return -1;
+}
+
+/// @brief make room for more sprites in the frame being recorded
+/// @param count
+/// @return false if out of memory
+static bool _drawReserve(uint32_t count)
+{
+	DrawBuffer* rec = _drawList.rec;
+	if (rec->count + count <= rec->max)
+		return true;
+
+	uint32_t newMax = (rec->max > 0) ? rec->max : DRAW_INITIAL_CMDS;
+	while (newMax < rec->count + count)
+	{
+		newMax *= 2;
+	}
+	SpriteCmd* cmds = realloc(rec->cmds, newMax * sizeof(SpriteCmd));
+	if (cmds == NULL)
+	{
+		assert(false);
+		return false;
+	}
+	rec->cmds = cmds;
+	rec->max = newMax;
+	return true;
+}
@@ -8,18 +8,44 @@
 #include "globals.h"
 #include "Object.h"
 #include "random.h"
-#include "SOIL.h"
 #include "baseTypes.h"
 #include "draw.h"
+#include "texmgr.h"
+#include "anim.h"
+#include "input.h"
 
 #define NUM_DUCKS 2
 #define M_PI (acos(-1.0) / 2)
 #define GRASS_BOUND 700.0f
+#define DUCK_HISTORY 16		// positions kept for rewinding shots, a quarter second at 60Hz
 
 // all of these values are based upon the layout of the PNG
 static const char DUCK_SHEET[] = "asset/NES - Duck Hunt - Ducks.png";
 static const int32_t SPRITE_COUNT = 12;
-static const int32_t flyFrameLength = 56;
+
+// sheet columns: 0-2 flying up, 3-5 flying across, 6-8 flying away, 9 shot, 10-11 falling.
+// Every flying frame carries the flap, each duck only plays it on its own frame
+static const AnimFrame _flyUpFrames[] = {
+	{ 0, flap, 56 }, { 1, flap, 56 }, { 2, flap, 56 }
+};
+static const AnimFrame _flyAcrossFrames[] = {
+	{ 3, flap, 56 }, { 4, flap, 56 }, { 5, flap, 56 }
+};
+static const AnimFrame _flyAwayFrames[] = {
+	{ 6, flap, 56 }, { 7, flap, 56 }, { 8, flap, 56 }
+};
+static const AnimFrame _shotFrames[] = {
+	{ 9, ANIM_NO_EVENT, 750 }
+};
+// the first frame only plays once, so the fall sound isn't repeated
+static const AnimFrame _fallFrames[] = {
+	{ 10, fall, 56 }, { 11, ANIM_NO_EVENT, 56 }, { 10, ANIM_NO_EVENT, 56 }
+};
+static const AnimClip _flyUpClip = { _flyUpFrames, 3, 0, ANIM_LOOP };
+static const AnimClip _flyAcrossClip = { _flyAcrossFrames, 3, 0, ANIM_LOOP };
+static const AnimClip _flyAwayClip = { _flyAwayFrames, 3, 0, ANIM_LOOP };
+static const AnimClip _shotClip = { _shotFrames, 1, 0, ANIM_ONCE };
+static const AnimClip _fallClip = { _fallFrames, 3, 1, ANIM_LOOP };
 
 
 static uint8_t _layer = 0;
@@ -49,27 +75,38 @@ typedef enum duck_state_t
 	inactive
 } DuckState;
 
+/// @brief Where a duck was at the end of an update
+typedef struct duck_history_t
+{
+	uint64_t time;
+	Coord2D position;
+} DuckHistory;
+
 typedef struct duck_t
 {
 	Object obj;
 
-	uint32_t quackTimerSet;
-	uint32_t quackTimer;
+	DuckHistory history[DUCK_HISTORY];
+	uint32_t historyNext;
+	uint32_t historyCount;
+
+	Milliseconds quackTimerSet;
+	Milliseconds quackTimer;
 	uint8_t layer;
 	Bounds2D bounds;
 	Color type;
 	bool bottomCollide;
-	uint8_t frame;
-	uint32_t frameUpdate;
+	Animator* anim;
 	DuckState state;
 } Duck;
 
 // the object vtable for all ducks
-static void _duckUpdate(Object* obj, uint32_t milliseconds);
+static void _duckUpdate(Object* obj, Milliseconds milliseconds);
 static void _duckDraw(Object* obj);
 static ObjVtable _duckVtable = {
 	_duckDraw,
-	_duckUpdate
+	_duckUpdate,
+	"duck"
 };
 
 static const Coord2D size = {
@@ -82,7 +119,9 @@ static GLuint _duckTexture = 0;
 // other private methods
 static void _duckDoCollisions(Duck* duck);
 static void _duckCollideField(Duck* duck);
+static void _duckAnimEvent(void* owner, uint8_t event, uint8_t frame);
 static Coord2D _duckGetVel();
+static void _duckRecordPosition(Duck* duck, uint64_t time);
 
 // initialize callbacks
 static duckSoundCB _soundCB = NULL;
@@ -106,12 +145,18 @@ void duckInitTexture()
 {
     if (_duckTexture == 0)
     {
-        _duckTexture = SOIL_load_OGL_texture(DUCK_SHEET, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-            SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+        _duckTexture = texMgrAcquire(DUCK_SHEET);
         assert(_duckTexture != 0);
     }
 }
 
+// Release sprite sheet
+void duckReleaseTexture()
+{
+    texMgrRelease(_duckTexture);
+    _duckTexture = 0;
+}
+
 /// @brief Instantiate and initialize a duck object
 /// @param bounds 
 /// @return 
@@ -129,10 +174,11 @@ Duck* duckNew(Bounds2D bounds)
 		duck->bounds.botRight.y = GRASS_BOUND;
 		duck->type = 0;
 		duck->state = inactive;
-        duck->frame = 0;
-		duck->frameUpdate = 0;
+		duck->anim = animNew(duck, _duckAnimEvent);
 		duck->layer = _layer++;
 		duck->bottomCollide = false;
+		duck->historyNext = 0;
+		duck->historyCount = 0;
 	}
 	return duck;
 }
@@ -142,6 +188,7 @@ Duck* duckNew(Bounds2D bounds)
 void duckDelete(Duck* duck)
 {
     objDeinit(&duck->obj);
+    animDelete(duck->anim);
 
     free(duck);
 }
@@ -156,31 +203,33 @@ void ducksFlyAway(Duck** ducks)
 		if (ducks[i]->state == flying)
 		{
 			ducks[i]->state = leaving;
+			animSwitch(ducks[i]->anim, &_flyAwayClip);
 			ducks[i]->obj.velocity.x = 0;
 			ducks[i]->obj.velocity.y = -60.0f * ((-22.0f / ((_roundNum)+1.0f)) + 15.0f);
 		}
 	}
 }
 
-/// @brief Check if the mouse click hit a duck
+/// @brief Check if the mouse click hit a duck, where each duck was when the click happened
 /// @param mousePos
+/// @param time timestamp of the click, 0 to test where the ducks are now
 /// @param ducks
-int32_t duckCheckForHit(Coord2D mousePos, Duck** ducks)
+int32_t duckCheckForHit(Coord2D mousePos, uint64_t time, Duck** ducks)
 {
 	int i;
 
 	for (i = 0; i < NUM_DUCKS; ++i)
 	{
+		Coord2D position = duckPositionAt(ducks[i], time);
 		// check if the mouse overlaps with the duck
-		if ((ducks[i])->state == dead || (ducks[i])->state == shot || (ducks[i])->state == inactive || ((ducks[i])->obj.position.x - (size.x / 2) > mousePos.x ||
-			((ducks[i])->obj.position.x + (size.x / 2)) < mousePos.x) || (ducks[i])->obj.position.y - (size.y / 2) > mousePos.y ||
-			((ducks[i])->obj.position.y + (size.y / 2)) < mousePos.y)
+		if ((ducks[i])->state == dead || (ducks[i])->state == shot || (ducks[i])->state == inactive || (position.x - (size.x / 2) > mousePos.x ||
+			(position.x + (size.x / 2)) < mousePos.x) || position.y - (size.y / 2) > mousePos.y ||
+			(position.y + (size.y / 2)) < mousePos.y)
 			continue;
 		// if the mouse is on top of a duck, shoot that duck
 		// update its sprite and make it stand still
 		(ducks[i])->state = shot;
-		(ducks[i])->frame = 0;
-		(ducks[i])->frameUpdate = 750;
+		animPlay((ducks[i])->anim, &_shotClip, 0);
 		(ducks[i])->obj.velocity.x = 0.0f;
 		(ducks[i])->obj.velocity.y = 0.0f;
 		// return proper score value based on the duck color and round number
@@ -197,6 +246,59 @@ int32_t duckCheckForHit(Coord2D mousePos, Duck** ducks)
 	return 0;
 }
 
+/// @brief Where a duck was at a given time, between the positions recorded at the end of
+/// the updates either side of it. Earlier than the history goes gives the oldest position
+/// @param duck
+/// @param time on the inputFrameTime clock, 0 for where it is now
+/// @return
+Coord2D duckPositionAt(const Duck* duck, uint64_t time)
+{
+	if (time == 0 || duck->historyCount == 0)
+		return duck->obj.position;
+
+	// walk back from the newest to the first position recorded before the time
+	uint32_t newer = (duck->historyNext + DUCK_HISTORY - 1) % DUCK_HISTORY;
+	if (time >= duck->history[newer].time)
+		return duck->obj.position;
+	for (uint32_t i = 1; i < duck->historyCount; ++i)
+	{
+		uint32_t older = (newer + DUCK_HISTORY - 1) % DUCK_HISTORY;
+		const DuckHistory* a = &duck->history[older];
+		const DuckHistory* b = &duck->history[newer];
+		if (time >= a->time)
+		{
+			float t = (float)(time - a->time) / (float)(b->time - a->time);
+			Coord2D position = {
+				a->position.x + (b->position.x - a->position.x) * t,
+				a->position.y + (b->position.y - a->position.y) * t
+			};
+			return position;
+		}
+		newer = older;
+	}
+	return duck->history[newer].position;
+}
+
+/// @brief Find a duck that a click could still hit
+/// @param ducks
+/// @param pos set to the centre of the duck
+/// @param velocity set to how fast it's moving, pixels per second
+/// @return false if none are flying
+bool duckFindTarget(Duck** ducks, Coord2D* pos, Coord2D* velocity)
+{
+	int i;
+
+	for (i = 0; i < NUM_DUCKS; ++i)
+	{
+		if ((ducks[i])->state != flying)
+			continue;
+		*pos = (ducks[i])->obj.position;
+		*velocity = (ducks[i])->obj.velocity;
+		return true;
+	}
+	return false;
+}
+
 /// @brief spawn 2 ducks for the current wave
 /// @param roundNum, ducks
 void ducksSetActive(uint8_t roundNum, Duck** ducks)
@@ -211,14 +313,16 @@ void ducksSetActive(uint8_t roundNum, Duck** ducks)
 		vel = _duckGetVel();
 		ducks[i]->state = flying;
 		ducks[i]->type = randGetInt(color_min, color_count);
-		ducks[i]->frame = randGetInt(0, 2);
-		ducks[i]->quackTimerSet = (uint32_t)(1250 * randGetFloat(0.8f, 1.2f));
+		animPlay(ducks[i]->anim, &_flyUpClip, (uint8_t)randGetInt(0, 2));
+		ducks[i]->quackTimerSet = 1250 * randGetFloat(0.8f, 1.2f);
 		ducks[i]->quackTimer = ducks[i]->quackTimerSet;
 		ducks[i]->obj.position.y = ducks[i]->bounds.botRight.y + 50;
 		ducks[i]->obj.position.x = (float)randGetInt(0 + (int32_t)(size.x / 2), (int32_t)uiSize.x - (int32_t)(size.x / 2));
 		ducks[i]->obj.velocity.x = vel.x;
 		ducks[i]->obj.velocity.y = vel.y;
 		ducks[i]->bottomCollide = false;
+		// it has jumped, nothing before here is where it was
+		ducks[i]->historyCount = 0;
 	}
 }
 
@@ -252,13 +356,13 @@ bool duckActiveStatus(Duck** ducks)
 /// @brief Move the duck and process collisions based on duck state
 /// @param obj 
 /// @param milliseconds 
-static void _duckUpdate(Object* obj, uint32_t milliseconds)
+static void _duckUpdate(Object* obj, Milliseconds milliseconds)
 {
 	Duck* duck = (Duck*)obj;
     objDefaultUpdate(obj, milliseconds);
 
-	// update the duck's animation and velocity depending on its state
-	// also play any needed sfx
+	// update the duck's clip and velocity depending on its state
+	// also play any needed sfx, the clips play their own
 	switch (duck->state)
 	{
 		// flying and leaving are the same case
@@ -267,26 +371,15 @@ static void _duckUpdate(Object* obj, uint32_t milliseconds)
 				_duckDoCollisions((Duck*)obj);
 			if (!(duck->bottomCollide) && ((duck->obj.position.y + (size.y / 2)) <= duck->bounds.botRight.y))
 				duck->bottomCollide = true;
+			// pick the sprites for the direction, keeping the wing beat where it was
+			animSwitch(duck->anim, (-(obj->velocity.y) < abs((int32_t)obj->velocity.x)) ? &_flyAcrossClip : &_flyUpClip);
 			// intentional lack of break statement
 		case leaving:
-
-			if (milliseconds >= duck->frameUpdate)
-			{
-				duck->frameUpdate = flyFrameLength;
-				if (++(duck->frame) > 2)
-					duck->frame = 0;
-				// play the sound on different frames so it sounds more natural
-				if (duck->layer == duck->frame)
-					_soundCB(flap);
-			}
-			else
-			{
-				duck->frameUpdate -= milliseconds;
-			}
 			// check for despawn condition
 			if (duck->obj.position.y < -size.y)
 			{
 				duck->state = inactive;
+				animStop(duck->anim);
 			}
 			// check for quack sound
 			if (milliseconds >= duck->quackTimer)
@@ -300,18 +393,12 @@ static void _duckUpdate(Object* obj, uint32_t milliseconds)
 			}
 			break;
 		case shot:
-			if (milliseconds >= duck->frameUpdate)
+			if (animFinished(duck->anim))
 			{
 				duck->state = dead;
-				duck->frame = 1;
 				obj->velocity.y = 240.0f;
 				duck->bottomCollide = false;
-				duck->frameUpdate = flyFrameLength;
-				_soundCB(fall);
-			}
-			else
-			{
-				duck->frameUpdate -= milliseconds;
+				animPlay(duck->anim, &_fallClip, 0);
 			}
 			break;
 		case dead:
@@ -319,19 +406,47 @@ static void _duckUpdate(Object* obj, uint32_t milliseconds)
 			if (duck->obj.position.y + (size.y / 2) >= duck->bounds.botRight.y + 132)
 			{
 				duck->state = inactive;
+				animStop(duck->anim);
 				_soundCB(thud);
 			}
-			else if (milliseconds >= duck->frameUpdate)
-			{
-				duck->frameUpdate = flyFrameLength;
-				duck->frame = (duck->frame == 1) ? 2 : 1;
-			}
-			else
-			{
-				duck->frameUpdate -= milliseconds;
-			}
 			break;
 	}
+
+	_duckRecordPosition(duck, inputFrameTime());
+}
+
+/// @brief Remember where the duck is as of the time the update brought it up to
+/// @param duck
+/// @param time
+static void _duckRecordPosition(Duck* duck, uint64_t time)
+{
+	// updates that don't move the clock on, like the staged scenes, replace the newest
+	uint32_t newest = (duck->historyNext + DUCK_HISTORY - 1) % DUCK_HISTORY;
+	if (duck->historyCount > 0 && duck->history[newest].time >= time)
+	{
+		duck->history[newest].time = time;
+		duck->history[newest].position = duck->obj.position;
+		return;
+	}
+
+	duck->history[duck->historyNext].time = time;
+	duck->history[duck->historyNext].position = duck->obj.position;
+	duck->historyNext = (duck->historyNext + 1) % DUCK_HISTORY;
+	duck->historyCount = min(duck->historyCount + 1, DUCK_HISTORY);
+}
+
+/// @brief Play the sounds the clips ask for
+/// @param owner duck
+/// @param event sound
+/// @param frame 
+static void _duckAnimEvent(void* owner, uint8_t event, uint8_t frame)
+{
+	Duck* duck = (Duck*)owner;
+
+	// play the flap on different frames for each duck so it sounds more natural
+	if (event == flap && frame != duck->layer)
+		return;
+	_soundCB((soundIds)event);
 }
 
 static void _duckDoCollisions(Duck* duck)
@@ -388,20 +503,9 @@ static void _duckDraw(Object* obj)
     float vPerColor = 1.0f / (float)color_count;
 
     // calculate the starting uv... remember v of 0 is the bottom of the texture
-    GLfloat xTextureCoord = (duck->frame * uPerFrame) + (duck->state * 3 * uPerFrame);
+    GLfloat xTextureCoord = animGetCell(duck->anim) * uPerFrame;
     GLfloat yTextureCoord = (color_count - duck->type) * vPerColor;
 
-
-	// adjust sprite offset for certian cases
-
-	// if the duck is shot, move to the shot sprite
-	// if the duck is flying/leaving, set sprite to appropriate flying sprite
-
-	if (duck->state == leaving || duck->state == shot || (duck->state == flying && (-(obj->velocity.y) < abs((int32_t)obj->velocity.x))))
-	{
-		xTextureCoord += uPerFrame * 3;
-	}
-
     const float DUCK_DEPTH = -0.5f + (duck->layer * 0.01f);
 	// check if the duck is facing left or right. If it is facing left,
 	// mirror the sprite
@@ -1,12 +1,12 @@
-#include <windows.h>											// Header File For Windows
+#include <Windows.h>											// Header File For Windows
 #include <stdlib.h>												// Header File For Malloc/Free
 #include <stdarg.h>												// Header File For Variable Argument Routines
 #include <math.h>												// Header File For Math Operations
-#include <gl\gl.h>												// Header File For The OpenGL32 Library
-#include <gl\glu.h>												// Header File For The GLu32 Library
+#include <gl/GL.h>												// Header File For The OpenGL32 Library
+#include <gl/GLU.h>												// Header File For The GLu32 Library
 #include "glut.h"
 #include "baseTypes.h"
-#include "object.h"
+#include "Object.h"
 #include "field.h"
 
 typedef struct field_t
@@ -18,11 +18,12 @@ typedef struct field_t
 } Field;
 
 // the object vtable for all fields
-static void _fieldUpdate(Object* obj, uint32_t milliseconds);
+static void _fieldUpdate(Object* obj, Milliseconds milliseconds);
 static void _fieldDraw(Object* obj);
 static ObjVtable _fieldVtable = {
 	_fieldDraw,
-	_fieldUpdate
+	_fieldUpdate,
+	"field"
 };
 
 /// @brief Instantiate and initialize a field object
@@ -80,7 +81,7 @@ Coord2D fieldGetSize(const Field* field)
 /// @brief Currently a no-op
 /// @param obj 
 /// @param milliseconds 
-static void _fieldUpdate(Object* obj, uint32_t milliseconds)
+static void _fieldUpdate(Object* obj, Milliseconds milliseconds)
 {
 	objDefaultUpdate(obj, milliseconds);
 }
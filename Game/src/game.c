@@ -2,16 +2,37 @@
 #include "input.h"
 #include "application.h"
 #include "framework.h"
+#include "sound.h"
+#include <stdio.h>
+#include <string.h>
 
 
 #include "levelmgr.h"
 #include "objmgr.h"
+#include "draw.h"
+#include "golden.h"
+#include "bench.h"
+#include "texmgr.h"
+#include "loader.h"
+#include "capture.h"
+#include "profile.h"
+#include "perfhud.h"
+#include "latency.h"
+#include "udpPointer.h"
+#include "bot.h"
+#include "globals.h"
+#include "timer.h"
 
 
 static void _gameInit();
 static void _gameShutdown();
 static void _gameDraw();
-static void _gameUpdate(uint32_t milliseconds);
+static void _gameUpdate(Milliseconds milliseconds);
+static int _gameGolden(Application* app, const char* cmdLine);
+static void _gameParseOptions(Application* app, const char* cmdLine);
+static int _gameBench(const char* cmdLine);
+static int _gameLatency(Application* app, const char* cmdLine);
+static void _gameAttachConsole();
 
 static LevelDef _levelDefs[] = {
 	{
@@ -21,7 +42,24 @@ static LevelDef _levelDefs[] = {
 	}
 };
 static Level* _curLevel = NULL;
-static bool _wiiInput = true;
+static uint32_t _renderBuffers = 3;
+static uint32_t _renderDelay = 0;
+static uint32_t _loaderWorkers = 4;
+static bool _instanced = false;
+static char _captureFile[MAX_PATH] = "";
+static uint32_t _captureFps = 0;
+static char _profileFile[MAX_PATH] = "";
+static bool _perfHud = false;
+static bool _clickLatency = false;
+static uint32_t _pointerPort = 0;
+static const BotSkill* _botSkill = NULL;
+static uint32_t _botLogMinutes = 60;
+static char _audioFile[MAX_PATH] = "";
+
+// startup timing, printed once each
+static uint64_t _startTime = 0;
+static bool _firstFrameReported = false;
+static bool _loadReported = false;
 
 /// @brief Program Entry Point (WinMain)
 /// @param hInstance 
@@ -33,9 +71,35 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 {
 	const char GAME_NAME[] = "Duck Hunt";
 
+	timerInit();
+	_startTime = timerNowMicroseconds();
+
 	Application* app = appNew(hInstance, GAME_NAME, _gameDraw, _gameUpdate);
+	appSetRenderFunc(app, drawRender);
 	appSetWidth(app, 960);
 	appSetHeight(app, 1024);
+	appSetPreserveFrame(app, true);
+	_gameParseOptions(app, lpCmdLine);
+	if (app != NULL && strncmp(lpCmdLine, "-golden", 7) == 0)
+	{
+		_gameAttachConsole();
+		int result = _gameGolden(app, lpCmdLine);
+		appDelete(app);
+		return result;
+	}
+	if (app != NULL && strncmp(lpCmdLine, "-bench", 6) == 0)
+	{
+		_gameAttachConsole();
+		appDelete(app);
+		return _gameBench(lpCmdLine);
+	}
+	if (app != NULL && strncmp(lpCmdLine, "-latency", 8) == 0)
+	{
+		_gameAttachConsole();
+		int result = _gameLatency(app, lpCmdLine);
+		appDelete(app);
+		return result;
+	}
 	if (app != NULL)
 	{
 		GLWindow* window = fwInitWindow(app);
@@ -57,96 +121,326 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	}
 }
 
+/// @brief Frame pacing and threading options. The display on the cabinet refreshes at 60Hz,
+/// so cap there by default, and submit to GL from a render thread with triple buffering.
+/// usage: -fps <n> (0 for uncapped), -vsync, -singlethread, -renderbuffers <2|3>,
+/// -slowrender <ms> to stall the renderer every frame, -loadworkers <n> (0 loads everything up front),
+/// -instanced to draw through GL 3.3 instancing instead of immediate mode,
+/// -capture <file> to record what is presented at the -fps rate, as Y4M if the name ends in .y4m,
+/// -profile <file> to write a Chrome trace of the session on exit,
+/// -perfhud to start with the performance overlay showing (F3 toggles it),
+/// -clicklatency to time each shot from the button press to the frame showing it, printed on exit,
+/// -pointer [port] to aim with pointer samples sent over UDP, like a wii remote bridge,
+/// -bot [novice|average|expert|perfect] to let a bot play, for soak tests,
+/// -soaklog <minutes> for how often the bot logs frame times, memory and voices (60 by default),
+/// -audio <mixer|null|wav <file>> to mix in software, out to the device, nowhere or a WAV file
+/// @param app
+/// @param cmdLine
+static void _gameParseOptions(Application* app, const char* cmdLine)
+{
+	const uint32_t DEFAULT_FPS = 60;
+	if (app == NULL)
+		return;
+
+	uint32_t fps = DEFAULT_FPS;
+	const char* option = strstr(cmdLine, "-fps ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 5, "%u", &fps);
+	}
+	appSetTargetFps(app, fps);
+	appSetVsync(app, strstr(cmdLine, "-vsync") != NULL);
+
+	option = strstr(cmdLine, "-renderbuffers ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 15, "%u", &_renderBuffers);
+	}
+	option = strstr(cmdLine, "-slowrender ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 12, "%u", &_renderDelay);
+	}
+	option = strstr(cmdLine, "-loadworkers ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 13, "%u", &_loaderWorkers);
+	}
+	if (strstr(cmdLine, "-singlethread") != NULL)
+	{
+		_renderBuffers = 0;
+	}
+	// the instanced path redraws whole frames, so there's no back buffer to preserve
+	_instanced = (strstr(cmdLine, "-instanced") != NULL);
+	if (_instanced)
+	{
+		appSetGLVersion(app, 3, 3);
+		appSetPreserveFrame(app, false);
+	}
+	appSetRenderThread(app, _renderBuffers > 0);
+
+	option = strstr(cmdLine, "-capture ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 9, "%259s", _captureFile, (unsigned)sizeof(_captureFile));
+		_captureFps = fps;
+	}
+	option = strstr(cmdLine, "-profile ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 9, "%259s", _profileFile, (unsigned)sizeof(_profileFile));
+	}
+	_perfHud = (strstr(cmdLine, "-perfhud") != NULL);
+	_clickLatency = (strstr(cmdLine, "-clicklatency") != NULL);
+	option = strstr(cmdLine, "-pointer");
+	if (option != NULL)
+	{
+		_pointerPort = UDP_POINTER_DEFAULT_PORT;
+		sscanf_s(option + 8, "%u", &_pointerPort);
+	}
+	option = strstr(cmdLine, "-bot");
+	if (option != NULL)
+	{
+		char skill[16] = "";
+		sscanf_s(option + 4, " %15[a-z]", skill, (unsigned)sizeof(skill));
+		_botSkill = botFindSkill(skill);
+		if (_botSkill == NULL)
+		{
+			printf("bot: no skill called %s\n", skill);
+		}
+	}
+	option = strstr(cmdLine, "-soaklog ");
+	if (option != NULL)
+	{
+		sscanf_s(option + 9, "%u", &_botLogMinutes);
+	}
+	option = strstr(cmdLine, "-audio ");
+	if (option != NULL)
+	{
+		char sink[16] = "";
+		sscanf_s(option + 7, "%15s %259s", sink, (unsigned)sizeof(sink), _audioFile, (unsigned)sizeof(_audioFile));
+		if (strcmp(sink, "mixer") == 0)
+		{
+			soundSetSink(soundDeviceSink(), NULL);
+		}
+		else if (strcmp(sink, "null") == 0)
+		{
+			soundSetSink(mixerNullSink(), NULL);
+		}
+		else if (strcmp(sink, "wav") == 0 && _audioFile[0] != '\0')
+		{
+			soundSetSink(mixerWavSink(), _audioFile);
+		}
+	}
+}
+
+/// @brief Render the known scenes without a window and compare them to the golden images
+/// usage: -golden [dir] to compare, -golden-update [dir] to record,
+/// -golden-gl [dir] to compare what GL draws in an offscreen context
+/// @param app
+/// @param cmdLine
+/// @return number of failing scenes
+static int _gameGolden(Application* app, const char* cmdLine)
+{
+	char mode[32] = "";
+	char directory[MAX_PATH] = "asset/golden";
+	sscanf_s(cmdLine, "%31s %259s", mode, (unsigned)sizeof(mode), directory, (unsigned)sizeof(directory));
+
+	// the level still plays sounds and reads the cursor while being staged
+	soundInit(appGetMaxSounds(app));
+	inputInit();
+	int result = goldenRun(&_levelDefs[0], directory, strcmp(mode, "-golden-update") == 0,
+						   strcmp(mode, "-golden-gl") == 0);
+	inputShutdown();
+	soundShutdown();
+	return result;
+}
+
+/// @brief Run micro-benchmarks without a window
+/// usage: -bench <name>, -bench all
+/// @param cmdLine
+/// @return number of failed benchmarks
+static int _gameBench(const char* cmdLine)
+{
+	char name[64] = "all";
+	sscanf_s(cmdLine, "-bench %63s", name, (unsigned)sizeof(name));
+	return benchRun(name);
+}
+
+/// @brief Measure click to photon latency without a window, presenting on a simulated display
+/// usage: -latency [clicks]
+/// @param app
+/// @param cmdLine
+/// @return number of runs that measured nothing
+static int _gameLatency(Application* app, const char* cmdLine)
+{
+	const uint32_t DEFAULT_CLICKS = 200;
+	uint32_t clicks = DEFAULT_CLICKS;
+	sscanf_s(cmdLine, "-latency %u", &clicks);
+
+	soundInit(appGetMaxSounds(app));
+	inputInit();
+	int result = latencyRun(&_levelDefs[0], _gameUpdate, _gameDraw, clicks);
+	inputShutdown();
+	soundShutdown();
+	return result;
+}
+
+/// @brief Print to the console the headless tools were started from, or to a new one
+static void _gameAttachConsole()
+{
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		AllocConsole();
+	}
+	FILE* console;
+	freopen_s(&console, "CONOUT$", "w", stdout);
+}
+
 /// @brief Initialize code to run at application startup
 static void _gameInit()
 {
 	const uint32_t MAX_OBJECTS = 500;
+	if (_profileFile[0] != '\0')
+	{
+		profStart(0);
+		PROFILE_THREAD("main");
+	}
+	drawSetRenderBuffers(_renderBuffers);
+	drawSetRenderDelay(_renderDelay);
+	drawSetBackend(_instanced ? DRAW_BACKEND_GL_INSTANCED : DRAW_BACKEND_GL);
+	drawInit();
+	drawSetPartialRedraw(!_instanced);
+	texMgrInit();
+	loaderInit(_loaderWorkers);
+	perfHudInit();
+	perfHudSetVisible(_perfHud);
 	objMgrInit(MAX_OBJECTS);
 	levelMgrInit();
 	_curLevel = levelMgrLoad(&_levelDefs[0]);
+
+	if (_captureFile[0] != '\0')
+	{
+		captureStart(_captureFile, _captureFps);
+	}
+	if (_clickLatency)
+	{
+		latencyStart();
+	}
+	if (_botSkill != NULL)
+	{
+		BotConfig bot = { _botSkill, _botLogMinutes };
+		inputPointerStart(botGetBackend(), &bot);
+	}
+	else if (_pointerPort != 0)
+	{
+		UdpPointerConfig pointer = { (uint16_t)_pointerPort, uiSize };
+		inputPointerStart(udpPointerGetBackend(), &pointer);
+	}
 }
 
 /// @brief Cleanup the game and free up any allocated resources
 static void _gameShutdown()
 {
+	inputPointerStop();
+	inputPointerReport();
+	soundReport();
 	levelMgrUnload(_curLevel);
 
+	// finish any loads still in flight before the modules waiting on them go away
+	loaderShutdown();
 	levelMgrShutdown();
 	objMgrShutdown();
+	perfHudShutdown();
+	texMgrShutdown();
+	// the render thread has stopped and handed the context back
+	captureStop();
+	drawShutdown();
+	if (_clickLatency)
+	{
+		latencyStop();
+		latencyReport();
+	}
+
+	if (_profileFile[0] != '\0')
+	{
+		profStop();
+		profWriteTrace(_profileFile);
+		profShutdown();
+	}
 }
 
 /// @brief Draw everything to the screen for current frame
 static void _gameDraw() 
 {
+	uint64_t start = timerNowMicroseconds();
+	drawFrameBegin();
 	objMgrDraw();
+	perfHudDraw();
+	drawFrameEnd();
+	perfHudRecordDraw(timerNowMicroseconds() - start);
+
+	if (!_firstFrameReported)
+	{
+		_firstFrameReported = true;
+		printf("startup: first frame after %.1f ms\n", (timerNowMicroseconds() - _startTime) / 1000.0);
+	}
 }
 
 /// @brief Perform updates for all game objects, for the elapsed duration
 /// @param milliseconds 
-static void _gameUpdate(uint32_t milliseconds)
+static void _gameUpdate(Milliseconds milliseconds)
 {
-	static bool latch = false;
-	if (levelMgrGetState() == menuScreen)
+	static uint64_t cursorSample = 0;
+	uint64_t start = timerNowMicroseconds();
+
+	// time pointer samples to the frame that draws the cursor there
+	if (inputPointerNewestSample() != cursorSample)
 	{
-		if (inputMousePressed(INPUT_BUTTON_LEFT))
-		{
-			levelMgrStartGame();
-			_wiiInput = true;
-		}
-		else if (inputMousePressed(INPUT_BUTTON_RIGHT))
-		{
-			_wiiInput = false;
-			levelMgrStartGame();
-		}
+		cursorSample = inputPointerNewestSample();
+		latencyTag(LATENCY_CURSOR, cursorSample);
 	}
-	// Register user click as a gun shot
-	else if (inputMousePressed(INPUT_BUTTON_LEFT))
+
+	// F3 shows and hides the performance overlay
+	if (inputKeyPressedThisFrame(VK_F3))
 	{
-		if (!latch && levelMgrGetState() == gameScreen)
-			processClick(inputMousePosition());
-		latch = true;
+		perfHudSetVisible(!perfHudIsVisible());
 	}
-	else if (!inputMousePressed(INPUT_BUTTON_LEFT) && latch)
+
+	// hand finished loads to the modules waiting on them
+	loaderPoll();
+	if (!_loadReported && !loaderBusy() && texMgrLoading() == 0)
 	{
-		latch = false;
+		_loadReported = true;
+		printf("startup: fully loaded after %.1f ms\n", (timerNowMicroseconds() - _startTime) / 1000.0);
+		texMgrReport();
+	}
 
-		// if the wii remote is being used, perform virtual alt+tab input for mouse y-axis consistency
-		if (_wiiInput)
-		{
+	// move everything up to this frame's time first, so each click is tested against where
+	// the ducks were when it happened, which is now between the last two updates
+	objMgrUpdate(milliseconds);
 
-			INPUT alt;
-
-
-			
-			alt.type = INPUT_KEYBOARD;
-			alt.ki.wVk = VK_MENU; // Virtual key code for alt
-			alt.ki.wScan = 0; // Hardware scan code (not used here)
-			alt.ki.dwFlags = 0; // No special flags
-			alt.ki.time = 0; // Let system provide timestamp
-			alt.ki.dwExtraInfo = 0;
-
-			// Press the key
-			SendInput(1, &alt, sizeof(INPUT));
-
-			INPUT tab;
-			tab.type = INPUT_KEYBOARD;
-			tab.ki.wVk = VK_TAB; // Virtual key code for tab
-			tab.ki.wScan = 0; // Hardware scan code (not used here)
-			tab.ki.dwFlags = 0; // No special flags
-			tab.ki.time = 0; // Let system provide timestamp
-			tab.ki.dwExtraInfo = 0;
-
-			// Press the key
-			SendInput(1, &tab, sizeof(INPUT));
-
-			// Release the key
-			tab.ki.dwFlags = KEYEVENTF_KEYUP;
-			SendInput(1, &tab, sizeof(INPUT));
-			// Release the key
-			alt.ki.dwFlags = KEYEVENTF_KEYUP;
-			SendInput(1, &alt, sizeof(INPUT));
+	// every click since the last update counts, in the order they happened, until one changes
+	// the state. The rest were aimed at what was on screen before, like the menu
+	uint32_t count;
+	const InputEvent* events = inputEvents(&count);
+	levelState state = levelMgrGetState();
+	for (uint32_t i = 0; i < count && levelMgrGetState() == state; ++i)
+	{
+		const InputEvent* event = &events[i];
+		if (event->type == INPUT_EVENT_BUTTON_DOWN)
+		{
+			if (state == menuScreen)
+			{
+				levelMgrStartGame();
+			}
+			// Register user click as a gun shot
+			else if (event->code == INPUT_BUTTON_LEFT)
+			{
+				processClick(event->position, event->timestamp);
+			}
 		}
 	}
-	
-	objMgrUpdate(milliseconds);
-}
\ No newline at end of file
+
+	perfHudRecordUpdate(milliseconds, timerNowMicroseconds() - start);
+}
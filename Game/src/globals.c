@@ -4,4 +4,43 @@
 const Coord2D uiSize = {
     960.0f,
     1024.0f
+};
+
+// which sounds keep their voice when too many play at once. The gun and the jingles matter
+// most, the wings flap constantly and nobody misses one
+const int32_t soundPriorities[numSounds] = {
+    0,  // flap
+    1,  // quack
+    2,  // fall
+    2,  // thud
+    3,  // menu
+    3,  // gameStart
+    2,  // bark
+    2,  // dogPopup
+    2,  // laugh
+    3,  // roundClear
+    3,  // fail
+    3,  // gameOver
+    3,  // perfSound
+    4   // gun
+};
+
+// how often each sound may play. Every duck flaps and quacks, so those are capped to what a
+// flock sounds like whatever its size. The gun always fires, cutting off its oldest echo
+const SoundPolicy soundPolicies[numSounds] = {
+    // instances  interval  coalesce  steal
+    { 3,          60.0f,    true,     SOUND_STEAL_OLDEST },     // flap
+    { 2,          250.0f,   true,     SOUND_STEAL_NONE },       // quack
+    { 2,          0.0f,     true,     SOUND_STEAL_OLDEST },     // fall
+    { 2,          0.0f,     true,     SOUND_STEAL_OLDEST },     // thud
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // menu
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // gameStart
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // bark
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // dogPopup
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // laugh
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // roundClear
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // fail
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // gameOver
+    { 1,          0.0f,     true,     SOUND_STEAL_OLDEST },     // perfSound
+    { 2,          0.0f,     false,    SOUND_STEAL_OLDEST }      // gun
 };
\ No newline at end of file
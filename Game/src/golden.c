@@ -0,0 +1,284 @@
+#include <Windows.h>
+#include <gl/GL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "golden.h"
+#include "globals.h"
+#include "draw.h"
+#include "swrender.h"
+#include "objmgr.h"
+#include "texmgr.h"
+#include "random.h"
+#include "application.h"
+#include "framework.h"
+#include "SOIL.h"
+
+// Renders each staged scene with the software backend, or with GL in an offscreen context,
+// and compares it against <directory>/<scene>.tga. Failing scenes leave <scene>.actual.tga
+// and <scene>.diff.tga behind.
+
+#define GOLDEN_SEED 1985
+#define GOLDEN_MAX_OBJECTS 500
+// largest per channel difference that still counts as a match
+#define GOLDEN_TOLERANCE 8
+#define GOLDEN_PATH_LENGTH 260
+// largest possible YIQ delta, used to normalize the perceptual score
+#define GOLDEN_MAX_YIQ_DELTA 35215.0f
+
+static const char* _sceneNames[sceneCount] = {
+	"menu",
+	"roundPopup",
+	"flyAway",
+	"dogOneDuck",
+	"dogTwoDucks",
+	"dogLaugh",
+	"gameOver"
+};
+
+static bool _goldenCompare(const SwImage* actual, const char* goldenPath, const char* diffPath);
+static float _goldenYiqDelta(const uint8_t* a, const uint8_t* b);
+static double _goldenNow();
+static void _goldenDraw();
+
+/// @brief Render every scene headlessly and check it against, or record it as, the golden image
+/// @param levelDef level to stage the scenes in
+/// @param directory where the golden images live
+/// @param update overwrite the golden images instead of comparing
+/// @param gl render through the real GL path instead of the software reference
+/// @return number of scenes that failed
+int32_t goldenRun(const LevelDef* levelDef, const char* directory, bool update, bool gl)
+{
+	int32_t failures = 0;
+	Application* app = NULL;
+	GLOffscreen* offscreen = NULL;
+	SwImage glFrame = { (int32_t)uiSize.x, (int32_t)uiSize.y, 3, NULL };
+
+	if (gl)
+	{
+		app = appNew(GetModuleHandle(NULL), "Duck Hunt golden", _goldenDraw, NULL);
+		if (app != NULL)
+		{
+			appSetWidth(app, (uint32_t)uiSize.x);
+			appSetHeight(app, (uint32_t)uiSize.y);
+			offscreen = fwInitOffscreen(app);
+		}
+		glFrame.pixels = malloc((size_t)glFrame.width * glFrame.height * 3);
+		if (offscreen == NULL || glFrame.pixels == NULL)
+		{
+			printf("golden: no offscreen GL context\n");
+			free(glFrame.pixels);
+			fwShutdownOffscreen(offscreen);
+			appDelete(app);
+			return sceneCount;
+		}
+		drawSetBackend(DRAW_BACKEND_GL);
+		drawSetRenderBuffers(0);
+		drawInit();
+	}
+	else
+	{
+		drawSetBackend(DRAW_BACKEND_SOFTWARE);
+		drawInit();
+		if (!swrInit((int32_t)uiSize.x, (int32_t)uiSize.y))
+		{
+			printf("golden: out of memory\n");
+			drawShutdown();
+			return sceneCount;
+		}
+	}
+	texMgrInit();
+	objMgrInit(GOLDEN_MAX_OBJECTS);
+	levelMgrInit();
+
+	for (int32_t scene = 0; scene < sceneCount; ++scene)
+	{
+		char goldenPath[GOLDEN_PATH_LENGTH];
+		char actualPath[GOLDEN_PATH_LENGTH];
+		char diffPath[GOLDEN_PATH_LENGTH];
+		snprintf(goldenPath, sizeof(goldenPath), "%s/%s.tga", directory, _sceneNames[scene]);
+		snprintf(actualPath, sizeof(actualPath), "%s/%s.actual.tga", directory, _sceneNames[scene]);
+		snprintf(diffPath, sizeof(diffPath), "%s/%s.diff.tga", directory, _sceneNames[scene]);
+
+		// every scene starts from the same seed so duck types and flight paths repeat
+		randSeed(GOLDEN_SEED);
+		Level* level = levelMgrLoad(levelDef);
+		levelMgrStageScene((Scene)scene);
+
+		const SwImage* frame;
+		double renderMs;
+		if (offscreen != NULL)
+		{
+			double start = _goldenNow();
+			fwOffscreenFrame(offscreen);
+			glFinish();
+			renderMs = (_goldenNow() - start) * 1000.0;
+			fwOffscreenReadPixels(offscreen, glFrame.pixels);
+			frame = &glFrame;
+		}
+		else
+		{
+			drawFrameBegin();
+			objMgrDraw();
+			double start = _goldenNow();
+			drawFrameEnd();
+			renderMs = (_goldenNow() - start) * 1000.0;
+			frame = swrGetFrame();
+		}
+		if (update)
+		{
+			if (SOIL_save_image(goldenPath, SOIL_SAVE_TYPE_TGA, frame->width, frame->height, frame->channels, frame->pixels))
+			{
+				printf("golden: %-12s RECORDED %.2f ms\n", _sceneNames[scene], renderMs);
+			}
+			else
+			{
+				printf("golden: %-12s could not write %s\n", _sceneNames[scene], goldenPath);
+				++failures;
+			}
+		}
+		else
+		{
+			printf("golden: %-12s ", _sceneNames[scene]);
+			if (!_goldenCompare(frame, goldenPath, diffPath))
+			{
+				SOIL_save_image(actualPath, SOIL_SAVE_TYPE_TGA, frame->width, frame->height, frame->channels, frame->pixels);
+				++failures;
+			}
+			printf(" %.2f ms\n", renderMs);
+		}
+
+		levelMgrUnload(level);
+	}
+
+	printf("golden: %d of %d scenes failed\n", failures, (int32_t)sceneCount);
+
+	levelMgrShutdown();
+	objMgrShutdown();
+	texMgrShutdown();
+	if (offscreen != NULL)
+	{
+		drawShutdown();
+		fwShutdownOffscreen(offscreen);
+		appDelete(app);
+		free(glFrame.pixels);
+	}
+	else
+	{
+		swrShutdown();
+		drawShutdown();
+	}
+	drawSetBackend(DRAW_BACKEND_GL);
+
+	return failures;
+}
+
+/// @brief The offscreen frame, recorded the same way the game records it
+static void _goldenDraw()
+{
+	drawFrameBegin();
+	objMgrDraw();
+	drawFrameEnd();
+}
+
+/// @brief Compare a frame against the golden image and write a diff image when they differ
+/// @param actual
+/// @param goldenPath
+/// @param diffPath
+/// @return true if every pixel is within tolerance
+static bool _goldenCompare(const SwImage* actual, const char* goldenPath, const char* diffPath)
+{
+	int32_t width, height, channels;
+	uint8_t* golden = SOIL_load_image(goldenPath, &width, &height, &channels, SOIL_LOAD_RGB);
+	if (golden == NULL)
+	{
+		printf("FAIL missing %s, record it with -golden-update", goldenPath);
+		return false;
+	}
+	if (width != actual->width || height != actual->height)
+	{
+		printf("FAIL size %dx%d, expected %dx%d", actual->width, actual->height, width, height);
+		SOIL_free_image_data(golden);
+		return false;
+	}
+
+	size_t count = (size_t)width * height;
+	uint8_t* diff = malloc(count * 3);
+	uint32_t mismatches = 0;
+	int32_t maxChannelDelta = 0;
+	double perceptual = 0.0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint8_t* a = &actual->pixels[i * 3];
+		const uint8_t* g = &golden[i * 3];
+		int32_t channelDelta = 0;
+		for (int32_t c = 0; c < 3; ++c)
+		{
+			int32_t d = abs((int32_t)a[c] - (int32_t)g[c]);
+			channelDelta = (d > channelDelta) ? d : channelDelta;
+		}
+		maxChannelDelta = (channelDelta > maxChannelDelta) ? channelDelta : maxChannelDelta;
+
+		float delta = _goldenYiqDelta(a, g) / GOLDEN_MAX_YIQ_DELTA;
+		perceptual += delta;
+		if (channelDelta > GOLDEN_TOLERANCE)
+			++mismatches;
+
+		if (diff != NULL)
+		{
+			uint8_t* out = &diff[i * 3];
+			if (channelDelta > GOLDEN_TOLERANCE)
+			{
+				// mismatches in red, brighter for differences that are easier to see
+				out[0] = (uint8_t)(128 + 127 * delta);
+				out[1] = 0;
+				out[2] = 0;
+			}
+			else
+			{
+				// faded grayscale of the golden image for context
+				uint8_t luma = (uint8_t)((g[0] * 77 + g[1] * 150 + g[2] * 29) >> 8);
+				out[0] = out[1] = out[2] = (uint8_t)(192 + (luma >> 2));
+			}
+		}
+	}
+
+	bool passed = (mismatches == 0);
+	printf("%s %u px over tolerance, max channel delta %d, perceptual %.5f",
+		passed ? "PASS" : "FAIL", mismatches, maxChannelDelta, perceptual / (double)count);
+
+	if (!passed && diff != NULL)
+	{
+		SOIL_save_image(diffPath, SOIL_SAVE_TYPE_TGA, width, height, 3, diff);
+	}
+
+	free(diff);
+	SOIL_free_image_data(golden);
+	return passed;
+}
+
+/// @brief Squared color difference in YIQ space, weighted the way the eye weighs it
+/// @param a, b RGB pixels
+/// @return delta from 0 to GOLDEN_MAX_YIQ_DELTA
+static float _goldenYiqDelta(const uint8_t* a, const uint8_t* b)
+{
+	float r = (float)a[0] - (float)b[0];
+	float g = (float)a[1] - (float)b[1];
+	float bl = (float)a[2] - (float)b[2];
+
+	float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+	float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+	float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+
+	return 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+}
+
+/// @brief Wall clock in seconds
+static double _goldenNow()
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
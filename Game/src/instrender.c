@@ -0,0 +1,590 @@
+#include <Windows.h>
+#include <gl/GL.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instrender.h"
+#include "framework.h"
+
+// GL 3.3 path for SpriteCmds: one unit quad in a VAO, the sprites streamed as per-instance
+// attributes and drawn with one glDrawArraysInstanced per run of sprites sharing a texture.
+// Only core profile calls are used, the context itself is compatibility so the immediate
+// mode paths and SOIL still work next to it. Needs the context the framework makes when
+// the application asks for GL 3.3
+
+// sprites are streamed through a ring of segments, each fenced until the GPU has read it
+#define INST_SEGMENTS 3
+#define INST_INITIAL_CAPACITY 4096
+#define INST_FENCE_TIMEOUT_NS 1000000000ull
+
+// the parts of glext.h we need, Windows only ships the 1.1 header
+#ifndef GL_ARRAY_BUFFER
+typedef char GLchar;
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+typedef struct __GLsync* GLsync;
+typedef unsigned __int64 GLuint64;
+
+#define GL_ARRAY_BUFFER						0x8892
+#define GL_STREAM_DRAW						0x88E0
+#define GL_STATIC_DRAW						0x88E4
+#define GL_FRAGMENT_SHADER					0x8B30
+#define GL_VERTEX_SHADER					0x8B31
+#define GL_COMPILE_STATUS					0x8B81
+#define GL_LINK_STATUS						0x8B82
+#define GL_TEXTURE0							0x84C0
+#define GL_MAP_WRITE_BIT					0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT			0x0004
+#define GL_MAP_UNSYNCHRONIZED_BIT			0x0020
+#define GL_MAP_PERSISTENT_BIT				0x0040
+#define GL_MAP_COHERENT_BIT					0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE		0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT			0x00000001
+#define GL_TIMEOUT_EXPIRED					0x911B
+#define GL_WAIT_FAILED						0x911D
+#define GL_MAJOR_VERSION					0x821B
+#define GL_MINOR_VERSION					0x821C
+#define GL_NUM_EXTENSIONS					0x821D
+#endif
+
+typedef void (APIENTRY* GenVertexArraysFunc)(GLsizei n, GLuint* arrays);
+typedef void (APIENTRY* BindVertexArrayFunc)(GLuint array);
+typedef void (APIENTRY* DeleteVertexArraysFunc)(GLsizei n, const GLuint* arrays);
+typedef void (APIENTRY* GenBuffersFunc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* BindBufferFunc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* DeleteBuffersFunc)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY* BufferDataFunc)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+typedef void (APIENTRY* BufferStorageFunc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void* (APIENTRY* MapBufferRangeFunc)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRY* UnmapBufferFunc)(GLenum target);
+typedef void (APIENTRY* VertexAttribPointerFunc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef void (APIENTRY* EnableVertexAttribArrayFunc)(GLuint index);
+typedef void (APIENTRY* VertexAttribDivisorFunc)(GLuint index, GLuint divisor);
+typedef void (APIENTRY* DrawArraysInstancedFunc)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef GLuint (APIENTRY* CreateShaderFunc)(GLenum type);
+typedef void (APIENTRY* ShaderSourceFunc)(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+typedef void (APIENTRY* CompileShaderFunc)(GLuint shader);
+typedef void (APIENTRY* GetShaderivFunc)(GLuint shader, GLenum pname, GLint* params);
+typedef void (APIENTRY* GetShaderInfoLogFunc)(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef void (APIENTRY* DeleteShaderFunc)(GLuint shader);
+typedef GLuint (APIENTRY* CreateProgramFunc)();
+typedef void (APIENTRY* AttachShaderFunc)(GLuint program, GLuint shader);
+typedef void (APIENTRY* LinkProgramFunc)(GLuint program);
+typedef void (APIENTRY* GetProgramivFunc)(GLuint program, GLenum pname, GLint* params);
+typedef void (APIENTRY* GetProgramInfoLogFunc)(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef void (APIENTRY* DeleteProgramFunc)(GLuint program);
+typedef void (APIENTRY* UseProgramFunc)(GLuint program);
+typedef GLint (APIENTRY* GetUniformLocationFunc)(GLuint program, const GLchar* name);
+typedef void (APIENTRY* Uniform1iFunc)(GLint location, GLint v0);
+typedef void (APIENTRY* Uniform2fFunc)(GLint location, GLfloat v0, GLfloat v1);
+typedef void (APIENTRY* ActiveTextureFunc)(GLenum texture);
+typedef GLsync (APIENTRY* FenceSyncFunc)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY* ClientWaitSyncFunc)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (APIENTRY* DeleteSyncFunc)(GLsync sync);
+typedef const GLubyte* (APIENTRY* GetStringiFunc)(GLenum name, GLuint index);
+
+/// @brief GL 1.2+ entry points, fetched at runtime
+static struct inst_gl_t {
+	GenVertexArraysFunc GenVertexArrays;
+	BindVertexArrayFunc BindVertexArray;
+	DeleteVertexArraysFunc DeleteVertexArrays;
+	GenBuffersFunc GenBuffers;
+	BindBufferFunc BindBuffer;
+	DeleteBuffersFunc DeleteBuffers;
+	BufferDataFunc BufferData;
+	BufferStorageFunc BufferStorage;	// GL 4.4 or ARB_buffer_storage, may be NULL
+	MapBufferRangeFunc MapBufferRange;
+	UnmapBufferFunc UnmapBuffer;
+	VertexAttribPointerFunc VertexAttribPointer;
+	EnableVertexAttribArrayFunc EnableVertexAttribArray;
+	VertexAttribDivisorFunc VertexAttribDivisor;
+	DrawArraysInstancedFunc DrawArraysInstanced;
+	CreateShaderFunc CreateShader;
+	ShaderSourceFunc ShaderSource;
+	CompileShaderFunc CompileShader;
+	GetShaderivFunc GetShaderiv;
+	GetShaderInfoLogFunc GetShaderInfoLog;
+	DeleteShaderFunc DeleteShader;
+	CreateProgramFunc CreateProgram;
+	AttachShaderFunc AttachShader;
+	LinkProgramFunc LinkProgram;
+	GetProgramivFunc GetProgramiv;
+	GetProgramInfoLogFunc GetProgramInfoLog;
+	DeleteProgramFunc DeleteProgram;
+	UseProgramFunc UseProgram;
+	GetUniformLocationFunc GetUniformLocation;
+	Uniform1iFunc Uniform1i;
+	Uniform2fFunc Uniform2f;
+	ActiveTextureFunc ActiveTexture;
+	FenceSyncFunc FenceSync;
+	ClientWaitSyncFunc ClientWaitSync;
+	DeleteSyncFunc DeleteSync;
+	GetStringiFunc GetStringi;
+} _gl;
+
+/// @brief Per-instance attributes, one sprite
+typedef struct quad_instance_t {
+	GLfloat rect[4];	// left, top, right, bottom in pixels
+	GLfloat uv[4];		// u, v of the top left, then the extent. A negative extent mirrors
+	GLfloat depth;
+} QuadInstance;
+
+/// @brief Sprites in a row sharing a texture, drawn with one call
+typedef struct quad_run_t {
+	GLuint texture;
+	uint32_t first;
+	uint32_t count;
+} QuadRun;
+
+static struct instrender_t {
+	bool ready;
+	GLuint program;
+	GLint viewportLocation;
+	GLuint vao;
+	GLuint cornerBuffer;
+	GLuint instanceBuffer;
+
+	// streaming ring
+	bool persistent;
+	QuadInstance* mapped;		// the whole buffer, when persistently mapped
+	uint32_t capacity;			// instances per segment
+	uint32_t segment;
+	GLsync fences[INST_SEGMENTS];
+
+	QuadRun* runs;
+	uint32_t maxRuns;
+	uint32_t drawCalls;			// in the last frame
+} _inst;
+
+// corners of the unit quad in the same order drawSubmitCmd emits them: TL, BL, TR, BR
+static const GLfloat _corners[] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f };
+
+// matches glOrtho(0, width, height, 0, -1, 1) from glDrawResize
+static const char _vertexSource[] =
+	"#version 330 core\n"
+	"layout(location = 0) in vec2 corner;\n"
+	"layout(location = 1) in vec4 rect;\n"
+	"layout(location = 2) in vec4 uv;\n"
+	"layout(location = 3) in float depth;\n"
+	"uniform vec2 viewport;\n"
+	"out vec2 texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 position = mix(rect.xy, rect.zw, corner);\n"
+	"	texCoord = vec2(uv.x + uv.z * corner.x, uv.y - uv.w * corner.y);\n"
+	"	gl_Position = vec4(position.x * 2.0 / viewport.x - 1.0, 1.0 - position.y * 2.0 / viewport.y, -depth, 1.0);\n"
+	"}\n";
+
+static const char _fragmentSource[] =
+	"#version 330 core\n"
+	"in vec2 texCoord;\n"
+	"uniform sampler2D sheet;\n"
+	"out vec4 color;\n"
+	"void main()\n"
+	"{\n"
+	"	color = texture(sheet, texCoord);\n"
+	"}\n";
+
+static bool _instLoadFunctions();
+static GLuint _instCompile(GLenum type, const char* source);
+static bool _instAllocate(uint32_t capacity);
+static void _instReleaseBuffer();
+static void _instWaitSegment(uint32_t segment);
+static void _instBindInstances(uint32_t first);
+static bool _instHasBufferStorage();
+
+/// @brief Compile the shaders and create the buffers. Must be called on the thread owning the context
+/// @return false if the context isn't 3.3 capable, nothing is left allocated then
+bool instInit()
+{
+	ZeroMemory(&_inst, sizeof(_inst));
+	if (!_instLoadFunctions())
+	{
+		printf("instrender: GL 3.3 entry points missing\n");
+		return false;
+	}
+
+	GLuint vertex = _instCompile(GL_VERTEX_SHADER, _vertexSource);
+	GLuint fragment = _instCompile(GL_FRAGMENT_SHADER, _fragmentSource);
+	if (vertex == 0 || fragment == 0)
+	{
+		_gl.DeleteShader(vertex);
+		_gl.DeleteShader(fragment);
+		return false;
+	}
+
+	_inst.program = _gl.CreateProgram();
+	_gl.AttachShader(_inst.program, vertex);
+	_gl.AttachShader(_inst.program, fragment);
+	_gl.LinkProgram(_inst.program);
+	_gl.DeleteShader(vertex);
+	_gl.DeleteShader(fragment);
+
+	GLint linked = GL_FALSE;
+	_gl.GetProgramiv(_inst.program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char log[512];
+		_gl.GetProgramInfoLog(_inst.program, sizeof(log), NULL, log);
+		printf("instrender: link failed: %s\n", log);
+		_gl.DeleteProgram(_inst.program);
+		_inst.program = 0;
+		return false;
+	}
+	_inst.viewportLocation = _gl.GetUniformLocation(_inst.program, "viewport");
+	_gl.UseProgram(_inst.program);
+	_gl.Uniform1i(_gl.GetUniformLocation(_inst.program, "sheet"), 0);
+	_gl.UseProgram(0);
+
+	// the corners are the only per-vertex data, everything else advances per instance
+	_gl.GenVertexArrays(1, &_inst.vao);
+	_gl.BindVertexArray(_inst.vao);
+	_gl.GenBuffers(1, &_inst.cornerBuffer);
+	_gl.BindBuffer(GL_ARRAY_BUFFER, _inst.cornerBuffer);
+	_gl.BufferData(GL_ARRAY_BUFFER, sizeof(_corners), _corners, GL_STATIC_DRAW);
+	_gl.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), NULL);
+	_gl.EnableVertexAttribArray(0);
+	for (GLuint attrib = 1; attrib <= 3; ++attrib)
+	{
+		_gl.EnableVertexAttribArray(attrib);
+		_gl.VertexAttribDivisor(attrib, 1);
+	}
+	_gl.BindVertexArray(0);
+	_gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	_inst.persistent = _instHasBufferStorage();
+	if (!_instAllocate(INST_INITIAL_CAPACITY))
+	{
+		instShutdown();
+		return false;
+	}
+
+	_inst.ready = (glGetError() == GL_NO_ERROR);
+	if (!_inst.ready)
+	{
+		printf("instrender: setup raised a GL error\n");
+		instShutdown();
+		return false;
+	}
+	printf("instrender: GL %s, %s streaming\n", (const char*)glGetString(GL_VERSION),
+		   _inst.persistent ? "persistent mapped" : "map range");
+	return true;
+}
+
+/// @brief Free the GL objects. Must be called on the thread owning the context
+void instShutdown()
+{
+	_instReleaseBuffer();
+	if (_inst.vao != 0)
+		_gl.DeleteVertexArrays(1, &_inst.vao);
+	if (_inst.cornerBuffer != 0)
+		_gl.DeleteBuffers(1, &_inst.cornerBuffer);
+	if (_inst.program != 0)
+		_gl.DeleteProgram(_inst.program);
+	free(_inst.runs);
+	ZeroMemory(&_inst, sizeof(_inst));
+}
+
+/// @brief Draw recorded sprites in order, batching neighbours that share a texture
+/// @param cmds
+/// @param count
+/// @return false if nothing was drawn, the caller draws the frame some other way then
+bool instDraw(const SpriteCmd* cmds, uint32_t count)
+{
+	_inst.drawCalls = 0;
+	if (!_inst.ready)
+		return false;
+	if (count == 0)
+		return true;
+
+	// every sprite could start a new run in the worst case
+	if (count > _inst.maxRuns)
+	{
+		QuadRun* runs = realloc(_inst.runs, count * sizeof(QuadRun));
+		if (runs == NULL)
+			return false;
+		_inst.runs = runs;
+		_inst.maxRuns = count;
+	}
+	if (count > _inst.capacity)
+	{
+		uint32_t capacity = _inst.capacity;
+		while (capacity < count)
+		{
+			capacity *= 2;
+		}
+		if (!_instAllocate(capacity))
+		{
+			// the old ring is gone too, leave this and every later frame to immediate mode
+			_inst.ready = false;
+			return false;
+		}
+	}
+
+	_inst.segment = (_inst.segment + 1) % INST_SEGMENTS;
+	_instWaitSegment(_inst.segment);
+
+	uint32_t base = _inst.segment * _inst.capacity;
+	_gl.BindBuffer(GL_ARRAY_BUFFER, _inst.instanceBuffer);
+	QuadInstance* dst;
+	if (_inst.persistent)
+	{
+		dst = _inst.mapped + base;
+	}
+	else
+	{
+		// the fence already says the GPU is done with this segment
+		dst = _gl.MapBufferRange(GL_ARRAY_BUFFER, base * sizeof(QuadInstance), count * sizeof(QuadInstance),
+								 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (dst == NULL)
+		{
+			_gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+			return false;
+		}
+	}
+
+	uint32_t written = 0;
+	uint32_t runCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const SpriteCmd* cmd = &cmds[i];
+		// not uploaded yet
+		if (cmd->texture == 0)
+			continue;
+
+		QuadInstance* quad = &dst[written];
+		quad->rect[0] = cmd->xPositionLeft;
+		quad->rect[1] = cmd->yPositionTop;
+		quad->rect[2] = cmd->xPositionRight;
+		quad->rect[3] = cmd->yPositionBottom;
+		quad->uv[0] = cmd->xTextureCoord;
+		quad->uv[1] = cmd->yTextureCoord;
+		quad->uv[2] = cmd->u;
+		quad->uv[3] = cmd->v;
+		quad->depth = cmd->depth;
+
+		if (runCount == 0 || _inst.runs[runCount - 1].texture != cmd->texture)
+		{
+			_inst.runs[runCount].texture = cmd->texture;
+			_inst.runs[runCount].first = base + written;
+			_inst.runs[runCount].count = 0;
+			++runCount;
+		}
+		++_inst.runs[runCount - 1].count;
+		++written;
+	}
+	if (!_inst.persistent)
+	{
+		_gl.UnmapBuffer(GL_ARRAY_BUFFER);
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	_gl.UseProgram(_inst.program);
+	_gl.Uniform2f(_inst.viewportLocation, (GLfloat)viewport[2], (GLfloat)viewport[3]);
+	_gl.BindVertexArray(_inst.vao);
+	_gl.ActiveTexture(GL_TEXTURE0);
+	for (uint32_t i = 0; i < runCount; ++i)
+	{
+		const QuadRun* run = &_inst.runs[i];
+		glBindTexture(GL_TEXTURE_2D, run->texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		_instBindInstances(run->first);
+		_gl.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)run->count);
+	}
+	_inst.drawCalls = runCount;
+	_inst.fences[_inst.segment] = _gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	// leave the fixed function state as the immediate mode paths expect it
+	_gl.BindVertexArray(0);
+	_gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+	_gl.UseProgram(0);
+	return true;
+}
+
+/// @brief Number of instanced draw calls the last instDraw made
+/// @return
+uint32_t instGetDrawCalls()
+{
+	return _inst.drawCalls;
+}
+
+/// @brief Fetch everything instDraw needs
+/// @return false if a required entry point is missing
+static bool _instLoadFunctions()
+{
+	bool ok = true;
+#define INST_LOAD(member, name) ok &= ((_gl.member = fwGetProcAddress(name)) != NULL)
+	INST_LOAD(GenVertexArrays, "glGenVertexArrays");
+	INST_LOAD(BindVertexArray, "glBindVertexArray");
+	INST_LOAD(DeleteVertexArrays, "glDeleteVertexArrays");
+	INST_LOAD(GenBuffers, "glGenBuffers");
+	INST_LOAD(BindBuffer, "glBindBuffer");
+	INST_LOAD(DeleteBuffers, "glDeleteBuffers");
+	INST_LOAD(BufferData, "glBufferData");
+	INST_LOAD(MapBufferRange, "glMapBufferRange");
+	INST_LOAD(UnmapBuffer, "glUnmapBuffer");
+	INST_LOAD(VertexAttribPointer, "glVertexAttribPointer");
+	INST_LOAD(EnableVertexAttribArray, "glEnableVertexAttribArray");
+	INST_LOAD(VertexAttribDivisor, "glVertexAttribDivisor");
+	INST_LOAD(DrawArraysInstanced, "glDrawArraysInstanced");
+	INST_LOAD(CreateShader, "glCreateShader");
+	INST_LOAD(ShaderSource, "glShaderSource");
+	INST_LOAD(CompileShader, "glCompileShader");
+	INST_LOAD(GetShaderiv, "glGetShaderiv");
+	INST_LOAD(GetShaderInfoLog, "glGetShaderInfoLog");
+	INST_LOAD(DeleteShader, "glDeleteShader");
+	INST_LOAD(CreateProgram, "glCreateProgram");
+	INST_LOAD(AttachShader, "glAttachShader");
+	INST_LOAD(LinkProgram, "glLinkProgram");
+	INST_LOAD(GetProgramiv, "glGetProgramiv");
+	INST_LOAD(GetProgramInfoLog, "glGetProgramInfoLog");
+	INST_LOAD(DeleteProgram, "glDeleteProgram");
+	INST_LOAD(UseProgram, "glUseProgram");
+	INST_LOAD(GetUniformLocation, "glGetUniformLocation");
+	INST_LOAD(Uniform1i, "glUniform1i");
+	INST_LOAD(Uniform2f, "glUniform2f");
+	INST_LOAD(ActiveTexture, "glActiveTexture");
+	INST_LOAD(FenceSync, "glFenceSync");
+	INST_LOAD(ClientWaitSync, "glClientWaitSync");
+	INST_LOAD(DeleteSync, "glDeleteSync");
+	INST_LOAD(GetStringi, "glGetStringi");
+#undef INST_LOAD
+
+	// optional, without it each frame maps its segment instead
+	_gl.BufferStorage = fwGetProcAddress("glBufferStorage");
+	return ok;
+}
+
+/// @brief Compile one shader stage
+/// @param type
+/// @param source
+/// @return shader, 0 on failure
+static GLuint _instCompile(GLenum type, const char* source)
+{
+	GLuint shader = _gl.CreateShader(type);
+	_gl.ShaderSource(shader, 1, &source, NULL);
+	_gl.CompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	_gl.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		char log[512];
+		_gl.GetShaderInfoLog(shader, sizeof(log), NULL, log);
+		printf("instrender: %s shader failed: %s\n", (type == GL_VERTEX_SHADER) ? "vertex" : "fragment", log);
+		_gl.DeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+/// @brief (Re)create the instance ring with room for capacity sprites per segment
+/// @param capacity
+/// @return false if out of memory
+static bool _instAllocate(uint32_t capacity)
+{
+	_instReleaseBuffer();
+
+	GLsizeiptr size = (GLsizeiptr)capacity * INST_SEGMENTS * sizeof(QuadInstance);
+	_gl.GenBuffers(1, &_inst.instanceBuffer);
+	_gl.BindBuffer(GL_ARRAY_BUFFER, _inst.instanceBuffer);
+	if (_inst.persistent)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		_gl.BufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+		_inst.mapped = _gl.MapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+	}
+	else
+	{
+		_gl.BufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+	}
+	_gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (glGetError() != GL_NO_ERROR || (_inst.persistent && _inst.mapped == NULL))
+	{
+		printf("instrender: could not allocate %u sprites\n", capacity);
+		_instReleaseBuffer();
+		return false;
+	}
+	_inst.capacity = capacity;
+	return true;
+}
+
+/// @brief Wait for every segment and delete the instance buffer
+static void _instReleaseBuffer()
+{
+	for (uint32_t i = 0; i < INST_SEGMENTS; ++i)
+	{
+		_instWaitSegment(i);
+	}
+	if (_inst.instanceBuffer != 0)
+	{
+		if (_inst.mapped != NULL)
+		{
+			_gl.BindBuffer(GL_ARRAY_BUFFER, _inst.instanceBuffer);
+			_gl.UnmapBuffer(GL_ARRAY_BUFFER);
+			_gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		_gl.DeleteBuffers(1, &_inst.instanceBuffer);
+	}
+	_inst.instanceBuffer = 0;
+	_inst.mapped = NULL;
+	_inst.capacity = 0;
+}
+
+/// @brief Block until the GPU has finished reading a segment
+/// @param segment
+static void _instWaitSegment(uint32_t segment)
+{
+	GLsync fence = _inst.fences[segment];
+	if (fence == NULL)
+		return;
+
+	GLenum result;
+	do
+	{
+		result = _gl.ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, INST_FENCE_TIMEOUT_NS);
+	} while (result == GL_TIMEOUT_EXPIRED);
+	_gl.DeleteSync(fence);
+	_inst.fences[segment] = NULL;
+}
+
+/// @brief Point the per-instance attributes at a sprite in the ring.
+/// There's no base instance in 3.3, so each run moves the pointers instead
+/// @param first
+static void _instBindInstances(uint32_t first)
+{
+	const size_t offset = first * sizeof(QuadInstance);
+	_gl.BindBuffer(GL_ARRAY_BUFFER, _inst.instanceBuffer);
+	_gl.VertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (const void*)(offset + offsetof(QuadInstance, rect)));
+	_gl.VertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (const void*)(offset + offsetof(QuadInstance, uv)));
+	_gl.VertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (const void*)(offset + offsetof(QuadInstance, depth)));
+}
+
+/// @brief Whether the context really offers glBufferStorage. Drivers can hand out the entry
+/// point without supporting it, so it takes GL 4.4 or the extension as well
+/// @return
+static bool _instHasBufferStorage()
+{
+	if (_gl.BufferStorage == NULL)
+		return false;
+
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 4))
+		return true;
+
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (GLint i = 0; i < extensions; ++i)
+	{
+		const char* name = (const char*)_gl.GetStringi(GL_EXTENSIONS, (GLuint)i);
+		if (name != NULL && strcmp(name, "GL_ARB_buffer_storage") == 0)
+			return true;
+	}
+	return false;
+}
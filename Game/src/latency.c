@@ -0,0 +1,359 @@
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "latency.h"
+#include "globals.h"
+#include "draw.h"
+#include "swrender.h"
+#include "objmgr.h"
+#include "texmgr.h"
+#include "loader.h"
+#include "input.h"
+#include "timer.h"
+#include "random.h"
+
+// Click to photon latency. The press time rides along with the input, levelmgr tags what the
+// click did, draw assigns the tags to the frame being recorded and whoever presents that frame
+// closes them. In the game the present is when the render thread has submitted the frame, so
+// the swap and scanout are not included. latencyRun drives the real update and draw functions
+// headlessly, presenting on a simulated display clock so it can run without a window
+
+#define LATENCY_MAX_PENDING 64
+#define LATENCY_MAX_SAMPLES 4096
+#define LATENCY_SEED 1985
+#define LATENCY_FPS 60
+#define LATENCY_MAX_OBJECTS 500
+#define LATENCY_MAX_QUEUED 2
+#define LATENCY_FRAMES_PER_CLICK 600	// give up on a run that stops finding ducks
+
+static const char* _outcomeNames[LATENCY_OUTCOME_COUNT] = {
+	"shot",
+	"hit",
+	"cursor"
+};
+
+/// @brief A tagged click waiting for its frame to be presented
+typedef struct latency_pending_t {
+	LatencyOutcome	outcome;
+	uint64_t		inputTime;
+	uint64_t		frame;						// 0 until a frame showing it is recorded
+} LatencyPending;
+
+/// @brief The simulated display, in nanoseconds
+typedef struct latency_clock_t {
+	uint64_t		period;
+	uint32_t		queued;						// frames waiting ahead of each one
+	uint64_t		start;						// when the next frame starts, on a vsync
+	uint64_t		previous;
+} LatencyClock;
+
+static struct latency_t {
+	volatile bool	active;
+	volatile LONG	callers;					// threads between checking active and leaving the lock
+	CRITICAL_SECTION lock;						// tags come from the update, presents from the render thread
+	uint64_t		recorded;
+	LatencyPending	pending[LATENCY_MAX_PENDING];
+	uint32_t		pendingCount;
+	uint32_t		dropped;
+	uint64_t		samples[LATENCY_OUTCOME_COUNT][LATENCY_MAX_SAMPLES];
+	uint32_t		sampleCount[LATENCY_OUTCOME_COUNT];
+} _latency;
+
+static uint32_t _latencySimulate(const LevelDef* levelDef, AppUpdateFunc update, AppDrawFunc draw,
+								 uint32_t clicks, uint32_t queued);
+static void _latencyFrame(LatencyClock* clock, AppUpdateFunc update, AppDrawFunc draw);
+static uint64_t _latencyPhase(uint64_t period);
+static int _latencyCompare(const void* a, const void* b);
+static bool _latencyEnter();
+static void _latencyLeave();
+
+/// @brief Start collecting samples, clearing any from an earlier session
+void latencyStart()
+{
+	if (_latency.active)
+		return;
+
+	ZeroMemory(&_latency, sizeof(_latency));
+	InitializeCriticalSection(&_latency.lock);
+	_latency.active = true;
+}
+
+/// @brief Stop collecting. The samples stay for latencyReport. Waits for any thread still
+/// tagging or presenting, so the lock can go
+void latencyStop()
+{
+	if (!_latency.active)
+		return;
+
+	_latency.active = false;
+	while (InterlockedCompareExchange(&_latency.callers, 0, 0) != 0)
+	{
+		Sleep(0);
+	}
+	DeleteCriticalSection(&_latency.lock);
+}
+
+/// @brief Print the percentiles for each outcome. Sorts the samples in place
+void latencyReport()
+{
+	for (uint32_t outcome = 0; outcome < LATENCY_OUTCOME_COUNT; ++outcome)
+	{
+		uint64_t* samples = _latency.samples[outcome];
+		uint32_t count = _latency.sampleCount[outcome];
+		if (count == 0)
+		{
+			printf("latency: %-6s no samples\n", _outcomeNames[outcome]);
+			continue;
+		}
+
+		qsort(samples, count, sizeof(uint64_t), _latencyCompare);
+		printf("latency: %-6s %u samples, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+			   _outcomeNames[outcome], count,
+			   samples[(count - 1) * 50 / 100] / 1000000.0, samples[(count - 1) * 90 / 100] / 1000000.0,
+			   samples[(count - 1) * 99 / 100] / 1000000.0, samples[count - 1] / 1000000.0);
+	}
+	if (_latency.dropped > 0 || _latency.pendingCount > 0)
+	{
+		printf("latency: %u tags dropped, %u never presented\n", _latency.dropped, _latency.pendingCount);
+	}
+}
+
+/// @brief Note what a click did, to be timed once a frame showing it is presented
+/// @param outcome
+/// @param inputTime timerNowNanoseconds of the press, 0 if there wasn't one
+void latencyTag(LatencyOutcome outcome, uint64_t inputTime)
+{
+	if (inputTime == 0 || !_latencyEnter())
+		return;
+
+	if (_latency.pendingCount < LATENCY_MAX_PENDING)
+	{
+		LatencyPending* pending = &_latency.pending[_latency.pendingCount++];
+		pending->outcome = outcome;
+		pending->inputTime = inputTime;
+		pending->frame = 0;
+	}
+	else
+	{
+		_latency.dropped++;
+	}
+	_latencyLeave();
+}
+
+/// @brief A frame has been recorded, everything tagged since the last one shows in it
+/// @return the frame's number, 0 when not collecting
+uint64_t latencyFrameRecorded()
+{
+	if (!_latencyEnter())
+		return 0;
+
+	uint64_t frame = ++_latency.recorded;
+	for (uint32_t i = 0; i < _latency.pendingCount; ++i)
+	{
+		if (_latency.pending[i].frame == 0)
+		{
+			_latency.pending[i].frame = frame;
+		}
+	}
+	_latencyLeave();
+	return frame;
+}
+
+/// @brief The number of the last frame recorded
+/// @return
+uint64_t latencyNewestFrame()
+{
+	return _latency.recorded;
+}
+
+/// @brief A frame has reached the display. Frames can be skipped when a newer one replaces
+/// them, so this closes the tags of every frame up to it
+/// @param frame from latencyFrameRecorded
+/// @param presentTime timerNowNanoseconds, or the simulated equivalent
+void latencyFramePresented(uint64_t frame, uint64_t presentTime)
+{
+	if (frame == 0 || !_latencyEnter())
+		return;
+
+	uint32_t i = 0;
+	while (i < _latency.pendingCount)
+	{
+		LatencyPending* pending = &_latency.pending[i];
+		if (pending->frame == 0 || pending->frame > frame)
+		{
+			++i;
+			continue;
+		}
+
+		uint32_t* count = &_latency.sampleCount[pending->outcome];
+		if (*count < LATENCY_MAX_SAMPLES)
+		{
+			_latency.samples[pending->outcome][(*count)++] =
+				(presentTime > pending->inputTime) ? presentTime - pending->inputTime : 0;
+		}
+		*pending = _latency.pending[--_latency.pendingCount];
+	}
+	_latencyLeave();
+}
+
+/// @brief Shoot at ducks through the real update and draw without a window, once for each
+/// number of frames queued ahead of the display, and report the latency of each
+/// @param levelDef level to play
+/// @param update the game's update
+/// @param draw the game's draw
+/// @param clicks shots per run
+/// @return number of runs that measured nothing
+int32_t latencyRun(const LevelDef* levelDef, AppUpdateFunc update, AppDrawFunc draw, uint32_t clicks)
+{
+	int32_t failures = 0;
+
+	drawSetBackend(DRAW_BACKEND_SOFTWARE);
+	drawInit();
+	if (!swrInit((int32_t)uiSize.x, (int32_t)uiSize.y))
+	{
+		printf("latency: out of memory\n");
+		drawShutdown();
+		drawSetBackend(DRAW_BACKEND_GL);
+		return 1;
+	}
+	texMgrInit();
+	loaderInit(0);
+	objMgrInit(LATENCY_MAX_OBJECTS);
+	levelMgrInit();
+
+	for (uint32_t queued = 0; queued <= LATENCY_MAX_QUEUED; ++queued)
+	{
+		latencyStart();
+		uint32_t fired = _latencySimulate(levelDef, update, draw, clicks, queued);
+		latencyStop();
+
+		printf("latency: %u frame(s) queued at %u Hz, %u of %u clicks fired\n", queued, LATENCY_FPS, fired, clicks);
+		latencyReport();
+		if (_latency.sampleCount[LATENCY_SHOT] == 0)
+		{
+			++failures;
+		}
+	}
+
+	levelMgrShutdown();
+	objMgrShutdown();
+	loaderShutdown();
+	texMgrShutdown();
+	swrShutdown();
+	drawShutdown();
+	drawSetBackend(DRAW_BACKEND_GL);
+
+	return failures;
+}
+
+/// @brief Play one level on the simulated clock, clicking on a duck whenever there is one
+/// @param levelDef
+/// @param update
+/// @param draw
+/// @param clicks
+/// @param queued frames waiting ahead of each one at the display
+/// @return clicks made
+static uint32_t _latencySimulate(const LevelDef* levelDef, AppUpdateFunc update, AppDrawFunc draw,
+								 uint32_t clicks, uint32_t queued)
+{
+	const uint64_t period = 1000000000ull / LATENCY_FPS;
+	LatencyClock clock = { period, queued, period, 0 };
+	randSeed(LATENCY_SEED);
+	Level* level = levelMgrLoad(levelDef);
+
+	// any click starts the game
+	inputMouseInjectButton(INPUT_BUTTON_RIGHT, true, clock.start - _latencyPhase(clock.period));
+	_latencyFrame(&clock, update, draw);
+	inputMouseInjectButton(INPUT_BUTTON_RIGHT, false, clock.start);
+	_latencyFrame(&clock, update, draw);
+
+	uint32_t fired = 0;
+	uint64_t frames = 0;
+	while (fired < clicks && frames < (uint64_t)clicks * LATENCY_FRAMES_PER_CLICK)
+	{
+		Coord2D target, velocity;
+		++frames;
+		if (!levelMgrFindTarget(&target, &velocity))
+		{
+			_latencyFrame(&clock, update, draw);
+			continue;
+		}
+
+		// the press arrived somewhere during the previous frame
+		inputMouseUpdatePosition(target);
+		inputMouseInjectButton(INPUT_BUTTON_LEFT, true, clock.start - _latencyPhase(clock.period));
+		_latencyFrame(&clock, update, draw);
+		inputMouseInjectButton(INPUT_BUTTON_LEFT, false, clock.start);
+		++fired;
+
+		// let the shot reach the display before the next one
+		for (uint32_t i = 0; i <= queued + 1; ++i)
+		{
+			_latencyFrame(&clock, update, draw);
+		}
+	}
+
+	levelMgrUnload(level);
+	return fired;
+}
+
+/// @brief Run one frame and present it on the simulated display. The update and draw take
+/// as long as they really take, the display flips at the first vsync after the frame is done
+/// and shows it once the frames queued ahead of it have had their turn
+/// @param clock moved on to the start of the next frame
+/// @param update
+/// @param draw
+static void _latencyFrame(LatencyClock* clock, AppUpdateFunc update, AppDrawFunc draw)
+{
+	uint64_t elapsed = (clock->previous > 0) ? clock->start - clock->previous : clock->period;
+	uint64_t begin = timerNowNanoseconds();
+	inputFrameBegin(clock->start);
+	update((Milliseconds)(elapsed / 1000000.0));
+	inputFrameEnd();
+	draw();
+	uint64_t done = clock->start + (timerNowNanoseconds() - begin);
+
+	uint64_t vsync = (done / clock->period + 1) * clock->period;
+	latencyFramePresented(latencyNewestFrame(), vsync + clock->queued * clock->period);
+	clock->previous = clock->start;
+	clock->start = vsync;
+}
+
+/// @brief How long before the frame a press arrived
+/// @param period
+/// @return nanoseconds, less than a period
+static uint64_t _latencyPhase(uint64_t period)
+{
+	uint64_t phase = (uint64_t)(period * randGetFloat(0.0f, 1.0f));
+	return (phase < period) ? phase : period - 1;
+}
+
+static int _latencyCompare(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+/// @brief Take the lock if collecting. latencyStop waits for everyone who got in to leave
+/// before deleting it
+/// @return false when not collecting, and the lock isn't held
+static bool _latencyEnter()
+{
+	InterlockedIncrement(&_latency.callers);
+	if (!_latency.active)
+	{
+		InterlockedDecrement(&_latency.callers);
+		return false;
+	}
+	EnterCriticalSection(&_latency.lock);
+	return true;
+}
+
+/// @brief Release the lock taken by _latencyEnter
+static void _latencyLeave()
+{
+	LeaveCriticalSection(&_latency.lock);
+	InterlockedDecrement(&_latency.callers);
+}
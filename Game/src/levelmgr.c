@@ -13,8 +13,17 @@
 #include "player.h"
 #include "globals.h"
 #include "objmgr.h"
-#include "SOIL.h"
+#include "text.h"
+#include "texmgr.h"
 #include "sound.h"
+#include "input.h"
+#include "loader.h"
+#include "latency.h"
+#include "random.h"
+
+// simulated frame length and upper bound when staging scenes
+#define STAGE_STEP 16
+#define STAGE_TIMEOUT 300000
 
 
 typedef struct level_t
@@ -33,6 +42,12 @@ static Level* level = NULL;
 
 static int32_t _soundId[numSounds];
 
+/// @brief A sound file read on a loader worker
+typedef struct sound_job_t {
+    soundIds id;
+    int32_t soundId;
+} SoundJob;
+
 // sound strings
 static const char _soundNames[numSounds][50] = {
     "asset/sfx/wingFlap.wav",
@@ -54,12 +69,20 @@ static const char _soundNames[numSounds][50] = {
 // local function prototypes
 static void _levelMgrActiveDucks(uint8_t roundNum);
 static void _levelMgrPlaySound(soundIds id);
+static void _levelMgrLoadSound(void* job);
+static void _levelMgrSoundLoaded(void* job);
 static void _levelMgrFlyAway();
 static void _levelMgrFlyAwayOver();
 static bool _levelMgrCheckDucks();
 static void _levelMgrEndGame();
 static void _levelMgrPerfect(uint32_t score);
 static void _levelMgrReload();
+static void _levelMgrStep(uint32_t milliseconds);
+static bool _levelMgrStepUntil(roundBoolCB done);
+static bool _levelMgrAcceptsShots();
+static bool _levelMgrFlyingAway();
+static bool _levelMgrDogVisible();
+static bool _levelMgrGameOver();
 
 /// @brief Initialize the level manager
 void levelMgrInit()
@@ -69,18 +92,23 @@ void levelMgrInit()
     playerInitTextures();
     bgInitTexture();
     roundInitTextures();
-    srand((int32_t)time(NULL));
-    roundSetCBs(_levelMgrPlaySound, _levelMgrFlyAway, _levelMgrActiveDucks, _levelMgrEndGame,
-                _levelMgrCheckDucks, _levelMgrFlyAwayOver, _levelMgrPerfect, _levelMgrReload);
-    duckSetCB(_levelMgrPlaySound);
+    textInitTexture();
+    randSeed((uint32_t)time(NULL));
 
-    // load sounds
+    // load sounds, in the background when the loader has workers. Until a sound has
+    // loaded, playing it does nothing
     for (i = 0; i < numSounds; ++i)
         _soundId[i] = SOUND_NOSOUND;
     for (i = 0; i < numSounds; ++i)
-        _soundId[i] = soundLoad(_soundNames[i]);
-    for (i = 0; i < numSounds; ++i)
-        assert(_soundId[i] != SOUND_NOSOUND);
+    {
+        SoundJob* job = malloc(sizeof(SoundJob));
+        assert(job != NULL);
+        if (job == NULL)
+            continue;
+        job->id = (soundIds)i;
+        job->soundId = SOUND_NOSOUND;
+        loaderSubmit(_levelMgrLoadSound, _levelMgrSoundLoaded, job);
+    }
 }
 
 /// @brief Shutdown the level manager
@@ -90,6 +118,12 @@ void levelMgrShutdown()
 
     for (i = 0; i < numSounds; ++i)
         soundUnload(_soundId[i]);
+
+    textReleaseTexture();
+    roundReleaseTextures();
+    bgReleaseTexture();
+    playerReleaseTextures();
+    duckReleaseTexture();
 }
 
 /// @brief Loads the level and all required objects/assets
@@ -102,6 +136,10 @@ Level* levelMgrLoad(const LevelDef* levelDef)
     {
         level->def = levelDef;
 
+        roundSetCBs(_levelMgrPlaySound, _levelMgrFlyAway, _levelMgrActiveDucks, _levelMgrEndGame,
+                    _levelMgrCheckDucks, _levelMgrFlyAwayOver, _levelMgrPerfect, _levelMgrReload);
+        duckSetCB(_levelMgrPlaySound);
+
         // the field provides the boundaries of the scene & encloses the ducks
         level->field = fieldNew(levelDef->fieldBounds, levelDef->fieldColor);
         
@@ -129,26 +167,37 @@ Level* levelMgrLoad(const LevelDef* levelDef)
     return level;
 }
 
-/// @brief Processes a click based on the current location of the mouse
-/// @param pos, level
-void processClick(Coord2D pos)
+/// @brief Processes a click based on where the mouse was when it happened
+/// @param pos, pressTime timerNowNanoseconds of the press, 0 if it wasn't a real one
+/// @return score for the duck hit, 0 for a miss or when no shot could be fired
+int32_t processClick(Coord2D pos, uint64_t pressTime)
 {
-    State roundState = roundGetState(level->round);
     // check if the plater is currently allowed to shoot
-    if (roundState != (State)4 && roundState != (State)5)
-        return;
+    if (!roundAcceptsShots(level->round))
+        return 0;
     // check if the player has a bullet to shoot
     if (!playerShoot(level->player))
-        return;
+        return 0;
     _levelMgrPlaySound(gun);
-    int32_t hitScore = duckCheckForHit(pos, level->ducks);
+    latencyTag(LATENCY_SHOT, pressTime);
+    int32_t hitScore = duckCheckForHit(pos, pressTime, level->ducks);
     if (hitScore != 0)
     {
+        latencyTag(LATENCY_HIT, pressTime);
         playerUpScore(level->player, hitScore);
         // tell roundmgr that a duck was hit
         roundDuckHit(level->round);
     }
-    
+    return hitScore;
+}
+
+/// @brief Find somewhere a click would hit a duck right now, and where the duck is heading
+/// @param pos
+/// @param velocity pixels per second
+/// @return false if shots aren't being taken or no duck is flying
+bool levelMgrFindTarget(Coord2D* pos, Coord2D* velocity)
+{
+    return roundAcceptsShots(level->round) && duckFindTarget(level->ducks, pos, velocity);
 }
 
 /// @brief Getter for the level state
@@ -194,6 +243,51 @@ void levelMgrUnload(Level* level)
     free(level);
 }
 
+/// @brief Drive the loaded level into a known scene using simulated time only
+/// @param scene
+void levelMgrStageScene(Scene scene)
+{
+    Coord2D cursor = { 480.0f, 400.0f };
+    inputMouseUpdatePosition(cursor);
+    objMgrUpdate(0);
+
+    if (scene == sceneMenu)
+        return;
+
+    levelMgrStartGame();
+    switch (scene)
+    {
+        case sceneRoundPopup:
+            _levelMgrStep(1000);
+            break;
+        case sceneFlyAway:
+            _levelMgrStepUntil(_levelMgrFlyingAway);
+            _levelMgrStep(300);
+            break;
+        case sceneDogOneDuck:
+        case sceneDogTwoDucks:
+        case sceneDogLaugh:
+        {
+            uint32_t shots = (scene == sceneDogOneDuck) ? 1 : (scene == sceneDogTwoDucks) ? 2 : 0;
+            _levelMgrStepUntil(_levelMgrAcceptsShots);
+            for (uint32_t i = 0; i < shots && i < level->def->numDucks; ++i)
+            {
+                processClick(((Object*)level->ducks[i])->position, 0);
+            }
+            _levelMgrStepUntil(_levelMgrDogVisible);
+            // let the dog finish popping up
+            _levelMgrStep(400);
+            break;
+        }
+        case sceneGameOver:
+            _levelMgrStepUntil(_levelMgrGameOver);
+            _levelMgrStep(500);
+            break;
+        default:
+            break;
+    }
+}
+
 static void _levelMgrActiveDucks(uint8_t roundNum)
 {
     ducksSetActive(roundNum, level->ducks);
@@ -204,6 +298,31 @@ static void _levelMgrPlaySound(soundIds id)
     soundPlay(_soundId[id]);
 }
 
+/// @brief Read a sound file, on a loader worker
+/// @param job SoundJob
+static void _levelMgrLoadSound(void* job)
+{
+    SoundJob* soundJob = (SoundJob*)job;
+    soundJob->soundId = soundLoad(_soundNames[soundJob->id]);
+}
+
+/// @brief Publish a loaded sound, on the main thread
+/// @param job SoundJob, freed here
+static void _levelMgrSoundLoaded(void* job)
+{
+    SoundJob* soundJob = (SoundJob*)job;
+    _soundId[soundJob->id] = soundJob->soundId;
+    assert(_soundId[soundJob->id] != SOUND_NOSOUND);
+    soundSetPriority(_soundId[soundJob->id], soundPriorities[soundJob->id]);
+    soundSetPolicy(_soundId[soundJob->id], &soundPolicies[soundJob->id]);
+
+    // the menu jingle arrived after the menu was shown
+    if (soundJob->id == menu && level != NULL && level->state == menuScreen)
+        _levelMgrPlaySound(menu);
+
+    free(soundJob);
+}
+
 static void _levelMgrFlyAway()
 {
     // set all the ducks to the fly away state
@@ -242,4 +361,43 @@ static void _levelMgrPerfect(uint32_t score)
 static void _levelMgrReload()
 {
     playerReload(level->player);
-}
\ No newline at end of file
+}
+
+static bool _levelMgrAcceptsShots()
+{
+    return roundAcceptsShots(level->round);
+}
+
+static bool _levelMgrFlyingAway()
+{
+    return roundFlyingAway(level->round);
+}
+
+static bool _levelMgrDogVisible()
+{
+    return roundDogVisible(level->round);
+}
+
+static bool _levelMgrGameOver()
+{
+    return roundGameOver(level->round);
+}
+
+static void _levelMgrStep(uint32_t milliseconds)
+{
+    for (uint32_t t = 0; t < milliseconds; t += STAGE_STEP)
+    {
+        objMgrUpdate(STAGE_STEP);
+    }
+}
+
+static bool _levelMgrStepUntil(roundBoolCB done)
+{
+    for (uint32_t t = 0; t < STAGE_TIMEOUT; t += STAGE_STEP)
+    {
+        if (done())
+            return true;
+        objMgrUpdate(STAGE_STEP);
+    }
+    return false;
+}
@@ -0,0 +1,174 @@
+#include <Windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "loader.h"
+#include "profile.h"
+
+// Runs asset loading work on a small pool of worker threads. The work function runs on a
+// worker; the done function runs on the thread that calls loaderPoll, normally the main thread.
+// Without workers (loaderInit never called, or a single core) jobs run inline in loaderSubmit
+
+#define LOADER_MAX_WORKERS 4
+#define LOADER_MAX_JOBS 64
+
+typedef struct loader_job_t {
+    LoaderFunc work;
+    LoaderFunc done;
+    void* data;
+} LoaderJob;
+
+static struct loader_t {
+    HANDLE workers[LOADER_MAX_WORKERS];
+    uint32_t workerCount;
+    bool stopping;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE queued;
+
+    // jobs waiting for a worker, as a ring
+    LoaderJob waiting[LOADER_MAX_JOBS];
+    uint32_t waitingHead;
+    uint32_t waitingCount;
+
+    // jobs whose work is done, waiting for loaderPoll
+    LoaderJob finished[LOADER_MAX_JOBS];
+    uint32_t finishedCount;
+
+    // submitted jobs whose done function hasn't run yet, only touched by the polling thread
+    uint32_t outstanding;
+} _loader;
+
+static DWORD WINAPI _loaderWorker(LPVOID param);
+
+/// @brief Start the worker pool, leaving a core for the main and render threads
+/// @param maxWorkers 
+void loaderInit(uint32_t maxWorkers)
+{
+    ZeroMemory(&_loader, sizeof(_loader));
+    InitializeCriticalSection(&_loader.lock);
+    InitializeConditionVariable(&_loader.queued);
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    uint32_t workers = (info.dwNumberOfProcessors > 1) ? info.dwNumberOfProcessors - 1 : 0;
+    workers = min(workers, min(maxWorkers, LOADER_MAX_WORKERS));
+
+    for (uint32_t i = 0; i < workers; ++i)
+    {
+        HANDLE worker = CreateThread(NULL, 0, _loaderWorker, NULL, 0, NULL);
+        if (worker == NULL)
+            break;
+        _loader.workers[_loader.workerCount++] = worker;
+    }
+}
+
+/// @brief Let the workers finish what is queued, stop them, and run the remaining done functions
+void loaderShutdown()
+{
+    EnterCriticalSection(&_loader.lock);
+    _loader.stopping = true;
+    WakeAllConditionVariable(&_loader.queued);
+    LeaveCriticalSection(&_loader.lock);
+
+    for (uint32_t i = 0; i < _loader.workerCount; ++i)
+    {
+        WaitForSingleObject(_loader.workers[i], INFINITE);
+        CloseHandle(_loader.workers[i]);
+    }
+    _loader.workerCount = 0;
+
+    loaderPoll();
+    assert(_loader.outstanding == 0);
+
+    DeleteCriticalSection(&_loader.lock);
+}
+
+/// @brief Whether submitted jobs run in the background
+/// @return 
+bool loaderIsAsync()
+{
+    return _loader.workerCount > 0;
+}
+
+/// @brief Queue a job
+/// @param work runs on a worker
+/// @param done runs in loaderPoll, may be NULL
+/// @param job passed to both
+void loaderSubmit(LoaderFunc work, LoaderFunc done, void* job)
+{
+    if (_loader.workerCount == 0)
+    {
+        work(job);
+        if (done != NULL)
+            done(job);
+        return;
+    }
+
+    EnterCriticalSection(&_loader.lock);
+    // out of space to track the job!
+    assert(_loader.outstanding < LOADER_MAX_JOBS);
+    uint32_t slot = (_loader.waitingHead + _loader.waitingCount) % LOADER_MAX_JOBS;
+    _loader.waiting[slot].work = work;
+    _loader.waiting[slot].done = done;
+    _loader.waiting[slot].data = job;
+    ++_loader.waitingCount;
+    ++_loader.outstanding;
+    WakeConditionVariable(&_loader.queued);
+    LeaveCriticalSection(&_loader.lock);
+}
+
+/// @brief Run the done functions of jobs that have finished since the last poll
+void loaderPoll()
+{
+    LoaderJob finished[LOADER_MAX_JOBS];
+    uint32_t count;
+
+    EnterCriticalSection(&_loader.lock);
+    count = _loader.finishedCount;
+    memcpy(finished, _loader.finished, count * sizeof(LoaderJob));
+    _loader.finishedCount = 0;
+    LeaveCriticalSection(&_loader.lock);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (finished[i].done != NULL)
+            finished[i].done(finished[i].data);
+        --_loader.outstanding;
+    }
+}
+
+/// @brief Whether any submitted job hasn't been completed by loaderPoll yet
+/// @return 
+bool loaderBusy()
+{
+    return _loader.outstanding > 0;
+}
+
+static DWORD WINAPI _loaderWorker(LPVOID param)
+{
+    PROFILE_THREAD("loader");
+
+    EnterCriticalSection(&_loader.lock);
+    for (;;)
+    {
+        while (_loader.waitingCount == 0 && !_loader.stopping)
+        {
+            SleepConditionVariableCS(&_loader.queued, &_loader.lock, INFINITE);
+        }
+        if (_loader.waitingCount == 0)
+            break;
+
+        LoaderJob job = _loader.waiting[_loader.waitingHead];
+        _loader.waitingHead = (_loader.waitingHead + 1) % LOADER_MAX_JOBS;
+        --_loader.waitingCount;
+        LeaveCriticalSection(&_loader.lock);
+
+        job.work(job.data);
+
+        EnterCriticalSection(&_loader.lock);
+        _loader.finished[_loader.finishedCount++] = job;
+    }
+    LeaveCriticalSection(&_loader.lock);
+
+    return 0;
+}
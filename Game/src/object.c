@@ -1,5 +1,7 @@
+#include <stdlib.h>
 #include "baseTypes.h"
-#include "object.h"
+#include "Object.h"
+#include "profile.h"
 
 static ObjRegistrationFunc _registerFunc = NULL;
 static ObjRegistrationFunc _deregisterFunc = NULL;
@@ -52,25 +54,29 @@ void objDraw(Object* obj)
 {
     if (obj->vtable != NULL && obj->vtable->draw != NULL) 
     {
+        PROFILE_BEGIN(obj->vtable->name);
         obj->vtable->draw(obj);
+        PROFILE_END();
     }
 }
 
 /// @brief Update this object, using it's vtable
 /// @param obj 
 /// @param milliseconds 
-void objUpdate(Object* obj, uint32_t milliseconds)
+void objUpdate(Object* obj, Milliseconds milliseconds)
 {
     if (obj->vtable != NULL && obj->vtable->update != NULL) 
     {
+        PROFILE_BEGIN(obj->vtable->name);
         obj->vtable->update(obj, milliseconds);
+        PROFILE_END();
         return;
     }
 
     objDefaultUpdate(obj, milliseconds);
 }
 
-void objDefaultUpdate(Object* obj, uint32_t milliseconds)
+void objDefaultUpdate(Object* obj, Milliseconds milliseconds)
 {
     obj->position.x += obj->velocity.x * milliseconds / 1000.0f;
     obj->position.y += obj->velocity.y * milliseconds / 1000.0f;
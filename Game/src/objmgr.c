@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "objmgr.h"
+#include "anim.h"
 #include "baseTypes.h"
+#include "profile.h"
 
 static struct objmgr_t {
     Object** list;
@@ -23,6 +25,9 @@ void objMgrInit(uint32_t maxObjects)
         _objMgr.count = 0;
     }
 
+    // objects own at most one animator each
+    animMgrInit(maxObjects);
+
     // setup registration, so all initialized objects are logged w/ the manager
     objEnableRegistration(objMgrAdd, objMgrRemove);
 }
@@ -36,6 +41,8 @@ void objMgrShutdown()
     // this isn't strictly required, but want to enforce proper cleanup
     assert(_objMgr.count == 0);
 
+    animMgrShutdown();
+
     // objMgr doesn't own the objects, so just clean up self
     free(_objMgr.list);
     _objMgr.list = NULL;
@@ -82,6 +89,7 @@ void objMgrRemove(Object* obj)
 /// @brief Draws all registered objects
 void objMgrDraw() 
 {
+    PROFILE_BEGIN("objMgrDraw");
     for (uint32_t i = 0; i < _objMgr.max; ++i)
     {
         Object* obj = _objMgr.list[i];
@@ -90,12 +98,21 @@ void objMgrDraw()
             objDraw(obj);
         }
     }
+    PROFILE_END();
+}
+
+/// @brief Number of registered objects
+/// @return 
+uint32_t objMgrGetCount()
+{
+    return _objMgr.count;
 }
 
-/// @brief Updates all registered objects
+/// @brief Updates all registered objects, then advances their animations in one pass
 /// @param milliseconds 
-void objMgrUpdate(uint32_t milliseconds)
+void objMgrUpdate(Milliseconds milliseconds)
 {
+    PROFILE_BEGIN("objMgrUpdate");
     for (uint32_t i = 0; i < _objMgr.max; ++i)
     {
         Object* obj = _objMgr.list[i];
@@ -104,5 +121,10 @@ void objMgrUpdate(uint32_t milliseconds)
             objUpdate(obj, milliseconds);
         }
     }
+
+    PROFILE_BEGIN("animMgrUpdate");
+    animMgrUpdate(milliseconds);
+    PROFILE_END();
+    PROFILE_END();
 }
 
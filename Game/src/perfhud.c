@@ -0,0 +1,309 @@
+#include <Windows.h>
+#include <gl/GLU.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "perfhud.h"
+#include "draw.h"
+#include "texmgr.h"
+#include "objmgr.h"
+#include "sound.h"
+#include "timer.h"
+
+// Overlay of frame timing and the counters the subsystems keep, drawn above everything
+// including the cursor. The text uses a 3x5 pixel font built into a texture at startup and
+// is only laid out again a few times a second. The frame time graph changes every frame
+
+#define HUD_FONT_NAME "builtin:perfhud-font"
+#define HUD_TEXTURE_WIDTH 64
+#define HUD_TEXTURE_HEIGHT 32
+#define HUD_CELL_WIDTH 4
+#define HUD_CELL_HEIGHT 6
+#define HUD_GLYPH_WIDTH 3
+#define HUD_GLYPH_HEIGHT 5
+#define HUD_FONT_COLUMNS (HUD_TEXTURE_WIDTH / HUD_CELL_WIDTH)
+#define HUD_NO_GLYPH 0xFF
+
+#define HUD_SCALE 3.0f
+#define HUD_MARGIN 6.0f
+#define HUD_LINES 5
+#define HUD_LINE_CHARS 40
+#define HUD_MAX_GLYPHS (HUD_LINES * HUD_LINE_CHARS)
+#define HUD_GRAPH_FRAMES 120
+#define HUD_GRAPH_BAR_WIDTH 3.0f
+#define HUD_GRAPH_HEIGHT 60.0f
+#define HUD_GRAPH_MS 50.0f			// frame time at the top of the graph
+#define HUD_REFRESH_MS 250.0f
+
+// the cursor sits at 0.99, nothing can be nearer than 1
+static const float HUD_PANEL_DEPTH = 0.995f;
+static const float HUD_DEPTH = 1.0f;
+static const Coord2D HUD_ORIGIN = { 8.0f, 8.0f };
+
+/// @brief A font glyph, one octal digit per row from the top, high bit on the left
+typedef struct hud_glyph_t {
+	char character;
+	uint16_t rows;
+} HudGlyph;
+
+static const HudGlyph HUD_GLYPHS[] = {
+	{ '0', 075557 }, { '1', 026227 }, { '2', 071747 }, { '3', 071717 }, { '4', 055711 },
+	{ '5', 074717 }, { '6', 074757 }, { '7', 071122 }, { '8', 075757 }, { '9', 075717 },
+	{ 'A', 025755 }, { 'B', 065656 }, { 'C', 034443 }, { 'D', 065556 }, { 'E', 074647 },
+	{ 'F', 074644 }, { 'G', 034553 }, { 'H', 055755 }, { 'I', 072227 }, { 'J', 011152 },
+	{ 'K', 055655 }, { 'L', 044447 }, { 'M', 057755 }, { 'N', 065555 }, { 'O', 025552 },
+	{ 'P', 065644 }, { 'Q', 025563 }, { 'R', 065655 }, { 'S', 034216 }, { 'T', 072222 },
+	{ 'U', 055557 }, { 'V', 055552 }, { 'W', 055775 }, { 'X', 055255 }, { 'Y', 055222 },
+	{ 'Z', 071247 }, { '.', 000002 }, { ':', 002020 }, { '/', 011244 }, { '%', 051245 },
+	{ '-', 000700 },
+};
+#define HUD_GLYPH_COUNT (sizeof(HUD_GLYPHS) / sizeof(HUD_GLYPHS[0]))
+// two extra cells after the glyphs, filled solid for the graph and the panel behind it all
+#define HUD_CELL_SOLID HUD_GLYPH_COUNT
+#define HUD_CELL_PANEL (HUD_GLYPH_COUNT + 1)
+
+static struct perfhud_t {
+	bool visible;
+	GLuint font;
+	uint8_t glyphs[128];
+
+	// frame times for the graph, as a ring
+	Milliseconds frames[HUD_GRAPH_FRAMES];
+	uint32_t newest;
+
+	// averaged over the frames since the text was last laid out
+	Milliseconds sinceRefresh;
+	uint32_t framesSinceRefresh;
+	uint64_t updateMicroseconds;
+	uint64_t drawMicroseconds;
+	uint64_t hudMicroseconds;
+
+	SpriteCmd text[HUD_MAX_GLYPHS];
+	uint32_t textCount;
+	float textWidth;
+	SpriteCmd graph[HUD_GRAPH_FRAMES + 1];
+} _perfHud;
+
+static void _perfHudBuildFont(uint8_t* rgba);
+static void _perfHudLayout();
+static void _perfHudLine(uint32_t line, const char* text);
+static void _perfHudCell(SpriteCmd* cmd, uint32_t cell, float left, float top, float right, float bottom, float depth);
+static uint64_t _perfHudHeapBytes();
+
+/// @brief Build the font texture. Hidden until perfHudSetVisible
+void perfHudInit()
+{
+	static uint8_t rgba[HUD_TEXTURE_WIDTH * HUD_TEXTURE_HEIGHT * 4];
+
+	ZeroMemory(&_perfHud, sizeof(_perfHud));
+	memset(_perfHud.glyphs, HUD_NO_GLYPH, sizeof(_perfHud.glyphs));
+	for (uint32_t i = 0; i < HUD_GLYPH_COUNT; ++i)
+	{
+		_perfHud.glyphs[(uint8_t)HUD_GLYPHS[i].character] = (uint8_t)i;
+	}
+
+	_perfHudBuildFont(rgba);
+	_perfHud.font = texMgrCreate(HUD_FONT_NAME, rgba, HUD_TEXTURE_WIDTH, HUD_TEXTURE_HEIGHT, 4);
+}
+
+/// @brief Release the font texture
+void perfHudShutdown()
+{
+	texMgrRelease(_perfHud.font);
+	_perfHud.font = 0;
+}
+
+/// @brief Show or hide the overlay
+/// @param visible
+void perfHudSetVisible(bool visible)
+{
+	if (visible && !_perfHud.visible)
+	{
+		// start from fresh averages rather than whatever built up while hidden
+		_perfHud.sinceRefresh = HUD_REFRESH_MS;
+	}
+	_perfHud.visible = visible;
+}
+
+/// @brief Whether the overlay is showing
+/// @return
+bool perfHudIsVisible()
+{
+	return _perfHud.visible;
+}
+
+/// @brief Account for one update, and lay the text out again when it is due
+/// @param frame time the update covered
+/// @param updateMicroseconds time the update took
+void perfHudRecordUpdate(Milliseconds frame, uint64_t updateMicroseconds)
+{
+	_perfHud.newest = (_perfHud.newest + 1) % HUD_GRAPH_FRAMES;
+	_perfHud.frames[_perfHud.newest] = frame;
+	_perfHud.sinceRefresh += frame;
+	_perfHud.framesSinceRefresh++;
+	_perfHud.updateMicroseconds += updateMicroseconds;
+
+	if (_perfHud.visible && _perfHud.sinceRefresh >= HUD_REFRESH_MS)
+	{
+		uint64_t start = timerNowMicroseconds();
+		_perfHudLayout();
+		_perfHud.hudMicroseconds = timerNowMicroseconds() - start;
+	}
+}
+
+/// @brief Account for one draw
+/// @param drawMicroseconds time spent recording and handing off the frame
+void perfHudRecordDraw(uint64_t drawMicroseconds)
+{
+	_perfHud.drawMicroseconds += drawMicroseconds;
+}
+
+/// @brief Record the overlay for this frame, between drawFrameBegin and drawFrameEnd
+void perfHudDraw()
+{
+	if (!_perfHud.visible)
+		return;
+
+	uint64_t start = timerNowMicroseconds();
+
+	float top = HUD_ORIGIN.y + HUD_LINES * (HUD_GLYPH_HEIGHT + 2) * HUD_SCALE;
+	float bottom = top + HUD_GRAPH_HEIGHT;
+	float width = max(_perfHud.textWidth, HUD_GRAPH_FRAMES * HUD_GRAPH_BAR_WIDTH);
+	_perfHudCell(&_perfHud.graph[0], HUD_CELL_PANEL, HUD_ORIGIN.x - HUD_MARGIN, HUD_ORIGIN.y - HUD_MARGIN,
+				 HUD_ORIGIN.x + width + HUD_MARGIN, bottom + HUD_MARGIN, HUD_PANEL_DEPTH);
+
+	// oldest frame on the left
+	float left = HUD_ORIGIN.x;
+	for (uint32_t i = 1; i <= HUD_GRAPH_FRAMES; ++i)
+	{
+		Milliseconds frame = _perfHud.frames[(_perfHud.newest + i) % HUD_GRAPH_FRAMES];
+		float height = min(frame / HUD_GRAPH_MS, 1.0f) * HUD_GRAPH_HEIGHT;
+		_perfHudCell(&_perfHud.graph[i], HUD_CELL_SOLID, left, bottom - height, left + HUD_GRAPH_BAR_WIDTH - 1.0f,
+					 bottom, HUD_DEPTH);
+		left += HUD_GRAPH_BAR_WIDTH;
+	}
+
+	drawSprites(_perfHud.graph, HUD_GRAPH_FRAMES + 1);
+	drawSprites(_perfHud.text, _perfHud.textCount);
+	_perfHud.hudMicroseconds += timerNowMicroseconds() - start;
+}
+
+/// @brief White glyphs on transparent, then the solid and panel cells
+/// @param rgba HUD_TEXTURE_WIDTH * HUD_TEXTURE_HEIGHT pixels, rows top to bottom
+static void _perfHudBuildFont(uint8_t* rgba)
+{
+	memset(rgba, 0, HUD_TEXTURE_WIDTH * HUD_TEXTURE_HEIGHT * 4);
+	for (uint32_t cell = 0; cell <= HUD_CELL_PANEL; ++cell)
+	{
+		uint32_t cellX = (cell % HUD_FONT_COLUMNS) * HUD_CELL_WIDTH;
+		uint32_t cellY = (cell / HUD_FONT_COLUMNS) * HUD_CELL_HEIGHT;
+		for (uint32_t y = 0; y < HUD_GLYPH_HEIGHT; ++y)
+		{
+			for (uint32_t x = 0; x < HUD_GLYPH_WIDTH; ++x)
+			{
+				uint8_t* pixel = &rgba[((cellY + y) * HUD_TEXTURE_WIDTH + cellX + x) * 4];
+				if (cell == HUD_CELL_PANEL)
+				{
+					pixel[3] = 0xA0;
+				}
+				else if (cell == HUD_CELL_SOLID ||
+						 ((HUD_GLYPHS[cell].rows >> ((HUD_GLYPH_HEIGHT - 1 - y) * 3 + (HUD_GLYPH_WIDTH - 1 - x))) & 1))
+				{
+					pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0xFF;
+				}
+			}
+		}
+	}
+}
+
+/// @brief Average what came in since the last layout and lay the text out
+static void _perfHudLayout()
+{
+	char line[HUD_LINE_CHARS + 1];
+	uint32_t frames = max(_perfHud.framesSinceRefresh, 1);
+	double frameMs = _perfHud.sinceRefresh / frames;
+	DrawStats stats = drawGetStats();
+
+	_perfHud.textCount = 0;
+	_perfHud.textWidth = 0.0f;
+
+	snprintf(line, sizeof(line), "FPS %.1f FRAME %.2fMS", (frameMs > 0.0) ? 1000.0 / frameMs : 0.0, frameMs);
+	_perfHudLine(0, line);
+	snprintf(line, sizeof(line), "UPDATE %.2fMS DRAW %.2fMS", _perfHud.updateMicroseconds / 1000.0 / frames,
+			 _perfHud.drawMicroseconds / 1000.0 / frames);
+	_perfHudLine(1, line);
+	snprintf(line, sizeof(line), "SPRITES %u CALLS %u BINDS %u", stats.sprites, stats.drawCalls, stats.textureBinds);
+	_perfHudLine(2, line);
+	snprintf(line, sizeof(line), "OBJECTS %u VOICES %u", objMgrGetCount(), soundGetActiveVoices());
+	_perfHudLine(3, line);
+	snprintf(line, sizeof(line), "HEAP %lluKB HUD %.3fMS", (unsigned long long)(_perfHudHeapBytes() / 1024),
+			 _perfHud.hudMicroseconds / 1000.0 / frames);
+	_perfHudLine(4, line);
+
+	_perfHud.sinceRefresh = 0.0f;
+	_perfHud.framesSinceRefresh = 0;
+	_perfHud.updateMicroseconds = 0;
+	_perfHud.drawMicroseconds = 0;
+	_perfHud.hudMicroseconds = 0;
+}
+
+/// @brief Append the glyphs for a line of text, skipping spaces and characters the font lacks
+/// @param line
+/// @param text
+static void _perfHudLine(uint32_t line, const char* text)
+{
+	float top = HUD_ORIGIN.y + line * (HUD_GLYPH_HEIGHT + 2) * HUD_SCALE;
+	float left = HUD_ORIGIN.x;
+	for (const char* c = text; *c != '\0' && _perfHud.textCount < HUD_MAX_GLYPHS; ++c)
+	{
+		uint8_t glyph = ((uint8_t)*c < sizeof(_perfHud.glyphs)) ? _perfHud.glyphs[(uint8_t)*c] : HUD_NO_GLYPH;
+		if (glyph != HUD_NO_GLYPH)
+		{
+			_perfHudCell(&_perfHud.text[_perfHud.textCount++], glyph, left, top,
+						 left + HUD_GLYPH_WIDTH * HUD_SCALE, top + HUD_GLYPH_HEIGHT * HUD_SCALE, HUD_DEPTH);
+		}
+		left += HUD_CELL_WIDTH * HUD_SCALE;
+	}
+	_perfHud.textWidth = max(_perfHud.textWidth, left - HUD_ORIGIN.x);
+}
+
+/// @brief A quad showing one cell of the font. The solid and panel cells are a single colour,
+/// so those sample one texel in the middle instead of stretching the cell
+/// @params
+static void _perfHudCell(SpriteCmd* cmd, uint32_t cell, float left, float top, float right, float bottom, float depth)
+{
+	float cellX = (float)((cell % HUD_FONT_COLUMNS) * HUD_CELL_WIDTH);
+	float cellY = (float)((cell / HUD_FONT_COLUMNS) * HUD_CELL_HEIGHT);
+
+	cmd->texture = _perfHud.font;
+	cmd->xPositionLeft = left;
+	cmd->xPositionRight = right;
+	cmd->yPositionTop = top;
+	cmd->yPositionBottom = bottom;
+	if (cell >= HUD_CELL_SOLID)
+	{
+		cmd->u = 0.0f;
+		cmd->v = 0.0f;
+		cmd->xTextureCoord = (cellX + 1.5f) / HUD_TEXTURE_WIDTH;
+		cmd->yTextureCoord = 1.0f - (cellY + 2.5f) / HUD_TEXTURE_HEIGHT;
+	}
+	else
+	{
+		cmd->u = (float)HUD_GLYPH_WIDTH / HUD_TEXTURE_WIDTH;
+		cmd->v = (float)HUD_GLYPH_HEIGHT / HUD_TEXTURE_HEIGHT;
+		cmd->xTextureCoord = cellX / HUD_TEXTURE_WIDTH;
+		cmd->yTextureCoord = 1.0f - cellY / HUD_TEXTURE_HEIGHT;
+	}
+	cmd->depth = depth;
+}
+
+/// @brief Bytes allocated from the process heap, which the CRT allocates from
+/// @return bytes, 0 if unknown
+static uint64_t _perfHudHeapBytes()
+{
+	HEAP_SUMMARY summary;
+	summary.cb = sizeof(summary);
+	if (!HeapSummary(GetProcessHeap(), 0, &summary))
+		return 0;
+	return summary.cbAllocated;
+}
@@ -5,13 +5,13 @@
 
 #include "player.h"
 #include "Object.h"
-#include "SOIL.h"
 #include "baseTypes.h"
 #include "input.h"
 #include "draw.h"
+#include "text.h"
+#include "texmgr.h"
 
 static const char CURSOR[] = "asset/cursor.png";
-static const char NUMBERS[] = "asset/numbers.png";
 
 typedef struct player_t
 {
@@ -23,13 +23,13 @@ typedef struct player_t
     Bounds2D bounds;
 } Player;
 
-static const Coord2D _numSize = {
-	30.0f,
-	35.0f
-};
-static const Coord2D _scorePos = {
-	720.0f,
-	887.0f
+static const TextLayout _scoreLayout = {
+	TEXT_STYLE_SCORE,
+	TEXT_PAD_ZERO,
+	6,					// digits
+	{ 720.0f, 887.0f },	// position
+	{ 30.0f, 35.0f },	// glyphSize
+	0.76f				// depth
 };
 static const Coord2D size = {
 	30.0f,
@@ -45,13 +45,13 @@ static const Coord2D _bullpos = {
 };
 
 static GLuint _cursorTexture = 0;
-static GLuint _numberTexture = 0;
 // the object vtable for the player object
-static void _playerUpdate(Object* obj, uint32_t milliseconds);
+static void _playerUpdate(Object* obj, Milliseconds milliseconds);
 static void _playerDraw(Object* obj);
 static ObjVtable _playerVtable = {
     _playerDraw,
-    _playerUpdate
+    _playerUpdate,
+    "player"
 };
 
 // load the cursor image
@@ -59,17 +59,16 @@ void playerInitTextures()
 {
     if (_cursorTexture == 0)
     {
-        _cursorTexture = SOIL_load_OGL_texture(CURSOR, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-            SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+        _cursorTexture = texMgrAcquire(CURSOR);
         assert(_cursorTexture != 0);
     }
-	if (_numberTexture == 0)
-	{
-		_numberTexture = SOIL_load_OGL_texture(NUMBERS, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-			SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
-		assert(_numberTexture != 0);
-	}
+}
 
+// release the cursor image
+void playerReleaseTextures()
+{
+    texMgrRelease(_cursorTexture);
+    _cursorTexture = 0;
 }
 
 /// @brief Instantiate and initialize the player object
@@ -144,7 +143,7 @@ void playerDeInit(Player* player)
     free(player);
 }
 
-static void _playerUpdate(Object* obj, uint32_t milliseconds)
+static void _playerUpdate(Object* obj, Milliseconds milliseconds)
 {
 	obj->position = inputMousePosition();
 }
@@ -164,34 +163,10 @@ static void _playerDraw(Object* obj)
 	// draw player UI elements
 	if (player->inGame)
 	{
-		float leftx = _scorePos.x, topy = _scorePos.y;
-
-		for (i = 100000; i > 0; i /= 10)
-		{
-			// calculate the bounding box
-			xPositionLeft = leftx;
-			xPositionRight = xPositionLeft + _numSize.x;
-			yPositionTop = topy;
-			yPositionBottom = yPositionTop + _numSize.y;
-
-			// find the proper sprite frame from the sprite sheet
-			float uPerNum = 1.0f / 11.0f;
-			float vPerNum = 1.0f / 2.0f;
+		textDrawNumber(&_scoreLayout, player->score);
 
-			uint32_t digit = (player->score / i) % 10;
-			// calculate the starting uv... remember v of 0 is the bottom of the texture
-			xTextureCoord = uPerNum * ((digit % 5) + 6);
-			yTextureCoord = (digit >= 5) ? vPerNum : 1;
-
-			const float UI_DEPTH = 0.76f;
-
-			drawSprite(_numberTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
-					   uPerNum, vPerNum, xTextureCoord, yTextureCoord, UI_DEPTH);
-			leftx += _numSize.x;
-		}
 		// draw over bullets if needed
-		leftx = _bullpos.x;
-		topy = _bullpos.y;
+		float leftx = _bullpos.x, topy = _bullpos.y;
 		for (i = 0; i < (3 - player->bullets); ++i)
 		{
 			// calculate the bounding box
@@ -210,7 +185,7 @@ static void _playerDraw(Object* obj)
 
 			const float UI_DEPTH = 0.76f;
 
-			drawSprite(_numberTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
+			drawSprite(textGetTexture(), xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 				u, v, xTextureCoord, yTextureCoord, UI_DEPTH);
 			leftx -= _bullSize.x;
 		}
@@ -222,7 +197,7 @@ static void _playerDraw(Object* obj)
 		yPositionTop = (obj->position.y - size.y / 2);
 		yPositionBottom = (obj->position.y + size.y / 2);
 
-		const float CURSOR_DEPTH = 1.0f;
+		const float CURSOR_DEPTH = 0.99f;
 
 		drawSprite(_cursorTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 				   1, 1, 0, 1, CURSOR_DEPTH);
@@ -3,6 +3,22 @@
 
 #include "random.h"
 
+// the generator behind MSVC's rand, kept here so a seed stages the same game whichever
+// C runtime the game is built with
+#define RAND_MULTIPLIER 214013u
+#define RAND_INCREMENT 2531011u
+#define RAND_LIMIT 0x7fff
+
+static uint32_t _randState = 1;
+
+static int32_t _randNext();
+
+/// @brief Restart the sequence
+/// @param seed 
+void randSeed(uint32_t seed)
+{
+    _randState = seed;
+}
 
 /// @brief Return a random floating point value in the specified range
 /// @param min 
@@ -10,8 +26,8 @@
 /// @return 
 float randGetFloat(float min, float max)
 {
-    int r = rand();
-    float rPct = (float)r/(float)RAND_MAX;
+    int r = _randNext();
+    float rPct = (float)r/(float)RAND_LIMIT;
 
     return (rPct * (max - min)) + min;
 }
@@ -22,10 +38,18 @@ float randGetFloat(float min, float max)
 /// @return 
 int32_t randGetInt(int32_t min, int32_t max)
 {
-    int r = rand();
+    int r = _randNext();
 
     r %= (max - min);
     r += min;
 
     return r;
+}
+
+/// @brief Step the generator
+/// @return 0 to RAND_LIMIT
+static int32_t _randNext()
+{
+    _randState = _randState * RAND_MULTIPLIER + RAND_INCREMENT;
+    return (int32_t)((_randState >> 16) & RAND_LIMIT);
 }
\ No newline at end of file
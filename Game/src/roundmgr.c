@@ -1,14 +1,20 @@
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <Windows.h>
 #include <gl/GLU.h>
 #include <assert.h>
 
 #include "Object.h"
-#include "SOIL.h"
 #include "globals.h"
 #include "roundmgr.h"
 #include "draw.h"
+#include "text.h"
+#include "texmgr.h"
+#include "anim.h"
+
+// number of quads the HUD can be made of
+#define HUD_MAX_SPRITES 32
 
 typedef enum roundState_t
 {
@@ -42,24 +48,44 @@ typedef struct roundmgr_t
 	uint8_t requiredDucks;
 	bool duckStatus[10];
 
-	uint32_t updateTimeLeft;
-	uint32_t dogLaughTimer;
-	uint8_t dogLaughFrame;
+	Milliseconds updateTimeLeft;
+	Animator* dog;
 
 	Bounds2D bounds;
+
+	// retained HUD quads, rebuilt only when the values they show change
+	SpriteCmd hud[HUD_MAX_SPRITES];
+	uint32_t hudCount;
+	bool hudDirty;
 } Round;
 
 // the object vtable for the round manager object
-static void _roundUpdate(Object* obj, uint32_t milliseconds);
+static void _roundUpdate(Object* obj, Milliseconds milliseconds);
 static void _roundDraw(Object* obj);
 static ObjVtable _roundVtable = {
 	_roundDraw,
-	_roundUpdate
+	_roundUpdate,
+	"round"
 };
 
 // static constants for draws
-static const Coord2D roundNumPos = { 150, 819 };
 static const Coord2D roundPopupPos = { 380, 242 };
+static const TextLayout _roundNumLayout = {
+	TEXT_STYLE_COUNTER,
+	TEXT_PAD_RIGHT,
+	2,						// digits
+	{ 150.0f, 819.0f },		// position
+	{ 34.0f, 34.0f },		// glyphSize
+	0.76f					// depth
+};
+static const TextLayout _roundPopupNumLayout = {
+	TEXT_STYLE_SCORE,
+	TEXT_PAD_LEFT,
+	2,						// digits
+	{ 436.0f, 314.0f },		// position, roundPopupPos + (56, 72)
+	{ 32.0f, 32.0f },		// glyphSize
+	0.76f					// depth
+};
 static const Coord2D flyAwayPopupPos = { 360, 242 };
 static const Coord2D duckUIpos = { 360, 887 };
 static const Coord2D _cellSize = { 30.0f, 35.0f };
@@ -68,14 +94,25 @@ static const Coord2D _dogSize = { 216.0f, 186.0f };
 static const float _dogLowy = 752.0f;
 static const float _dogTopy = 579.0f;
 static const float _dogSpeed = 600.0f;
-static const uint32_t _dogFrameLength = 77;
 
-static const char NUMBERS[] = "asset/numbers.png";
-static const char DUCK_UI[] = "asset/DuckUI.png";
+// dog sheet cells, row major: 0 laughing, 1 holding one duck, 2 laughing, 3 holding two ducks
+static const AnimFrame _dogLaughFrames[] = {
+	{ 0, ANIM_NO_EVENT, 77 }, { 2, ANIM_NO_EVENT, 77 }
+};
+static const AnimFrame _dogOneDuckFrames[] = {
+	{ 1, ANIM_NO_EVENT, 1000 }
+};
+static const AnimFrame _dogTwoDucksFrames[] = {
+	{ 3, ANIM_NO_EVENT, 1000 }
+};
+static const AnimClip _dogLaughClip = { _dogLaughFrames, 2, 0, ANIM_LOOP };
+static const AnimClip _dogOneDuckClip = { _dogOneDuckFrames, 1, 0, ANIM_ONCE };
+static const AnimClip _dogTwoDucksClip = { _dogTwoDucksFrames, 1, 0, ANIM_ONCE };
+
+static const char DUCK_UI[] = "asset/duckUI.png";
 static const char DOG[] = "asset/dogSprites.png";
 static const char BOXES[] = "asset/NES - Duck Hunt - UI elements.png";
 static const char UI[] = "asset/NES - Duck Hunt - Backgrounds.png";
-static GLuint _numberTexture = 0;
 static GLuint _textBoxesTexture = 0;
 static GLuint _interfaceTexture = 0;
 static GLuint _duckUITexture = 0;
@@ -93,42 +130,48 @@ static roundNoArgCB _reloadCB = NULL;
 
 // private methods
 static uint32_t _roundGetFlyAwayTime(uint8_t roundNum);
+static void _roundSetState(Round* round, State state);
+static void _roundBuildHud(Round* round);
+static void _roundHudAdd(Round* round, GLuint texture, GLfloat xPositionLeft, GLfloat xPositionRight, GLfloat yPositionTop,
+						 GLfloat yPositionBottom, GLfloat u, GLfloat v, GLfloat xTextureCoord, GLfloat yTextureCoord,
+						 float depth);
+static void _roundHudAddNumber(Round* round, const TextLayout* layout, uint32_t value);
 
 // load the cursor image
 void roundInitTextures()
 {
-	if (_numberTexture == 0)
-	{
-		_numberTexture = SOIL_load_OGL_texture(NUMBERS, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-			SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
-		assert(_numberTexture != 0);
-	}
 	if (_textBoxesTexture == 0)
 	{
-		_textBoxesTexture = SOIL_load_OGL_texture(BOXES, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-			SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+		_textBoxesTexture = texMgrAcquire(BOXES);
 		assert(_textBoxesTexture != 0);
 	}
 	if (_interfaceTexture == 0)
 	{
-		_interfaceTexture = SOIL_load_OGL_texture(UI, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-			SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+		_interfaceTexture = texMgrAcquire(UI);
 		assert(_interfaceTexture != 0);
 	}
 	if (_duckUITexture == 0)
 	{
-		_duckUITexture = SOIL_load_OGL_texture(DUCK_UI, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-			SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+		_duckUITexture = texMgrAcquire(DUCK_UI);
 		assert(_duckUITexture != 0);
 	}
 	if (_dogTexture == 0)
 	{
-		_dogTexture = SOIL_load_OGL_texture(DOG, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
-			SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB);
+		_dogTexture = texMgrAcquire(DOG);
 		assert(_dogTexture != 0);
 	}
 }
 
+// release the round interface images
+void roundReleaseTextures()
+{
+	texMgrRelease(_textBoxesTexture);
+	texMgrRelease(_interfaceTexture);
+	texMgrRelease(_duckUITexture);
+	texMgrRelease(_dogTexture);
+	_textBoxesTexture = _interfaceTexture = _duckUITexture = _dogTexture = 0;
+}
+
 /// @brief Sets the callbacks
 /// @param soundcb, flyAwaycb, losecb
 void roundSetCBs(roundSoundCB soundcb, roundNoArgCB flyAwaycb, roundMakeCB makeDuckscb, roundNoArgCB losecb,
@@ -161,7 +204,7 @@ void roundClearCBs()
 /// @params round
 void roundSetActive(Round* round)
 {
-	round->roundState = start;
+	_roundSetState(round, start);
 	round->requiredDucks = 6;
 	_soundCB(gameStart);
 	round->obj.position.x = boundsGetCenter(&(round->bounds)).x;
@@ -173,7 +216,7 @@ void roundSetActive(Round* round)
 void roundSetInctive(Round* round)
 {
 	round->roundNum = 1;
-	round->roundState = inactive;
+	_roundSetState(round, inactive);
 }
 
 /// @brief Instantiate and initialize the roundManager
@@ -190,12 +233,15 @@ Round* roundInit(Bounds2D bounds)
 
 		round->roundNum = 1;
 		round->bounds = bounds;
-		round->roundState = inactive;
+		_roundSetState(round, inactive);
 		round->ducksHit = 0;
 		round->waveNum = 0;
 		round->requiredDucks = 6;
+		round->hudCount = 0;
+		round->hudDirty = true;
 		// the position and velocity of the round object are used for the dog
 		round->obj.position.y = _dogLowy;
+		round->dog = animNew(round, NULL);
 	}
 	return round;
 }
@@ -205,6 +251,7 @@ Round* roundInit(Bounds2D bounds)
 void roundDeInit(Round* round)
 {
 	objDeinit(&round->obj);
+	animDelete(round->dog);
 
 	free(round);
 }
@@ -217,6 +264,34 @@ State roundGetState(Round* round)
 	return round->roundState;
 }
 
+/// @brief whether the player is currently allowed to shoot
+/// @param round
+bool roundAcceptsShots(Round* round)
+{
+	return round->roundState == wave || round->roundState == flyAway;
+}
+
+/// @brief whether the ducks of the current wave are escaping
+/// @param round
+bool roundFlyingAway(Round* round)
+{
+	return round->roundState == flyAway;
+}
+
+/// @brief whether the dog is on screen
+/// @param round
+bool roundDogVisible(Round* round)
+{
+	return round->roundState == waveEndSeq || round->roundState == ending;
+}
+
+/// @brief whether the game over sequence is playing
+/// @param round
+bool roundGameOver(Round* round)
+{
+	return round->roundState == ending;
+}
+
 /// @brief increment the number of hit ducks
 /// @param round
 void roundDuckHit(Round* round)
@@ -226,9 +301,10 @@ void roundDuckHit(Round* round)
 	// mark the current duck as hit
 	round->duckStatus[round->currentDuck] = true;
 	++(round->currentDuck);
+	round->hudDirty = true;
 }
 
-static void _roundUpdate(Object* obj, uint32_t milliseconds)
+static void _roundUpdate(Object* obj, Milliseconds milliseconds)
 {
 	int8_t i;
 	Round* round = (Round*)obj;
@@ -241,13 +317,14 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 				round->roundNum == 20)
 			{
 				++(round->requiredDucks);
+				round->hudDirty = true;
 			}
 			round->currentDuck = 0;
 			round->waveNum = 0;
 			round->barkFlag = false;
 			_reloadCB();
 			round->ducksHit = 0;
-			round->roundState = startSeq;
+			_roundSetState(round, startSeq);
 			if (round->roundNum == 1)
 				round->updateTimeLeft = 7500;
 			else
@@ -258,7 +335,7 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 		case startSeq:
 			if (milliseconds >= round->updateTimeLeft)
 			{
-				round->roundState = waveStart;
+				_roundSetState(round, waveStart);
 			}
 			else
 			{
@@ -278,17 +355,17 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 			round->waveDucksHit = 0;
 			_reloadCB();
 			// update the round state
-			round->roundState = wave;
+			_roundSetState(round, wave);
 			break;
 		case wave:
 			// if the timer is complete before both ducks are shot, show the fly away state
 			if (round->waveDucksHit == 2)
 			{
-				round->roundState = duckWait;
+				_roundSetState(round, duckWait);
 			}
 			else if (milliseconds >= round->updateTimeLeft)
 			{
-				round->roundState = flyAway;
+				_roundSetState(round, flyAway);
 				_flyAwayCB();
 			}
 			else
@@ -303,7 +380,7 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 			{
 				if (round->roundState == flyAway)
 					_flyAwayOverCB();
-				round->roundState = waveEnd;
+				_roundSetState(round, waveEnd);
 			}
 			break;
 		case waveEnd:
@@ -312,20 +389,19 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 			if (round->waveDucksHit == 0)
 			{
 				_soundCB(laugh);
-				round->dogLaughFrame = 0;
-				round->dogLaughTimer = _dogFrameLength;
+				animPlay(round->dog, &_dogLaughClip, 0);
 			}
 			else
 			{
 				_soundCB(dogPopup);
+				animPlay(round->dog, (round->waveDucksHit == 1) ? &_dogOneDuckClip : &_dogTwoDucksClip, 0);
 			}
-			round->roundState = waveEndSeq;
+			_roundSetState(round, waveEndSeq);
 			round->obj.velocity.y = -_dogSpeed;
 			break;
 		case waveEndSeq:
 			// update the dog position
 			objDefaultUpdate(obj, milliseconds);
-			// update the dog animation as needed
 			// check the state of the dog and whether/how it has to move
 			if (round->obj.position.y <= _dogTopy && round->obj.velocity.y == -_dogSpeed)
 			{
@@ -351,40 +427,26 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 				// if this was the last wave, move to the round end. otherwise, move to next wave
 				if (++(round->waveNum) == 5)
 				{
-					round->roundState = roundEnd;
+					_roundSetState(round, roundEnd);
 				}
 				else
 				{
-					round->roundState = waveStart;
+					_roundSetState(round, waveStart);
 					round->currentDuck = round->waveNum * 2;
 				}
 			}
-			// if the dog is laughing, update the frame
-			if (round->waveDucksHit == 0)
-			{
-				if (milliseconds >= round->dogLaughTimer)
-				{
-					round->dogLaughFrame = (round->dogLaughFrame) ? (0) : (1);
-					round->dogLaughTimer = _dogFrameLength;
-
-				}
-				else
-				{
-					round->dogLaughTimer -= milliseconds;
-				}
-			}
 			break;
 		case roundEnd:
 			// check if the user hit enough ducks to continue play
 			if (round->ducksHit < round->requiredDucks)
 			{
-				round->roundState = lose;
+				_roundSetState(round, lose);
 				_soundCB(fail);
 				round->updateTimeLeft = 2000;
 			}
 			else
 			{
-				round->roundState = win;
+				_roundSetState(round, win);
 				_soundCB(roundClear);
 				round->updateTimeLeft = 4500;
 			}
@@ -395,7 +457,7 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 				// check if the user had a perfect round
 				if (round->ducksHit == 10)
 				{
-					round->roundState = perfect;
+					_roundSetState(round, perfect);
 					_soundCB(perfSound);
 					// update the score by the proper perfect bonus
 					if (round->roundNum < 21)
@@ -424,7 +486,7 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 				}
 				else
 				{
-					round->roundState = start;
+					_roundSetState(round, start);
 					++(round->roundNum);
 				}
 			}
@@ -437,7 +499,7 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 			if (milliseconds >= round->updateTimeLeft)
 			{
 				++(round->roundNum);
-				round->roundState = start;
+				_roundSetState(round, start);
 			}
 			else
 			{
@@ -447,12 +509,11 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 		case lose:
 			if (milliseconds >= round->updateTimeLeft)
 			{
-				round->roundState = ending;
+				_roundSetState(round, ending);
 				_soundCB(gameOver);
 				round->updateTimeLeft = 4500;
 				round->obj.velocity.y = -_dogSpeed;
-				round->dogLaughFrame = 0;
-				round->dogLaughTimer = _dogFrameLength;
+				animPlay(round->dog, &_dogLaughClip, 0);
 			}
 			else
 			{
@@ -468,24 +529,14 @@ static void _roundUpdate(Object* obj, uint32_t milliseconds)
 			else
 			{
 				round->updateTimeLeft -= milliseconds;
-				// animate the dog laughing
 
-				// update the dog position
+				// update the dog position, the laugh animates itself
 				objDefaultUpdate(obj, milliseconds);
 				if (round->obj.position.y <= _dogTopy)
 				{
 					round->obj.velocity.y = 0.0f;
 					round->obj.position.y = _dogTopy;
 				}
-				if (milliseconds >= round->dogLaughTimer)
-				{
-					round->dogLaughFrame = (round->dogLaughFrame) ? (0) : (1);
-					round->dogLaughTimer = _dogFrameLength;
-				}
-				else
-				{
-					round->dogLaughTimer -= milliseconds;
-				}
 			}
 			break;
 	}
@@ -499,25 +550,26 @@ static uint32_t _roundGetFlyAwayTime(uint8_t roundNum)
 	return (uint32_t)(((7.5f / (roundNum)) + 4.79f) * 1000);
 }
 
+/// @brief move to a new state, the popups shown by the HUD depend on it
+/// @param round, state
+static void _roundSetState(Round* round, State state)
+{
+	round->roundState = state;
+	round->hudDirty = true;
+}
+
 static void _roundDraw(Object* obj)
 {
 	Round* round = (Round*)obj;
 	if (round->roundState == inactive)
 		return;
 
-	Coord2D center = boundsGetCenter(&(round->bounds));
-	
 	GLfloat xPositionLeft;
 	GLfloat xPositionRight;
 	GLfloat yPositionTop;
 	GLfloat yPositionBottom;
 	GLfloat xTextureCoord;
 	GLfloat yTextureCoord;
-	const float UI_DEPTH = 0.75f;
-	const float NUM_DEPTH = 0.76f;
-
-	const float uPerNum = 1.0f / 11.0f;
-	const float vPerNum = 1.0f / 2.0f;
 
 	// draw the dog at the end of each round based on the number of ducks the user caught
 	// also draw if the user has lost
@@ -537,16 +589,9 @@ static void _roundDraw(Object* obj)
 		float vPerDog = 1.0f / 2.0f;
 		
 		// calculate the starting uv... remember v of 0 is the bottom of the texture
-		if (round->waveDucksHit > 0 && round->roundState != ending)
-		{
-			xTextureCoord = uPerDog;
-			yTextureCoord = 1.0f / round->waveDucksHit;
-		}
-		else
-		{
-			xTextureCoord = 0;
-			yTextureCoord = 1.0f - (round->dogLaughFrame * vPerDog);
-		}
+		uint8_t cell = animGetCell(round->dog);
+		xTextureCoord = (cell % 2) * uPerDog;
+		yTextureCoord = 1.0f - ((cell / 2) * vPerDog);
 
 		const float DOG_DEPTH = -0.1f;
 
@@ -554,7 +599,31 @@ static void _roundDraw(Object* obj)
 				   uPerDog, vPerDog, xTextureCoord, yTextureCoord, DOG_DEPTH);
 	}
 
-	
+	// the HUD only changes on round transitions and hits, so reuse the last layout otherwise
+	if (round->hudDirty)
+	{
+		_roundBuildHud(round);
+	}
+	drawSprites(round->hud, round->hudCount);
+}
+
+/// @brief lay out the interface, round number, popups and duck counters
+/// @param round
+static void _roundBuildHud(Round* round)
+{
+	Coord2D center = boundsGetCenter(&(round->bounds));
+
+	GLfloat xPositionLeft;
+	GLfloat xPositionRight;
+	GLfloat yPositionTop;
+	GLfloat yPositionBottom;
+	GLfloat xTextureCoord;
+	GLfloat yTextureCoord;
+	const float UI_DEPTH = 0.75f;
+
+	round->hudCount = 0;
+	round->hudDirty = false;
+
 	// draw the Ui elements
 	// calculate the bounding box
 	xPositionLeft = (center.x - uiSize.x / 2);
@@ -572,52 +641,12 @@ static void _roundDraw(Object* obj)
 
 	const float BG_DEPTH = 0.0f;
 
-	drawSprite(_interfaceTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
+	_roundHudAdd(round, _interfaceTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 				uPerFrame, startV, xTextureCoord, yTextureCoord, BG_DEPTH);
 
 
 	// draw the round number
-	// calculate the bounding box
-	xPositionLeft = roundNumPos.x;
-	xPositionRight = roundNumPos.x + 34;
-	yPositionTop = roundNumPos.y;
-	yPositionBottom = roundNumPos.y + 34;
-
-	
-
-	uint8_t roundDigit = (round->roundNum >= 10) ? (round->roundNum / 10) : (round->roundNum);
-	// calculate the starting uv... remember v of 0 is the bottom of the texture
-	xTextureCoord = uPerNum * (roundDigit % 5);
-	yTextureCoord = (roundDigit >= 5) ? vPerNum : 1;
-
-	
-
-	drawSprite(_numberTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
-			   uPerNum, vPerNum, xTextureCoord, yTextureCoord, NUM_DEPTH);
-
-
-	// draw the second round number
-	// calculate the bounding box
-	xPositionLeft = roundNumPos.x + 34;
-	xPositionRight = roundNumPos.x + 68;
-	yPositionTop = roundNumPos.y;
-	yPositionBottom = roundNumPos.y + 34;
-
-
-	// calculate the starting uv... remember v of 0 is the bottom of the texture
-	if (round->roundNum >= 10)
-	{
-		xTextureCoord = uPerNum * ((round->roundNum % 10) % 5);
-		yTextureCoord = (round->roundNum % 10 >= 5) ? vPerNum : 1;
-	}
-	else
-	{
-		xTextureCoord = uPerNum * 5;
-		yTextureCoord = vPerNum;
-	}
-
-	drawSprite(_numberTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
-			   uPerNum, vPerNum, xTextureCoord, yTextureCoord, NUM_DEPTH);
+	_roundHudAddNumber(round, &_roundNumLayout, round->roundNum);
 
 	// if a round is just beginning, display the round number popup
 	if (round->roundState == startSeq || round->roundState == start)
@@ -635,51 +664,12 @@ static void _roundDraw(Object* obj)
 		xTextureCoord = 0.0f;
 		yTextureCoord = 1.0f;
 
-		drawSprite(_textBoxesTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
+		_roundHudAdd(round, _textBoxesTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 				   uWidth, v, xTextureCoord, yTextureCoord, UI_DEPTH);
 
 
-		// first round number
-		// calculate the bounding box
-		xPositionLeft = roundPopupPos.x + 56;
-		xPositionRight = xPositionLeft + 32;
-		yPositionTop = roundPopupPos.y + 72;
-		yPositionBottom = yPositionTop + 32;
-
-
-		// calculate the starting uv... remember v of 0 is the bottom of the texture
-		if (round->roundNum >= 10)
-		{
-			xTextureCoord = uPerNum * (((round->roundNum / 10) % 5) + 6);
-			yTextureCoord = (round->roundNum / 10 >= 5) ? vPerNum : 1;
-		}
-		else
-		{
-			xTextureCoord = uPerNum * 5;
-			yTextureCoord = 1;
-		}
-
-			
-		drawSprite(_numberTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
-				   uPerNum, vPerNum, xTextureCoord, yTextureCoord, NUM_DEPTH);
-
-
-		// second round number
-		// calculate the bounding box
-		GLfloat xPositionLeft = roundPopupPos.x + 88;
-		GLfloat xPositionRight = xPositionLeft + 32;
-		GLfloat yPositionTop = roundPopupPos.y + 72;
-		GLfloat yPositionBottom = yPositionTop + 32;
-
-
-		// calculate the starting uv... remember v of 0 is the bottom of the texture
-		xTextureCoord = uPerNum * ((round->roundNum % 5) + 6);
-		yTextureCoord = (round->roundNum % 10 >= 5) ? vPerNum : 1;
-
-
-		drawSprite(_numberTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
-			uPerNum, vPerNum, xTextureCoord, yTextureCoord, NUM_DEPTH);
-
+		// round number
+		_roundHudAddNumber(round, &_roundPopupNumLayout, round->roundNum);
 	}
 	
 	// if the round is in the fly away state, display the flyAway text box
@@ -698,7 +688,7 @@ static void _roundDraw(Object* obj)
 		xTextureCoord = 1 - uWidth;
 		yTextureCoord = 1.0f;
 
-		drawSprite(_textBoxesTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
+		_roundHudAdd(round, _textBoxesTexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 					uWidth, v, xTextureCoord, yTextureCoord, UI_DEPTH);
 	}
 
@@ -724,7 +714,7 @@ static void _roundDraw(Object* obj)
 			yTextureCoord = 1.0f;
 ;
 
-			drawSprite(_duckUITexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
+			_roundHudAdd(round, _duckUITexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 					   uWidth, v, xTextureCoord, yTextureCoord, UI_DEPTH);
 		}
 		leftx += _cellSize.x;
@@ -756,10 +746,49 @@ static void _roundDraw(Object* obj)
 			yTextureCoord = 0.99f;
 		}
 
-		drawSprite(_duckUITexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
+		_roundHudAdd(round, _duckUITexture, xPositionLeft, xPositionRight, yPositionTop, yPositionBottom,
 			uWidth, v, xTextureCoord, yTextureCoord, UI_DEPTH);
 
 		leftx += _cellSize.x;
 	}
 }
 
+/// @brief append a quad to the retained HUD
+/// @params
+static void _roundHudAdd(Round* round, GLuint texture, GLfloat xPositionLeft, GLfloat xPositionRight, GLfloat yPositionTop,
+						 GLfloat yPositionBottom, GLfloat u, GLfloat v, GLfloat xTextureCoord, GLfloat yTextureCoord,
+						 float depth)
+{
+	assert(round->hudCount < HUD_MAX_SPRITES);
+	if (round->hudCount == HUD_MAX_SPRITES)
+		return;
+
+	SpriteCmd* cmd = &round->hud[round->hudCount++];
+	cmd->texture = texture;
+	cmd->xPositionLeft = xPositionLeft;
+	cmd->xPositionRight = xPositionRight;
+	cmd->yPositionTop = yPositionTop;
+	cmd->yPositionBottom = yPositionBottom;
+	cmd->u = u;
+	cmd->v = v;
+	cmd->xTextureCoord = xTextureCoord;
+	cmd->yTextureCoord = yTextureCoord;
+	cmd->depth = depth;
+}
+
+/// @brief append a number's quads to the retained HUD
+/// @param round
+/// @param layout
+/// @param value
+static void _roundHudAddNumber(Round* round, const TextLayout* layout, uint32_t value)
+{
+	uint32_t count;
+	const SpriteCmd* quads = textLayoutNumber(layout, value, &count);
+
+	assert(round->hudCount + count <= HUD_MAX_SPRITES);
+	if (round->hudCount + count > HUD_MAX_SPRITES)
+		return;
+
+	memcpy(&round->hud[round->hudCount], quads, count * sizeof(SpriteCmd));
+	round->hudCount += count;
+}
@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "swrender.h"
+#include "SOIL.h"
+
+// CPU reference for drawSubmitCmd: nearest sampling, clamped UVs, GL_LESS depth test
+// against the same -1..1 ortho depth range and SRC_ALPHA/ONE_MINUS_SRC_ALPHA blending
+
+#define SWR_MAX_TEXTURES 64
+
+static struct swrender_t {
+	SwImage frame;
+	float* depth;
+	SwImage textures[SWR_MAX_TEXTURES];
+	uint32_t textureCount;
+} _swr = { { 0, 0, 0, NULL }, NULL, { { 0, 0, 0, NULL } }, 0 };
+
+static void _swrDrawCmd(const SpriteCmd* cmd);
+
+/// @brief Allocate the color and depth buffers
+/// @param width
+/// @param height
+/// @return false if out of memory
+bool swrInit(int32_t width, int32_t height)
+{
+	_swr.frame.width = width;
+	_swr.frame.height = height;
+	_swr.frame.channels = 3;
+	_swr.frame.pixels = malloc((size_t)width * height * 3);
+	_swr.depth = malloc((size_t)width * height * sizeof(float));
+	_swr.textureCount = 0;
+
+	return _swr.frame.pixels != NULL && _swr.depth != NULL;
+}
+
+/// @brief Free buffers and all loaded textures
+void swrShutdown()
+{
+	for (uint32_t i = 0; i < _swr.textureCount; ++i)
+	{
+		free(_swr.textures[i].pixels);
+	}
+	free(_swr.frame.pixels);
+	free(_swr.depth);
+	memset(&_swr, 0, sizeof(_swr));
+}
+
+/// @brief Decode an image the same way the GL path does and keep it in memory
+/// @param filename
+/// @return texture id, 0 on failure
+uint32_t swrLoadTexture(const char* filename)
+{
+	int32_t width, height, channels;
+	uint8_t* pixels = SOIL_load_image(filename, &width, &height, &channels, SOIL_LOAD_AUTO);
+	if (pixels == NULL)
+		return 0;
+
+	uint32_t id = swrCreateTexture(pixels, width, height, channels);
+	SOIL_free_image_data(pixels);
+	return id;
+}
+
+/// @brief Keep an RGBA copy of already decoded pixels
+/// @param pixels rows top to bottom
+/// @param width
+/// @param height
+/// @param channels 1 to 4, as returned by SOIL_load_image
+/// @return texture id, 0 on failure
+uint32_t swrCreateTexture(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels)
+{
+	if (_swr.textureCount == SWR_MAX_TEXTURES || channels < 1 || channels > 4)
+		return 0;
+
+	SwImage* tex = &_swr.textures[_swr.textureCount];
+	size_t count = (size_t)width * height;
+	tex->pixels = malloc(count * 4);
+	if (tex->pixels == NULL)
+		return 0;
+	tex->width = width;
+	tex->height = height;
+	tex->channels = 4;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint8_t* src = &pixels[i * channels];
+		uint8_t* dst = &tex->pixels[i * 4];
+		// grey and grey-alpha images spread to all three colors
+		dst[0] = src[0];
+		dst[1] = (channels >= 3) ? src[1] : src[0];
+		dst[2] = (channels >= 3) ? src[2] : src[0];
+		dst[3] = (channels == 4) ? src[3] : (channels == 2) ? src[1] : 0xFF;
+
+		// match SOIL_FLAG_NTSC_SAFE_RGB
+		for (int32_t c = 0; c < 3; ++c)
+		{
+			dst[c] = (uint8_t)(16 + ((dst[c] * 219 + 127) / 255));
+		}
+	}
+
+	return ++_swr.textureCount;
+}
+
+/// @brief Free a texture's pixels. Its id is not reused
+/// @param id
+void swrUnloadTexture(uint32_t id)
+{
+	if (id == 0 || id > _swr.textureCount)
+		return;
+
+	free(_swr.textures[id - 1].pixels);
+	memset(&_swr.textures[id - 1], 0, sizeof(SwImage));
+}
+
+/// @brief Look up a loaded texture
+/// @param id
+/// @return texture, NULL if there is none with that id
+const SwImage* swrGetTexture(uint32_t id)
+{
+	if (id == 0 || id > _swr.textureCount || _swr.textures[id - 1].pixels == NULL)
+		return NULL;
+
+	return &_swr.textures[id - 1];
+}
+
+/// @brief Clear color and depth
+/// @params red, green, blue
+void swrClear(uint8_t red, uint8_t green, uint8_t blue)
+{
+	size_t count = (size_t)_swr.frame.width * _swr.frame.height;
+	for (size_t i = 0; i < count; ++i)
+	{
+		_swr.frame.pixels[i * 3 + 0] = red;
+		_swr.frame.pixels[i * 3 + 1] = green;
+		_swr.frame.pixels[i * 3 + 2] = blue;
+		_swr.depth[i] = 1.0f;
+	}
+}
+
+/// @brief Rasterize a recorded frame in order
+/// @param cmds
+/// @param count
+void swrDraw(const SpriteCmd* cmds, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_swrDrawCmd(&cmds[i]);
+	}
+}
+
+/// @brief The last rendered frame
+/// @return frame
+const SwImage* swrGetFrame()
+{
+	return &_swr.frame;
+}
+
+static void _swrDrawCmd(const SpriteCmd* cmd)
+{
+	const SwImage* tex = swrGetTexture(cmd->texture);
+	if (tex == NULL)
+		return;
+
+	float left = fminf(cmd->xPositionLeft, cmd->xPositionRight);
+	float right = fmaxf(cmd->xPositionLeft, cmd->xPositionRight);
+	float top = fminf(cmd->yPositionTop, cmd->yPositionBottom);
+	float bottom = fmaxf(cmd->yPositionTop, cmd->yPositionBottom);
+	if (right <= left || bottom <= top)
+		return;
+
+	// pixels whose centers fall inside the quad
+	int32_t x0 = (int32_t)ceilf(left - 0.5f);
+	int32_t x1 = (int32_t)ceilf(right - 0.5f);
+	int32_t y0 = (int32_t)ceilf(top - 0.5f);
+	int32_t y1 = (int32_t)ceilf(bottom - 0.5f);
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > _swr.frame.width) x1 = _swr.frame.width;
+	if (y1 > _swr.frame.height) y1 = _swr.frame.height;
+
+	// the ortho projection maps depth to -depth in NDC, so window depth is (1 - depth) / 2
+	float depth = (1.0f - cmd->depth) * 0.5f;
+	float width = cmd->xPositionRight - cmd->xPositionLeft;
+	float height = cmd->yPositionBottom - cmd->yPositionTop;
+
+	for (int32_t y = y0; y < y1; ++y)
+	{
+		// remember v of 0 is the bottom of the texture, and the texture was loaded flipped
+		float t = cmd->yTextureCoord - cmd->v * (((float)y + 0.5f - cmd->yPositionTop) / height);
+		int32_t row = (int32_t)floorf((1.0f - t) * tex->height);
+		if (row < 0) row = 0;
+		if (row >= tex->height) row = tex->height - 1;
+
+		for (int32_t x = x0; x < x1; ++x)
+		{
+			size_t index = (size_t)y * _swr.frame.width + x;
+			if (!(depth < _swr.depth[index]))
+				continue;
+			_swr.depth[index] = depth;
+
+			float s = cmd->xTextureCoord + cmd->u * (((float)x + 0.5f - cmd->xPositionLeft) / width);
+			int32_t col = (int32_t)floorf(s * tex->width);
+			if (col < 0) col = 0;
+			if (col >= tex->width) col = tex->width - 1;
+
+			const uint8_t* texel = &tex->pixels[((size_t)row * tex->width + col) * 4];
+			uint8_t* dst = &_swr.frame.pixels[index * 3];
+			uint32_t alpha = texel[3];
+			for (int32_t c = 0; c < 3; ++c)
+			{
+				dst[c] = (uint8_t)((texel[c] * alpha + dst[c] * (255 - alpha) + 127) / 255);
+			}
+		}
+	}
+}
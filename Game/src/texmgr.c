@@ -0,0 +1,378 @@
+#include <Windows.h>
+#include <gl/GLU.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#include "texmgr.h"
+#include "draw.h"
+#include "loader.h"
+#include "profile.h"
+#include "SOIL.h"
+
+// Handles are slot numbers starting at 1. Sprites are recorded with the handle and resolved
+// to the backend texture by drawSprite, so a texture still loading simply isn't drawn yet
+
+#define TEXMGR_MAX_TEXTURES 32
+
+typedef struct texture_entry_t {
+    char path[MAX_PATH];        // canonical, so different spellings of a file share an entry
+    volatile GLuint texture;    // backend texture, 0 while loading
+    uint32_t refs;
+    uint32_t bytes;
+    bool used;
+} TextureEntry;
+
+/// @brief A file to decode on a loader worker
+typedef struct texture_job_t {
+    uint32_t slot;
+    char filename[MAX_PATH];
+} TextureJob;
+
+/// @brief Decoded pixels waiting for the thread that owns GL
+typedef struct texture_upload_t {
+    uint32_t slot;
+    uint8_t* pixels;
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+} TextureUpload;
+
+static struct texmgr_t {
+    TextureEntry list[TEXMGR_MAX_TEXTURES];
+    uint32_t count;
+    volatile LONG decodes;
+    volatile LONG loading;
+
+    CRITICAL_SECTION lock;
+    TextureUpload uploads[TEXMGR_MAX_TEXTURES];
+    uint32_t uploadCount;
+} _texMgr;
+
+static bool _texMgrCanonical(const char* filename, char* path);
+static TextureEntry* _texMgrClaim(const char* path, bool* created);
+static void _texMgrDecode(void* job);
+static void _texMgrFree(TextureEntry* entry);
+
+/// @brief Initialize the texture manager
+void texMgrInit()
+{
+    ZeroMemory(&_texMgr, sizeof(_texMgr));
+    InitializeCriticalSection(&_texMgr.lock);
+}
+
+/// @brief Shutdown the texture manager, unloading anything still referenced.
+/// The loader must have been shut down first
+void texMgrShutdown()
+{
+    texMgrUpload();
+
+    for (uint32_t i = 0; i < TEXMGR_MAX_TEXTURES; ++i)
+    {
+        TextureEntry* entry = &_texMgr.list[i];
+        if (entry->used && entry->refs > 0)
+        {
+            // every acquire should have been matched by a release
+            printf("texmgr: %s still has %u reference(s)\n", entry->path, entry->refs);
+            _texMgrFree(entry);
+        }
+    }
+
+    DeleteCriticalSection(&_texMgr.lock);
+    ZeroMemory(&_texMgr, sizeof(_texMgr));
+}
+
+/// @brief Get a reference to the texture for a file, only loading it if nothing else holds it.
+/// With a running loader the file is decoded in the background and uploaded by texMgrUpload
+/// @param filename 
+/// @return texture handle, 0 on failure
+GLuint texMgrAcquire(const char* filename)
+{
+    char path[MAX_PATH];
+    if (!_texMgrCanonical(filename, path))
+        return 0;
+
+    bool created;
+    TextureEntry* freeEntry = _texMgrClaim(path, &created);
+    if (freeEntry == NULL)
+        return 0;
+
+    uint32_t slot = (uint32_t)(freeEntry - _texMgr.list);
+    if (!created)
+        return slot + 1;
+
+    if (loaderIsAsync())
+    {
+        TextureJob* job = malloc(sizeof(TextureJob));
+        if (job != NULL)
+        {
+            job->slot = slot;
+            strcpy_s(job->filename, MAX_PATH, filename);
+            InterlockedIncrement(&_texMgr.loading);
+            loaderSubmit(_texMgrDecode, NULL, job);
+            return slot + 1;
+        }
+    }
+
+    uint32_t bytes;
+    GLuint texture = drawLoadTexture(filename, &bytes);
+    InterlockedIncrement(&_texMgr.decodes);
+    if (texture == 0)
+    {
+        _texMgrFree(freeEntry);
+        return 0;
+    }
+    freeEntry->texture = texture;
+    freeEntry->bytes = bytes;
+    return slot + 1;
+}
+
+/// @brief Get a reference to a texture built from pixels in memory, shared by name like a file.
+/// The pixels are copied and handed to texMgrUpload, so this can be called from any thread
+/// that texMgrAcquire can
+/// @param name unique among created textures, must not look like a file path
+/// @param pixels rows top to bottom
+/// @param width 
+/// @param height 
+/// @param channels 
+/// @return texture handle, 0 on failure
+GLuint texMgrCreate(const char* name, const uint8_t* pixels, int32_t width, int32_t height, int32_t channels)
+{
+    bool created;
+    TextureEntry* entry = _texMgrClaim(name, &created);
+    if (entry == NULL)
+        return 0;
+
+    uint32_t slot = (uint32_t)(entry - _texMgr.list);
+    if (!created)
+        return slot + 1;
+
+    size_t bytes = (size_t)width * height * channels;
+    TextureUpload upload = { slot, malloc(bytes), width, height, channels };
+    if (upload.pixels == NULL)
+    {
+        _texMgrFree(entry);
+        return 0;
+    }
+    memcpy(upload.pixels, pixels, bytes);
+
+    InterlockedIncrement(&_texMgr.loading);
+    EnterCriticalSection(&_texMgr.lock);
+    _texMgr.uploads[_texMgr.uploadCount++] = upload;
+    LeaveCriticalSection(&_texMgr.lock);
+    return slot + 1;
+}
+
+/// @brief Drop a reference, unloading the texture when it was the last one.
+/// Must be called on the thread that owns the GL context
+/// @param handle 
+void texMgrRelease(GLuint handle)
+{
+    if (handle == 0 || handle > TEXMGR_MAX_TEXTURES)
+        return;
+
+    TextureEntry* entry = &_texMgr.list[handle - 1];
+    // could not find texture to release!
+    assert(entry->used && entry->refs > 0);
+    if (!entry->used || entry->refs == 0)
+        return;
+
+    EnterCriticalSection(&_texMgr.lock);
+    bool unload = (--entry->refs == 0 && entry->texture != 0);
+    LeaveCriticalSection(&_texMgr.lock);
+    if (unload)
+    {
+        _texMgrFree(entry);
+    }
+    // still loading, texMgrUpload frees it once the pixels arrive
+}
+
+/// @brief The backend texture for a handle
+/// @param handle 
+/// @return texture, 0 if it hasn't finished loading
+GLuint texMgrGetTexture(GLuint handle)
+{
+    if (handle == 0 || handle > TEXMGR_MAX_TEXTURES)
+        return 0;
+
+    return _texMgr.list[handle - 1].texture;
+}
+
+/// @brief Create textures for everything the loader has decoded so far.
+/// Must be called on the thread that owns the GL context
+/// @return number of textures uploaded
+uint32_t texMgrUpload()
+{
+    TextureUpload uploads[TEXMGR_MAX_TEXTURES];
+    uint32_t count;
+
+    EnterCriticalSection(&_texMgr.lock);
+    count = _texMgr.uploadCount;
+    memcpy(uploads, _texMgr.uploads, count * sizeof(TextureUpload));
+    _texMgr.uploadCount = 0;
+    LeaveCriticalSection(&_texMgr.lock);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        TextureUpload* upload = &uploads[i];
+        TextureEntry* entry = &_texMgr.list[upload->slot];
+        GLuint texture = 0;
+        if (upload->pixels != NULL)
+        {
+            PROFILE_BEGIN("textureUpload");
+            texture = drawCreateTexture(upload->pixels, upload->width, upload->height, upload->channels);
+            PROFILE_END();
+            SOIL_free_image_data(upload->pixels);
+        }
+
+        // the game thread acquires and releases entries while this runs on the render thread
+        EnterCriticalSection(&_texMgr.lock);
+        bool released = (entry->refs == 0);
+        if (released)
+        {
+            ZeroMemory(entry, sizeof(TextureEntry));
+            --_texMgr.count;
+        }
+        else if (texture != 0)
+        {
+            entry->bytes = (uint32_t)(upload->width * upload->height * upload->channels);
+            entry->texture = texture;
+        }
+        LeaveCriticalSection(&_texMgr.lock);
+
+        if (released)
+        {
+            // released before it finished loading
+            if (texture != 0)
+                drawUnloadTexture(texture);
+        }
+        else if (texture == 0)
+        {
+            printf("texmgr: failed to load %s\n", entry->path);
+        }
+        InterlockedDecrement(&_texMgr.loading);
+    }
+
+    return count;
+}
+
+/// @brief Number of textures decoding or waiting to be uploaded
+/// @return 
+uint32_t texMgrLoading()
+{
+    return (uint32_t)_texMgr.loading;
+}
+
+/// @brief Print the loaded textures and their memory use
+void texMgrReport()
+{
+    uint32_t refs = 0;
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < TEXMGR_MAX_TEXTURES; ++i)
+    {
+        TextureEntry* entry = &_texMgr.list[i];
+        if (entry->used)
+        {
+            printf("texmgr: %7u KB %2u ref(s) %s\n", entry->bytes / 1024, entry->refs, entry->path);
+            refs += entry->refs;
+            bytes += entry->bytes;
+        }
+    }
+    printf("texmgr: %u textures, %u references, %d decodes, %u KB total\n",
+           _texMgr.count, refs, (int32_t)_texMgr.decodes, bytes / 1024);
+}
+
+/// @brief Add a reference to the entry for a path, or claim a free entry for it
+/// @param path 
+/// @param created set when the entry is new and still needs its texture
+/// @return entry, NULL when out of space
+static TextureEntry* _texMgrClaim(const char* path, bool* created)
+{
+    *created = false;
+    TextureEntry* freeEntry = NULL;
+    EnterCriticalSection(&_texMgr.lock);
+    for (uint32_t i = 0; i < TEXMGR_MAX_TEXTURES; ++i)
+    {
+        TextureEntry* entry = &_texMgr.list[i];
+        if (!entry->used)
+        {
+            if (freeEntry == NULL)
+                freeEntry = entry;
+        }
+        else if (entry->refs > 0 && strcmp(entry->path, path) == 0)
+        {
+            ++entry->refs;
+            LeaveCriticalSection(&_texMgr.lock);
+            return entry;
+        }
+    }
+
+    // out of space to add a texture!
+    assert(freeEntry != NULL);
+    if (freeEntry == NULL)
+    {
+        LeaveCriticalSection(&_texMgr.lock);
+        return NULL;
+    }
+
+    strcpy_s(freeEntry->path, MAX_PATH, path);
+    freeEntry->texture = 0;
+    freeEntry->bytes = 0;
+    freeEntry->refs = 1;
+    freeEntry->used = true;
+    ++_texMgr.count;
+    *created = true;
+    LeaveCriticalSection(&_texMgr.lock);
+    return freeEntry;
+}
+
+/// @brief Decode a file on a loader worker and queue it for upload
+/// @param job TextureJob, freed here
+static void _texMgrDecode(void* job)
+{
+    TextureJob* textureJob = (TextureJob*)job;
+    TextureUpload upload;
+    upload.slot = textureJob->slot;
+    PROFILE_BEGIN("textureDecode");
+    upload.pixels = SOIL_load_image(textureJob->filename, &upload.width, &upload.height, &upload.channels, SOIL_LOAD_AUTO);
+    PROFILE_END();
+    InterlockedIncrement(&_texMgr.decodes);
+    free(textureJob);
+
+    EnterCriticalSection(&_texMgr.lock);
+    _texMgr.uploads[_texMgr.uploadCount++] = upload;
+    LeaveCriticalSection(&_texMgr.lock);
+}
+
+/// @brief Unload an entry's texture and give the slot back
+/// @param entry 
+static void _texMgrFree(TextureEntry* entry)
+{
+    EnterCriticalSection(&_texMgr.lock);
+    GLuint texture = entry->texture;
+    ZeroMemory(entry, sizeof(TextureEntry));
+    --_texMgr.count;
+    LeaveCriticalSection(&_texMgr.lock);
+
+    if (texture != 0)
+        drawUnloadTexture(texture);
+}
+
+/// @brief Absolute, lower case path with forward slashes
+/// @param filename 
+/// @param path MAX_PATH characters
+/// @return false if the path couldn't be resolved
+static bool _texMgrCanonical(const char* filename, char* path)
+{
+    DWORD length = GetFullPathNameA(filename, MAX_PATH, path, NULL);
+    if (length == 0 || length >= MAX_PATH)
+        return false;
+
+    for (DWORD i = 0; i < length; ++i)
+    {
+        path[i] = (path[i] == '\\') ? '/' : (char)tolower((unsigned char)path[i]);
+    }
+    return true;
+}
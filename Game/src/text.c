@@ -0,0 +1,210 @@
+#include <Windows.h>
+#include <gl/GLU.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "text.h"
+#include "draw.h"
+#include "texmgr.h"
+
+static const char NUMBERS[] = "asset/numbers.png";
+
+// the sheet is 11 glyphs across and 2 down: digits 0-4 on top, 5-9 below, with the
+// counter style in the first five columns and the score style in the last five
+#define TEXT_SHEET_COLUMNS 11
+#define TEXT_SHEET_ROWS 2
+#define TEXT_BLANK 10
+#define TEXT_GLYPH_COUNT 11
+// number of distinct layouts kept laid out at once
+#define TEXT_CACHE_SIZE 16
+
+/// @brief Top left uv of a glyph, v of 1 is the top of the texture
+typedef struct text_glyph_t {
+	float u;
+	float v;
+} TextGlyph;
+
+/// @brief Quads for the last value drawn with a layout
+typedef struct text_cache_entry_t {
+	TextLayout layout;
+	uint32_t value;
+	uint32_t count;
+	uint32_t lastUsed;
+	bool valid;
+	SpriteCmd quads[TEXT_MAX_DIGITS];
+} TextCacheEntry;
+
+static struct text_t {
+	GLuint texture;
+	TextGlyph glyphs[TEXT_STYLE_COUNT][TEXT_GLYPH_COUNT];
+	TextCacheEntry cache[TEXT_CACHE_SIZE];
+	uint32_t useCounter;
+} _text;
+
+static bool _textSameLayout(const TextLayout* a, const TextLayout* b);
+
+/// @brief load the number sheet and build the glyph table
+void textInitTexture()
+{
+	if (_text.texture != 0)
+		return;
+
+	_text.texture = texMgrAcquire(NUMBERS);
+	assert(_text.texture != 0);
+
+	const float uPerNum = 1.0f / TEXT_SHEET_COLUMNS;
+	const float vPerNum = 1.0f / TEXT_SHEET_ROWS;
+	for (uint32_t digit = 0; digit < 10; ++digit)
+	{
+		float v = (digit >= 5) ? vPerNum : 1.0f;
+		_text.glyphs[TEXT_STYLE_COUNTER][digit].u = uPerNum * (digit % 5);
+		_text.glyphs[TEXT_STYLE_COUNTER][digit].v = v;
+		_text.glyphs[TEXT_STYLE_SCORE][digit].u = uPerNum * ((digit % 5) + 6);
+		_text.glyphs[TEXT_STYLE_SCORE][digit].v = v;
+	}
+	// the middle column holds an empty cell for each style
+	_text.glyphs[TEXT_STYLE_COUNTER][TEXT_BLANK].u = uPerNum * 5;
+	_text.glyphs[TEXT_STYLE_COUNTER][TEXT_BLANK].v = vPerNum;
+	_text.glyphs[TEXT_STYLE_SCORE][TEXT_BLANK].u = uPerNum * 5;
+	_text.glyphs[TEXT_STYLE_SCORE][TEXT_BLANK].v = 1.0f;
+
+	for (uint32_t i = 0; i < TEXT_CACHE_SIZE; ++i)
+	{
+		_text.cache[i].valid = false;
+	}
+}
+
+/// @brief release the number sheet
+void textReleaseTexture()
+{
+	texMgrRelease(_text.texture);
+	_text.texture = 0;
+}
+
+/// @brief The number sheet, for callers that draw other cells of it
+/// @return texture
+GLuint textGetTexture()
+{
+	return _text.texture;
+}
+
+/// @brief lay out a number without going through the cache
+/// @param layout
+/// @param value
+/// @param quads room for TEXT_MAX_DIGITS sprites
+/// @return number of quads written
+uint32_t textBuildNumber(const TextLayout* layout, uint32_t value, SpriteCmd* quads)
+{
+	uint32_t digits[TEXT_MAX_DIGITS];
+	uint32_t used = 0;
+	do
+	{
+		digits[used++] = value % 10;
+		value /= 10;
+	} while (value > 0 && used < TEXT_MAX_DIGITS);
+
+	uint32_t width = (layout->digits > 0) ? min(layout->digits, TEXT_MAX_DIGITS) : used;
+	for (uint32_t i = used; i < width; ++i)
+	{
+		digits[i] = 0;
+	}
+	used = min(used, width);
+
+	const float uPerNum = 1.0f / TEXT_SHEET_COLUMNS;
+	const float vPerNum = 1.0f / TEXT_SHEET_ROWS;
+	float leftx = layout->position.x;
+	for (uint32_t slot = 0; slot < width; ++slot)
+	{
+		// digits are stored lowest first
+		uint32_t glyph;
+		switch (layout->pad)
+		{
+			case TEXT_PAD_LEFT:
+				glyph = (slot < width - used) ? TEXT_BLANK : digits[width - 1 - slot];
+				break;
+			case TEXT_PAD_RIGHT:
+				glyph = (slot < used) ? digits[used - 1 - slot] : TEXT_BLANK;
+				break;
+			default:
+				glyph = digits[width - 1 - slot];
+				break;
+		}
+
+		SpriteCmd* cmd = &quads[slot];
+		cmd->texture = _text.texture;
+		cmd->xPositionLeft = leftx;
+		cmd->xPositionRight = leftx + layout->glyphSize.x;
+		cmd->yPositionTop = layout->position.y;
+		cmd->yPositionBottom = layout->position.y + layout->glyphSize.y;
+		cmd->u = uPerNum;
+		cmd->v = vPerNum;
+		cmd->xTextureCoord = _text.glyphs[layout->style][glyph].u;
+		cmd->yTextureCoord = _text.glyphs[layout->style][glyph].v;
+		cmd->depth = layout->depth;
+
+		leftx += layout->glyphSize.x;
+	}
+
+	return width;
+}
+
+/// @brief quads for a number, only laid out again when the value drawn with this layout changes
+/// @param layout
+/// @param value
+/// @param count number of quads returned
+/// @return quads, valid until the next call
+const SpriteCmd* textLayoutNumber(const TextLayout* layout, uint32_t value, uint32_t* count)
+{
+	TextCacheEntry* entry = NULL;
+	TextCacheEntry* oldest = &_text.cache[0];
+	for (uint32_t i = 0; i < TEXT_CACHE_SIZE; ++i)
+	{
+		TextCacheEntry* candidate = &_text.cache[i];
+		if (candidate->valid && _textSameLayout(&candidate->layout, layout))
+		{
+			entry = candidate;
+			break;
+		}
+		if (!candidate->valid || (oldest->valid && candidate->lastUsed < oldest->lastUsed))
+		{
+			oldest = candidate;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		// take over the least recently used slot
+		entry = oldest;
+		entry->layout = *layout;
+		entry->valid = false;
+	}
+
+	if (!entry->valid || entry->value != value)
+	{
+		entry->count = textBuildNumber(layout, value, entry->quads);
+		entry->value = value;
+		entry->valid = true;
+	}
+
+	entry->lastUsed = ++_text.useCounter;
+	*count = entry->count;
+	return entry->quads;
+}
+
+/// @brief record a number for this frame
+/// @param layout
+/// @param value
+void textDrawNumber(const TextLayout* layout, uint32_t value)
+{
+	uint32_t count;
+	const SpriteCmd* quads = textLayoutNumber(layout, value, &count);
+	drawSprites(quads, count);
+}
+
+static bool _textSameLayout(const TextLayout* a, const TextLayout* b)
+{
+	return a->style == b->style && a->pad == b->pad && a->digits == b->digits &&
+		a->position.x == b->position.x && a->position.y == b->position.y &&
+		a->glyphSize.x == b->glyphSize.x && a->glyphSize.y == b->glyphSize.y &&
+		a->depth == b->depth;
+}
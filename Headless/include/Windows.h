@@ -0,0 +1,168 @@
+#pragma once
+// The part of Win32 the renderer, loader and golden tests use, on top of POSIX threads and
+// clocks, so they build on Linux without the window, XAudio2 and WGL parts of the framework.
+// Anything that isn't here isn't meant to build headless
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WINAPI
+#define CALLBACK
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#define _In_
+#define _In_opt_
+#define __forceinline inline __attribute__((always_inline))
+#define __declspec(attribute) __declspec_##attribute
+#define __declspec_thread __thread
+
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef int64_t LONG64;
+typedef uint64_t ULONGLONG;
+typedef unsigned int UINT;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef HANDLE HWND;
+typedef HANDLE HINSTANCE;
+typedef HANDLE HMODULE;
+typedef int errno_t;
+
+typedef union {
+	struct {
+		DWORD LowPart;
+		LONG HighPart;
+	};
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct {
+	DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+typedef pthread_mutex_t CRITICAL_SECTION;
+typedef pthread_cond_t CONDITION_VARIABLE;
+typedef DWORD (WINAPI* LPTHREAD_START_ROUTINE)(LPVOID parameter);
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED 0xFFFFFFFF
+#define TIMERR_NOERROR 0
+#define TIMER_ALL_ACCESS 0x1F0003
+
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define CopyMemory(destination, source, length) memcpy((destination), (source), (length))
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define YieldProcessor() __builtin_ia32_pause()
+#else
+#define YieldProcessor() ((void)0)
+#endif
+
+// critical sections are recursive, like on Windows
+void InitializeCriticalSection(CRITICAL_SECTION* section);
+void DeleteCriticalSection(CRITICAL_SECTION* section);
+void EnterCriticalSection(CRITICAL_SECTION* section);
+void LeaveCriticalSection(CRITICAL_SECTION* section);
+
+void InitializeConditionVariable(CONDITION_VARIABLE* condition);
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* condition, CRITICAL_SECTION* section, DWORD milliseconds);
+void WakeConditionVariable(CONDITION_VARIABLE* condition);
+void WakeAllConditionVariable(CONDITION_VARIABLE* condition);
+
+// handles are threads only, WaitForSingleObject joins and CloseHandle frees
+HANDLE CreateThread(void* attributes, size_t stackSize, LPTHREAD_START_ROUTINE start, LPVOID parameter,
+					DWORD flags, DWORD* threadId);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+BOOL CloseHandle(HANDLE handle);
+DWORD GetCurrentThreadId();
+void Sleep(DWORD milliseconds);
+
+// there are no waitable timers, timer.c falls back to Sleep
+HANDLE CreateWaitableTimerExW(void* attributes, const wchar_t* name, DWORD flags, DWORD access);
+BOOL SetWaitableTimer(HANDLE timer, const LARGE_INTEGER* due, LONG period, void* routine, void* argument, BOOL resume);
+UINT timeBeginPeriod(UINT period);
+UINT timeEndPeriod(UINT period);
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+
+void GetSystemInfo(SYSTEM_INFO* info);
+HMODULE GetModuleHandle(LPCSTR name);
+DWORD GetFullPathNameA(LPCSTR filename, DWORD length, LPSTR buffer, LPSTR* filePart);
+
+errno_t fopen_s(FILE** file, const char* filename, const char* mode);
+errno_t strcpy_s(char* destination, size_t size, const char* source);
+#define _stricmp strcasecmp
+
+static inline LONG InterlockedIncrement(volatile LONG* value)
+{
+	return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedDecrement(volatile LONG* value)
+{
+	return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedExchange(volatile LONG* value, LONG exchange)
+{
+	return __atomic_exchange_n(value, exchange, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedExchangeAdd(volatile LONG* value, LONG add)
+{
+	return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedCompareExchange(volatile LONG* value, LONG exchange, LONG comparand)
+{
+	__atomic_compare_exchange_n(value, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+static inline LONG64 InterlockedExchange64(volatile LONG64* value, LONG64 exchange)
+{
+	return __atomic_exchange_n(value, exchange, __ATOMIC_SEQ_CST);
+}
+
+static inline void MemoryBarrier()
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,3 @@
+#pragma once
+// case sensitive file systems spell it GL/gl.h
+#include <GL/gl.h>
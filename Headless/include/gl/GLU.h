@@ -0,0 +1,4 @@
+#pragma once
+// case sensitive file systems spell it GL/glu.h
+#include <GL/gl.h>
+#include <GL/glu.h>
@@ -0,0 +1,11 @@
+#include "baseTypes.h"
+#include "openglDraw.h"
+
+// MSVC merges the inline functions in the framework headers across translation units like
+// C++ does. C99 only emits them out of line where they're declared extern, which is here
+extern inline Coord2D boundsGetCenter(const Bounds2D* bounds);
+extern inline Coord2D boundsGetDimensions(const Bounds2D* bounds);
+extern inline void glDrawInit(float backRed, float backGreen, float backBlue);
+extern inline void glDrawStart(bool clear);
+extern inline void glDrawEnd();
+extern inline void glDrawResize(int32_t width, int32_t height);
@@ -0,0 +1,44 @@
+#include <Windows.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "input.h"
+#include "sound.h"
+#include "timer.h"
+#include "golden.h"
+
+// Entry point of the headless build, which only runs the golden image checks. Run it from
+// the Game folder, like the game, so the assets and asset/golden are found.
+// usage: -golden [dir] to compare, -golden-update [dir] to record,
+// -golden-gl [dir] to compare what GL draws in an offscreen context
+
+// what game.c stages the goldens in
+static const LevelDef _goldenLevel = {
+	{{0, 0}, {960, 1024}},	// fieldBounds
+	0x00ff0000,				// fieldColor
+	2						// numDucks
+};
+#define HEADLESS_MAX_SOUNDS 20
+
+int main(int argc, char** argv)
+{
+	const char* mode = (argc > 1) ? argv[1] : "";
+	const char* directory = (argc > 2) ? argv[2] : "asset/golden";
+	bool update = (strcmp(mode, "-golden-update") == 0);
+	bool gl = (strcmp(mode, "-golden-gl") == 0);
+	if (!update && !gl && strcmp(mode, "-golden") != 0)
+	{
+		printf("usage: %s -golden|-golden-update|-golden-gl [dir]\n", argv[0]);
+		return -1;
+	}
+
+	timerInit();
+	// the level still plays sounds and reads the cursor while being staged
+	soundInit(HEADLESS_MAX_SOUNDS);
+	inputInit();
+	int result = goldenRun(&_goldenLevel, directory, update, gl);
+	inputShutdown();
+	soundShutdown();
+	timerShutdown();
+	return result;
+}
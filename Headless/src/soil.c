@@ -0,0 +1,349 @@
+#include <Windows.h>
+#include <gl/GL.h>
+#include <png.h>
+#include "SOIL.h"
+
+// The part of SOIL the game uses, for builds that can't link the prebuilt Win32 library.
+// PNGs are decoded with libpng and TGAs by hand, both into the layout stb_image gives SOIL:
+// rows top to bottom, palettes expanded, 16 bit channels cut to 8. Only TGA is saved,
+// written the way SOIL writes it so either build reads the other's files
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+#define SOIL_TGA_HEADER_SIZE 18
+#define SOIL_TGA_TRUECOLOR 2
+#define SOIL_TGA_GREY 3
+#define SOIL_TGA_RLE 8						// added to the types above
+#define SOIL_TGA_TOP_DOWN 0x20
+
+static const char* _soilResult = "SOIL initialized";
+
+static unsigned char* _soilLoadPng(FILE* file, int* width, int* height, int* channels);
+static unsigned char* _soilLoadTga(FILE* file, int* width, int* height, int* channels);
+static unsigned char* _soilConvert(unsigned char* pixels, int width, int height, int channels, int forceChannels);
+static void _soilPngWarning(png_structp png, png_const_charp message);
+
+unsigned char* SOIL_load_image(const char* filename, int* width, int* height, int* channels, int force_channels)
+{
+	FILE* file;
+	if (fopen_s(&file, filename, "rb") != 0)
+	{
+		_soilResult = "Unable to open file";
+		return NULL;
+	}
+
+	png_byte signature[8];
+	size_t read = fread(signature, 1, sizeof(signature), file);
+	rewind(file);
+	unsigned char* pixels = (read == sizeof(signature) && png_sig_cmp(signature, 0, sizeof(signature)) == 0)
+		? _soilLoadPng(file, width, height, channels)
+		: _soilLoadTga(file, width, height, channels);
+	fclose(file);
+
+	if (pixels == NULL)
+		return NULL;
+	_soilResult = "Image loaded";
+	return _soilConvert(pixels, *width, *height, *channels, force_channels);
+}
+
+int SOIL_save_image(const char* filename, int image_type, int width, int height, int channels,
+					const unsigned char* const data)
+{
+	if (image_type != SOIL_SAVE_TYPE_TGA || channels < 1 || channels > 4)
+	{
+		_soilResult = "Saving only supports TGA";
+		return 0;
+	}
+	FILE* file;
+	if (fopen_s(&file, filename, "wb") != 0)
+	{
+		_soilResult = "Unable to open file";
+		return 0;
+	}
+
+	bool alpha = (channels % 2) == 0;
+	int colors = channels - (alpha ? 1 : 0);
+	uint8_t header[SOIL_TGA_HEADER_SIZE] = { 0 };
+	header[2] = (colors >= 3) ? SOIL_TGA_TRUECOLOR : SOIL_TGA_GREY;
+	header[12] = (uint8_t)(width & 0xFF);
+	header[13] = (uint8_t)(width >> 8);
+	header[14] = (uint8_t)(height & 0xFF);
+	header[15] = (uint8_t)(height >> 8);
+	header[16] = (uint8_t)(channels * 8);
+	header[17] = alpha ? 8 : 0;
+	fwrite(header, 1, sizeof(header), file);
+
+	// bottom row first, blue before red
+	for (int y = height - 1; y >= 0; --y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const unsigned char* src = &data[((size_t)y * width + x) * channels];
+			uint8_t pixel[4];
+			memcpy(pixel, src, channels);
+			if (colors >= 3)
+			{
+				pixel[0] = src[2];
+				pixel[2] = src[0];
+			}
+			fwrite(pixel, 1, channels, file);
+		}
+	}
+
+	bool written = (ferror(file) == 0);
+	fclose(file);
+	_soilResult = written ? "Image saved" : "Unable to write file";
+	return written ? 1 : 0;
+}
+
+void SOIL_free_image_data(unsigned char* img_data)
+{
+	free(img_data);
+}
+
+const char* SOIL_last_result(void)
+{
+	return _soilResult;
+}
+
+/// @brief Upload decoded pixels as a 2D texture, honouring only the flags the game passes
+/// (SOIL_FLAG_INVERT_Y and SOIL_FLAG_NTSC_SAFE_RGB). Filtering and wrapping match SOIL's defaults
+unsigned int SOIL_create_OGL_texture(const unsigned char* const data, int width, int height, int channels,
+									 unsigned int reuse_texture_ID, unsigned int flags)
+{
+	static const GLenum FORMATS[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
+	if (data == NULL || channels < 1 || channels > 4)
+	{
+		_soilResult = "Invalid image data";
+		return 0;
+	}
+
+	size_t stride = (size_t)width * channels;
+	unsigned char* pixels = malloc(stride * height);
+	if (pixels == NULL)
+	{
+		_soilResult = "Out of memory";
+		return 0;
+	}
+	for (int y = 0; y < height; ++y)
+	{
+		int source = (flags & SOIL_FLAG_INVERT_Y) ? height - 1 - y : y;
+		memcpy(&pixels[y * stride], &data[source * stride], stride);
+	}
+	if (flags & SOIL_FLAG_NTSC_SAFE_RGB)
+	{
+		// the same table SOIL scales with, alpha is left alone
+		int colors = channels - ((channels % 2 == 0) ? 1 : 0);
+		uint8_t table[256];
+		for (int i = 0; i < 256; ++i)
+			table[i] = (uint8_t)((235.499f - 15.501f) * i / 255.0f + 15.501f);
+		for (size_t i = 0; i < (size_t)width * height; ++i)
+			for (int c = 0; c < colors; ++c)
+				pixels[i * channels + c] = table[pixels[i * channels + c]];
+	}
+
+	GLuint texture = reuse_texture_ID;
+	if (texture == SOIL_CREATE_NEW_ID)
+		glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, FORMATS[channels - 1], width, height, 0, FORMATS[channels - 1],
+				 GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	free(pixels);
+
+	_soilResult = "Image loaded as an OpenGL texture";
+	return texture;
+}
+
+/// @brief Decode a PNG into 1 to 4 channels of 8 bits
+/// @param file positioned at the signature
+/// @param width
+/// @param height
+/// @param channels
+/// @return pixels, NULL on failure
+static unsigned char* _soilLoadPng(FILE* file, int* width, int* height, int* channels)
+{
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, _soilPngWarning);
+	png_infop info = (png != NULL) ? png_create_info_struct(png) : NULL;
+	unsigned char* volatile pixels = NULL;
+	png_bytep* volatile rows = NULL;
+	if (info == NULL || setjmp(png_jmpbuf(png)))
+	{
+		_soilResult = "Corrupt PNG";
+		png_destroy_read_struct(&png, &info, NULL);
+		free(pixels);
+		free(rows);
+		return NULL;
+	}
+
+	png_init_io(png, file);
+	png_read_info(png, info);
+	png_set_palette_to_rgb(png);
+	png_set_expand_gray_1_2_4_to_8(png);
+	png_set_tRNS_to_alpha(png);
+	png_set_strip_16(png);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+
+	*width = (int)png_get_image_width(png, info);
+	*height = (int)png_get_image_height(png, info);
+	*channels = png_get_channels(png, info);
+	size_t stride = png_get_rowbytes(png, info);
+	pixels = malloc(stride * *height);
+	rows = malloc(sizeof(png_bytep) * *height);
+	if (pixels == NULL || rows == NULL)
+		png_error(png, "out of memory");
+	for (int y = 0; y < *height; ++y)
+		rows[y] = pixels + y * stride;
+	png_read_image(png, rows);
+	png_read_end(png, NULL);
+
+	png_destroy_read_struct(&png, &info, NULL);
+	free(rows);
+	return pixels;
+}
+
+/// @brief Decode an uncompressed or RLE true color or grey TGA
+/// @param file
+/// @param width
+/// @param height
+/// @param channels
+/// @return pixels, NULL on failure
+static unsigned char* _soilLoadTga(FILE* file, int* width, int* height, int* channels)
+{
+	uint8_t header[SOIL_TGA_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header))
+	{
+		_soilResult = "Unknown image type";
+		return NULL;
+	}
+	int type = header[2] & ~SOIL_TGA_RLE;
+	bool rle = (header[2] & SOIL_TGA_RLE) != 0;
+	*width = header[12] | (header[13] << 8);
+	*height = header[14] | (header[15] << 8);
+	*channels = header[16] / 8;
+	bool topDown = (header[17] & SOIL_TGA_TOP_DOWN) != 0;
+	if (header[1] != 0 || (type != SOIL_TGA_TRUECOLOR && type != SOIL_TGA_GREY) ||
+		header[16] % 8 != 0 || *channels < 1 || *channels > 4 || *width == 0 || *height == 0)
+	{
+		_soilResult = "Unsupported TGA";
+		return NULL;
+	}
+	fseek(file, header[0], SEEK_CUR);
+
+	size_t count = (size_t)*width * *height;
+	unsigned char* pixels = malloc(count * *channels);
+	if (pixels == NULL)
+	{
+		_soilResult = "Out of memory";
+		return NULL;
+	}
+
+	// decode in file order, then flip and swizzle
+	uint8_t pixel[4];
+	uint32_t run = 0;
+	bool repeat = false;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (rle && run == 0)
+		{
+			int packet = fgetc(file);
+			run = (uint32_t)(packet & 0x7F) + 1;
+			repeat = (packet & 0x80) != 0;
+			if (fread(pixel, 1, *channels, file) != (size_t)*channels)
+				break;
+		}
+		else if (!rle || !repeat)
+		{
+			if (fread(pixel, 1, *channels, file) != (size_t)*channels)
+				break;
+		}
+		if (rle)
+			--run;
+
+		size_t row = i / *width;
+		size_t y = topDown ? row : (size_t)*height - 1 - row;
+		unsigned char* dst = &pixels[(y * *width + i % *width) * *channels];
+		memcpy(dst, pixel, *channels);
+		if (*channels >= 3)
+		{
+			dst[0] = pixel[2];
+			dst[2] = pixel[0];
+		}
+	}
+	if (feof(file) || ferror(file))
+	{
+		_soilResult = "Truncated TGA";
+		free(pixels);
+		return NULL;
+	}
+	return pixels;
+}
+
+/// @brief Convert to the requested number of channels the way stb_image does
+/// @param pixels freed if a new buffer is returned
+/// @param width
+/// @param height
+/// @param channels what pixels has
+/// @param forceChannels SOIL_LOAD_AUTO to keep them
+/// @return pixels with forceChannels channels, NULL if out of memory
+static unsigned char* _soilConvert(unsigned char* pixels, int width, int height, int channels, int forceChannels)
+{
+	if (forceChannels == SOIL_LOAD_AUTO || forceChannels == channels)
+		return pixels;
+
+	size_t count = (size_t)width * height;
+	unsigned char* converted = malloc(count * forceChannels);
+	if (converted == NULL)
+	{
+		_soilResult = "Out of memory";
+		free(pixels);
+		return NULL;
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		const unsigned char* src = &pixels[i * channels];
+		unsigned char* dst = &converted[i * forceChannels];
+		uint8_t r = src[0];
+		uint8_t g = (channels >= 3) ? src[1] : src[0];
+		uint8_t b = (channels >= 3) ? src[2] : src[0];
+		uint8_t a = (channels == 4) ? src[3] : (channels == 2) ? src[1] : 0xFF;
+		uint8_t luma = (channels >= 3) ? (uint8_t)((r * 77 + g * 150 + b * 29) >> 8) : r;
+		switch (forceChannels)
+		{
+		case SOIL_LOAD_L:
+			dst[0] = luma;
+			break;
+		case SOIL_LOAD_LA:
+			dst[0] = luma;
+			dst[1] = a;
+			break;
+		case SOIL_LOAD_RGB:
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+			break;
+		default:
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+			dst[3] = a;
+			break;
+		}
+	}
+	free(pixels);
+	return converted;
+}
+
+/// @brief stb_image doesn't check color profiles, so don't complain about the assets' ones either
+/// @param png
+/// @param message
+static void _soilPngWarning(png_structp png, png_const_charp message)
+{
+}
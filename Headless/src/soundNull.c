@@ -0,0 +1,111 @@
+#include <Windows.h>
+#include "sound.h"
+
+// Headless there is no XAudio2, clips get ids so the game can keep track of them
+// but nothing is read or played
+
+static struct {
+	CRITICAL_SECTION lock;
+	int32_t maxSounds;
+	bool* loaded;
+} _soundNull;
+
+void soundSetSink(const MixerSink* sink, const void* config)
+{
+}
+
+const MixerSink* soundDeviceSink()
+{
+	return NULL;
+}
+
+bool soundInit(int32_t maxSounds)
+{
+	_soundNull.loaded = calloc(maxSounds, sizeof(bool));
+	if (_soundNull.loaded == NULL)
+		return false;
+	_soundNull.maxSounds = maxSounds;
+	InitializeCriticalSection(&_soundNull.lock);
+	return true;
+}
+
+bool soundShutdown()
+{
+	if (_soundNull.loaded == NULL)
+		return false;
+	DeleteCriticalSection(&_soundNull.lock);
+	free(_soundNull.loaded);
+	_soundNull.loaded = NULL;
+	_soundNull.maxSounds = 0;
+	return true;
+}
+
+/// @brief Take a free id, the file isn't opened. Called from loader workers
+/// @param filename
+/// @return id, SOUND_NOSOUND if all maxSounds are taken
+int32_t soundLoad(const char* filename)
+{
+	int32_t soundId = SOUND_NOSOUND;
+
+	EnterCriticalSection(&_soundNull.lock);
+	for (int32_t i = 0; i < _soundNull.maxSounds; ++i)
+	{
+		if (!_soundNull.loaded[i])
+		{
+			_soundNull.loaded[i] = true;
+			soundId = i;
+			break;
+		}
+	}
+	LeaveCriticalSection(&_soundNull.lock);
+
+	return soundId;
+}
+
+void soundUnload(int32_t soundId)
+{
+	if (soundId < 0 || soundId >= _soundNull.maxSounds)
+		return;
+
+	EnterCriticalSection(&_soundNull.lock);
+	_soundNull.loaded[soundId] = false;
+	LeaveCriticalSection(&_soundNull.lock);
+}
+
+void soundPlay(int32_t soundId)
+{
+}
+
+void soundStop(int32_t soundId)
+{
+}
+
+void soundSetPriority(int32_t soundId, int32_t priority)
+{
+}
+
+void soundSetGain(int32_t soundId, float gain)
+{
+}
+
+void soundSetPolicy(int32_t soundId, const SoundPolicy* policy)
+{
+}
+
+void soundFrameBegin(uint64_t frameTime)
+{
+}
+
+uint32_t soundGetActiveVoices()
+{
+	return 0;
+}
+
+uint32_t soundGetVoicesCreated()
+{
+	return 0;
+}
+
+void soundReport()
+{
+}
@@ -0,0 +1,261 @@
+#define _GNU_SOURCE
+#include <Windows.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+
+/// @brief A thread, the only kind of handle there is headless
+typedef struct {
+	pthread_t				thread;
+	bool					joined;
+} ThreadHandle;
+
+/// @brief What the new thread calls, it frees this itself since the handle can be closed first
+typedef struct {
+	LPTHREAD_START_ROUTINE	start;
+	LPVOID					parameter;
+} ThreadStart;
+
+static void* _threadMain(void* parameter);
+static struct timespec _deadline(DWORD milliseconds);
+
+void InitializeCriticalSection(CRITICAL_SECTION* section)
+{
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(section, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION* section)
+{
+	pthread_mutex_destroy(section);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* section)
+{
+	pthread_mutex_lock(section);
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* section)
+{
+	pthread_mutex_unlock(section);
+}
+
+void InitializeConditionVariable(CONDITION_VARIABLE* condition)
+{
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(condition, &attributes);
+	pthread_condattr_destroy(&attributes);
+}
+
+/// @brief Wait for a wake with the section held on entry and again on return
+/// @param condition
+/// @param section
+/// @param milliseconds INFINITE to wait for a wake
+/// @return FALSE if it timed out
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* condition, CRITICAL_SECTION* section, DWORD milliseconds)
+{
+	if (milliseconds == INFINITE)
+		return pthread_cond_wait(condition, section) == 0;
+
+	struct timespec deadline = _deadline(milliseconds);
+	return pthread_cond_timedwait(condition, section, &deadline) == 0;
+}
+
+void WakeConditionVariable(CONDITION_VARIABLE* condition)
+{
+	pthread_cond_signal(condition);
+}
+
+void WakeAllConditionVariable(CONDITION_VARIABLE* condition)
+{
+	pthread_cond_broadcast(condition);
+}
+
+HANDLE CreateThread(void* attributes, size_t stackSize, LPTHREAD_START_ROUTINE start, LPVOID parameter,
+					DWORD flags, DWORD* threadId)
+{
+	ThreadHandle* handle = malloc(sizeof(ThreadHandle));
+	ThreadStart* entry = malloc(sizeof(ThreadStart));
+	if (handle == NULL || entry == NULL)
+	{
+		free(handle);
+		free(entry);
+		return NULL;
+	}
+	entry->start = start;
+	entry->parameter = parameter;
+	handle->joined = false;
+	if (pthread_create(&handle->thread, NULL, _threadMain, entry) != 0)
+	{
+		free(handle);
+		free(entry);
+		return NULL;
+	}
+	if (threadId != NULL)
+		*threadId = 0;
+	return handle;
+}
+
+/// @brief Wait for a thread to exit. Only INFINITE is supported, nothing headless waits less
+/// @param handle
+/// @param milliseconds
+/// @return WAIT_OBJECT_0 once the thread has exited
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+	ThreadHandle* thread = handle;
+	if (thread == NULL || milliseconds != INFINITE)
+		return WAIT_FAILED;
+	if (!thread->joined)
+	{
+		pthread_join(thread->thread, NULL);
+		thread->joined = true;
+	}
+	return WAIT_OBJECT_0;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+	ThreadHandle* thread = handle;
+	if (thread == NULL)
+		return FALSE;
+	if (!thread->joined)
+		pthread_detach(thread->thread);
+	free(thread);
+	return TRUE;
+}
+
+DWORD GetCurrentThreadId()
+{
+	return (DWORD)syscall(SYS_gettid);
+}
+
+void Sleep(DWORD milliseconds)
+{
+	struct timespec duration = { milliseconds / 1000, (long)(milliseconds % 1000) * 1000000 };
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+		;
+}
+
+HANDLE CreateWaitableTimerExW(void* attributes, const wchar_t* name, DWORD flags, DWORD access)
+{
+	return NULL;
+}
+
+BOOL SetWaitableTimer(HANDLE timer, const LARGE_INTEGER* due, LONG period, void* routine, void* argument, BOOL resume)
+{
+	return FALSE;
+}
+
+UINT timeBeginPeriod(UINT period)
+{
+	// nanosleep already wakes within a fraction of a millisecond
+	return TIMERR_NOERROR;
+}
+
+UINT timeEndPeriod(UINT period)
+{
+	return TIMERR_NOERROR;
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	counter->QuadPart = (LONGLONG)now.tv_sec * 1000000000 + now.tv_nsec;
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+void GetSystemInfo(SYSTEM_INFO* info)
+{
+	ZeroMemory(info, sizeof(SYSTEM_INFO));
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	info->dwNumberOfProcessors = (processors > 0) ? (DWORD)processors : 1;
+}
+
+HMODULE GetModuleHandle(LPCSTR name)
+{
+	return NULL;
+}
+
+/// @brief Prefix relative paths with the working directory. Unlike Windows, . and .. are
+/// left in, the result only has to be the same for the same spelling
+/// @param filename
+/// @param length size of buffer
+/// @param buffer
+/// @param filePart not supported, must be NULL
+/// @return characters written without the terminator, the size needed if it didn't fit, 0 on failure
+DWORD GetFullPathNameA(LPCSTR filename, DWORD length, LPSTR buffer, LPSTR* filePart)
+{
+	char directory[PATH_MAX] = "";
+	if (filename[0] != '/' && getcwd(directory, sizeof(directory)) == NULL)
+		return 0;
+
+	size_t prefix = strlen(directory);
+	size_t needed = prefix + (prefix > 0 ? 1 : 0) + strlen(filename);
+	if (needed >= length)
+		return (DWORD)(needed + 1);
+	memcpy(buffer, directory, prefix);
+	if (prefix > 0)
+		buffer[prefix++] = '/';
+	strcpy(buffer + prefix, filename);
+	return (DWORD)needed;
+}
+
+errno_t fopen_s(FILE** file, const char* filename, const char* mode)
+{
+	*file = fopen(filename, mode);
+	return (*file != NULL) ? 0 : errno;
+}
+
+errno_t strcpy_s(char* destination, size_t size, const char* source)
+{
+	size_t length = strlen(source);
+	if (length >= size)
+	{
+		if (size > 0)
+			destination[0] = '\0';
+		return ERANGE;
+	}
+	memcpy(destination, source, length + 1);
+	return 0;
+}
+
+/// @brief pthread entry point that calls the Win32 style one
+/// @param parameter ThreadStart
+/// @return
+static void* _threadMain(void* parameter)
+{
+	ThreadStart entry = *(ThreadStart*)parameter;
+	free(parameter);
+	entry.start(entry.parameter);
+	return NULL;
+}
+
+/// @brief Absolute monotonic time some milliseconds from now, for timed waits
+/// @param milliseconds
+/// @return
+static struct timespec _deadline(DWORD milliseconds)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec += 1;
+		deadline.tv_nsec -= 1000000000;
+	}
+	return deadline;
+}
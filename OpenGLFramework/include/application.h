@@ -9,12 +9,14 @@ extern "C" {
 typedef struct application_t Application;
 
 typedef void (*AppDrawFunc)();
-typedef void (*AppUpdateFunc)(uint32_t);
+typedef void (*AppUpdateFunc)(Milliseconds);
+typedef uint64_t (*AppRenderFunc)();
 
 Application* appNew(HINSTANCE instance, const char* title, AppDrawFunc drawFunc, AppUpdateFunc updateFunc);
 void appDelete(Application* app);
 void appDraw(Application* app);
-void appUpdate(Application* app, uint32_t milliseconds);
+void appUpdate(Application* app, Milliseconds milliseconds);
+uint64_t appRender(Application* app);
 
 HINSTANCE appGetInstance(const Application* app);
 const char* appGetTitle(const Application* app);
@@ -23,11 +25,23 @@ void appSetWidth(Application* app, uint32_t width);
 void appSetHeight(Application* app, uint32_t height);
 void appSetBitsPerPixel(Application* app, uint32_t bpp);
 void appSetMaxSounds(Application* app, uint32_t maxSounds);
+void appSetPreserveFrame(Application* app, bool preserveFrame);
+void appSetTargetFps(Application* app, uint32_t fps);
+void appSetVsync(Application* app, bool vsync);
+void appSetRenderFunc(Application* app, AppRenderFunc renderFunc);
+void appSetRenderThread(Application* app, bool renderThread);
+void appSetGLVersion(Application* app, uint32_t major, uint32_t minor);
 
 uint32_t appGetWidth(const Application* app);
 uint32_t appGetHeight(const Application* app);
 uint32_t appGetBitsPerPixel(const Application* app);
 uint32_t appGetMaxSounds(const Application* app);
+bool appGetPreserveFrame(const Application* app);
+uint32_t appGetTargetFps(const Application* app);
+bool appGetVsync(const Application* app);
+bool appGetRenderThread(const Application* app);
+uint32_t appGetGLMajorVersion(const Application* app);
+uint32_t appGetGLMinorVersion(const Application* app);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/// @brief Elapsed time passed down the update chain. Fractional, so a frame shorter than
+/// a millisecond still moves things and frame lengths don't quantize
+typedef float Milliseconds;
+
 typedef struct 
 {
     float x;
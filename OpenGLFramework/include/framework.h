@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 typedef struct gl_window_t GLWindow;
+typedef struct gl_offscreen_t GLOffscreen;
 
 GLWindow* fwInitWindow(Application* app);
 bool fwUpdateWindow(GLWindow* window);
@@ -15,6 +16,15 @@ void fwSendTerminate(GLWindow* window);
 void fwSendFullscreen(GLWindow* window, bool fullscreen);
 bool fwChangeResolution(GLWindow* window, uint32_t width, uint32_t height, uint32_t bitsPerPixel);
 
+GLOffscreen* fwInitOffscreen(Application* app);
+void fwOffscreenFrame(GLOffscreen* offscreen);
+void fwOffscreenReadPixels(GLOffscreen* offscreen, uint8_t* rgb);
+void fwShutdownOffscreen(GLOffscreen* offscreen);
+
+LRESULT CALLBACK fwInputWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+void* fwGetProcAddress(const char* name);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -12,17 +12,64 @@ typedef enum {
     INPUT_BUTTON_COUNT
 } InputButton;
 
+typedef enum {
+    INPUT_EVENT_KEY_DOWN,
+    INPUT_EVENT_KEY_UP,
+    INPUT_EVENT_BUTTON_DOWN,
+    INPUT_EVENT_BUTTON_UP,
+    INPUT_EVENT_MOVE
+} InputEventType;
+
+/// @brief One change of input, in the order they arrived
+typedef struct input_event_t {
+    InputEventType type;
+    uint8_t code;           // virtual key or InputButton
+    Coord2D position;       // mouse position when it happened
+    uint64_t timestamp;     // timerNowNanoseconds
+} InputEvent;
+
+/// @brief A source of absolute pointer samples, like a light gun or a wii remote's IR camera,
+/// read on its own thread or polled at the start of each update. It hands each sample to
+/// inputPointerSample
+typedef struct input_pointer_backend_t {
+    const char* name;
+    bool (*start)(const void* config);
+    void (*stop)();
+    void (*poll)(uint64_t frameTime);   // NULL for backends with their own thread
+} InputPointerBackend;
+
 // "public" methods - use these to check keyboard & mouse status
 bool inputKeyPressed(char vkCode);
+bool inputKeyPressedThisFrame(char vkCode);
+bool inputKeyReleasedThisFrame(char vkCode);
 Coord2D inputMousePosition();
 bool inputMousePressed(InputButton button);
+bool inputMousePressedThisFrame(InputButton button);
+bool inputMouseReleasedThisFrame(InputButton button);
+const InputEvent* inputEvents(uint32_t* count);
+uint64_t inputFrameTime();
+uint32_t inputDroppedEvents();
+
+bool inputPointerStart(const InputPointerBackend* backend, const void* config);
+void inputPointerStop();
+bool inputPointerActive();
+uint64_t inputPointerNewestSample();
+void inputPointerReport();
+
+// called by pointer backends, from any thread
+void inputPointerSample(Coord2D position, uint32_t buttons, uint64_t sampleTime);
 
 // "private" methods - should only be called by framework
 void inputInit();
 void inputShutdown();
+void inputFrameBegin(uint64_t timestamp);
+void inputFrameEnd();
 void inputKeyUpdate(uint8_t vkCode, bool pressed);
+void inputKeyInject(uint8_t vkCode, bool pressed, uint64_t timestamp);
 void inputMouseUpdatePosition(Coord2D coords);
+void inputMouseInjectPosition(Coord2D coords, uint64_t timestamp);
 void inputMouseUpdateButton(InputButton button, bool pressed);
+void inputMouseInjectButton(InputButton button, bool pressed, uint64_t timestamp);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,50 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIXER_SAMPLE_RATE 48000
+#define MIXER_CHANNELS 2
+#define MIXER_BLOCK_FRAMES 512
+#define MIXER_RING_BLOCKS 4
+#define MIXER_NOCLIP -1
+
+// sample formats, as tagged in a WAV file
+#define MIXER_FORMAT_PCM 1
+#define MIXER_FORMAT_FLOAT 3
+
+/// @brief Where the mix goes. Each block is MIXER_BLOCK_FRAMES interleaved float frames from
+/// the mixer's ring, and stays untouched until MIXER_RING_BLOCKS - 1 more have been written,
+/// so a device can queue it without copying
+typedef struct mixer_sink_t {
+    const char* name;
+    bool (*open)(const void* config);
+    void (*write)(const float* samples, uint32_t frames);
+    void (*close)();
+    bool paced;     // write waits for the device, otherwise the mixer keeps to real time itself
+} MixerSink;
+
+bool mixerInit();
+void mixerShutdown();
+bool mixerStart(const MixerSink* sink, const void* config);
+void mixerStop();
+int32_t mixerAddClip(const void* data, uint32_t bytes, uint16_t format, uint16_t channels,
+                     uint32_t sampleRate, uint16_t bitsPerSample);
+void mixerRemoveClip(int32_t clipId);
+bool mixerPlay(int32_t clipId, float gain, int32_t priority);
+void mixerStopClip(int32_t clipId);
+uint32_t mixerCountClip(int32_t clipId);
+void mixerStealClip(int32_t clipId, bool quietest);
+void mixerRender(float* samples, uint32_t frames);
+void mixerSetSimd(bool enabled);
+uint32_t mixerGetActiveVoices();
+void mixerReport();
+
+const MixerSink* mixerNullSink();
+const MixerSink* mixerWavSink();
+
+#ifdef __cplusplus
+}
+#endif
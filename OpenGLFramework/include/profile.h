@@ -0,0 +1,38 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scoped timing markers, exported as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+// The markers are compiled into debug builds, and into release builds defining FW_PROFILE.
+// Even then they only record between profStart and profStop. Every PROFILE_BEGIN needs a
+// PROFILE_END on the same thread, and names must outlive the session (string literals)
+
+#if defined(_DEBUG) && !defined(FW_PROFILE) && !defined(FW_NO_PROFILE)
+#define FW_PROFILE
+#endif
+
+#ifdef FW_PROFILE
+#define PROFILE_BEGIN(name) profBegin(name)
+#define PROFILE_END() profEnd()
+#define PROFILE_THREAD(name) profThreadName(name)
+#else
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+void profStart(uint32_t eventsPerThread);
+void profStop();
+bool profWriteTrace(const char* filename);
+void profShutdown();
+
+void profBegin(const char* name);
+void profEnd();
+void profThreadName(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
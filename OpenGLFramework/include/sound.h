@@ -1,5 +1,6 @@
 #pragma once
 #include "baseTypes.h"
+#include "mixer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -7,12 +8,36 @@ extern "C" {
 
 #define SOUND_NOSOUND -1
 
+/// @brief Which instance of a clip makes way when it's already playing as often as allowed
+typedef enum {
+    SOUND_STEAL_NONE,       // the new play is dropped
+    SOUND_STEAL_OLDEST,
+    SOUND_STEAL_QUIETEST    // the lowest gain, then the oldest
+} SoundSteal;
+
+/// @brief Limits on how often a clip plays, so triggers from many objects don't stack
+typedef struct sound_policy_t {
+    uint32_t maxInstances;  // playing at once, 0 for no limit
+    Milliseconds minInterval;   // plays sooner than this after the last one are dropped
+    bool coalesce;          // plays in the same frame as the last one are dropped
+    SoundSteal steal;
+} SoundPolicy;
+
+void soundSetSink(const MixerSink* sink, const void* config);
+const MixerSink* soundDeviceSink();
 bool soundInit(int32_t maxSounds);
 bool soundShutdown();
 int32_t soundLoad(const char* filename);
 void soundUnload(int32_t soundId);
 void soundPlay(int32_t soundId);
 void soundStop(int32_t soundId);
+void soundSetPriority(int32_t soundId, int32_t priority);
+void soundSetGain(int32_t soundId, float gain);
+void soundSetPolicy(int32_t soundId, const SoundPolicy* policy);
+void soundFrameBegin(uint64_t frameTime);
+uint32_t soundGetActiveVoices();
+uint32_t soundGetVoicesCreated();
+void soundReport();
 
 #ifdef __cplusplus
 }
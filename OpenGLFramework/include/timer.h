@@ -0,0 +1,17 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void timerInit();
+void timerShutdown();
+
+uint64_t timerNowNanoseconds();
+uint64_t timerNowMicroseconds();
+void timerSleepUntil(uint64_t deadline);
+
+#ifdef __cplusplus
+}
+#endif
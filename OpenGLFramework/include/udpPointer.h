@@ -0,0 +1,21 @@
+#pragma once
+#include "baseTypes.h"
+#include "input.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UDP_POINTER_DEFAULT_PORT 4444
+
+/// @brief Where to listen, and the window size the normalized samples are scaled to
+typedef struct udp_pointer_config_t {
+    uint16_t port;
+    Coord2D size;
+} UdpPointerConfig;
+
+const InputPointerBackend* udpPointerGetBackend();
+
+#ifdef __cplusplus
+}
+#endif
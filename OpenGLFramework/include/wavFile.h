@@ -0,0 +1,26 @@
+#pragma once
+#include "baseTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief A WAV file mapped into memory. The format and samples point into the mapping and
+/// stay valid until wavClose, so every buffer submitted from them has to have ended first
+typedef struct wav_file_t {
+    const void* format;         // the fmt chunk, a WAVEFORMATEX or WAVEFORMATEXTENSIBLE
+    uint32_t formatBytes;
+    const void* samples;        // the data chunk
+    uint32_t sampleBytes;
+
+    void* file;
+    void* mapping;
+    const uint8_t* view;
+} WavFile;
+
+bool wavOpen(const char* filename, WavFile* wav);
+void wavClose(WavFile* wav);
+
+#ifdef __cplusplus
+}
+#endif
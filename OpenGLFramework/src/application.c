@@ -1,4 +1,5 @@
 #include "application.h"
+#include "profile.h"
 
 struct application_t {
     // windows instance
@@ -8,6 +9,7 @@ struct application_t {
     const char* title;
     AppDrawFunc drawFunc;
     AppUpdateFunc updateFunc;
+    AppRenderFunc renderFunc;
 
     // window settings
     uint32_t    width;
@@ -16,6 +18,18 @@ struct application_t {
 
     // audio
     uint32_t    maxSounds;
+
+    // rendering
+    bool        preserveFrame;
+
+    // frame pacing
+    uint32_t    targetFps;      // 0 renders as fast as possible
+    bool        vsync;
+    bool        renderThread;   // submit and swap on a separate thread
+
+    // context, 0.0 for whatever wglCreateContext gives us
+    uint32_t    glMajorVersion;
+    uint32_t    glMinorVersion;
 };
 
 /// @brief Create an instance of an application with default settings
@@ -35,11 +49,18 @@ Application* appNew(HINSTANCE instance, const char* title, AppDrawFunc drawFunc,
         app->title = title;
         app->drawFunc = drawFunc;
         app->updateFunc = updateFunc;
+        app->renderFunc = NULL;
 
         app->width = DEFAULT_WIDTH;
         app->height = DEFAULT_HEIGHT;
         app->bpp = DEFAULT_BPP;
         app->maxSounds = DEFAULT_MAXSOUNDS;
+        app->preserveFrame = false;
+        app->targetFps = 0;
+        app->vsync = false;
+        app->renderThread = false;
+        app->glMajorVersion = 0;
+        app->glMinorVersion = 0;
     }
 
     return app;
@@ -58,19 +79,38 @@ void appDraw(Application* app)
 {
     if (app->drawFunc != NULL)
     {
+        PROFILE_BEGIN("appDraw");
         app->drawFunc();
+        PROFILE_END();
     }
 }
 
 /// @brief Updates the application for the passage of the requested number of milliseconds
 /// @param application 
 /// @param milliseconds 
-void appUpdate(Application* app, uint32_t milliseconds)
+void appUpdate(Application* app, Milliseconds milliseconds)
 {
     if (app->updateFunc != NULL) 
     {
+        PROFILE_BEGIN("appUpdate");
         app->updateFunc(milliseconds);
+        PROFILE_END();
+    }
+}
+
+/// @brief Submits whatever appDraw recorded, on the thread that owns the GL context
+/// @param application 
+/// @return when the submitted frame was recorded, 0 if nothing was submitted
+uint64_t appRender(Application* app)
+{
+    if (app->renderFunc != NULL)
+    {
+        PROFILE_BEGIN("appRender");
+        uint64_t recordedAt = app->renderFunc();
+        PROFILE_END();
+        return recordedAt;
     }
+    return 0;
 }
 
 /*
@@ -80,6 +120,12 @@ void appSetWidth(Application* app, uint32_t width) { app->width = width; }
 void appSetHeight(Application* app, uint32_t height) { app->height = height; }
 void appSetBitsPerPixel(Application* app, uint32_t bpp) { app->bpp = bpp; }
 void appSetMaxSounds(Application* app, uint32_t maxSounds) { app->maxSounds = maxSounds; }
+void appSetPreserveFrame(Application* app, bool preserveFrame) { app->preserveFrame = preserveFrame; }
+void appSetTargetFps(Application* app, uint32_t fps) { app->targetFps = fps; }
+void appSetVsync(Application* app, bool vsync) { app->vsync = vsync; }
+void appSetRenderFunc(Application* app, AppRenderFunc renderFunc) { app->renderFunc = renderFunc; }
+void appSetRenderThread(Application* app, bool renderThread) { app->renderThread = renderThread; }
+void appSetGLVersion(Application* app, uint32_t major, uint32_t minor) { app->glMajorVersion = major; app->glMinorVersion = minor; }
 
 /*
  * Getters for various application fields
@@ -90,3 +136,9 @@ uint32_t appGetWidth(const Application* app) { return app->width; }
 uint32_t appGetHeight(const Application* app) { return app->height; }
 uint32_t appGetBitsPerPixel(const Application* app) { return app->bpp; }
 uint32_t appGetMaxSounds(const Application* app) { return app->maxSounds; }
+bool appGetPreserveFrame(const Application* app) { return app->preserveFrame; }
+uint32_t appGetTargetFps(const Application* app) { return app->targetFps; }
+bool appGetVsync(const Application* app) { return app->vsync; }
+bool appGetRenderThread(const Application* app) { return app->renderThread; }
+uint32_t appGetGLMajorVersion(const Application* app) { return app->glMajorVersion; }
+uint32_t appGetGLMinorVersion(const Application* app) { return app->glMinorVersion; }
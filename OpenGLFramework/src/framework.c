@@ -2,11 +2,14 @@
 #include <stdio.h>
 #include <io.h>
 #include <fcntl.h>
+#include <math.h>
 
 #include "framework.h"
 #include "openglDraw.h"
 #include "input.h"
 #include "sound.h"
+#include "timer.h"
+#include "profile.h"
 
 // Application Define Message For Toggling
 #define WM_TOGGLEFULLSCREEN (WM_USER+1)
@@ -18,6 +21,87 @@
 #endif
 
 static const char CLASS_NAME[] = "OpenGL Application";
+static const char OFFSCREEN_CLASS_NAME[] = "OpenGL Offscreen";
+
+// how often frame pacing stats are printed
+#define FRAME_STATS_INTERVAL_US 5000000
+// frames this far past their target interval are counted as late
+#define FRAME_LATE_SLACK_US 1000
+// how much consecutive frame intervals differ, upper bounds of the histogram buckets
+#define FRAME_JITTER_BUCKETS 7
+static const uint32_t FRAME_JITTER_LIMITS_US[FRAME_JITTER_BUCKETS] = { 100, 250, 500, 1000, 2000, 4000, 8000 };
+
+// WGL_EXT_swap_control, fetched at runtime
+typedef BOOL (WINAPI* SwapIntervalFunc)(int interval);
+
+// WGL_ARB_create_context, fetched at runtime
+typedef HGLRC (WINAPI* CreateContextAttribsFunc)(HDC hDC, HGLRC hShareContext, const int* attribList);
+#define WGL_CONTEXT_MAJOR_VERSION_ARB				0x2091
+#define WGL_CONTEXT_MINOR_VERSION_ARB				0x2092
+#define WGL_CONTEXT_PROFILE_MASK_ARB				0x9126
+#define WGL_CONTEXT_COMPATIBILITY_PROFILE_BIT_ARB	0x00000002
+
+/// @brief Frame interval accumulators for the current stats window
+typedef struct {
+	uint64_t			windowStart;
+	uint64_t			cpuStart;					// process cpu time, 100ns units
+	uint32_t			frames;
+	uint32_t			lateFrames;
+	double				sum;
+	double				sumSquares;
+	uint64_t			minInterval;
+	uint64_t			maxInterval;
+	uint64_t			lastInterval;
+	uint32_t			jitter[FRAME_JITTER_BUCKETS + 1];	// Last Bucket Is Everything Over The Limits
+	uint32_t			events;						// Window Messages Dispatched
+	uint32_t			maxEvents;					// Most In One Frame
+	uint32_t			maxEventAge;				// Oldest Message When Dispatched, Milliseconds
+} FrameStats;
+
+/// @brief Render thread accumulators, only touched by the render thread
+typedef struct {
+	uint64_t			windowStart;
+	LONG				producedStart;
+	uint32_t			presented;
+	double				latencySum;
+	uint64_t			latencyMax;
+} RenderStats;
+
+// framebuffer objects, GL 3.0 or ARB_framebuffer_object, fetched at runtime
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER					0x8D40
+#define GL_RENDERBUFFER					0x8D41
+#define GL_COLOR_ATTACHMENT0			0x8CE0
+#define GL_DEPTH_ATTACHMENT				0x8D00
+#define GL_FRAMEBUFFER_COMPLETE			0x8CD5
+#define GL_RGBA8						0x8058
+#define GL_DEPTH_COMPONENT24			0x81A6
+#endif
+
+typedef struct {
+	void (APIENTRY* GenFramebuffers)(GLsizei n, GLuint* framebuffers);
+	void (APIENTRY* BindFramebuffer)(GLenum target, GLuint framebuffer);
+	void (APIENTRY* DeleteFramebuffers)(GLsizei n, const GLuint* framebuffers);
+	void (APIENTRY* GenRenderbuffers)(GLsizei n, GLuint* renderbuffers);
+	void (APIENTRY* BindRenderbuffer)(GLenum target, GLuint renderbuffer);
+	void (APIENTRY* DeleteRenderbuffers)(GLsizei n, const GLuint* renderbuffers);
+	void (APIENTRY* RenderbufferStorage)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+	void (APIENTRY* FramebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+	GLenum (APIENTRY* CheckFramebufferStatus)(GLenum target);
+} FramebufferFuncs;
+
+typedef struct gl_offscreen_t {
+	Application*		app;
+	int32_t				width;
+	int32_t				height;
+	HWND				hWnd;						// Hidden Window, Only For Its Device Context
+	HDC					hDC;
+	HGLRC				hRC;
+	FramebufferFuncs	fbo;
+	GLuint				framebuffer;
+	GLuint				colorBuffer;
+	GLuint				depthBuffer;
+} GLOffscreen;
 
 typedef struct gl_window_t {						// Contains Information Vital To A Window
 	Application*		app;
@@ -29,7 +113,17 @@ typedef struct gl_window_t {						// Contains Information Vital To A Window
 
 	// state information
 	bool				isVisible;					// Window Visible?
-	ULONGLONG			lastTickCount;				// Tick Counter
+	uint64_t			lastFrameTime;				// Start Of Last Frame, Nanoseconds
+	uint64_t			nextFrameTime;				// Frame Limiter Deadline, Microseconds
+	FrameStats			stats;
+
+	// render thread, only running inside the update loop when the app asks for it
+	HANDLE				renderThread;
+	HANDLE				frameReady;					// Signalled After Each Recorded Frame
+	volatile LONG		renderStop;
+	volatile LONG		framesProduced;
+	volatile LONG64		pendingResize;				// (Width << 32) | Height, 0 When None
+	RenderStats			renderStats;
 } GLWindow;
 
 // private helper methods
@@ -37,8 +131,23 @@ static bool _registerWindowClass(Application* app);
 static GLWindow* _createWindow(Application* app);
 static void _destroyWindow(GLWindow* window);
 static HWND _initializeWindowEx(GLWindow* window, Application* app);
-static bool _setPixelFormat(HDC deviceContext, uint32_t bitsPerPixel);
+static bool _setPixelFormat(HDC deviceContext, uint32_t bitsPerPixel, bool preserveFrame);
 static LRESULT CALLBACK _messageHandler(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+static bool _inputMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+static void _setSwapInterval(int interval);
+static void _upgradeContext(HDC deviceContext, HGLRC* renderContext, uint32_t major, uint32_t minor);
+static bool _pumpMessages(GLWindow* window);
+static void _waitForNextFrame(GLWindow* window);
+static void _frameStatsReset(FrameStats* stats, uint64_t now);
+static void _frameStatsRecord(GLWindow* window, uint64_t now, uint64_t interval);
+static uint64_t _processCpuTime();
+static void _startRenderThread(GLWindow* window);
+static void _stopRenderThread(GLWindow* window);
+static DWORD WINAPI _renderThreadMain(LPVOID param);
+static void _renderStatsRecord(GLWindow* window, uint64_t now, uint64_t latency);
+static void _resize(GLWindow* window, int32_t width, int32_t height);
+static uint64_t _messageTime();
+static bool _loadFramebufferFuncs(FramebufferFuncs* fbo);
 
 /// @brief Initialize windows for running this application
 /// @param app 
@@ -62,6 +171,7 @@ GLWindow* fwInitWindow(Application* app)
 	*stdin = *hf_in;
 
 	// initialize core systems
+	timerInit();
 	soundInit(appGetMaxSounds(app));
 	inputInit();
 
@@ -90,39 +200,52 @@ GLWindow* fwInitWindow(Application* app)
 
 bool fwUpdateWindow(GLWindow* window)
 {
-	MSG msg;
+	// everything that arrived since the last frame is seen by this update
+	if (!_pumpMessages(window))
+	{
+		_stopRenderThread(window);
+		return false;
+	}
 
-	if (PeekMessage(&msg, window->hWnd, 0, 0, PM_REMOVE) != 0) 
+	if (window->isVisible) 
 	{
-		if (msg.message == WM_QUIT)
+		uint64_t now = timerNowNanoseconds();
+		uint64_t interval = now - window->lastFrameTime;
+		window->lastFrameTime = now;
+		_frameStatsRecord(window, now / 1000, interval / 1000);
+
+		inputFrameBegin(now);
+		soundFrameBegin(now);
+		appUpdate(window->app, (Milliseconds)(interval / 1000000.0));
+		inputFrameEnd();
+
+		if (window->renderThread == NULL && appGetRenderThread(window->app))
 		{
-			return false;
+			_startRenderThread(window);
 		}
-		else
+
+		if (window->renderThread != NULL)
 		{
-			DispatchMessage(&msg);
+			// record here, the render thread submits and swaps
+			appDraw(window->app);
+			InterlockedIncrement(&window->framesProduced);
+			SetEvent(window->frameReady);
 		}
-	}
-	else
-	{
-		if (window->isVisible) 
+		else
 		{
-			ULONGLONG tickCount = GetTickCount64();
-			uint32_t ticks = (uint32_t)(tickCount - window->lastTickCount);
-			window->lastTickCount = tickCount;
-
-			appUpdate(window->app, ticks);
-
-			glDrawStart();
+			glDrawStart(!appGetPreserveFrame(window->app));
 			appDraw(window->app);
+			appRender(window->app);
 			glDrawEnd();
 
 			SwapBuffers(window->hDC);
 		}
-		else
-		{
-			WaitMessage();
-		}
+
+		_waitForNextFrame(window);
+	}
+	else
+	{
+		WaitMessage();
 	}
 
 	return true;
@@ -135,10 +258,12 @@ void fwShutdownWindow(GLWindow* window)
 	// store the instance, so we can still safely use it after destroying the window
 	HINSTANCE inst = appGetInstance(window->app);
 
+	_stopRenderThread(window);
 	inputShutdown();
 	soundShutdown();
 
 	_destroyWindow(window);
+	timerShutdown();
 
 	// UnRegister Window Class
 	UnregisterClass(CLASS_NAME, inst);
@@ -185,6 +310,167 @@ bool fwChangeResolution(GLWindow* window, uint32_t width, uint32_t height, uint3
 	return true;
 }
 
+/// @brief Create a GL context that renders into an offscreen framebuffer instead of a window,
+/// for running the real GL paths without showing anything. WGL still needs a hidden window for
+/// its device context, so this needs a display driver like any other context. offscreenEgl.c
+/// has the same calls for machines without one.
+/// The context is current on the calling thread when this returns
+/// @param app size and GL version, its draw and render functions are used by fwOffscreenFrame
+/// @return offscreen, NULL if no context could be made
+GLOffscreen* fwInitOffscreen(Application* app)
+{
+	GLOffscreen* offscreen = malloc(sizeof(GLOffscreen));
+	if (offscreen == NULL)
+		return NULL;
+	ZeroMemory(offscreen, sizeof(GLOffscreen));
+	offscreen->app = app;
+	offscreen->width = (int32_t)appGetWidth(app);
+	offscreen->height = (int32_t)appGetHeight(app);
+
+	timerInit();
+
+	// WGL needs a window for its device context, it's never shown and never drawn to
+	WNDCLASSEX windowClass;
+	ZeroMemory(&windowClass, sizeof(WNDCLASSEX));
+	windowClass.cbSize = sizeof(WNDCLASSEX);
+	windowClass.style = CS_OWNDC;
+	windowClass.lpfnWndProc = DefWindowProc;
+	windowClass.hInstance = appGetInstance(app);
+	windowClass.lpszClassName = OFFSCREEN_CLASS_NAME;
+	RegisterClassEx(&windowClass);
+
+	offscreen->hWnd = CreateWindowEx(0, OFFSCREEN_CLASS_NAME, appGetTitle(app), WS_POPUP,
+									 0, 0, 1, 1, HWND_DESKTOP, 0, appGetInstance(app), NULL);
+	offscreen->hDC = (offscreen->hWnd != 0) ? GetDC(offscreen->hWnd) : 0;
+	if (offscreen->hDC == 0 || !_setPixelFormat(offscreen->hDC, appGetBitsPerPixel(app), false))
+	{
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+	offscreen->hRC = wglCreateContext(offscreen->hDC);
+	if (offscreen->hRC == 0 || !wglMakeCurrent(offscreen->hDC, offscreen->hRC))
+	{
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+	if (appGetGLMajorVersion(app) >= 3)
+	{
+		_upgradeContext(offscreen->hDC, &offscreen->hRC, appGetGLMajorVersion(app), appGetGLMinorVersion(app));
+	}
+
+	// render into our own color and depth buffers, the window's are 1x1 and may not be owned by us
+	if (!_loadFramebufferFuncs(&offscreen->fbo))
+	{
+		printf("framework: offscreen rendering needs GL 3.0 or ARB_framebuffer_object\n");
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+	FramebufferFuncs* fbo = &offscreen->fbo;
+	fbo->GenFramebuffers(1, &offscreen->framebuffer);
+	fbo->BindFramebuffer(GL_FRAMEBUFFER, offscreen->framebuffer);
+	fbo->GenRenderbuffers(1, &offscreen->colorBuffer);
+	fbo->BindRenderbuffer(GL_RENDERBUFFER, offscreen->colorBuffer);
+	fbo->RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, offscreen->width, offscreen->height);
+	fbo->FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen->colorBuffer);
+	fbo->GenRenderbuffers(1, &offscreen->depthBuffer);
+	fbo->BindRenderbuffer(GL_RENDERBUFFER, offscreen->depthBuffer);
+	fbo->RenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, offscreen->width, offscreen->height);
+	fbo->FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreen->depthBuffer);
+	if (fbo->CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("framework: offscreen framebuffer incomplete\n");
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+
+	const float BG_RED = 0.0f;
+	const float BG_GREEN = 0.0f;
+	const float BG_BLUE = 0.0f;
+
+	glDrawInit(BG_RED, BG_GREEN, BG_BLUE);
+	glDrawResize(offscreen->width, offscreen->height);
+	printf("framework: offscreen %dx%d, %s %s\n", offscreen->width, offscreen->height,
+		   (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+	return offscreen;
+}
+
+/// @brief Draw one frame through the same calls the window loop makes, minus the swap
+/// @param offscreen 
+void fwOffscreenFrame(GLOffscreen* offscreen)
+{
+	glDrawStart(!appGetPreserveFrame(offscreen->app));
+	appDraw(offscreen->app);
+	appRender(offscreen->app);
+	glDrawEnd();
+}
+
+/// @brief Copy the last frame out, waiting for the GPU to finish it
+/// @param offscreen 
+/// @param rgb width * height * 3 bytes, rows top to bottom
+void fwOffscreenReadPixels(GLOffscreen* offscreen, uint8_t* rgb)
+{
+	const size_t stride = (size_t)offscreen->width * 3;
+
+	// GL rows are bottom to top, read into the end of the buffer and flip in place
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, offscreen->width, offscreen->height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+	for (int32_t top = 0, bottom = offscreen->height - 1; top < bottom; ++top, --bottom)
+	{
+		uint8_t* a = rgb + top * stride;
+		uint8_t* b = rgb + bottom * stride;
+		for (size_t i = 0; i < stride; ++i)
+		{
+			uint8_t t = a[i];
+			a[i] = b[i];
+			b[i] = t;
+		}
+	}
+}
+
+/// @brief Release the context and everything made for it
+/// @param offscreen 
+void fwShutdownOffscreen(GLOffscreen* offscreen)
+{
+	if (offscreen == NULL)
+		return;
+
+	if (offscreen->framebuffer != 0)
+	{
+		offscreen->fbo.BindFramebuffer(GL_FRAMEBUFFER, 0);
+		offscreen->fbo.DeleteFramebuffers(1, &offscreen->framebuffer);
+	}
+	if (offscreen->colorBuffer != 0)
+		offscreen->fbo.DeleteRenderbuffers(1, &offscreen->colorBuffer);
+	if (offscreen->depthBuffer != 0)
+		offscreen->fbo.DeleteRenderbuffers(1, &offscreen->depthBuffer);
+	if (offscreen->hRC != 0)
+	{
+		wglMakeCurrent(NULL, NULL);
+		wglDeleteContext(offscreen->hRC);
+	}
+	if (offscreen->hDC != 0)
+		ReleaseDC(offscreen->hWnd, offscreen->hDC);
+	if (offscreen->hWnd != 0)
+		DestroyWindow(offscreen->hWnd);
+	UnregisterClass(OFFSCREEN_CLASS_NAME, appGetInstance(offscreen->app));
+
+	timerShutdown();
+	free(offscreen);
+}
+
+/// @brief Look up a GL entry point beyond 1.1 in whichever context is current
+/// @param name 
+/// @return function, NULL if the context doesn't have it
+void* fwGetProcAddress(const char* name)
+{
+	PROC proc = wglGetProcAddress(name);
+	// some drivers return small values instead of NULL
+	if (proc == (PROC)1 || proc == (PROC)2 || proc == (PROC)3 || proc == (PROC)-1)
+		return NULL;
+	return (void*)proc;
+}
+
 /// @brief Registers a windows class (primarily for message handling)
 /// @param app 
 /// @return 
@@ -240,7 +526,7 @@ static GLWindow* _createWindow(Application* app)
 		}
 
 		// setup the default pixel format
-		if (!_setPixelFormat(window->hDC, appGetBitsPerPixel(app)))
+		if (!_setPixelFormat(window->hDC, appGetBitsPerPixel(app), appGetPreserveFrame(app)))
 		{
 			_destroyWindow(window);
 			return NULL;
@@ -261,6 +547,15 @@ static GLWindow* _createWindow(Application* app)
 			return NULL;
 		}
 
+		// Swap For A Newer Context If The Application Asked For One
+		if (appGetGLMajorVersion(app) >= 3)
+		{
+			_upgradeContext(window->hDC, &window->hRC, appGetGLMajorVersion(app), appGetGLMinorVersion(app));
+		}
+
+		// Let The Frame Limiter Or The Display Pace Us
+		_setSwapInterval(appGetVsync(app) ? 1 : 0);
+
 		// Make The Window Visible
 		ShowWindow(window->hWnd, SW_NORMAL);
 		window->isVisible = true;
@@ -268,8 +563,10 @@ static GLWindow* _createWindow(Application* app)
 		// Reshape Our GL Window
 		glDrawResize(appGetWidth(app), appGetHeight(app));
 
-		// Get Tick Count
-		window->lastTickCount = GetTickCount64();
+		// Start The Frame Clock
+		window->lastFrameTime = timerNowNanoseconds();
+		window->nextFrameTime = window->lastFrameTime / 1000;
+		_frameStatsReset(&window->stats, window->nextFrameTime);
 	}
 
 	return window;
@@ -343,8 +640,9 @@ static HWND _initializeWindowEx(GLWindow* window, Application* app)
 /// @brief Establish and set up the pixel format that will be used
 /// @param deviceContext 
 /// @param bitsPerPixel 
+/// @param preserveFrame ask for the back buffer to be copied rather than exchanged on swap
 /// @return 
-static bool _setPixelFormat(HDC deviceContext, uint32_t bitsPerPixel) 
+static bool _setPixelFormat(HDC deviceContext, uint32_t bitsPerPixel, bool preserveFrame) 
 {
 	PIXELFORMATDESCRIPTOR pfd =											// pfd Tells Windows How We Want Things To Be
 	{
@@ -352,7 +650,8 @@ static bool _setPixelFormat(HDC deviceContext, uint32_t bitsPerPixel)
 		1,																// Version Number
 		PFD_DRAW_TO_WINDOW |											// Format Must Support Window
 		PFD_SUPPORT_OPENGL |											// Format Must Support OpenGL
-		PFD_DOUBLEBUFFER,												// Must Support Double Buffering
+		PFD_DOUBLEBUFFER |												// Must Support Double Buffering
+		(preserveFrame ? PFD_SWAP_COPY : 0),							// Keep Back Buffer Contents On Swap
 		PFD_TYPE_RGBA,													// Request An RGBA Format
 		(BYTE)bitsPerPixel,												// Select Our Color Depth
 		0, 0, 0, 0, 0, 0,												// Color Bits Ignored
@@ -374,6 +673,351 @@ static bool _setPixelFormat(HDC deviceContext, uint32_t bitsPerPixel)
 	return SetPixelFormat(deviceContext, pixelFormat, &pfd);
 }
 
+/// @brief Turn vsync on or off, if the driver lets us
+/// @param interval number of vertical blanks per swap
+static void _setSwapInterval(int interval)
+{
+	SwapIntervalFunc swapInterval = (SwapIntervalFunc)wglGetProcAddress("wglSwapIntervalEXT");
+	if (swapInterval != NULL)
+	{
+		swapInterval(interval);
+	}
+}
+
+/// @brief Replace the legacy context with one of the given version. The compatibility profile
+/// is requested so fixed function code and SOIL keep working next to the newer paths.
+/// Keeps the legacy context if the driver can't provide it
+/// @param deviceContext 
+/// @param renderContext current legacy context, replaced on success
+/// @param major 
+/// @param minor 
+static void _upgradeContext(HDC deviceContext, HGLRC* renderContext, uint32_t major, uint32_t minor)
+{
+	CreateContextAttribsFunc createContextAttribs =
+		(CreateContextAttribsFunc)wglGetProcAddress("wglCreateContextAttribsARB");
+	if (createContextAttribs == NULL)
+	{
+		printf("framework: GL %u.%u unavailable, no WGL_ARB_create_context\n", major, minor);
+		return;
+	}
+
+	const int attribs[] = {
+		WGL_CONTEXT_MAJOR_VERSION_ARB, (int)major,
+		WGL_CONTEXT_MINOR_VERSION_ARB, (int)minor,
+		WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_COMPATIBILITY_PROFILE_BIT_ARB,
+		0
+	};
+	HGLRC context = createContextAttribs(deviceContext, NULL, attribs);
+	if (context == NULL || !wglMakeCurrent(deviceContext, context))
+	{
+		printf("framework: GL %u.%u context creation failed\n", major, minor);
+		if (context != NULL)
+			wglDeleteContext(context);
+		wglMakeCurrent(deviceContext, *renderContext);
+		return;
+	}
+
+	wglDeleteContext(*renderContext);
+	*renderContext = context;
+}
+
+/// @brief Dispatch every pending message, counting them and how long the oldest waited
+/// @param window 
+/// @return false once WM_QUIT arrives
+static bool _pumpMessages(GLWindow* window)
+{
+	MSG msg;
+	uint32_t events = 0;
+	uint32_t oldest = 0;
+	DWORD now = GetTickCount();
+
+	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) != 0)
+	{
+		if (msg.message == WM_QUIT)
+		{
+			return false;
+		}
+
+		// message times come from the same tick count, anything posted during the loop reads as 0
+		LONG age = (LONG)(now - msg.time);
+		oldest = max(oldest, (age > 0) ? (uint32_t)age : 0);
+		++events;
+		DispatchMessage(&msg);
+	}
+
+	FrameStats* stats = &window->stats;
+	stats->events += events;
+	stats->maxEvents = max(stats->maxEvents, events);
+	stats->maxEventAge = max(stats->maxEventAge, oldest);
+	return true;
+}
+
+/// @brief When the message being handled was queued, on the timer's clock. Message times are
+/// GetTickCount milliseconds, so this is only as fine as the system tick, but input is stamped
+/// when it happened rather than when the loop got round to dispatching it
+/// @return timerNowNanoseconds of the message
+static uint64_t _messageTime()
+{
+	static uint64_t last = 0;
+	uint64_t now = timerNowNanoseconds();
+	LONG age = (LONG)(GetTickCount() - (DWORD)GetMessageTime());
+	uint64_t time = (age > 0) ? now - min(now, (uint64_t)age * 1000000) : now;
+
+	// messages from the same tick read as the same age, keep them in the order they came
+	last = max(last, time);
+	return last;
+}
+
+/// @brief Hold the loop until the next frame is due when a frame rate cap is set
+/// @param window 
+static void _waitForNextFrame(GLWindow* window)
+{
+	uint32_t fps = appGetTargetFps(window->app);
+	if (fps == 0)
+	{
+		return;
+	}
+
+	uint64_t period = 1000000 / fps;
+	uint64_t now = timerNowMicroseconds();
+	window->nextFrameTime += period;
+
+	// after a long stall (loading, dragging the window) restart the schedule
+	// instead of rendering a burst of frames to catch up
+	if (window->nextFrameTime + period < now)
+	{
+		window->nextFrameTime = now;
+	}
+
+	timerSleepUntil(window->nextFrameTime);
+}
+
+/// @brief Start a new stats window
+/// @param stats 
+/// @param now 
+static void _frameStatsReset(FrameStats* stats, uint64_t now)
+{
+	ZeroMemory(stats, sizeof(FrameStats));
+	stats->windowStart = now;
+	stats->cpuStart = _processCpuTime();
+	stats->minInterval = UINT64_MAX;
+}
+
+/// @brief Accumulate a frame interval and periodically print how steady the frame rate was
+/// @param window 
+/// @param now 
+/// @param interval microseconds since the previous frame started
+static void _frameStatsRecord(GLWindow* window, uint64_t now, uint64_t interval)
+{
+	FrameStats* stats = &window->stats;
+	uint32_t fps = appGetTargetFps(window->app);
+	uint64_t period = (fps > 0) ? 1000000 / fps : 0;
+
+	stats->frames++;
+	stats->sum += (double)interval;
+	stats->sumSquares += (double)interval * (double)interval;
+	stats->minInterval = min(stats->minInterval, interval);
+	stats->maxInterval = max(stats->maxInterval, interval);
+	if (period > 0 && interval > period + FRAME_LATE_SLACK_US)
+	{
+		stats->lateFrames++;
+	}
+	if (stats->frames > 1)
+	{
+		uint64_t change = (interval > stats->lastInterval) ? interval - stats->lastInterval : stats->lastInterval - interval;
+		uint32_t bucket = 0;
+		while (bucket < FRAME_JITTER_BUCKETS && change >= FRAME_JITTER_LIMITS_US[bucket])
+		{
+			bucket++;
+		}
+		stats->jitter[bucket]++;
+	}
+	stats->lastInterval = interval;
+
+	uint64_t windowLength = now - stats->windowStart;
+	if (windowLength < FRAME_STATS_INTERVAL_US)
+	{
+		return;
+	}
+
+	double mean = stats->sum / stats->frames;
+	double variance = stats->sumSquares / stats->frames - mean * mean;
+	double jitter = (variance > 0.0) ? sqrt(variance) : 0.0;
+	// cpu time is in 100ns units, report it as a share of one core
+	double cpu = (double)(_processCpuTime() - stats->cpuStart) / 10.0 / (double)windowLength * 100.0;
+
+	printf("frame: %.2f ms avg (target %.2f ms), jitter %.3f ms, range %.2f-%.2f ms, %u late, cpu %.1f%%\n",
+		mean / 1000.0, period / 1000.0, jitter / 1000.0,
+		stats->minInterval / 1000.0, stats->maxInterval / 1000.0, stats->lateFrames, cpu);
+
+	printf("frame-to-frame change:");
+	for (uint32_t i = 0; i < FRAME_JITTER_BUCKETS; ++i)
+	{
+		printf(" <%.2gms %u", FRAME_JITTER_LIMITS_US[i] / 1000.0, stats->jitter[i]);
+	}
+	printf(" more %u\n", stats->jitter[FRAME_JITTER_BUCKETS]);
+	printf("input: %.1f messages per frame, at most %u, oldest waited %u ms\n",
+		(double)stats->events / stats->frames, stats->maxEvents, stats->maxEventAge);
+
+	_frameStatsReset(stats, now);
+}
+
+/// @brief Move the GL context to a new render thread. Done lazily from the update loop so
+/// the application can still load textures on the main thread during startup
+/// @param window 
+static void _startRenderThread(GLWindow* window)
+{
+	window->renderStop = 0;
+	window->framesProduced = 0;
+	window->frameReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	// a context can only be current on one thread at a time
+	wglMakeCurrent(NULL, NULL);
+	if (window->frameReady != NULL)
+	{
+		window->renderThread = CreateThread(NULL, 0, _renderThreadMain, window, 0, NULL);
+	}
+
+	if (window->renderThread == NULL)
+	{
+		// keep going single threaded
+		wglMakeCurrent(window->hDC, window->hRC);
+		if (window->frameReady != NULL)
+		{
+			CloseHandle(window->frameReady);
+			window->frameReady = NULL;
+		}
+		appSetRenderThread(window->app, false);
+	}
+}
+
+/// @brief Stop the render thread and take the GL context back
+/// @param window 
+static void _stopRenderThread(GLWindow* window)
+{
+	if (window->renderThread == NULL)
+	{
+		return;
+	}
+
+	InterlockedExchange(&window->renderStop, 1);
+	SetEvent(window->frameReady);
+	WaitForSingleObject(window->renderThread, INFINITE);
+
+	CloseHandle(window->renderThread);
+	CloseHandle(window->frameReady);
+	window->renderThread = NULL;
+	window->frameReady = NULL;
+
+	wglMakeCurrent(window->hDC, window->hRC);
+
+	// apply a resize the thread never got to
+	LONG64 resize = InterlockedExchange64(&window->pendingResize, 0);
+	if (resize != 0)
+	{
+		glDrawResize((int32_t)(resize >> 32), (int32_t)(resize & 0xFFFFFFFF));
+	}
+}
+
+/// @brief Owns the GL context while running. Submits and swaps each frame the update loop records
+/// @param param the window
+/// @return 
+static DWORD WINAPI _renderThreadMain(LPVOID param)
+{
+	GLWindow* window = (GLWindow*)param;
+	wglMakeCurrent(window->hDC, window->hRC);
+	PROFILE_THREAD("render");
+
+	ZeroMemory(&window->renderStats, sizeof(RenderStats));
+	window->renderStats.windowStart = timerNowMicroseconds();
+
+	while (WaitForSingleObject(window->frameReady, INFINITE) == WAIT_OBJECT_0 && !window->renderStop)
+	{
+		LONG64 resize = InterlockedExchange64(&window->pendingResize, 0);
+		if (resize != 0)
+		{
+			glDrawResize((int32_t)(resize >> 32), (int32_t)(resize & 0xFFFFFFFF));
+		}
+
+		glDrawStart(!appGetPreserveFrame(window->app));
+		uint64_t recordedAt = appRender(window->app);
+		glDrawEnd();
+
+		if (recordedAt != 0)
+		{
+			SwapBuffers(window->hDC);
+
+			uint64_t now = timerNowMicroseconds();
+			_renderStatsRecord(window, now, now - recordedAt);
+		}
+	}
+
+	wglMakeCurrent(NULL, NULL);
+	return 0;
+}
+
+/// @brief Accumulate the time from a frame being recorded to it being swapped, and
+/// periodically print it along with how many recorded frames made it to the screen
+/// @param window 
+/// @param now 
+/// @param latency microseconds
+static void _renderStatsRecord(GLWindow* window, uint64_t now, uint64_t latency)
+{
+	RenderStats* stats = &window->renderStats;
+	stats->presented++;
+	stats->latencySum += (double)latency;
+	stats->latencyMax = max(stats->latencyMax, latency);
+
+	uint64_t windowLength = now - stats->windowStart;
+	if (windowLength < FRAME_STATS_INTERVAL_US)
+	{
+		return;
+	}
+
+	LONG produced = window->framesProduced;
+	double seconds = windowLength / 1000000.0;
+	printf("render: %.1f fps presented of %.1f fps recorded, record to swap %.2f ms avg, %.2f ms max\n",
+		stats->presented / seconds, (produced - stats->producedStart) / seconds,
+		stats->latencySum / stats->presented / 1000.0, stats->latencyMax / 1000.0);
+
+	ZeroMemory(stats, sizeof(RenderStats));
+	stats->windowStart = now;
+	stats->producedStart = produced;
+}
+
+/// @brief Resize now, or hand the size to the render thread when it owns GL
+/// @param window 
+/// @param width 
+/// @param height 
+static void _resize(GLWindow* window, int32_t width, int32_t height)
+{
+	if (window->renderThread != NULL)
+	{
+		InterlockedExchange64(&window->pendingResize, ((LONG64)width << 32) | (uint32_t)height);
+		return;
+	}
+
+	glDrawResize(width, height);
+}
+
+/// @brief Total user and kernel time used by this process
+/// @return 100ns units
+static uint64_t _processCpuTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+	{
+		return 0;
+	}
+
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return k.QuadPart + u.QuadPart;
+}
+
 /// @brief Processes incoming windows messages
 /// @param hWnd 
 /// @param uMsg unused
@@ -419,12 +1063,12 @@ static LRESULT CALLBACK _messageHandler(HWND hWnd, UINT uMsg, WPARAM wParam, LPA
 
 				case SIZE_MAXIMIZED:									// Was Window Maximized?
 					window->isVisible = TRUE;							// Set isVisible To True
-					glDrawResize(LOWORD(lParam), HIWORD(lParam));		// Reshape Window - LoWord=Width, HiWord=Height
+					_resize(window, LOWORD(lParam), HIWORD(lParam));	// Reshape Window - LoWord=Width, HiWord=Height
 					return 0;
 
 				case SIZE_RESTORED:										// Was Window Restored?
 					window->isVisible = TRUE;							// Set isVisible To True
-					glDrawResize(LOWORD(lParam), HIWORD(lParam));		// Reshape Window - LoWord=Width, HiWord=Height
+					_resize(window, LOWORD(lParam), HIWORD(lParam));	// Reshape Window - LoWord=Width, HiWord=Height
 					return 0;
 			}
 			break;
@@ -433,14 +1077,32 @@ static LRESULT CALLBACK _messageHandler(HWND hWnd, UINT uMsg, WPARAM wParam, LPA
 		//	g_createFullScreen = (g_createFullScreen == TRUE) ? FALSE : TRUE;
 		//	PostMessage(hWnd, WM_QUIT, 0, 0);
 		//	break;
+	}
 
+	if (_inputMessage(uMsg, wParam, lParam))
+	{
+		return 0;
+	}
+
+	return DefWindowProc(hWnd, uMsg, wParam, lParam);					// Pass Unhandled Messages To DefWindowProc
+}
+
+/// @brief Hand a mouse or keyboard message to the input module, stamped with when it was queued
+/// @param uMsg
+/// @param wParam
+/// @param lParam
+/// @return false if it isn't input
+static bool _inputMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	switch (uMsg)
+	{
 		/***
 		 * Mouse inputs
 		 ***/
-		case WM_RBUTTONDOWN:	inputMouseUpdateButton(INPUT_BUTTON_RIGHT, true); return 0;
-		case WM_RBUTTONUP:		inputMouseUpdateButton(INPUT_BUTTON_RIGHT, false); return 0;
-		case WM_LBUTTONDOWN:	inputMouseUpdateButton(INPUT_BUTTON_LEFT, true); return 0;
-		case WM_LBUTTONUP:		inputMouseUpdateButton(INPUT_BUTTON_LEFT, false); return 0;
+		case WM_RBUTTONDOWN:	inputMouseInjectButton(INPUT_BUTTON_RIGHT, true, _messageTime()); return true;
+		case WM_RBUTTONUP:		inputMouseInjectButton(INPUT_BUTTON_RIGHT, false, _messageTime()); return true;
+		case WM_LBUTTONDOWN:	inputMouseInjectButton(INPUT_BUTTON_LEFT, true, _messageTime()); return true;
+		case WM_LBUTTONUP:		inputMouseInjectButton(INPUT_BUTTON_LEFT, false, _messageTime()); return true;
 
 		case WM_MOUSEMOVE:
 		{
@@ -448,8 +1110,8 @@ static LRESULT CALLBACK _messageHandler(HWND hWnd, UINT uMsg, WPARAM wParam, LPA
 			coord.x = (float)LOWORD(lParam);
 			coord.y = (float)HIWORD(lParam);
 
-			inputMouseUpdatePosition(coord);
-			return 0;
+			inputMouseInjectPosition(coord, _messageTime());
+			return true;
 		}
 
 		/***
@@ -459,21 +1121,56 @@ static LRESULT CALLBACK _messageHandler(HWND hWnd, UINT uMsg, WPARAM wParam, LPA
 			// Is Key (wParam) In A Valid Range?
 			if ((wParam >= 0) && (wParam <= 255))
 			{
-				inputKeyUpdate((uint8_t)wParam, true);
-				return 0;
+				inputKeyInject((uint8_t)wParam, true, _messageTime());
+				return true;
 			}
-			break;
+			return false;
 
 		case WM_KEYUP:
 			// Is Key (wParam) In A Valid Range?
 			if ((wParam >= 0) && (wParam <= 255))
 			{
-				inputKeyUpdate((uint8_t)wParam, false);
-				return 0;
+				inputKeyInject((uint8_t)wParam, false, _messageTime());
+				return true;
 			}
-			break;
+			return false;
 	}
 
-	return DefWindowProc(hWnd, uMsg, wParam, lParam);					// Pass Unhandled Messages To DefWindowProc
+	return false;
 }
 
+/// @brief A window procedure that takes input the way the game window does, for tools that
+/// post input to a window of their own
+/// @param hWnd
+/// @param uMsg
+/// @param wParam
+/// @param lParam
+/// @return
+LRESULT CALLBACK fwInputWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	if (_inputMessage(uMsg, wParam, lParam))
+	{
+		return 0;
+	}
+	return DefWindowProc(hWnd, uMsg, wParam, lParam);
+}
+
+/// @brief Fetch the framebuffer object entry points
+/// @param fbo 
+/// @return false if any is missing
+static bool _loadFramebufferFuncs(FramebufferFuncs* fbo)
+{
+	fbo->GenFramebuffers = fwGetProcAddress("glGenFramebuffers");
+	fbo->BindFramebuffer = fwGetProcAddress("glBindFramebuffer");
+	fbo->DeleteFramebuffers = fwGetProcAddress("glDeleteFramebuffers");
+	fbo->GenRenderbuffers = fwGetProcAddress("glGenRenderbuffers");
+	fbo->BindRenderbuffer = fwGetProcAddress("glBindRenderbuffer");
+	fbo->DeleteRenderbuffers = fwGetProcAddress("glDeleteRenderbuffers");
+	fbo->RenderbufferStorage = fwGetProcAddress("glRenderbufferStorage");
+	fbo->FramebufferRenderbuffer = fwGetProcAddress("glFramebufferRenderbuffer");
+	fbo->CheckFramebufferStatus = fwGetProcAddress("glCheckFramebufferStatus");
+
+	return fbo->GenFramebuffers != NULL && fbo->BindFramebuffer != NULL && fbo->DeleteFramebuffers != NULL &&
+		fbo->GenRenderbuffers != NULL && fbo->BindRenderbuffer != NULL && fbo->DeleteRenderbuffers != NULL &&
+		fbo->RenderbufferStorage != NULL && fbo->FramebufferRenderbuffer != NULL && fbo->CheckFramebufferStatus != NULL;
+}
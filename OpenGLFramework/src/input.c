@@ -1,27 +1,102 @@
 #include <Windows.h>
+#include <stdio.h>
+#include <string.h>
 #include "baseTypes.h"
 #include "input.h"
+#include "timer.h"
+
+// Every press, release and move since the last update is queued with its time, so several
+// clicks inside one frame each count. The held state and the edges since the last update are
+// kept as bitsets alongside. The queue and edges are cleared by inputFrameEnd once the update
+// has seen them, and everything here belongs to the thread running the window. A pointer
+// backend's thread only touches its own locked list of samples, which inputFrameBegin applies
+
+#define INPUT_MAX_EVENTS 1024
+#define INPUT_KEY_WORDS (256 / 32)
+#define INPUT_MAX_POINTER_SAMPLES 256
+
+#define INPUT_BIT_TEST(bits, index) (((bits)[(index) >> 5] >> ((index) & 31)) & 1)
+#define INPUT_BIT_SET(bits, index) ((bits)[(index) >> 5] |= (1u << ((index) & 31)))
+#define INPUT_BIT_CLEAR(bits, index) ((bits)[(index) >> 5] &= ~(1u << ((index) & 31)))
 
 /// @brief Keyboard state
 typedef struct {
-	bool keyDown[256];
+	uint32_t keyDown[INPUT_KEY_WORDS];
+	uint32_t keyPressed[INPUT_KEY_WORDS];		// went down since the last update
+	uint32_t keyReleased[INPUT_KEY_WORDS];		// went up since the last update
 } Keyboard;
 
-/// @brief Mouse state
+/// @brief Mouse state, one bit per InputButton
 typedef struct {
 	Coord2D position;
-	bool	buttons[INPUT_BUTTON_COUNT];
+	uint32_t buttons;
+	uint32_t pressed;
+	uint32_t released;
 } Mouse;
 
+/// @brief Everything that happened since the last update
+typedef struct {
+	InputEvent events[INPUT_MAX_EVENTS];
+	uint32_t count;
+	uint32_t dropped;		// since init, the edges are still kept when the queue is full
+	uint64_t frameTime;		// when the update seeing them started
+} EventQueue;
+
+/// @brief One reading from a pointer backend
+typedef struct {
+	Coord2D position;
+	uint32_t buttons;
+	uint64_t time;
+} PointerSample;
+
+/// @brief Samples waiting for the next update, and how long they waited
+typedef struct {
+	const InputPointerBackend* backend;
+	CRITICAL_SECTION lock;
+	PointerSample samples[INPUT_MAX_POINTER_SAMPLES];
+	uint32_t count;
+	uint32_t dropped;
+	uint32_t buttons;		// as of the last sample applied
+	uint64_t newest;		// arrival time of the last sample applied
+
+	uint64_t applied;
+	uint64_t waitSum;
+	uint64_t waitMax;
+} Pointer;
+
 static Keyboard s_Keyboard;
 static Mouse s_Mouse;
+static EventQueue s_Events;
+static Pointer s_Pointer;
+
+static void _inputPush(InputEventType type, uint8_t code, uint64_t timestamp);
+static void _inputMove(Coord2D coords, uint64_t timestamp);
+static void _inputPointerApply();
 
-/// @brief Retrieves the pressed state for a keyboard key
+/// @brief Retrieves the pressed state for a keyboard key. A key that went down and up again
+/// since the last update still reads as pressed for this one
 /// @param vkCode 
 /// @return 
 bool inputKeyPressed(char vkCode) 
 {
-	return s_Keyboard.keyDown[vkCode];
+	uint8_t key = (uint8_t)vkCode;
+	return INPUT_BIT_TEST(s_Keyboard.keyDown, key) || INPUT_BIT_TEST(s_Keyboard.keyPressed, key);
+}
+
+/// @brief Whether a keyboard key went down since the last update
+/// @param vkCode
+/// @return
+bool inputKeyPressedThisFrame(char vkCode)
+{
+	return INPUT_BIT_TEST(s_Keyboard.keyPressed, (uint8_t)vkCode);
+}
+
+/// @brief Whether a keyboard key went up since the last update
+/// @param vkCode
+/// @return
+bool inputKeyReleasedThisFrame(char vkCode)
+{
+	return INPUT_BIT_TEST(s_Keyboard.keyReleased, (uint8_t)vkCode);
 }
 
 /// @brief Retrieves the current mouse position
@@ -31,12 +106,53 @@ Coord2D inputMousePosition()
 	return s_Mouse.position;
 }
 
-/// @brief Retrieves the pressed state for a mouse button
+/// @brief Retrieves the pressed state for a mouse button. A click that was released again
+/// since the last update still reads as pressed for this one
 /// @param button 
 /// @return 
 bool inputMousePressed(InputButton button) 
 {
-	return s_Mouse.buttons[button];
+	return ((s_Mouse.buttons | s_Mouse.pressed) >> button) & 1;
+}
+
+/// @brief Whether a mouse button went down since the last update
+/// @param button 
+/// @return
+bool inputMousePressedThisFrame(InputButton button)
+{
+	return (s_Mouse.pressed >> button) & 1;
+}
+
+/// @brief Whether a mouse button went up since the last update
+/// @param button
+/// @return
+bool inputMouseReleasedThisFrame(InputButton button)
+{
+	return (s_Mouse.released >> button) & 1;
+}
+
+/// @brief Everything that happened since the last update, oldest first
+/// @param count set to the number of events
+/// @return
+const InputEvent* inputEvents(uint32_t* count)
+{
+	*count = s_Events.count;
+	return s_Events.events;
+}
+
+/// @brief When the current update started, on the same clock as the event timestamps. The
+/// update brings the game up to this time, so anything queued happened before it
+/// @return
+uint64_t inputFrameTime()
+{
+	return s_Events.frameTime;
+}
+
+/// @brief Events that didn't fit in the queue since init
+/// @return
+uint32_t inputDroppedEvents()
+{
+	return s_Events.dropped;
 }
 
 /// @brief Input system initialization
@@ -44,36 +160,268 @@ void inputInit()
 {
 	ZeroMemory(&s_Keyboard, sizeof(Keyboard));
 	ZeroMemory(&s_Mouse, sizeof(Mouse));
+	ZeroMemory(&s_Events, sizeof(EventQueue));
 }
 
 /// @brief Input system shutdown
 void inputShutdown() 
 {
+	inputPointerStop();
 	ZeroMemory(&s_Keyboard, sizeof(Keyboard));
 	ZeroMemory(&s_Mouse, sizeof(Mouse));
+	ZeroMemory(&s_Events, sizeof(EventQueue));
 }
 
-/// @brief Updates the pressed state of a keyboard key
+/// @brief Note the time the update about to run brings the game up to
+/// @param timestamp timerNowNanoseconds, or the simulated equivalent
+void inputFrameBegin(uint64_t timestamp)
+{
+	s_Events.frameTime = timestamp;
+	_inputPointerApply();
+}
+
+/// @brief Forget the events and edges the update has now seen
+void inputFrameEnd()
+{
+	ZeroMemory(s_Keyboard.keyPressed, sizeof(s_Keyboard.keyPressed));
+	ZeroMemory(s_Keyboard.keyReleased, sizeof(s_Keyboard.keyReleased));
+	s_Mouse.pressed = 0;
+	s_Mouse.released = 0;
+	s_Events.count = 0;
+}
+
+/// @brief Updates the pressed state of a keyboard key, as of now
 /// @param vkCode 
 /// @param pressed 
 void inputKeyUpdate(uint8_t vkCode, bool pressed) 
 {
-	s_Keyboard.keyDown[vkCode] = pressed;
+	inputKeyInject(vkCode, pressed, timerNowNanoseconds());
+}
+
+/// @brief Updates the pressed state of a keyboard key with the time it happened. Auto-repeat
+/// is ignored
+/// @param vkCode
+/// @param pressed
+/// @param timestamp timerNowNanoseconds, or the simulated equivalent
+void inputKeyInject(uint8_t vkCode, bool pressed, uint64_t timestamp)
+{
+	if (INPUT_BIT_TEST(s_Keyboard.keyDown, vkCode) == (uint32_t)pressed)
+		return;
+
+	if (pressed)
+	{
+		INPUT_BIT_SET(s_Keyboard.keyDown, vkCode);
+		INPUT_BIT_SET(s_Keyboard.keyPressed, vkCode);
+	}
+	else
+	{
+		INPUT_BIT_CLEAR(s_Keyboard.keyDown, vkCode);
+		INPUT_BIT_SET(s_Keyboard.keyReleased, vkCode);
+	}
+	_inputPush(pressed ? INPUT_EVENT_KEY_DOWN : INPUT_EVENT_KEY_UP, vkCode, timestamp);
 }
 
 /// @brief Updates the coordinates of the mouse
 /// @param coords 
 void inputMouseUpdatePosition(Coord2D coords) 
 {
-	s_Mouse.position = coords;
+	_inputMove(coords, timerNowNanoseconds());
 }
 
-/// @brief Updates the pressed state of a mouse button
+/// @brief Updates the coordinates of the mouse with the time it got there
+/// @param coords
+/// @param timestamp timerNowNanoseconds, or the simulated equivalent
+void inputMouseInjectPosition(Coord2D coords, uint64_t timestamp)
+{
+	_inputMove(coords, timestamp);
+}
+
+/// @brief Updates the pressed state of a mouse button, as of now
 /// @param button 
 /// @param pressed 
 void inputMouseUpdateButton(InputButton button, bool pressed)
 {
-	s_Mouse.buttons[button] = pressed;
+	inputMouseInjectButton(button, pressed, timerNowNanoseconds());
+}
+
+/// @brief Updates the pressed state of a mouse button with the time it happened, for input
+/// that was queued elsewhere or synthesized on a simulated clock
+/// @param button 
+/// @param pressed 
+/// @param timestamp timerNowNanoseconds, or the simulated equivalent
+void inputMouseInjectButton(InputButton button, bool pressed, uint64_t timestamp)
+{
+	uint32_t bit = 1u << button;
+	if (((s_Mouse.buttons & bit) != 0) == pressed)
+		return;
+
+	if (pressed)
+	{
+		s_Mouse.buttons |= bit;
+		s_Mouse.pressed |= bit;
+	}
+	else
+	{
+		s_Mouse.buttons &= ~bit;
+		s_Mouse.released |= bit;
+	}
+	_inputPush(pressed ? INPUT_EVENT_BUTTON_DOWN : INPUT_EVENT_BUTTON_UP, (uint8_t)button, timestamp);
+}
+
+/// @brief Start reading a pointer backend, its samples move the mouse and press its buttons
+/// @param backend
+/// @param config passed to the backend's start
+/// @return false if one is already running or it couldn't start
+bool inputPointerStart(const InputPointerBackend* backend, const void* config)
+{
+	if (s_Pointer.backend != NULL)
+		return false;
+
+	ZeroMemory(&s_Pointer, sizeof(Pointer));
+	InitializeCriticalSection(&s_Pointer.lock);
+	s_Pointer.backend = backend;
+	if (!backend->start(config))
+	{
+		printf("input: pointer backend %s didn't start\n", backend->name);
+		s_Pointer.backend = NULL;
+		DeleteCriticalSection(&s_Pointer.lock);
+		return false;
+	}
+	return true;
+}
+
+/// @brief Stop the pointer backend, waiting for its thread. The numbers stay for inputPointerReport
+void inputPointerStop()
+{
+	if (s_Pointer.backend == NULL)
+		return;
+
+	s_Pointer.backend->stop();
+	s_Pointer.backend = NULL;
+	DeleteCriticalSection(&s_Pointer.lock);
+}
+
+/// @brief Whether a pointer backend is running
+/// @return
+bool inputPointerActive()
+{
+	return s_Pointer.backend != NULL;
+}
+
+/// @brief When the newest pointer sample applied so far arrived
+/// @return timerNowNanoseconds, 0 if there hasn't been one
+uint64_t inputPointerNewestSample()
+{
+	return s_Pointer.newest;
+}
+
+/// @brief Print how long pointer samples waited between arriving and being applied
+void inputPointerReport()
+{
+	if (s_Pointer.applied == 0)
+		return;
+
+	printf("input: %llu pointer samples, applied %.2f ms avg %.2f ms max after arriving, %u dropped\n",
+		   (unsigned long long)s_Pointer.applied, s_Pointer.waitSum / 1000000.0 / s_Pointer.applied,
+		   s_Pointer.waitMax / 1000000.0, s_Pointer.dropped);
+}
+
+/// @brief Hand over a pointer sample. Called on the backend's thread
+/// @param position in window coordinates
+/// @param buttons one bit per InputButton held
+/// @param sampleTime timerNowNanoseconds when it arrived
+void inputPointerSample(Coord2D position, uint32_t buttons, uint64_t sampleTime)
+{
+	EnterCriticalSection(&s_Pointer.lock);
+	if (s_Pointer.count < INPUT_MAX_POINTER_SAMPLES)
+	{
+		PointerSample* sample = &s_Pointer.samples[s_Pointer.count++];
+		sample->position = position;
+		sample->buttons = buttons;
+		sample->time = sampleTime;
+	}
+	else
+	{
+		s_Pointer.dropped++;
+	}
+	LeaveCriticalSection(&s_Pointer.lock);
+}
+
+/// @brief Turn the waiting pointer samples into moves and button events, in arrival order
+static void _inputPointerApply()
+{
+	PointerSample samples[INPUT_MAX_POINTER_SAMPLES];
+	uint32_t count;
+
+	if (s_Pointer.backend == NULL)
+		return;
+	if (s_Pointer.backend->poll != NULL)
+	{
+		s_Pointer.backend->poll(s_Events.frameTime);
+	}
+
+	EnterCriticalSection(&s_Pointer.lock);
+	count = s_Pointer.count;
+	memcpy(samples, s_Pointer.samples, count * sizeof(PointerSample));
+	s_Pointer.count = 0;
+	LeaveCriticalSection(&s_Pointer.lock);
+
+	uint64_t now = timerNowNanoseconds();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const PointerSample* sample = &samples[i];
+		_inputMove(sample->position, sample->time);
+		for (uint32_t button = 0; button < INPUT_BUTTON_COUNT; ++button)
+		{
+			uint32_t bit = 1u << button;
+			if ((sample->buttons ^ s_Pointer.buttons) & bit)
+			{
+				inputMouseInjectButton((InputButton)button, (sample->buttons & bit) != 0, sample->time);
+			}
+		}
+		s_Pointer.buttons = sample->buttons;
+		s_Pointer.newest = sample->time;
+
+		uint64_t wait = (now > sample->time) ? now - sample->time : 0;
+		s_Pointer.applied++;
+		s_Pointer.waitSum += wait;
+		s_Pointer.waitMax = max(s_Pointer.waitMax, wait);
+	}
 }
 
+/// @brief Move the mouse, queueing the move
+/// @param coords
+/// @param timestamp
+static void _inputMove(Coord2D coords, uint64_t timestamp)
+{
+	s_Mouse.position = coords;
 
+	// only the latest of a run of moves matters
+	if (s_Events.count > 0 && s_Events.events[s_Events.count - 1].type == INPUT_EVENT_MOVE)
+	{
+		InputEvent* event = &s_Events.events[s_Events.count - 1];
+		event->position = coords;
+		event->timestamp = timestamp;
+		return;
+	}
+	_inputPush(INPUT_EVENT_MOVE, 0, timestamp);
+}
+
+/// @brief Queue an event at the current mouse position
+/// @param type
+/// @param code
+/// @param timestamp
+static void _inputPush(InputEventType type, uint8_t code, uint64_t timestamp)
+{
+	if (s_Events.count == INPUT_MAX_EVENTS)
+	{
+		s_Events.dropped++;
+		return;
+	}
+
+	InputEvent* event = &s_Events.events[s_Events.count++];
+	event->type = type;
+	event->code = code;
+	event->position = s_Mouse.position;
+	event->timestamp = timestamp;
+}
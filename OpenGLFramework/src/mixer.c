@@ -0,0 +1,640 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <immintrin.h>
+#define MIXER_SSE
+#endif
+#include "mixer.h"
+#include "timer.h"
+#include "profile.h"
+
+// A software mixer, for when there's no XAudio2 to play each clip on its own voice, or the
+// output has to be captured. Clips are converted to float stereo at the mixer's rate when they
+// load, so mixing a voice is one multiply-add per sample, 4 or 8 at a time. A thread mixes
+// blocks into a ring and hands each to the sink: the null sink for headless runs, a WAV file,
+// or the device through sound.c. Only the lock, the thread and the sleep touch the OS, through
+// the shim at the bottom, so the mix builds and can be checked off Windows too
+
+#define MIXER_MAX_CLIPS 64
+#define MIXER_MAX_VOICES 32
+#define MIXER_BLOCK_NS (MIXER_BLOCK_FRAMES * 1000000000ull / MIXER_SAMPLE_RATE)
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION MixerLock;
+typedef HANDLE MixerThread;
+#else
+typedef pthread_mutex_t MixerLock;
+typedef pthread_t MixerThread;
+#endif
+
+typedef struct mixer_clip_t {
+    float* samples;         // interleaved, MIXER_CHANNELS per frame
+    uint32_t frames;
+} MixerClip;
+
+typedef struct mixer_voice_t {
+    int32_t clipId;         // MIXER_NOCLIP when free
+    uint32_t position;      // frames played
+    float gain;
+    int32_t priority;
+    uint64_t started;       // order of the plays, for stealing the oldest
+} MixerVoice;
+
+static struct mixer_t {
+    MixerLock lock;         // clips load on loader threads and play on the main thread while the mixer thread reads them
+    MixerClip clips[MIXER_MAX_CLIPS];
+    MixerVoice voices[MIXER_MAX_VOICES];
+    uint64_t plays;
+    bool simd;
+
+    // output
+    const MixerSink* sink;
+    MixerThread thread;
+    volatile bool stopping;
+    float* ring;
+
+    // stats
+    uint64_t blocks;
+    uint64_t mixTime;       // nanoseconds
+    uint64_t voiceFrames;   // frames mixed, summed over voices
+    uint32_t steals;
+    uint32_t dropped;
+} _mixer;
+
+static void _mixerAccumulate(float* out, const float* in, uint32_t count, float gain);
+static void _mixerAccumulateScalar(float* out, const float* in, uint32_t count, float gain);
+static float _mixerReadSample(const uint8_t* data, uint16_t format, uint16_t bitsPerSample, uint32_t index);
+static void _mixerThread();
+static void _mixerLockInit(MixerLock* lock);
+static void _mixerLockFree(MixerLock* lock);
+static void _mixerLock(MixerLock* lock);
+static void _mixerUnlock(MixerLock* lock);
+static bool _mixerThreadStart(MixerThread* thread);
+static void _mixerThreadJoin(MixerThread thread);
+static void _mixerSleepMs(uint32_t milliseconds);
+
+/**
+ * @brief Set up an empty mixer. Nothing is output until mixerStart
+ * @return
+*/
+bool mixerInit() {
+    memset(&_mixer, 0, sizeof(_mixer));
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        _mixer.voices[i].clipId = MIXER_NOCLIP;
+    }
+    _mixer.simd = true;
+    _mixerLockInit(&_mixer.lock);
+    return true;
+}
+
+/**
+ * @brief Stop the output and free every clip
+*/
+void mixerShutdown() {
+    mixerStop();
+    for (int32_t i = 0; i < MIXER_MAX_CLIPS; ++i)
+    {
+        mixerRemoveClip(i);
+    }
+    _mixerLockFree(&_mixer.lock);
+}
+
+/**
+ * @brief Open a sink and start mixing into it on a thread
+ * @param sink
+ * @param config passed to the sink's open
+ * @return false if the sink wouldn't open
+*/
+bool mixerStart(const MixerSink* sink, const void* config) {
+    if (_mixer.sink != NULL)
+        return false;
+
+    _mixer.ring = malloc(MIXER_RING_BLOCKS * MIXER_BLOCK_FRAMES * MIXER_CHANNELS * sizeof(float));
+    if (_mixer.ring == NULL)
+        return false;
+    if (!sink->open(config)) {
+        free(_mixer.ring);
+        _mixer.ring = NULL;
+        return false;
+    }
+
+    _mixer.sink = sink;
+    _mixer.stopping = false;
+    if (!_mixerThreadStart(&_mixer.thread)) {
+        sink->close();
+        _mixer.sink = NULL;
+        free(_mixer.ring);
+        _mixer.ring = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Finish the block being mixed and close the sink
+*/
+void mixerStop() {
+    if (_mixer.sink == NULL)
+        return;
+
+    _mixer.stopping = true;
+    _mixerThreadJoin(_mixer.thread);
+    _mixer.sink->close();
+    _mixer.sink = NULL;
+    free(_mixer.ring);
+    _mixer.ring = NULL;
+}
+
+/**
+ * @brief Convert a clip to the mixer's format. Safe to call from loader threads
+ * @param data samples as they were in the file
+ * @param bytes
+ * @param format MIXER_FORMAT_PCM (8 or 16 bit) or MIXER_FORMAT_FLOAT (32 bit)
+ * @param channels 1 or 2
+ * @param sampleRate resampled linearly to MIXER_SAMPLE_RATE
+ * @param bitsPerSample
+ * @return clip id, MIXER_NOCLIP if the format isn't supported or there's no room
+*/
+int32_t mixerAddClip(const void* data, uint32_t bytes, uint16_t format, uint16_t channels,
+                     uint32_t sampleRate, uint16_t bitsPerSample) {
+    bool supported = (format == MIXER_FORMAT_PCM && (bitsPerSample == 8 || bitsPerSample == 16)) ||
+                     (format == MIXER_FORMAT_FLOAT && bitsPerSample == 32);
+    if (!supported || channels == 0 || channels > MIXER_CHANNELS || sampleRate == 0)
+        return MIXER_NOCLIP;
+
+    uint32_t sourceFrames = bytes / (channels * bitsPerSample / 8);
+    uint32_t frames = (uint32_t)((uint64_t)sourceFrames * MIXER_SAMPLE_RATE / sampleRate);
+    if (frames == 0)
+        return MIXER_NOCLIP;
+    float* samples = malloc(frames * MIXER_CHANNELS * sizeof(float));
+    if (samples == NULL)
+        return MIXER_NOCLIP;
+
+    const double step = (double)sampleRate / MIXER_SAMPLE_RATE;
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        double at = i * step;
+        uint32_t first = (uint32_t)at;
+        uint32_t second = (first + 1 < sourceFrames) ? first + 1 : first;
+        float t = (float)(at - first);
+        for (uint32_t c = 0; c < MIXER_CHANNELS; ++c)
+        {
+            uint32_t channel = (c < channels) ? c : channels - 1;
+            float a = _mixerReadSample(data, format, bitsPerSample, first * channels + channel);
+            float b = _mixerReadSample(data, format, bitsPerSample, second * channels + channel);
+            samples[i * MIXER_CHANNELS + c] = a + (b - a) * t;
+        }
+    }
+
+    int32_t clipId = MIXER_NOCLIP;
+    _mixerLock(&_mixer.lock);
+    for (int32_t i = 0; i < MIXER_MAX_CLIPS; ++i)
+    {
+        if (_mixer.clips[i].samples == NULL)
+        {
+            _mixer.clips[i].samples = samples;
+            _mixer.clips[i].frames = frames;
+            clipId = i;
+            break;
+        }
+    }
+    _mixerUnlock(&_mixer.lock);
+
+    if (clipId == MIXER_NOCLIP)
+        free(samples);
+    return clipId;
+}
+
+/**
+ * @brief Stop a clip and free it
+ * @param clipId
+*/
+void mixerRemoveClip(int32_t clipId) {
+    if (clipId == MIXER_NOCLIP)
+        return;
+
+    _mixerLock(&_mixer.lock);
+    float* samples = _mixer.clips[clipId].samples;
+    _mixer.clips[clipId].samples = NULL;
+    _mixer.clips[clipId].frames = 0;
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        if (_mixer.voices[i].clipId == clipId)
+            _mixer.voices[i].clipId = MIXER_NOCLIP;
+    }
+    _mixerUnlock(&_mixer.lock);
+    free(samples);
+}
+
+/**
+ * @brief Start a clip on a free voice, or steal the lowest priority, oldest one. Dropped when
+ * every voice is playing something of higher priority
+ * @param clipId
+ * @param gain 1 plays the clip as it is
+ * @param priority
+ * @return false if the play was dropped
+*/
+bool mixerPlay(int32_t clipId, float gain, int32_t priority) {
+    if (clipId == MIXER_NOCLIP)
+        return false;
+
+    _mixerLock(&_mixer.lock);
+    MixerVoice* chosen = NULL;
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        MixerVoice* voice = &_mixer.voices[i];
+        if (voice->clipId == MIXER_NOCLIP)
+        {
+            chosen = voice;
+            break;
+        }
+        if (voice->priority <= priority &&
+            (chosen == NULL || voice->priority < chosen->priority ||
+             (voice->priority == chosen->priority && voice->started < chosen->started)))
+            chosen = voice;
+    }
+    if (chosen == NULL) {
+        _mixer.dropped++;
+    }
+    else {
+        if (chosen->clipId != MIXER_NOCLIP)
+            _mixer.steals++;
+        chosen->clipId = clipId;
+        chosen->position = 0;
+        chosen->gain = gain;
+        chosen->priority = priority;
+        chosen->started = ++_mixer.plays;
+    }
+    _mixerUnlock(&_mixer.lock);
+    return chosen != NULL;
+}
+
+/**
+ * @brief Stop every voice playing the clip
+ * @param clipId
+*/
+void mixerStopClip(int32_t clipId) {
+    if (clipId == MIXER_NOCLIP)
+        return;
+
+    _mixerLock(&_mixer.lock);
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        if (_mixer.voices[i].clipId == clipId)
+            _mixer.voices[i].clipId = MIXER_NOCLIP;
+    }
+    _mixerUnlock(&_mixer.lock);
+}
+
+/**
+ * @brief Number of voices playing the clip
+ * @param clipId
+ * @return
+*/
+uint32_t mixerCountClip(int32_t clipId) {
+    uint32_t count = 0;
+    _mixerLock(&_mixer.lock);
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        if (_mixer.voices[i].clipId == clipId)
+            ++count;
+    }
+    _mixerUnlock(&_mixer.lock);
+    return count;
+}
+
+/**
+ * @brief Stop one of the voices playing the clip to make room for another
+ * @param clipId
+ * @param quietest the one with the lowest gain, otherwise the oldest
+*/
+void mixerStealClip(int32_t clipId, bool quietest) {
+    _mixerLock(&_mixer.lock);
+    MixerVoice* victim = NULL;
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        MixerVoice* voice = &_mixer.voices[i];
+        if (voice->clipId != clipId)
+            continue;
+        if (victim == NULL || (quietest && voice->gain < victim->gain) ||
+            ((!quietest || voice->gain == victim->gain) && voice->started < victim->started))
+            victim = voice;
+    }
+    if (victim != NULL)
+        victim->clipId = MIXER_NOCLIP;
+    _mixerUnlock(&_mixer.lock);
+}
+
+/**
+ * @brief Mix the playing voices into the next frames of output, moving them on. The mixer
+ * thread calls this for each block, and benchmarks can call it directly without a sink
+ * @param samples interleaved, MIXER_CHANNELS per frame, overwritten
+ * @param frames
+*/
+void mixerRender(float* samples, uint32_t frames) {
+    PROFILE_BEGIN("mixerRender");
+    uint64_t start = timerNowNanoseconds();
+    memset(samples, 0, frames * MIXER_CHANNELS * sizeof(float));
+
+    _mixerLock(&_mixer.lock);
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        MixerVoice* voice = &_mixer.voices[i];
+        if (voice->clipId == MIXER_NOCLIP)
+            continue;
+
+        const MixerClip* clip = &_mixer.clips[voice->clipId];
+        uint32_t count = clip->frames - voice->position;
+        if (count > frames)
+            count = frames;
+        const float* in = clip->samples + voice->position * MIXER_CHANNELS;
+        if (_mixer.simd)
+            _mixerAccumulate(samples, in, count * MIXER_CHANNELS, voice->gain);
+        else
+            _mixerAccumulateScalar(samples, in, count * MIXER_CHANNELS, voice->gain);
+
+        voice->position += count;
+        _mixer.voiceFrames += count;
+        if (voice->position >= clip->frames)
+            voice->clipId = MIXER_NOCLIP;
+    }
+    _mixerUnlock(&_mixer.lock);
+
+    _mixer.mixTime += timerNowNanoseconds() - start;
+    PROFILE_END();
+}
+
+/**
+ * @brief Mix with SSE/AVX, or one sample at a time for comparison
+ * @param enabled
+*/
+void mixerSetSimd(bool enabled) {
+    _mixer.simd = enabled;
+}
+
+/**
+ * @brief Number of voices playing a clip
+ * @return
+*/
+uint32_t mixerGetActiveVoices() {
+    uint32_t active = 0;
+    for (uint32_t i = 0; i < MIXER_MAX_VOICES; ++i)
+    {
+        if (_mixer.voices[i].clipId != MIXER_NOCLIP)
+            ++active;
+    }
+    return active;
+}
+
+/**
+ * @brief Print how much audio was mixed and what a voice costs. Resets the stats
+*/
+void mixerReport() {
+    double voiceSeconds = _mixer.voiceFrames / (double)MIXER_SAMPLE_RATE;
+    printf("mixer: %llu blocks to %s, %.1f voice seconds mixed, %.2f us per voice per second of audio, %u stolen, %u dropped\n",
+        (unsigned long long)_mixer.blocks, (_mixer.sink != NULL) ? _mixer.sink->name : "no sink", voiceSeconds,
+        (voiceSeconds > 0.0) ? _mixer.mixTime / voiceSeconds / 1000.0 : 0.0, _mixer.steals, _mixer.dropped);
+    _mixer.blocks = 0;
+    _mixer.mixTime = 0;
+    _mixer.voiceFrames = 0;
+    _mixer.steals = 0;
+    _mixer.dropped = 0;
+}
+
+/**
+ * @brief out += in * gain
+ * @param out
+ * @param in
+ * @param count samples, not frames
+ * @param gain
+*/
+static void _mixerAccumulate(float* out, const float* in, uint32_t count, float gain) {
+    uint32_t i = 0;
+#ifdef __AVX__
+    __m256 gain8 = _mm256_set1_ps(gain);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_loadu_ps(in + i), gain8));
+        _mm256_storeu_ps(out + i, mixed);
+    }
+#endif
+#ifdef MIXER_SSE
+    __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), gain4));
+        _mm_storeu_ps(out + i, mixed);
+    }
+#endif
+    _mixerAccumulateScalar(out + i, in + i, count - i, gain);
+}
+
+static void _mixerAccumulateScalar(float* out, const float* in, uint32_t count, float gain) {
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        out[i] += in[i] * gain;
+    }
+}
+
+/**
+ * @brief One sample of a clip as it was loaded, as a float in -1..1
+ * @param data
+ * @param format
+ * @param bitsPerSample
+ * @param index samples, not frames
+ * @return
+*/
+static float _mixerReadSample(const uint8_t* data, uint16_t format, uint16_t bitsPerSample, uint32_t index) {
+    if (format == MIXER_FORMAT_FLOAT) {
+        float sample;
+        memcpy(&sample, data + index * sizeof(float), sizeof(float));
+        return sample;
+    }
+    if (bitsPerSample == 8)
+        return (data[index] - 128) / 128.0f;
+
+    int16_t sample;
+    memcpy(&sample, data + index * sizeof(int16_t), sizeof(int16_t));
+    return sample / 32768.0f;
+}
+
+/**
+ * @brief Mix a block into the ring and hand it to the sink, until stopped. A sink that doesn't
+ * wait for a device is kept to real time, a ring ahead
+*/
+static void _mixerThread() {
+    PROFILE_THREAD("mixer");
+    uint64_t start = timerNowNanoseconds();
+    uint64_t block = 0;
+    while (!_mixer.stopping)
+    {
+        float* samples = _mixer.ring + (block % MIXER_RING_BLOCKS) * MIXER_BLOCK_FRAMES * MIXER_CHANNELS;
+        mixerRender(samples, MIXER_BLOCK_FRAMES);
+        _mixer.sink->write(samples, MIXER_BLOCK_FRAMES);
+        _mixer.blocks++;
+        ++block;
+
+        if (!_mixer.sink->paced && block >= MIXER_RING_BLOCKS)
+        {
+            uint64_t due = start + (block - MIXER_RING_BLOCKS) * MIXER_BLOCK_NS;
+            while (!_mixer.stopping && timerNowNanoseconds() < due)
+            {
+                _mixerSleepMs(1);
+            }
+        }
+    }
+}
+
+// Null sink, for headless runs and benchmarks
+
+static bool _mixerNullOpen(const void* config) { return true; }
+static void _mixerNullWrite(const float* samples, uint32_t frames) {}
+static void _mixerNullClose() {}
+
+static const MixerSink _mixerNull = {
+    "null",
+    _mixerNullOpen,
+    _mixerNullWrite,
+    _mixerNullClose,
+    false
+};
+
+/**
+ * @brief A sink that throws the mix away
+ * @return
+*/
+const MixerSink* mixerNullSink() {
+    return &_mixerNull;
+}
+
+// WAV sink, writing 32-bit float. The sizes in the header are filled in on close
+
+static struct mixer_wav_t {
+    FILE* file;
+    uint32_t dataBytes;
+} _mixerWav;
+
+static void _mixerWavHeader(uint32_t dataBytes) {
+    const uint16_t format = MIXER_FORMAT_FLOAT, channels = MIXER_CHANNELS, bits = 32;
+    const uint16_t blockAlign = MIXER_CHANNELS * sizeof(float);
+    const uint32_t rate = MIXER_SAMPLE_RATE, byteRate = MIXER_SAMPLE_RATE * blockAlign;
+    const uint32_t fmtBytes = 16, riffBytes = 4 + 8 + fmtBytes + 8 + dataBytes;
+
+    fseek(_mixerWav.file, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, _mixerWav.file);
+    fwrite(&riffBytes, 4, 1, _mixerWav.file);
+    fwrite("WAVEfmt ", 1, 8, _mixerWav.file);
+    fwrite(&fmtBytes, 4, 1, _mixerWav.file);
+    fwrite(&format, 2, 1, _mixerWav.file);
+    fwrite(&channels, 2, 1, _mixerWav.file);
+    fwrite(&rate, 4, 1, _mixerWav.file);
+    fwrite(&byteRate, 4, 1, _mixerWav.file);
+    fwrite(&blockAlign, 2, 1, _mixerWav.file);
+    fwrite(&bits, 2, 1, _mixerWav.file);
+    fwrite("data", 1, 4, _mixerWav.file);
+    fwrite(&dataBytes, 4, 1, _mixerWav.file);
+}
+
+/**
+ * @brief
+ * @param config the file name
+ * @return
+*/
+static bool _mixerWavOpen(const void* config) {
+    _mixerWav.file = fopen((const char*)config, "wb");
+    if (_mixerWav.file == NULL) {
+        printf("mixer: can't write %s\n", (const char*)config);
+        return false;
+    }
+    _mixerWav.dataBytes = 0;
+    _mixerWavHeader(0);
+    return true;
+}
+
+static void _mixerWavWrite(const float* samples, uint32_t frames) {
+    _mixerWav.dataBytes += (uint32_t)(fwrite(samples, sizeof(float) * MIXER_CHANNELS, frames, _mixerWav.file) *
+                                      sizeof(float) * MIXER_CHANNELS);
+}
+
+static void _mixerWavClose() {
+    _mixerWavHeader(_mixerWav.dataBytes);
+    fclose(_mixerWav.file);
+    _mixerWav.file = NULL;
+}
+
+static const MixerSink _mixerWavSink = {
+    "wav",
+    _mixerWavOpen,
+    _mixerWavWrite,
+    _mixerWavClose,
+    false
+};
+
+/**
+ * @brief A sink that records the mix to a WAV file, named in the config
+ * @return
+*/
+const MixerSink* mixerWavSink() {
+    return &_mixerWavSink;
+}
+
+// Lock, thread and sleep shim, Win32 on Windows and pthreads elsewhere
+
+#ifdef _WIN32
+
+static DWORD WINAPI _mixerThreadEntry(LPVOID param) {
+    _mixerThread();
+    return 0;
+}
+
+static void _mixerLockInit(MixerLock* lock) { InitializeCriticalSection(lock); }
+static void _mixerLockFree(MixerLock* lock) { DeleteCriticalSection(lock); }
+static void _mixerLock(MixerLock* lock) { EnterCriticalSection(lock); }
+static void _mixerUnlock(MixerLock* lock) { LeaveCriticalSection(lock); }
+
+static bool _mixerThreadStart(MixerThread* thread) {
+    *thread = CreateThread(NULL, 0, _mixerThreadEntry, NULL, 0, NULL);
+    return *thread != NULL;
+}
+
+static void _mixerThreadJoin(MixerThread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+static void _mixerSleepMs(uint32_t milliseconds) { Sleep(milliseconds); }
+
+#else
+
+static void* _mixerThreadEntry(void* param) {
+    _mixerThread();
+    return NULL;
+}
+
+static void _mixerLockInit(MixerLock* lock) { pthread_mutex_init(lock, NULL); }
+static void _mixerLockFree(MixerLock* lock) { pthread_mutex_destroy(lock); }
+static void _mixerLock(MixerLock* lock) { pthread_mutex_lock(lock); }
+static void _mixerUnlock(MixerLock* lock) { pthread_mutex_unlock(lock); }
+
+static bool _mixerThreadStart(MixerThread* thread) {
+    return pthread_create(thread, NULL, _mixerThreadEntry, NULL) == 0;
+}
+
+static void _mixerThreadJoin(MixerThread thread) {
+    pthread_join(thread, NULL);
+}
+
+static void _mixerSleepMs(uint32_t milliseconds) {
+    struct timespec duration = { milliseconds / 1000, (milliseconds % 1000) * 1000000l };
+    nanosleep(&duration, NULL);
+}
+
+#endif
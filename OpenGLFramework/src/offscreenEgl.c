@@ -0,0 +1,273 @@
+#include <Windows.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdio.h>
+
+#include "framework.h"
+#include "openglDraw.h"
+#include "timer.h"
+
+// The offscreen half of the framework on EGL, for machines without a display, like CI.
+// Builds that have no WGL compile this instead of framework.c. Mesa's surfaceless platform
+// needs neither a display server nor a GPU, llvmpipe renders on the CPU; anything else
+// EGL offers as its default display works too
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA	0x31DD
+#endif
+
+typedef struct {
+	void (APIENTRY* GenFramebuffers)(GLsizei n, GLuint* framebuffers);
+	void (APIENTRY* BindFramebuffer)(GLenum target, GLuint framebuffer);
+	void (APIENTRY* DeleteFramebuffers)(GLsizei n, const GLuint* framebuffers);
+	void (APIENTRY* GenRenderbuffers)(GLsizei n, GLuint* renderbuffers);
+	void (APIENTRY* BindRenderbuffer)(GLenum target, GLuint renderbuffer);
+	void (APIENTRY* DeleteRenderbuffers)(GLsizei n, const GLuint* renderbuffers);
+	void (APIENTRY* RenderbufferStorage)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+	void (APIENTRY* FramebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+	GLenum (APIENTRY* CheckFramebufferStatus)(GLenum target);
+} FramebufferFuncs;
+
+typedef struct gl_offscreen_t {
+	Application*		app;
+	int32_t				width;
+	int32_t				height;
+	EGLDisplay			display;
+	EGLContext			context;
+	EGLSurface			surface;					// 1x1, only so drivers without surfaceless contexts can make it current
+	FramebufferFuncs	fbo;
+	GLuint				framebuffer;
+	GLuint				colorBuffer;
+	GLuint				depthBuffer;
+} GLOffscreen;
+
+static EGLDisplay _eglDisplay();
+static EGLContext _eglContext(EGLDisplay display, EGLConfig config, uint32_t major, uint32_t minor);
+static bool _loadFramebufferFuncs(FramebufferFuncs* fbo);
+
+/// @brief Create a GL context that renders into an offscreen framebuffer, through EGL so no
+/// window system or display driver is needed. The context is current on the calling thread
+/// when this returns
+/// @param app size and GL version, its draw and render functions are used by fwOffscreenFrame
+/// @return offscreen, NULL if no context could be made
+GLOffscreen* fwInitOffscreen(Application* app)
+{
+	GLOffscreen* offscreen = malloc(sizeof(GLOffscreen));
+	if (offscreen == NULL)
+		return NULL;
+	ZeroMemory(offscreen, sizeof(GLOffscreen));
+	offscreen->app = app;
+	offscreen->width = (int32_t)appGetWidth(app);
+	offscreen->height = (int32_t)appGetHeight(app);
+	offscreen->display = EGL_NO_DISPLAY;
+	offscreen->context = EGL_NO_CONTEXT;
+	offscreen->surface = EGL_NO_SURFACE;
+
+	timerInit();
+
+	offscreen->display = _eglDisplay();
+	if (offscreen->display == EGL_NO_DISPLAY || !eglInitialize(offscreen->display, NULL, NULL))
+	{
+		printf("framework: no EGL display\n");
+		offscreen->display = EGL_NO_DISPLAY;
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+	EGLConfig config;
+	EGLint configs = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) ||
+		!eglChooseConfig(offscreen->display, configAttributes, &config, 1, &configs) || configs == 0)
+	{
+		printf("framework: no EGL config for desktop GL\n");
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+	offscreen->context = _eglContext(offscreen->display, config, appGetGLMajorVersion(app), appGetGLMinorVersion(app));
+	offscreen->surface = eglCreatePbufferSurface(offscreen->display, config, surfaceAttributes);
+	if (offscreen->context == EGL_NO_CONTEXT || offscreen->surface == EGL_NO_SURFACE ||
+		!eglMakeCurrent(offscreen->display, offscreen->surface, offscreen->surface, offscreen->context))
+	{
+		printf("framework: EGL context failed, error 0x%x\n", eglGetError());
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+
+	// render into our own color and depth buffers, the pbuffer is only 1x1
+	if (!_loadFramebufferFuncs(&offscreen->fbo))
+	{
+		printf("framework: offscreen rendering needs GL 3.0 or ARB_framebuffer_object\n");
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+	FramebufferFuncs* fbo = &offscreen->fbo;
+	fbo->GenFramebuffers(1, &offscreen->framebuffer);
+	fbo->BindFramebuffer(GL_FRAMEBUFFER, offscreen->framebuffer);
+	fbo->GenRenderbuffers(1, &offscreen->colorBuffer);
+	fbo->BindRenderbuffer(GL_RENDERBUFFER, offscreen->colorBuffer);
+	fbo->RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, offscreen->width, offscreen->height);
+	fbo->FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen->colorBuffer);
+	fbo->GenRenderbuffers(1, &offscreen->depthBuffer);
+	fbo->BindRenderbuffer(GL_RENDERBUFFER, offscreen->depthBuffer);
+	fbo->RenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, offscreen->width, offscreen->height);
+	fbo->FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreen->depthBuffer);
+	if (fbo->CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("framework: offscreen framebuffer incomplete\n");
+		fwShutdownOffscreen(offscreen);
+		return NULL;
+	}
+
+	const float BG_RED = 0.0f;
+	const float BG_GREEN = 0.0f;
+	const float BG_BLUE = 0.0f;
+
+	glDrawInit(BG_RED, BG_GREEN, BG_BLUE);
+	glDrawResize(offscreen->width, offscreen->height);
+	printf("framework: offscreen %dx%d, %s %s\n", offscreen->width, offscreen->height,
+		   (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+	return offscreen;
+}
+
+/// @brief Draw one frame through the same calls the window loop makes, minus the swap
+/// @param offscreen
+void fwOffscreenFrame(GLOffscreen* offscreen)
+{
+	glDrawStart(!appGetPreserveFrame(offscreen->app));
+	appDraw(offscreen->app);
+	appRender(offscreen->app);
+	glDrawEnd();
+}
+
+/// @brief Copy the last frame out, waiting for the GPU to finish it
+/// @param offscreen
+/// @param rgb width * height * 3 bytes, rows top to bottom
+void fwOffscreenReadPixels(GLOffscreen* offscreen, uint8_t* rgb)
+{
+	const size_t stride = (size_t)offscreen->width * 3;
+
+	// GL rows are bottom to top, read into the end of the buffer and flip in place
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, offscreen->width, offscreen->height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+	for (int32_t top = 0, bottom = offscreen->height - 1; top < bottom; ++top, --bottom)
+	{
+		uint8_t* a = rgb + top * stride;
+		uint8_t* b = rgb + bottom * stride;
+		for (size_t i = 0; i < stride; ++i)
+		{
+			uint8_t t = a[i];
+			a[i] = b[i];
+			b[i] = t;
+		}
+	}
+}
+
+/// @brief Release the context and everything made for it
+/// @param offscreen
+void fwShutdownOffscreen(GLOffscreen* offscreen)
+{
+	if (offscreen == NULL)
+		return;
+
+	if (offscreen->framebuffer != 0)
+	{
+		offscreen->fbo.BindFramebuffer(GL_FRAMEBUFFER, 0);
+		offscreen->fbo.DeleteFramebuffers(1, &offscreen->framebuffer);
+	}
+	if (offscreen->colorBuffer != 0)
+		offscreen->fbo.DeleteRenderbuffers(1, &offscreen->colorBuffer);
+	if (offscreen->depthBuffer != 0)
+		offscreen->fbo.DeleteRenderbuffers(1, &offscreen->depthBuffer);
+	if (offscreen->display != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(offscreen->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (offscreen->surface != EGL_NO_SURFACE)
+			eglDestroySurface(offscreen->display, offscreen->surface);
+		if (offscreen->context != EGL_NO_CONTEXT)
+			eglDestroyContext(offscreen->display, offscreen->context);
+		eglTerminate(offscreen->display);
+	}
+	eglReleaseThread();
+
+	timerShutdown();
+	free(offscreen);
+}
+
+/// @brief Look up a GL entry point beyond 1.1 in whichever context is current
+/// @param name
+/// @return function, NULL if the context doesn't have it
+void* fwGetProcAddress(const char* name)
+{
+	return (void*)eglGetProcAddress(name);
+}
+
+/// @brief Mesa's surfaceless platform when the client supports it, otherwise the default display
+/// @return display, EGL_NO_DISPLAY if there is none
+static EGLDisplay _eglDisplay()
+{
+	const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (extensions != NULL && strstr(extensions, "EGL_MESA_platform_surfaceless") != NULL && getPlatformDisplay != NULL)
+	{
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display != EGL_NO_DISPLAY)
+			return display;
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+/// @brief A context of the requested version with the compatibility profile, since the game
+/// still draws in immediate mode, or whatever the driver gives by default if that fails
+/// @param display
+/// @param config
+/// @param major 0 for the default
+/// @param minor
+/// @return context, EGL_NO_CONTEXT on failure
+static EGLContext _eglContext(EGLDisplay display, EGLConfig config, uint32_t major, uint32_t minor)
+{
+	if (major >= 3)
+	{
+		const EGLint attributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, (EGLint)major,
+			EGL_CONTEXT_MINOR_VERSION, (EGLint)minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+			EGL_NONE
+		};
+		EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, attributes);
+		if (context != EGL_NO_CONTEXT)
+			return context;
+		printf("framework: no GL %u.%u context, using the default\n", major, minor);
+	}
+	return eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+}
+
+/// @brief Fetch the framebuffer object entry points
+/// @param fbo
+/// @return false if any is missing
+static bool _loadFramebufferFuncs(FramebufferFuncs* fbo)
+{
+	fbo->GenFramebuffers = fwGetProcAddress("glGenFramebuffers");
+	fbo->BindFramebuffer = fwGetProcAddress("glBindFramebuffer");
+	fbo->DeleteFramebuffers = fwGetProcAddress("glDeleteFramebuffers");
+	fbo->GenRenderbuffers = fwGetProcAddress("glGenRenderbuffers");
+	fbo->BindRenderbuffer = fwGetProcAddress("glBindRenderbuffer");
+	fbo->DeleteRenderbuffers = fwGetProcAddress("glDeleteRenderbuffers");
+	fbo->RenderbufferStorage = fwGetProcAddress("glRenderbufferStorage");
+	fbo->FramebufferRenderbuffer = fwGetProcAddress("glFramebufferRenderbuffer");
+	fbo->CheckFramebufferStatus = fwGetProcAddress("glCheckFramebufferStatus");
+
+	return fbo->GenFramebuffers != NULL && fbo->BindFramebuffer != NULL && fbo->DeleteFramebuffers != NULL &&
+		fbo->GenRenderbuffers != NULL && fbo->BindRenderbuffer != NULL && fbo->DeleteRenderbuffers != NULL &&
+		fbo->RenderbufferStorage != NULL && fbo->FramebufferRenderbuffer != NULL && fbo->CheckFramebufferStatus != NULL;
+}
@@ -20,10 +20,14 @@ inline void glDrawInit(float backRed, float backGreen, float backBlue)
 }
 
 /// @brief Begin drawing GL primitives for the current frame
-inline void glDrawStart()
+/// @param clear false if the application redraws the changed regions of the previous frame itself
+inline void glDrawStart(bool clear)
 {
 	// Clear the window
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (clear)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
 	// Set the modelview matrix to be the identity matrix
 	glLoadIdentity();
 }
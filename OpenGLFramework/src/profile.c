@@ -0,0 +1,294 @@
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "profile.h"
+
+// Each thread records into its own ring, allocated the first time it records, so a marker is
+// a counter read and a store with no locking. When a ring wraps the oldest events are lost
+// and the trace keeps the most recent stretch
+
+#define PROF_MAX_THREADS 16
+#define PROF_DEFAULT_EVENTS (1 << 18)
+#define PROF_CALIBRATION_EVENTS 1024
+
+typedef enum prof_phase_t {
+	PROF_PHASE_BEGIN = 'B',
+	PROF_PHASE_END = 'E'
+} ProfPhase;
+
+typedef struct prof_event_t {
+	const char*		name;
+	int64_t			ticks;
+	ProfPhase		phase;
+} ProfEvent;
+
+/// @brief One thread's ring of events
+typedef struct prof_thread_t {
+	DWORD			id;
+	const char*		name;
+	ProfEvent*		events;
+	uint64_t		next;					// total events recorded, the ring holds the last mask + 1
+	uint64_t		mask;
+} ProfThread;
+
+static struct prof_t {
+	volatile bool	recording;
+	bool			initialized;
+	uint32_t		capacity;
+	LARGE_INTEGER	frequency;
+	int64_t			startTicks;
+	int64_t			stopTicks;
+	double			eventTicks;				// measured cost of one marker
+
+	CRITICAL_SECTION lock;
+	ProfThread*		threads[PROF_MAX_THREADS];
+	uint32_t		threadCount;
+} _prof;
+
+static __declspec(thread) ProfThread* _profThread = NULL;
+static __declspec(thread) bool _profNoSlot = false;		// attaching failed, don't retry on every marker
+
+static ProfThread* _profAttach();
+static void _profRecord(const char* name, ProfPhase phase);
+
+/// @brief Start recording markers. Only one session per run, the rings stay attached to their threads
+/// @param eventsPerThread ring size, rounded up to a power of two, 0 for the default
+void profStart(uint32_t eventsPerThread)
+{
+	if (_prof.initialized)
+		return;
+
+	uint32_t capacity = 1;
+	while (capacity < ((eventsPerThread > 0) ? eventsPerThread : PROF_DEFAULT_EVENTS))
+	{
+		capacity <<= 1;
+	}
+	_prof.capacity = capacity;
+	_prof.initialized = true;
+	InitializeCriticalSection(&_prof.lock);
+	QueryPerformanceFrequency(&_prof.frequency);
+
+#ifndef FW_PROFILE
+	printf("profile: markers are compiled out of this build, define FW_PROFILE to record them\n");
+#endif
+
+	// time our own markers so the trace can say what recording it cost
+	_prof.recording = true;
+	ProfThread* thread = _profAttach();
+	if (thread != NULL)
+	{
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		for (uint32_t i = 0; i < PROF_CALIBRATION_EVENTS; ++i)
+		{
+			_profRecord("calibration", (i & 1) ? PROF_PHASE_END : PROF_PHASE_BEGIN);
+		}
+		QueryPerformanceCounter(&end);
+		_prof.eventTicks = (double)(end.QuadPart - start.QuadPart) / PROF_CALIBRATION_EVENTS;
+		thread->next = 0;
+	}
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	_prof.startTicks = now.QuadPart;
+}
+
+/// @brief Stop recording, before writing the trace
+void profStop()
+{
+	if (!_prof.recording)
+		return;
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	_prof.stopTicks = now.QuadPart;
+	_prof.recording = false;
+}
+
+/// @brief Write everything the rings still hold as Chrome trace JSON. The other threads must not be
+/// recording, stop the session first
+/// @param filename
+/// @return false if the file couldn't be written
+bool profWriteTrace(const char* filename)
+{
+	if (!_prof.initialized)
+		return false;
+
+	FILE* file = fopen(filename, "w");
+	if (file == NULL)
+	{
+		printf("profile: can't open %s\n", filename);
+		return false;
+	}
+
+	double ticksToMicroseconds = 1000000.0 / (double)_prof.frequency.QuadPart;
+	int64_t sessionTicks = _prof.stopTicks - _prof.startTicks;
+	uint64_t written = 0;
+	uint64_t lost = 0;
+	double worstOverhead = 0.0;
+	bool first = true;
+
+	fprintf(file, "{\"traceEvents\":[");
+	for (uint32_t t = 0; t < _prof.threadCount; ++t)
+	{
+		const ProfThread* thread = _prof.threads[t];
+		if (thread->name != NULL)
+		{
+			fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+					first ? "" : ",", (unsigned long)thread->id, thread->name);
+			first = false;
+		}
+
+		uint64_t count = min(thread->next, thread->mask + 1);
+		lost += thread->next - count;
+		if (sessionTicks > 0)
+		{
+			worstOverhead = max(worstOverhead, thread->next * _prof.eventTicks / (double)sessionTicks);
+		}
+
+		// a wrapped ring can start inside a scope, skip ends with nothing open
+		int32_t depth = 0;
+		for (uint64_t i = thread->next - count; i < thread->next; ++i)
+		{
+			const ProfEvent* event = &thread->events[i & thread->mask];
+			if (event->phase == PROF_PHASE_END)
+			{
+				if (depth == 0)
+					continue;
+				--depth;
+			}
+			else
+			{
+				++depth;
+			}
+
+			fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu}",
+					first ? "" : ",", (event->name != NULL) ? event->name : "?", (char)event->phase,
+					(event->ticks - _prof.startTicks) * ticksToMicroseconds, (unsigned long)thread->id);
+			first = false;
+			++written;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	bool ok = (ferror(file) == 0);
+	fclose(file);
+
+	printf("profile: %llu events from %u threads to %s, %llu overwritten, markers cost up to %.2f%% of a thread\n",
+		   (unsigned long long)written, _prof.threadCount, filename, (unsigned long long)lost, worstOverhead * 100.0);
+	return ok;
+}
+
+/// @brief Free the rings. Every thread that recorded must have exited or stopped recording for good
+void profShutdown()
+{
+	if (!_prof.initialized)
+		return;
+
+	_prof.recording = false;
+	for (uint32_t t = 0; t < _prof.threadCount; ++t)
+	{
+		free(_prof.threads[t]->events);
+		free(_prof.threads[t]);
+	}
+	DeleteCriticalSection(&_prof.lock);
+	ZeroMemory(&_prof, sizeof(_prof));
+	_profThread = NULL;
+	_profNoSlot = false;
+}
+
+/// @brief Open a scope on this thread
+/// @param name
+void profBegin(const char* name)
+{
+	if (_prof.recording)
+	{
+		_profRecord(name, PROF_PHASE_BEGIN);
+	}
+}
+
+/// @brief Close the innermost scope on this thread
+void profEnd()
+{
+	if (_prof.recording)
+	{
+		_profRecord(NULL, PROF_PHASE_END);
+	}
+}
+
+/// @brief Label this thread in the trace
+/// @param name
+void profThreadName(const char* name)
+{
+	if (!_prof.initialized)
+		return;
+
+	ProfThread* thread = (_profThread != NULL) ? _profThread : _profAttach();
+	if (thread != NULL)
+	{
+		thread->name = name;
+	}
+}
+
+/// @brief Give the calling thread a ring. A thread that can't have one goes unrecorded for
+/// the rest of the session rather than trying again on every marker
+/// @return NULL if out of memory or threads
+static ProfThread* _profAttach()
+{
+	if (_profNoSlot)
+		return NULL;
+
+	ProfThread* thread = malloc(sizeof(ProfThread));
+	ProfEvent* events = malloc(_prof.capacity * sizeof(ProfEvent));
+	if (thread == NULL || events == NULL)
+	{
+		free(thread);
+		free(events);
+		_profNoSlot = true;
+		return NULL;
+	}
+	thread->id = GetCurrentThreadId();
+	thread->name = NULL;
+	thread->events = events;
+	thread->next = 0;
+	thread->mask = _prof.capacity - 1;
+
+	EnterCriticalSection(&_prof.lock);
+	bool added = (_prof.threadCount < PROF_MAX_THREADS);
+	if (added)
+	{
+		_prof.threads[_prof.threadCount++] = thread;
+	}
+	LeaveCriticalSection(&_prof.lock);
+
+	if (!added)
+	{
+		free(events);
+		free(thread);
+		_profNoSlot = true;
+		return NULL;
+	}
+	_profThread = thread;
+	return thread;
+}
+
+/// @brief Append an event to this thread's ring
+/// @param name
+/// @param phase
+static void _profRecord(const char* name, ProfPhase phase)
+{
+	ProfThread* thread = _profThread;
+	if (thread == NULL)
+	{
+		thread = _profAttach();
+		if (thread == NULL)
+			return;
+	}
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	ProfEvent* event = &thread->events[thread->next & thread->mask];
+	event->name = name;
+	event->ticks = now.QuadPart;
+	event->phase = phase;
+	thread->next++;
+}
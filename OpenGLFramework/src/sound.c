@@ -1,44 +1,208 @@
 #include <Windows.h>
 #include <xaudio2.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "sound.h"
-
-// MS chunk types
-#define fourccRIFF 'FFIR'
-#define fourccDATA 'atad'
-#define fourccFMT ' tmf'
-#define fourccWAVE 'EVAW'
-#define fourccXWMA 'AMWX'
-#define fourccDPDS 'sdpd'
-
-// MS XAudio2 RIFF-parsing code
-static HRESULT FindChunk(HANDLE hFile, DWORD fourcc, DWORD* dwChunkSize, DWORD* dwChunkDataPosition);
-static HRESULT ReadChunkData(HANDLE hFile, void* buffer, DWORD buffersize, DWORD bufferoffset);
-static HRESULT LoadChunkFile(const char* filename, WAVEFORMATEXTENSIBLE* wfx, XAUDIO2_BUFFER* buffer);
-static HRESULT PlayAudio(IXAudio2* pXAudio2, WAVEFORMATEX* wfx, XAUDIO2_BUFFER* buffer, int soundId);
-static HRESULT StopAudio(IXAudio2* pXAudio2, int soundId);
+#include "mixer.h"
+#include "wavFile.h"
+#include "profile.h"
+#include "timer.h"
+
+// Clips of the same format share a pool of source voices, created when the first clip of that
+// format loads and reused from then on. A voice is free again once XAudio2 says its buffer has
+// ended. When a pool is full the lowest priority, oldest voice is stolen for the new clip.
+// With a mixer sink set, clips go through the software mixer instead and XAudio2 is only
+// started if the sink is the device
+#define SOUND_MAX_FORMATS 4
+#define SOUND_VOICES_PER_FORMAT 8
+#define SOUND_WARMUP_NS 60000000000ull    // creations after the first minute count as churn
+#define SOUND_DRAIN_TIMEOUT_MS 1000         // for XAudio2 to give back a clip's buffers on unload
 
 typedef struct sound_source_t {
     const char* filename;
+    WavFile wav;                        // the buffer plays straight from the mapping
     WAVEFORMATEXTENSIBLE wfx;
     XAUDIO2_BUFFER buffer;
+    int32_t pool;
+    int32_t clip;                       // in the mixer, when there's a sink
+    int32_t priority;
+    float gain;
+    SoundPolicy policy;
+    uint64_t lastPlay;                  // nanoseconds, of the last play let through
+    uint32_t lastFrame;
 } SoundSource;
 
+/// @brief One pooled source voice. Each play is a new generation, and the voice is free once
+/// the buffer of its current generation has ended or been stopped. A stopped buffer is only
+/// flushed, XAudio2 may read it until its end arrives, so a voice reused before then remembers
+/// whose it was
+typedef struct sound_voice_t {
+    IXAudio2VoiceCallback callback;     // first, so the callbacks can find their voice
+    IXAudio2SourceVoice* source;
+    int32_t soundId;
+    int32_t priority;
+    float gain;
+    volatile LONG generation;
+    volatile LONG finished;             // written by the XAudio2 thread, buffers end in order
+    volatile LONG stopped;
+    int32_t flushedSoundId;             // still owed an end, until finished reaches flushedGeneration
+    LONG flushedGeneration;
+    uint64_t submitted;                 // timerNowNanoseconds of the play
+} SoundVoice;
+
+typedef struct sound_pool_t {
+    WAVEFORMATEXTENSIBLE wfx;
+    SoundVoice voices[SOUND_VOICES_PER_FORMAT];
+    uint32_t voiceCount;
+} SoundPool;
+
 static struct sound_manager_t {
     SoundSource*    sounds;
     int32_t         maxSounds;
 
     // dx audio system
-    IXAudio2SourceVoice** audios;
     IXAudio2* pXAudio2;
     IXAudio2MasteringVoice* pMasterVoice;
-} _soundMgr = { NULL, 0, NULL, NULL, NULL };
+    SoundPool       pools[SOUND_MAX_FORMATS];
+    int32_t         poolCount;
+
+    // soundLoad may run on loader threads
+    CRITICAL_SECTION lock;
+
+    // software mixing, when set before soundInit
+    const MixerSink* sink;
+    const void*     sinkConfig;
+
+    // frames, for the policies, when someone calls soundFrameBegin
+    uint32_t        frame;
+    uint64_t        frameTime;
+
+    // stats
+    uint64_t        initTime;
+    uint32_t        voicesCreated;
+    uint32_t        voicesCreatedLate;
+    uint32_t        plays;
+    uint32_t        steals;
+    uint32_t        dropped;
+    uint32_t        coalesced;
+    uint32_t        tooSoon;
+    uint32_t        overLimit;
+    uint32_t        starts;             // written by the XAudio2 thread
+    uint64_t        startTotal;
+    uint64_t        startMax;
+} _soundMgr = { NULL, 0, NULL, NULL };
+
+/// @brief Streams the mix to a single XAudio2 voice, queueing the mixer's ring blocks in place
+static struct sound_device_t {
+    IXAudio2VoiceCallback callback;     // first, so the callbacks can find it
+    IXAudio2SourceVoice* source;
+    HANDLE free;                        // a count for each ring block XAudio2 isn't holding
+} _soundDevice;
+
+static int32_t _soundFindPool(const WAVEFORMATEXTENSIBLE* wfx);
+static SoundVoice* _soundClaimVoice(SoundPool* pool, int32_t priority);
+static bool _soundAdmit(int32_t soundId);
+static void _soundPlayed(int32_t soundId);
+static uint32_t _soundCountInstances(int32_t soundId);
+static void _soundStealInstance(int32_t soundId, bool quietest);
+static void _soundStopVoice(SoundVoice* voice);
+static bool _soundVoiceBusy(const SoundVoice* voice);
+static bool _soundVoiceFlushing(const SoundVoice* voice);
+static bool _soundVoiceReading(const SoundVoice* voice, int32_t soundId);
+static void STDMETHODCALLTYPE _soundOnPassStart(IXAudio2VoiceCallback* This, UINT32 bytesRequired);
+static void STDMETHODCALLTYPE _soundOnPassEnd(IXAudio2VoiceCallback* This);
+static void STDMETHODCALLTYPE _soundOnStreamEnd(IXAudio2VoiceCallback* This);
+static void STDMETHODCALLTYPE _soundOnBufferStart(IXAudio2VoiceCallback* This, void* context);
+static void STDMETHODCALLTYPE _soundOnBufferEnd(IXAudio2VoiceCallback* This, void* context);
+static void STDMETHODCALLTYPE _soundOnLoopEnd(IXAudio2VoiceCallback* This, void* context);
+static void STDMETHODCALLTYPE _soundOnVoiceError(IXAudio2VoiceCallback* This, void* context, HRESULT error);
+static void STDMETHODCALLTYPE _soundOnDeviceBufferStart(IXAudio2VoiceCallback* This, void* context);
+static void STDMETHODCALLTYPE _soundOnDeviceBufferEnd(IXAudio2VoiceCallback* This, void* context);
+static bool _soundDeviceOpen(const void* config);
+static void _soundDeviceWrite(const float* samples, uint32_t frames);
+static void _soundDeviceClose();
+
+static const IXAudio2VoiceCallbackVtbl _soundCallbacks = {
+    _soundOnPassStart,
+    _soundOnPassEnd,
+    _soundOnStreamEnd,
+    _soundOnBufferStart,
+    _soundOnBufferEnd,
+    _soundOnLoopEnd,
+    _soundOnVoiceError
+};
+
+static const IXAudio2VoiceCallbackVtbl _soundDeviceCallbacks = {
+    _soundOnPassStart,
+    _soundOnPassEnd,
+    _soundOnStreamEnd,
+    _soundOnDeviceBufferStart,
+    _soundOnDeviceBufferEnd,
+    _soundOnLoopEnd,
+    _soundOnVoiceError
+};
+
+static const MixerSink _soundDeviceSink = {
+    "device",
+    _soundDeviceOpen,
+    _soundDeviceWrite,
+    _soundDeviceClose,
+    true
+};
+
+/**
+ * @brief Mix in software and send the mix to a sink instead of playing each clip on its own
+ * voice. Call before soundInit
+ * @param sink NULL for XAudio2 voices, soundDeviceSink() to hear the mix
+ * @param config for the sink
+*/
+void soundSetSink(const MixerSink* sink, const void* config) {
+    _soundMgr.sink = sink;
+    _soundMgr.sinkConfig = config;
+}
+
+/**
+ * @brief The mixer sink that plays through XAudio2
+ * @return 
+*/
+const MixerSink* soundDeviceSink() {
+    return &_soundDeviceSink;
+}
 
 /**
  * @brief allocate sound system resources
  * @return 
 */
 bool soundInit(int32_t maxSounds) {
+    _soundMgr.sounds = malloc(maxSounds * sizeof(SoundSource));
+    if(_soundMgr.sounds != NULL)
+        ZeroMemory(_soundMgr.sounds, maxSounds * sizeof(SoundSource));
+    _soundMgr.maxSounds = maxSounds;
+    _soundMgr.poolCount = 0;
+    InitializeCriticalSection(&_soundMgr.lock);
+
+    _soundMgr.initTime = timerNowNanoseconds();
+    _soundMgr.voicesCreated = 0;
+    _soundMgr.voicesCreatedLate = 0;
+    _soundMgr.plays = 0;
+    _soundMgr.steals = 0;
+    _soundMgr.dropped = 0;
+    _soundMgr.coalesced = 0;
+    _soundMgr.tooSoon = 0;
+    _soundMgr.overLimit = 0;
+    _soundMgr.frame = 0;
+    _soundMgr.frameTime = 0;
+    _soundMgr.starts = 0;
+    _soundMgr.startTotal = 0;
+    _soundMgr.startMax = 0;
+
+    // a mixer writing to a file or nowhere runs without any audio device
+    if (_soundMgr.sink != NULL && _soundMgr.sink != &_soundDeviceSink) {
+        mixerInit();
+        return mixerStart(_soundMgr.sink, _soundMgr.sinkConfig);
+    }
+
     HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
     if (FAILED(hr)) {
         return false;
@@ -63,14 +227,10 @@ bool soundInit(int32_t maxSounds) {
         return false;
     }
 
-    _soundMgr.sounds = malloc(maxSounds * sizeof(SoundSource));
-    if(_soundMgr.sounds != NULL)
-        ZeroMemory(_soundMgr.sounds, maxSounds * sizeof(SoundSource));
-    _soundMgr.audios = malloc(maxSounds * sizeof(IXAudio2SourceVoice*));
-    if(_soundMgr.audios != NULL)
-        ZeroMemory(_soundMgr.audios, maxSounds * sizeof(IXAudio2SourceVoice*));
-    _soundMgr.maxSounds = maxSounds;
-
+    if (_soundMgr.sink != NULL) {
+        mixerInit();
+        return mixerStart(_soundMgr.sink, _soundMgr.sinkConfig);
+    }
     return true;
 }
 
@@ -80,10 +240,22 @@ bool soundInit(int32_t maxSounds) {
 */
 bool soundShutdown() {
 
-    for (int32_t i = 0; i < _soundMgr.maxSounds; ++i)
+    // the voices read straight from the clips, so they go first
+    if (_soundMgr.sink != NULL)
+        mixerStop();
+    for (int32_t i = 0; i < _soundMgr.poolCount; ++i)
     {
-        StopAudio(_soundMgr.pXAudio2, i);
+        SoundPool* pool = &_soundMgr.pools[i];
+        for (uint32_t j = 0; j < pool->voiceCount; ++j)
+        {
+            IXAudio2SourceVoice_DestroyVoice(pool->voices[j].source);
+        }
+        pool->voiceCount = 0;
+    }
+    _soundMgr.poolCount = 0;
 
+    for (int32_t i = 0; i < _soundMgr.maxSounds; ++i)
+    {
         SoundSource* sound = &_soundMgr.sounds[i];
         if (sound->filename != NULL)
         {
@@ -91,241 +263,602 @@ bool soundShutdown() {
         }
     }
     free(_soundMgr.sounds);
-    free(_soundMgr.audios);
+    DeleteCriticalSection(&_soundMgr.lock);
+    if (_soundMgr.sink != NULL)
+        mixerShutdown();
 
-    IXAudio2_Release(_soundMgr.pXAudio2);
-    _soundMgr.pXAudio2 = NULL;
+    if (_soundMgr.pXAudio2 != NULL) {
+        IXAudio2_Release(_soundMgr.pXAudio2);
+        _soundMgr.pXAudio2 = NULL;
+    }
 
     return true;
 }
 
 /**
- * @brief Loads a clip from file into memory for playback
+ * @brief Loads a clip from file into memory for playback. Safe to call from several threads,
+ * only claiming the slot and finding its voice pool are serialized, the file is read outside the lock
  * @param filename 
  * @return id which is a handle to the clip data
 */
 int32_t soundLoad(const char* filename) {
+    int32_t soundId = SOUND_NOSOUND;
+
+    EnterCriticalSection(&_soundMgr.lock);
     for (int32_t i = 0; i < _soundMgr.maxSounds; ++i)
     {
         if (_soundMgr.sounds[i].filename == NULL)
         {
-            SoundSource* sound = &_soundMgr.sounds[i];
-            sound->filename = filename;
-
-            HRESULT hr = LoadChunkFile(filename, &sound->wfx, &sound->buffer);
-            if (FAILED(hr)) {
-                sound->filename = NULL;
-                return SOUND_NOSOUND;
-            }
-            return i;
+            _soundMgr.sounds[i].filename = filename;
+            soundId = i;
+            break;
         }
     }
+    LeaveCriticalSection(&_soundMgr.lock);
 
-    return SOUND_NOSOUND;
+    if (soundId == SOUND_NOSOUND)
+        return SOUND_NOSOUND;
+
+    SoundSource* sound = &_soundMgr.sounds[soundId];
+    PROFILE_BEGIN("soundLoad");
+    bool loaded = wavOpen(filename, &sound->wav);
+    PROFILE_END();
+
+    sound->pool = -1;
+    sound->clip = MIXER_NOCLIP;
+    sound->priority = 0;
+    sound->gain = 1.0f;
+    ZeroMemory(&sound->policy, sizeof(sound->policy));
+    sound->lastPlay = 0;
+    sound->lastFrame = 0;
+    if (loaded) {
+        ZeroMemory(&sound->wfx, sizeof(sound->wfx));
+        memcpy(&sound->wfx, sound->wav.format, min(sound->wav.formatBytes, sizeof(sound->wfx)));
+        ZeroMemory(&sound->buffer, sizeof(sound->buffer));
+        sound->buffer.AudioBytes = sound->wav.sampleBytes;
+        sound->buffer.pAudioData = sound->wav.samples;
+        sound->buffer.Flags = XAUDIO2_END_OF_STREAM; // tell the source voice not to expect any data after this buffer
+    }
+    if (loaded && _soundMgr.sink != NULL) {
+        // the mixer keeps its own converted copy
+        const WAVEFORMATEX* format = &sound->wfx.Format;
+        sound->clip = mixerAddClip(sound->buffer.pAudioData, sound->buffer.AudioBytes, format->wFormatTag,
+            format->nChannels, format->nSamplesPerSec, format->wBitsPerSample);
+        wavClose(&sound->wav);
+        sound->buffer.pAudioData = NULL;
+        loaded = (sound->clip != MIXER_NOCLIP);
+    }
+
+    EnterCriticalSection(&_soundMgr.lock);
+    if (loaded && _soundMgr.sink == NULL) {
+        sound->pool = _soundFindPool(&sound->wfx);
+        loaded = (sound->pool >= 0);
+    }
+    if (!loaded) {
+        wavClose(&sound->wav);
+        sound->buffer.pAudioData = NULL;
+        sound->filename = NULL;
+        soundId = SOUND_NOSOUND;
+    }
+    LeaveCriticalSection(&_soundMgr.lock);
+    return soundId;
 }
 
 /**
- * @brief Releases resources associated w/ a loaded clip
+ * @brief Releases resources associated w/ a loaded clip. Waits for XAudio2 to hand back every
+ * buffer of the clip first, stopping a voice only flushes them and they play from the mapping
  * @param soundId 
 */
 void soundUnload(int32_t soundId) {
     if (soundId == SOUND_NOSOUND)
         return;
 
+    soundStop(soundId);
     SoundSource* sound = &_soundMgr.sounds[soundId];
-    if (sound->buffer.pAudioData != NULL) {
-        free((BYTE*)sound->buffer.pAudioData);
-        sound->buffer.pAudioData = NULL;
+    if (sound->clip != MIXER_NOCLIP) {
+        mixerRemoveClip(sound->clip);
+        sound->clip = MIXER_NOCLIP;
+    }
 
-        sound->filename = NULL;
+    bool drained = true;
+    if (sound->pool >= 0 && sound->pool < _soundMgr.poolCount) {
+        const SoundPool* pool = &_soundMgr.pools[sound->pool];
+        uint64_t deadline = timerNowNanoseconds() + SOUND_DRAIN_TIMEOUT_MS * 1000000ull;
+        for (uint32_t i = 0; i < pool->voiceCount; ++i)
+        {
+            while (_soundVoiceReading(&pool->voices[i], soundId) && timerNowNanoseconds() < deadline)
+            {
+                Sleep(1);
+            }
+            drained = drained && !_soundVoiceReading(&pool->voices[i], soundId);
+        }
+    }
+    if (drained) {
+        wavClose(&sound->wav);
     }
+    else {
+        // leaking the mapping beats unmapping pages the XAudio2 thread is reading
+        printf("sound: %s still queued on a voice, left mapped\n", sound->filename);
+        ZeroMemory(&sound->wav, sizeof(sound->wav));
+    }
+    sound->buffer.pAudioData = NULL;
+    sound->filename = NULL;
 }
 
 /**
- * @brief Plays a clip loaded w/ LoadSound
+ * @brief Set which clips win when their pool runs out of voices
  * @param soundId 
+ * @param priority higher steals from lower, 0 by default
 */
-void soundPlay(int32_t soundId) {
+void soundSetPriority(int32_t soundId, int32_t priority) {
     if (soundId == SOUND_NOSOUND)
         return;
 
-    SoundSource* sound = &_soundMgr.sounds[soundId];
-    PlayAudio(_soundMgr.pXAudio2, (WAVEFORMATEX*)&sound->wfx, &sound->buffer, soundId);
+    _soundMgr.sounds[soundId].priority = priority;
 }
 
-void soundStop(int32_t soundId) {
+/**
+ * @brief Set how loud the clip plays from its next play on
+ * @param soundId 
+ * @param gain 1 plays it as recorded
+*/
+void soundSetGain(int32_t soundId, float gain) {
     if (soundId == SOUND_NOSOUND)
         return;
 
-    SoundSource* sound = &_soundMgr.sounds[soundId];
-    StopAudio(_soundMgr.pXAudio2, soundId);
+    _soundMgr.sounds[soundId].gain = gain;
 }
 
 /**
- * @brief FROM: https://learn.microsoft.com/en-us/windows/win32/xaudio2/how-to--load-audio-data-files-in-xaudio2
+ * @brief Limit how often the clip plays. No limits by default
+ * @param soundId 
+ * @param policy copied
 */
-static HRESULT FindChunk(HANDLE hFile, DWORD fourcc, DWORD* dwChunkSize, DWORD* dwChunkDataPosition)
-{
-    HRESULT hr = S_OK;
-    if (INVALID_SET_FILE_POINTER == SetFilePointer(hFile, 0, NULL, FILE_BEGIN))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    DWORD dwChunkType;
-    DWORD dwChunkDataSize;
-    DWORD dwRIFFDataSize = 0;
-    DWORD dwFileType;
-    DWORD bytesRead = 0;
-    DWORD dwOffset = 0;
-
-    while (hr == S_OK)
-    {
-        DWORD dwRead;
-        if (0 == ReadFile(hFile, &dwChunkType, sizeof(DWORD), &dwRead, NULL))
-            hr = HRESULT_FROM_WIN32(GetLastError());
-
-        if (0 == ReadFile(hFile, &dwChunkDataSize, sizeof(DWORD), &dwRead, NULL))
-            hr = HRESULT_FROM_WIN32(GetLastError());
+void soundSetPolicy(int32_t soundId, const SoundPolicy* policy) {
+    if (soundId == SOUND_NOSOUND)
+        return;
 
-        switch (dwChunkType)
-        {
-        case fourccRIFF:
-            dwRIFFDataSize = dwChunkDataSize;
-            dwChunkDataSize = 4;
-            if (0 == ReadFile(hFile, &dwFileType, sizeof(DWORD), &dwRead, NULL))
-                hr = HRESULT_FROM_WIN32(GetLastError());
-            break;
+    _soundMgr.sounds[soundId].policy = *policy;
+}
 
-        default:
-            if (INVALID_SET_FILE_POINTER == SetFilePointer(hFile, dwChunkDataSize, NULL, FILE_CURRENT))
-                return HRESULT_FROM_WIN32(GetLastError());
-        }
+/**
+ * @brief Start a new frame for the policies. Until this is called plays are timed by the clock
+ * and never coalesced
+ * @param frameTime timerNowNanoseconds, or a simulated time
+*/
+void soundFrameBegin(uint64_t frameTime) {
+    _soundMgr.frame++;
+    _soundMgr.frameTime = frameTime;
+}
 
-        dwOffset += sizeof(DWORD) * 2;
+/**
+ * @brief Plays a clip loaded w/ LoadSound, on a free voice of its pool or one stolen from a
+ * clip of no higher priority. Dropped when every voice is playing something more important
+ * @param soundId 
+*/
+void soundPlay(int32_t soundId) {
+    if (soundId == SOUND_NOSOUND)
+        return;
 
-        if (dwChunkType == fourcc)
-        {
-            *dwChunkSize = dwChunkDataSize;
-            *dwChunkDataPosition = dwOffset;
-            return S_OK;
-        }
+    if (!_soundAdmit(soundId))
+        return;
 
-        dwOffset += dwChunkDataSize;
+    SoundSource* sound = &_soundMgr.sounds[soundId];
+    if (sound->clip != MIXER_NOCLIP) {
+        if (mixerPlay(sound->clip, sound->gain, sound->priority))
+            _soundPlayed(soundId);
+        return;
+    }
 
-        if (bytesRead >= dwRIFFDataSize) return S_FALSE;
+    PROFILE_BEGIN("soundPlay");
+    SoundVoice* voice = _soundClaimVoice(&_soundMgr.pools[sound->pool], sound->priority);
+    if (voice == NULL) {
+        _soundMgr.dropped++;
+        PROFILE_END();
+        return;
+    }
+    _soundPlayed(soundId);
 
+    // a stopped buffer that hasn't ended yet is still read from its clip
+    if (voice->finished != voice->generation) {
+        voice->flushedSoundId = voice->soundId;
+        voice->flushedGeneration = voice->generation;
+    }
+    // the generation rides along as the buffer context, so a late end from a stolen play
+    // can't free the voice out from under this one
+    LONG generation = voice->generation + 1;
+    XAUDIO2_BUFFER buffer = sound->buffer;
+    buffer.pContext = (void*)(ULONG_PTR)generation;
+    voice->soundId = soundId;
+    voice->priority = sound->priority;
+    voice->gain = sound->gain;
+    voice->submitted = timerNowNanoseconds();
+    InterlockedExchange(&voice->generation, generation);
+
+    IXAudio2SourceVoice_SetVolume(voice->source, sound->gain, XAUDIO2_COMMIT_NOW);
+    HRESULT hr = IXAudio2SourceVoice_SubmitSourceBuffer(voice->source, &buffer, NULL);
+    if (FAILED(hr)) {
+        InterlockedExchange(&voice->finished, generation);
     }
+    else if (FAILED(IXAudio2SourceVoice_Start(voice->source, 0, XAUDIO2_COMMIT_NOW))) {
+        _soundStopVoice(voice);
+    }
+    _soundMgr.plays++;
+    PROFILE_END();
+}
 
-    return S_OK;
+/**
+ * @brief Number of voices playing a clip
+ * @return 
+*/
+uint32_t soundGetActiveVoices() {
+    if (_soundMgr.sink != NULL)
+        return mixerGetActiveVoices();
 
+    uint32_t active = 0;
+    for (int32_t i = 0; i < _soundMgr.poolCount; ++i)
+    {
+        SoundPool* pool = &_soundMgr.pools[i];
+        for (uint32_t j = 0; j < pool->voiceCount; ++j)
+        {
+            if (_soundVoiceBusy(&pool->voices[j]))
+                ++active;
+        }
+    }
+    return active;
 }
 
 /**
- * @brief FROM: https://learn.microsoft.com/en-us/windows/win32/xaudio2/how-to--load-audio-data-files-in-xaudio2
+ * @brief Source voices created since soundInit. Only a new format creates any, so this should
+ * stop growing once every clip has loaded
+ * @return 
 */
-static HRESULT ReadChunkData(HANDLE hFile, void* buffer, DWORD buffersize, DWORD bufferoffset)
-{
-    HRESULT hr = S_OK;
-    if (INVALID_SET_FILE_POINTER == SetFilePointer(hFile, bufferoffset, NULL, FILE_BEGIN))
-        return HRESULT_FROM_WIN32(GetLastError());
-    DWORD dwRead;
-    if (0 == ReadFile(hFile, buffer, buffersize, &dwRead, NULL))
-        hr = HRESULT_FROM_WIN32(GetLastError());
-    return hr;
+uint32_t soundGetVoicesCreated() {
+    return _soundMgr.voicesCreated;
 }
 
 /**
- * @brief FROM: https://learn.microsoft.com/en-us/windows/win32/xaudio2/how-to--load-audio-data-files-in-xaudio2
+ * @brief Print how the voice pools held up: creations after warming up, steals, drops, and how
+ * long clips took to start playing
 */
-static HRESULT LoadChunkFile(const char* filename, WAVEFORMATEXTENSIBLE* wfx, XAUDIO2_BUFFER* buffer) {
-    // Open the file
-    HANDLE hFile = CreateFile(
-        filename,
-        GENERIC_READ,
-        FILE_SHARE_READ,
-        NULL,
-        OPEN_EXISTING,
-        0,
-        NULL);
-
-    if (INVALID_HANDLE_VALUE == hFile) {
-        return S_FALSE;
+void soundReport() {
+    printf("sound: %u coalesced in a frame, %u too soon after the last, %u over the instance limit\n",
+        _soundMgr.coalesced, _soundMgr.tooSoon, _soundMgr.overLimit);
+    if (_soundMgr.sink != NULL) {
+        mixerReport();
+        return;
     }
 
-    if (INVALID_SET_FILE_POINTER == SetFilePointer(hFile, 0, NULL, FILE_BEGIN)) {
-        CloseHandle(hFile);
-        return S_FALSE;
+    float minutes = (timerNowNanoseconds() - _soundMgr.initTime) / 60000000000.0f;
+    float lateMinutes = (minutes > 1.0f) ? minutes - 1.0f : 0.0f;
+    printf("sound: %u voices in %d pools, %u created after the first minute (%.2f per minute)\n",
+        _soundMgr.voicesCreated, _soundMgr.poolCount, _soundMgr.voicesCreatedLate,
+        (lateMinutes > 0.0f) ? _soundMgr.voicesCreatedLate / lateMinutes : 0.0f);
+    printf("sound: %u plays, %u stolen, %u dropped, started %.2f ms avg %.2f ms max after the play\n",
+        _soundMgr.plays, _soundMgr.steals, _soundMgr.dropped,
+        (_soundMgr.starts > 0) ? _soundMgr.startTotal / (double)_soundMgr.starts / 1000000.0 : 0.0,
+        _soundMgr.startMax / 1000000.0);
+}
+
+/**
+ * @brief Stop every voice playing the clip
+ * @param soundId 
+*/
+void soundStop(int32_t soundId) {
+    if (soundId == SOUND_NOSOUND)
+        return;
+
+    if (_soundMgr.sounds[soundId].clip != MIXER_NOCLIP) {
+        mixerStopClip(_soundMgr.sounds[soundId].clip);
+        return;
     }
 
-    DWORD dwChunkSize;
-    DWORD dwChunkPosition;
-    //check the file type, should be fourccWAVE or 'XWMA'
-    FindChunk(hFile, fourccRIFF, &dwChunkSize, &dwChunkPosition);
-    DWORD filetype;
-    ReadChunkData(hFile, &filetype, sizeof(DWORD), dwChunkPosition);
-    if (filetype != fourccWAVE) {
-        CloseHandle(hFile);
-        return S_FALSE;
+    for (int32_t i = 0; i < _soundMgr.poolCount; ++i)
+    {
+        SoundPool* pool = &_soundMgr.pools[i];
+        for (uint32_t j = 0; j < pool->voiceCount; ++j)
+        {
+            SoundVoice* voice = &pool->voices[j];
+            if (voice->soundId == soundId && _soundVoiceBusy(voice))
+            {
+                _soundStopVoice(voice);
+            }
+        }
     }
+}
 
-    FindChunk(hFile, fourccFMT, &dwChunkSize, &dwChunkPosition);
-    ReadChunkData(hFile, wfx, dwChunkSize, dwChunkPosition);
+/**
+ * @brief Apply the clip's policy to a play, making room for it if that's allowed. The play
+ * only counts against the interval and coalescing once it gets a voice, see _soundPlayed
+ * @param soundId 
+ * @return false if the play should be dropped
+*/
+static bool _soundAdmit(int32_t soundId) {
+    SoundSource* sound = &_soundMgr.sounds[soundId];
+    const SoundPolicy* policy = &sound->policy;
+    uint64_t now = (_soundMgr.frame > 0) ? _soundMgr.frameTime : timerNowNanoseconds();
 
-    //fill out the audio data buffer with the contents of the fourccDATA chunk
-    FindChunk(hFile, fourccDATA, &dwChunkSize, &dwChunkPosition);
-    BYTE* pDataBuffer = malloc(dwChunkSize * sizeof(BYTE));
-    ReadChunkData(hFile, pDataBuffer, dwChunkSize, dwChunkPosition);
+    if (policy->coalesce && _soundMgr.frame > 0 && sound->lastFrame == _soundMgr.frame) {
+        _soundMgr.coalesced++;
+        return false;
+    }
+    if (sound->lastPlay != 0 && now - sound->lastPlay < (uint64_t)(policy->minInterval * 1000000.0f)) {
+        _soundMgr.tooSoon++;
+        return false;
+    }
+    if (policy->maxInstances > 0 && _soundCountInstances(soundId) >= policy->maxInstances) {
+        _soundMgr.overLimit++;
+        if (policy->steal == SOUND_STEAL_NONE)
+            return false;
+        _soundStealInstance(soundId, policy->steal == SOUND_STEAL_QUIETEST);
+    }
+    return true;
+}
+
+/**
+ * @brief Record a play that got a voice, for the next one's interval and coalescing
+ * @param soundId 
+*/
+static void _soundPlayed(int32_t soundId) {
+    SoundSource* sound = &_soundMgr.sounds[soundId];
+    sound->lastPlay = (_soundMgr.frame > 0) ? _soundMgr.frameTime : timerNowNanoseconds();
+    sound->lastFrame = _soundMgr.frame;
+}
 
-    buffer->AudioBytes = dwChunkSize;  //size of the audio buffer in bytes
-    buffer->pAudioData = pDataBuffer;  //buffer containing audio data
-    buffer->Flags = XAUDIO2_END_OF_STREAM; // tell the source voice not to expect any data after this buffer
+/**
+ * @brief Number of voices playing the clip
+ * @param soundId 
+ * @return 
+*/
+static uint32_t _soundCountInstances(int32_t soundId) {
+    const SoundSource* sound = &_soundMgr.sounds[soundId];
+    if (sound->clip != MIXER_NOCLIP)
+        return mixerCountClip(sound->clip);
+
+    uint32_t count = 0;
+    const SoundPool* pool = &_soundMgr.pools[sound->pool];
+    for (uint32_t i = 0; i < pool->voiceCount; ++i)
+    {
+        if (pool->voices[i].soundId == soundId && _soundVoiceBusy(&pool->voices[i]))
+            ++count;
+    }
+    return count;
+}
 
-    CloseHandle(hFile);
+/**
+ * @brief Stop one voice playing the clip
+ * @param soundId 
+ * @param quietest the one with the lowest gain, otherwise the oldest
+*/
+static void _soundStealInstance(int32_t soundId, bool quietest) {
+    const SoundSource* sound = &_soundMgr.sounds[soundId];
+    if (sound->clip != MIXER_NOCLIP) {
+        mixerStealClip(sound->clip, quietest);
+        return;
+    }
 
-    return S_OK;
+    SoundPool* pool = &_soundMgr.pools[sound->pool];
+    SoundVoice* victim = NULL;
+    for (uint32_t i = 0; i < pool->voiceCount; ++i)
+    {
+        SoundVoice* voice = &pool->voices[i];
+        if (voice->soundId != soundId || !_soundVoiceBusy(voice))
+            continue;
+        if (victim == NULL || (quietest && voice->gain < victim->gain) ||
+            ((!quietest || voice->gain == victim->gain) && voice->submitted < victim->submitted))
+            victim = voice;
+    }
+    if (victim != NULL)
+        _soundStopVoice(victim);
 }
 
 /**
- * @brief FROM: https://learn.microsoft.com/en-us/windows/win32/xaudio2/how-to--load-audio-data-files-in-xaudio2
+ * @brief Find the pool for a format, creating it and its voices for a new one. Called with the lock held
+ * @param wfx 
+ * @return pool index, -1 if there are too many formats or XAudio2 refused
 */
-static HRESULT PlayAudio(IXAudio2* pXAudio2, WAVEFORMATEX* wfx, XAUDIO2_BUFFER* buffer, int soundId) {
-    HRESULT hr = S_OK;
+static int32_t _soundFindPool(const WAVEFORMATEXTENSIBLE* wfx) {
+    const WAVEFORMATEX* format = &wfx->Format;
+    for (int32_t i = 0; i < _soundMgr.poolCount; ++i)
+    {
+        const WAVEFORMATEX* poolFormat = &_soundMgr.pools[i].wfx.Format;
+        if (poolFormat->wFormatTag == format->wFormatTag && poolFormat->nChannels == format->nChannels &&
+            poolFormat->nSamplesPerSec == format->nSamplesPerSec &&
+            poolFormat->wBitsPerSample == format->wBitsPerSample)
+            return i;
+    }
+    if (_soundMgr.poolCount == SOUND_MAX_FORMATS) {
+        printf("sound: more than %d formats, the rest won't play\n", SOUND_MAX_FORMATS);
+        return -1;
+    }
 
-    //if (_soundMgr.audios[soundId] == NULL)
+    SoundPool* pool = &_soundMgr.pools[_soundMgr.poolCount];
+    pool->wfx = *wfx;
+    pool->voiceCount = 0;
+    for (uint32_t i = 0; i < SOUND_VOICES_PER_FORMAT; ++i)
     {
-        IXAudio2SourceVoice* pSourceVoice;
+        SoundVoice* voice = &pool->voices[pool->voiceCount];
+        ZeroMemory(voice, sizeof(SoundVoice));
+        voice->callback.lpVtbl = &_soundCallbacks;
+        voice->soundId = SOUND_NOSOUND;
+        voice->flushedSoundId = SOUND_NOSOUND;
 
-        hr = IXAudio2_CreateSourceVoice(_soundMgr.pXAudio2, &pSourceVoice, wfx,
+        HRESULT hr = IXAudio2_CreateSourceVoice(_soundMgr.pXAudio2, &voice->source, (const WAVEFORMATEX*)&pool->wfx,
             0,
             XAUDIO2_DEFAULT_FREQ_RATIO,
-            NULL,
+            &voice->callback,
             NULL,
             NULL);
-        if (FAILED(hr)) {
-            return hr;
-        }
+        if (FAILED(hr))
+            break;
 
-        hr = IXAudio2SourceVoice_SubmitSourceBuffer(pSourceVoice, buffer, NULL);
-        if (FAILED(hr)) {
-            return hr;
-        }
+        pool->voiceCount++;
+        _soundMgr.voicesCreated++;
+        if (timerNowNanoseconds() - _soundMgr.initTime > SOUND_WARMUP_NS)
+            _soundMgr.voicesCreatedLate++;
+    }
+    if (pool->voiceCount == 0)
+        return -1;
 
-        _soundMgr.audios[soundId] = pSourceVoice;
+    return _soundMgr.poolCount++;
+}
+
+/**
+ * @brief Find a voice to play on, stealing the least important, oldest one if they're all busy
+ * @param pool 
+ * @param priority of the clip about to play
+ * @return NULL when every voice is playing something of higher priority
+*/
+static SoundVoice* _soundClaimVoice(SoundPool* pool, int32_t priority) {
+    SoundVoice* victim = NULL;
+    for (uint32_t i = 0; i < pool->voiceCount; ++i)
+    {
+        SoundVoice* voice = &pool->voices[i];
+        // one flushed buffer a voice at most, so unloading always knows what it still reads
+        if (_soundVoiceFlushing(voice))
+            continue;
+        if (!_soundVoiceBusy(voice))
+            return voice;
+
+        if (voice->priority <= priority &&
+            (victim == NULL || voice->priority < victim->priority ||
+             (voice->priority == victim->priority && voice->submitted < victim->submitted)))
+            victim = voice;
+    }
+    if (victim != NULL) {
+        _soundStopVoice(victim);
+        _soundMgr.steals++;
     }
+    return victim;
+}
 
-    hr = IXAudio2SourceVoice_Start(_soundMgr.audios[soundId], 0, XAUDIO2_COMMIT_NOW);
+/**
+ * @brief Cut a voice off and free it. Its buffer is flushed, and only ends later
+ * @param voice 
+*/
+static void _soundStopVoice(SoundVoice* voice) {
+    IXAudio2SourceVoice_Stop(voice->source, 0, XAUDIO2_COMMIT_NOW);
+    IXAudio2SourceVoice_FlushSourceBuffers(voice->source);
+    InterlockedExchange(&voice->stopped, voice->generation);
+}
 
-    return hr;
+static bool _soundVoiceBusy(const SoundVoice* voice) {
+    return voice->finished != voice->generation && voice->stopped != voice->generation;
 }
 
-static HRESULT StopAudio(IXAudio2* pXAudio2, int soundId) {
-    HRESULT hr = S_FALSE;
+/**
+ * @brief Whether the voice was reused before the end of the buffer it was stopped on arrived
+ * @param voice 
+ * @return 
+*/
+static bool _soundVoiceFlushing(const SoundVoice* voice) {
+    return (LONG)(voice->finished - voice->flushedGeneration) < 0;
+}
 
-    if (_soundMgr.audios[soundId] != NULL)
-    {
-        hr = IXAudio2SourceVoice_Stop(_soundMgr.audios[soundId], 0, XAUDIO2_COMMIT_NOW);
-    }
+/**
+ * @brief Whether XAudio2 may still read a clip's buffer on the voice
+ * @param voice 
+ * @param soundId 
+ * @return 
+*/
+static bool _soundVoiceReading(const SoundVoice* voice, int32_t soundId) {
+    return (voice->soundId == soundId && voice->finished != voice->generation) ||
+        (voice->flushedSoundId == soundId && _soundVoiceFlushing(voice));
+}
+
+// voice callbacks, on the XAudio2 thread. They mustn't block or call back into XAudio2
+static void STDMETHODCALLTYPE _soundOnPassStart(IXAudio2VoiceCallback* This, UINT32 bytesRequired) {}
+static void STDMETHODCALLTYPE _soundOnPassEnd(IXAudio2VoiceCallback* This) {}
+static void STDMETHODCALLTYPE _soundOnStreamEnd(IXAudio2VoiceCallback* This) {}
+static void STDMETHODCALLTYPE _soundOnLoopEnd(IXAudio2VoiceCallback* This, void* context) {}
+static void STDMETHODCALLTYPE _soundOnVoiceError(IXAudio2VoiceCallback* This, void* context, HRESULT error) {}
+static void STDMETHODCALLTYPE _soundOnDeviceBufferStart(IXAudio2VoiceCallback* This, void* context) {}
+
+/**
+ * @brief The voice started reading the clip, time it from the play
+*/
+static void STDMETHODCALLTYPE _soundOnBufferStart(IXAudio2VoiceCallback* This, void* context) {
+    SoundVoice* voice = (SoundVoice*)This;
+    if ((LONG)(ULONG_PTR)context != voice->generation)
+        return;
+
+    uint64_t latency = timerNowNanoseconds() - voice->submitted;
+    _soundMgr.starts++;
+    _soundMgr.startTotal += latency;
+    if (latency > _soundMgr.startMax)
+        _soundMgr.startMax = latency;
+}
 
-    return hr;
+/**
+ * @brief The clip has finished, or was flushed, so the voice is free for its generation
+*/
+static void STDMETHODCALLTYPE _soundOnBufferEnd(IXAudio2VoiceCallback* This, void* context) {
+    SoundVoice* voice = (SoundVoice*)This;
+    InterlockedExchange(&voice->finished, (LONG)(ULONG_PTR)context);
+}
+
+/**
+ * @brief The device is done with a ring block, the mixer may write another
+*/
+static void STDMETHODCALLTYPE _soundOnDeviceBufferEnd(IXAudio2VoiceCallback* This, void* context) {
+    ReleaseSemaphore(_soundDevice.free, 1, NULL);
 }
 
+/**
+ * @brief Start a float voice at the mixer's rate. Called by mixerStart from soundInit
+ * @param config unused
+ * @return 
+*/
+static bool _soundDeviceOpen(const void* config) {
+    WAVEFORMATEX format;
+    ZeroMemory(&format, sizeof(format));
+    format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+    format.nChannels = MIXER_CHANNELS;
+    format.nSamplesPerSec = MIXER_SAMPLE_RATE;
+    format.wBitsPerSample = 32;
+    format.nBlockAlign = MIXER_CHANNELS * sizeof(float);
+    format.nAvgBytesPerSec = MIXER_SAMPLE_RATE * format.nBlockAlign;
+
+    // the block being mixed is never one XAudio2 is still reading
+    _soundDevice.free = CreateSemaphore(NULL, MIXER_RING_BLOCKS - 1, MIXER_RING_BLOCKS - 1, NULL);
+    if (_soundDevice.free == NULL)
+        return false;
 
+    _soundDevice.callback.lpVtbl = &_soundDeviceCallbacks;
+    HRESULT hr = IXAudio2_CreateSourceVoice(_soundMgr.pXAudio2, &_soundDevice.source, &format,
+        0,
+        XAUDIO2_DEFAULT_FREQ_RATIO,
+        &_soundDevice.callback,
+        NULL,
+        NULL);
+    if (FAILED(hr)) {
+        CloseHandle(_soundDevice.free);
+        return false;
+    }
+    _soundMgr.voicesCreated++;
+    IXAudio2SourceVoice_Start(_soundDevice.source, 0, XAUDIO2_COMMIT_NOW);
+    return true;
+}
+
+/**
+ * @brief Queue a ring block, waiting while the device already holds all the others
+ * @param samples 
+ * @param frames 
+*/
+static void _soundDeviceWrite(const float* samples, uint32_t frames) {
+    WaitForSingleObject(_soundDevice.free, INFINITE);
+
+    XAUDIO2_BUFFER buffer;
+    ZeroMemory(&buffer, sizeof(buffer));
+    buffer.AudioBytes = (uint32_t)(frames * MIXER_CHANNELS * sizeof(float));
+    buffer.pAudioData = (const BYTE*)samples;
+    if (FAILED(IXAudio2SourceVoice_SubmitSourceBuffer(_soundDevice.source, &buffer, NULL)))
+        ReleaseSemaphore(_soundDevice.free, 1, NULL);
+}
+
+static void _soundDeviceClose() {
+    IXAudio2SourceVoice_Stop(_soundDevice.source, 0, XAUDIO2_COMMIT_NOW);
+    IXAudio2SourceVoice_DestroyVoice(_soundDevice.source);
+    _soundDevice.source = NULL;
+    CloseHandle(_soundDevice.free);
+}
@@ -0,0 +1,147 @@
+#include <Windows.h>
+#include "baseTypes.h"
+#include "timer.h"
+
+// Only available from the Windows 10 1803 SDK onwards
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// bounds for how early we stop sleeping and start spinning on the clock
+#define TIMER_MIN_SPIN_US 100
+#define TIMER_MAX_SPIN_US 4000
+
+/// @brief Monotonic clock and sleep state
+typedef struct {
+	LARGE_INTEGER	frequency;
+	HANDLE			waitable;
+	bool			periodSet;
+	uint64_t		spinMargin;		// expected oversleep, in microseconds
+	uint32_t		users;			// timerInit calls not yet matched by timerShutdown
+} HiResTimer;
+
+static HiResTimer s_Timer;
+
+static void _timerSleep(uint64_t microseconds);
+
+/// @brief Set up the performance counter and the most precise sleep the OS offers.
+/// Safe to call again, so the game can start the clock before the framework does.
+/// Each call needs a timerShutdown, the last one releases the timer
+void timerInit()
+{
+	if (s_Timer.users++ > 0)
+		return;
+
+	QueryPerformanceFrequency(&s_Timer.frequency);
+
+	// high resolution waitable timers wake within a fraction of a millisecond,
+	// otherwise fall back to Sleep with the scheduler period raised to 1ms
+	s_Timer.waitable = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (s_Timer.waitable != NULL)
+	{
+		s_Timer.spinMargin = 500;
+	}
+	else
+	{
+		s_Timer.periodSet = (timeBeginPeriod(1) == TIMERR_NOERROR);
+		s_Timer.spinMargin = 2000;
+	}
+}
+
+/// @brief Give back the timer handle and scheduler period once every timerInit is matched
+void timerShutdown()
+{
+	if (s_Timer.users == 0 || --s_Timer.users > 0)
+		return;
+
+	if (s_Timer.waitable != NULL)
+	{
+		CloseHandle(s_Timer.waitable);
+		s_Timer.waitable = NULL;
+	}
+	if (s_Timer.periodSet)
+	{
+		timeEndPeriod(1);
+		s_Timer.periodSet = false;
+	}
+	s_Timer.frequency.QuadPart = 0;
+}
+
+/// @brief Monotonic time since an arbitrary point, at the resolution of the performance counter
+/// @return nanoseconds
+uint64_t timerNowNanoseconds()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	uint64_t ticks = (uint64_t)counter.QuadPart;
+	uint64_t frequency = (uint64_t)s_Timer.frequency.QuadPart;
+	return (ticks / frequency) * 1000000000 + ((ticks % frequency) * 1000000000) / frequency;
+}
+
+/// @brief Monotonic time since an arbitrary point
+/// @return microseconds
+uint64_t timerNowMicroseconds()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	// split to avoid overflowing the multiply on long uptimes
+	uint64_t ticks = (uint64_t)counter.QuadPart;
+	uint64_t frequency = (uint64_t)s_Timer.frequency.QuadPart;
+	return (ticks / frequency) * 1000000 + ((ticks % frequency) * 1000000) / frequency;
+}
+
+/// @brief Block until the given time. Sleeps for most of the wait, then spins for the
+/// last stretch, which is sized from how late the OS has been waking us up
+/// @param deadline in timerNowMicroseconds time
+void timerSleepUntil(uint64_t deadline)
+{
+	uint64_t now = timerNowMicroseconds();
+	while (now < deadline && deadline - now > s_Timer.spinMargin)
+	{
+		uint64_t request = deadline - now - s_Timer.spinMargin;
+		_timerSleep(request);
+
+		uint64_t after = timerNowMicroseconds();
+		uint64_t slept = after - now;
+		uint64_t overshoot = (slept > request) ? slept - request : 0;
+
+		// grow the margin straight away when we wake late, shrink it slowly otherwise
+		if (overshoot > s_Timer.spinMargin)
+		{
+			s_Timer.spinMargin = (overshoot < TIMER_MAX_SPIN_US) ? overshoot : TIMER_MAX_SPIN_US;
+		}
+		else
+		{
+			uint64_t target = (overshoot > TIMER_MIN_SPIN_US) ? overshoot : TIMER_MIN_SPIN_US;
+			s_Timer.spinMargin -= (s_Timer.spinMargin - target) / 16;
+		}
+
+		now = after;
+	}
+
+	while (timerNowMicroseconds() < deadline)
+	{
+		YieldProcessor();
+	}
+}
+
+/// @brief Give up the CPU for roughly the requested time
+/// @param microseconds
+static void _timerSleep(uint64_t microseconds)
+{
+	if (s_Timer.waitable != NULL)
+	{
+		// negative due time is relative, in 100ns units
+		LARGE_INTEGER due;
+		due.QuadPart = -(LONGLONG)(microseconds * 10);
+		if (SetWaitableTimer(s_Timer.waitable, &due, 0, NULL, NULL, FALSE))
+		{
+			WaitForSingleObject(s_Timer.waitable, INFINITE);
+			return;
+		}
+	}
+
+	Sleep((DWORD)(microseconds / 1000));
+}
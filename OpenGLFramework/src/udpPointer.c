@@ -0,0 +1,134 @@
+#include <winsock2.h>
+#include <Windows.h>
+#include <stdio.h>
+#include "baseTypes.h"
+#include "udpPointer.h"
+#include "timer.h"
+#include "profile.h"
+
+// A pointer backend fed over UDP on the loopback address, standing in for a light gun or a
+// wii remote bridge. Each datagram is one sample in text, "x y buttons", with x and y
+// normalized to 0..1 across the window (the IR camera's view) and buttons one bit per
+// InputButton. Anything a bridge like GlovePIE can send, and easy to drive by hand
+
+#define UDP_POINTER_MAX_DATAGRAM 128
+
+static struct udp_pointer_t {
+	SOCKET			socket;
+	HANDLE			thread;
+	Coord2D			size;
+	uint32_t		malformed;
+} _udpPointer = { INVALID_SOCKET, NULL };
+
+static bool _udpPointerStart(const void* config);
+static void _udpPointerStop();
+static DWORD WINAPI _udpPointerThread(LPVOID param);
+
+static const InputPointerBackend _udpPointerBackend = {
+	"udp",
+	_udpPointerStart,
+	_udpPointerStop,
+	NULL
+};
+
+/// @brief The UDP pointer backend, for inputPointerStart with a UdpPointerConfig
+/// @return
+const InputPointerBackend* udpPointerGetBackend()
+{
+	return &_udpPointerBackend;
+}
+
+/// @brief Bind the socket and start reading it
+/// @param config UdpPointerConfig
+/// @return false if the port couldn't be bound
+static bool _udpPointerStart(const void* config)
+{
+	const UdpPointerConfig* udp = (const UdpPointerConfig*)config;
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+		return false;
+
+	_udpPointer.size = udp->size;
+	_udpPointer.malformed = 0;
+	_udpPointer.socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (_udpPointer.socket == INVALID_SOCKET)
+	{
+		WSACleanup();
+		return false;
+	}
+
+	struct sockaddr_in address;
+	ZeroMemory(&address, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(udp->port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(_udpPointer.socket, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR)
+	{
+		printf("input: can't listen for pointer samples on port %u\n", udp->port);
+		closesocket(_udpPointer.socket);
+		_udpPointer.socket = INVALID_SOCKET;
+		WSACleanup();
+		return false;
+	}
+
+	_udpPointer.thread = CreateThread(NULL, 0, _udpPointerThread, NULL, 0, NULL);
+	if (_udpPointer.thread == NULL)
+	{
+		closesocket(_udpPointer.socket);
+		_udpPointer.socket = INVALID_SOCKET;
+		WSACleanup();
+		return false;
+	}
+	printf("input: listening for pointer samples on 127.0.0.1:%u\n", udp->port);
+	return true;
+}
+
+/// @brief Close the socket, which wakes the thread out of its receive, and wait for it
+static void _udpPointerStop()
+{
+	closesocket(_udpPointer.socket);
+	WaitForSingleObject(_udpPointer.thread, INFINITE);
+	CloseHandle(_udpPointer.thread);
+	_udpPointer.thread = NULL;
+	_udpPointer.socket = INVALID_SOCKET;
+	WSACleanup();
+
+	if (_udpPointer.malformed > 0)
+	{
+		printf("input: %u pointer datagrams couldn't be read\n", _udpPointer.malformed);
+	}
+}
+
+/// @brief Receive samples until the socket closes, stamping each as it arrives
+/// @param param
+/// @return
+static DWORD WINAPI _udpPointerThread(LPVOID param)
+{
+	char datagram[UDP_POINTER_MAX_DATAGRAM + 1];
+
+	PROFILE_THREAD("pointer");
+	for (;;)
+	{
+		int32_t length = recv(_udpPointer.socket, datagram, UDP_POINTER_MAX_DATAGRAM, 0);
+		uint64_t now = timerNowNanoseconds();
+		if (length == SOCKET_ERROR)
+		{
+			// a sender that went away shows up as a reset, anything else is the socket closing
+			if (WSAGetLastError() == WSAECONNRESET)
+				continue;
+			break;
+		}
+		datagram[length] = '\0';
+
+		float x, y;
+		uint32_t buttons;
+		if (sscanf(datagram, "%f %f %u", &x, &y, &buttons) != 3)
+		{
+			_udpPointer.malformed++;
+			continue;
+		}
+		Coord2D position = { x * _udpPointer.size.x, y * _udpPointer.size.y };
+		inputPointerSample(position, buttons, now);
+	}
+	return 0;
+}
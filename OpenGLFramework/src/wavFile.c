@@ -0,0 +1,109 @@
+#include <Windows.h>
+#include <string.h>
+#include "wavFile.h"
+
+// WAV files are mapped rather than read, and the chunk table is walked once in memory. The
+// samples are used where they lie in the mapping, so a clip costs no heap and its pages are
+// shared with the file cache and only brought in as they're played
+
+#define WAV_HEADER_BYTES 12         // "RIFF", size, "WAVE"
+#define WAV_CHUNK_HEADER_BYTES 8    // id, size
+#define WAV_FORMAT_MIN_BYTES 16     // a WAVEFORMAT with wBitsPerSample
+
+static uint32_t _wavRead32(const uint8_t* bytes);
+
+/**
+ * @brief Map a WAV file and find its format and samples
+ * @param filename 
+ * @param wav filled in, and zeroed on failure
+ * @return false if the file can't be mapped or isn't a WAV with a format and data
+*/
+bool wavOpen(const char* filename, WavFile* wav) {
+    ZeroMemory(wav, sizeof(WavFile));
+
+    HANDLE file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD size = GetFileSize(file, NULL);
+    if (size == INVALID_FILE_SIZE || size < WAV_HEADER_BYTES) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+    const uint8_t* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    wav->file = file;
+    wav->mapping = mapping;
+    wav->view = view;
+
+    if (memcmp(view, "RIFF", 4) != 0 || memcmp(view + 8, "WAVE", 4) != 0) {
+        wavClose(wav);
+        return false;
+    }
+
+    // trust the RIFF size only as far as the file goes
+    uint32_t end = _wavRead32(view + 4) + 8;
+    if (end > size || end < WAV_HEADER_BYTES)
+        end = size;
+
+    uint32_t offset = WAV_HEADER_BYTES;
+    while (offset + WAV_CHUNK_HEADER_BYTES <= end)
+    {
+        const uint8_t* chunk = view + offset;
+        uint32_t chunkBytes = _wavRead32(chunk + 4);
+        uint32_t dataOffset = offset + WAV_CHUNK_HEADER_BYTES;
+        if (chunkBytes > end - dataOffset)
+            break;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunkBytes >= WAV_FORMAT_MIN_BYTES) {
+            wav->format = view + dataOffset;
+            wav->formatBytes = chunkBytes;
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            wav->samples = view + dataOffset;
+            wav->sampleBytes = chunkBytes;
+        }
+        if (wav->format != NULL && wav->samples != NULL)
+            return true;
+
+        // chunks are padded to an even size
+        offset = dataOffset + chunkBytes + (chunkBytes & 1);
+    }
+
+    wavClose(wav);
+    return false;
+}
+
+/**
+ * @brief Unmap the file. The format and samples can't be used after this
+ * @param wav 
+*/
+void wavClose(WavFile* wav) {
+    if (wav->view != NULL)
+        UnmapViewOfFile(wav->view);
+    if (wav->mapping != NULL)
+        CloseHandle(wav->mapping);
+    if (wav->file != NULL)
+        CloseHandle(wav->file);
+    ZeroMemory(wav, sizeof(WavFile));
+}
+
+/**
+ * @brief A little-endian 32-bit value, wherever it's aligned
+ * @param bytes 
+ * @return 
+*/
+static uint32_t _wavRead32(const uint8_t* bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}